@@ -0,0 +1,72 @@
+/*
+  deserializeJson() with and without ARDUINOJSON_ENABLE_BULK_SCAN in one
+  program. The option is part of the namespace name, so bulk_scan_on.cpp and
+  bulk_scan_off.cpp each include ArduinoJson with their own setting.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+struct ScanResult {
+  std::string error;
+  std::string json;
+  size_t memory;
+
+  bool operator==(const ScanResult & other) const {
+    return error == other.error && json == other.json && memory == other.memory;
+  }
+};
+
+enum ScanInput {
+  SCAN_POINTER,    // const char * and length
+  SCAN_STD_STRING,
+  SCAN_IN_PLACE,   // char * and length, strings are moved, not copied
+};
+
+ScanResult parseWithScan(const std::string & in, ScanInput input);
+ScanResult parseWithoutScan(const std::string & in, ScanInput input);
+
+// Parses every record of a JSON lines buffer into one document, returns how many parsed
+size_t parseRecordsWithScan(const char * data, size_t len);
+size_t parseRecordsWithoutScan(const char * data, size_t len);
+
+#ifdef BULK_SCAN_PARSE
+#include <ArduinoJson.h>
+
+#include <string.h>
+#include <vector>
+
+ScanResult BULK_SCAN_PARSE(const std::string & in, ScanInput input){
+  DynamicJsonDocument doc(4096);
+  std::vector<char> copy(in.begin(), in.end());
+  DeserializationError err;
+  if(input == SCAN_POINTER){
+    err = deserializeJson(doc, in.data(), in.size());
+  } else if(input == SCAN_STD_STRING){
+    err = deserializeJson(doc, in);
+  } else {
+    err = deserializeJson(doc, copy.data(), copy.size());
+  }
+  ScanResult result;
+  result.error = err.c_str();
+  serializeJson(doc, result.json);
+  result.memory = doc.memoryUsage();
+  return result;
+}
+
+size_t BULK_SCAN_RECORDS(const char * data, size_t len){
+  DynamicJsonDocument doc(2048);
+  size_t parsed = 0;
+  const char * end = data + len;
+  while(data < end){
+    const char * eol = (const char *)memchr(data, '\n', end - data);
+    if(!eol){
+      eol = end;
+    }
+    parsed += deserializeJson(doc, data, eol - data) == DeserializationError::Ok;
+    data = eol + 1;
+  }
+  return parsed;
+}
+#endif
@@ -0,0 +1,39 @@
+/*
+  An 8 MB JSON lines history export, one reading per line and a pretty-printed
+  layout every 100 lines, parsed one record at a time with the bulk scan and
+  without it.
+*/
+#include "test.h"
+#include "bulk_scan.h"
+
+#include <stdio.h>
+
+int main(){
+  std::string file;
+  char line[512];
+  unsigned s = 1;
+  for(int i = 0; file.size() < (8u << 20); i++){
+    s = s * 1103515245u + 12345u;
+    snprintf(line, sizeof(line), "{\"time\":\"2024-05-%02d %02d:%02d:%02d\",\"device\":\"higrow-24:0A:C4:00:11:22\","
+      "\"temp\":%d.%d,\"hum\":%u,\"lux\":%u,\"soil\":%u,\"salt\":%u,\"batt\":%u,"
+      "\"note\":\"periodic reading from the greenhouse sensor, nothing to report\"}\n",
+      i % 28 + 1, i % 24, i % 60, (i * 7) % 60, 20 + (int)(s % 10), (int)(s >> 8) % 10,
+      (s >> 4) % 100, (s >> 3) % 2000, (s >> 5) % 100, (s >> 6) % 50, 3500 + (s >> 7) % 700);
+    file += line;
+    if(i % 100 == 0){
+      // On one line, records are split at newlines
+      file += "{ \"response\": \"getLayout\", \"cards\": [\n"
+        "    { \"id\": \"temp\", \"card_type\": \"temperature\", \"name\": \"BME Temperature/C\", \"value\": 23 },"
+        "    { \"id\": \"soil\", \"card_type\": \"humidity\", \"name\": \"Soil\", \"value\": 37 } ] }\n";
+    }
+  }
+
+  size_t with = 0, without = 0;
+  double scan = benchNanos(5, [&]{ with = parseRecordsWithScan(file.data(), file.size()); });
+  double noScan = benchNanos(5, [&]{ without = parseRecordsWithoutScan(file.data(), file.size()); });
+  CHECK_EQ(with, without);
+  printf("%zu records, %.1f MB\n", with, file.size() / 1e6);
+  printf("char at a time  %5.0f MB/s\n", file.size() / noScan * 1e3);
+  printf("bulk scan       %5.0f MB/s\n", file.size() / scan * 1e3);
+  return testResult();
+}
@@ -0,0 +1,4 @@
+#define ARDUINOJSON_ENABLE_BULK_SCAN 0
+#define BULK_SCAN_PARSE parseWithoutScan
+#define BULK_SCAN_RECORDS parseRecordsWithoutScan
+#include "bulk_scan.h"
@@ -0,0 +1,4 @@
+#define ARDUINOJSON_ENABLE_BULK_SCAN 1
+#define BULK_SCAN_PARSE parseWithScan
+#define BULK_SCAN_RECORDS parseRecordsWithScan
+#include "bulk_scan.h"
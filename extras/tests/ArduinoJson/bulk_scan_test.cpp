@@ -0,0 +1,91 @@
+/*
+  The bulk scan of spaces and strings gives the same result as reading a char
+  at a time: random documents with comments, long runs of spaces, escapes and
+  both quotes, whole, truncated and with an embedded NUL, from a pointer, a
+  std::string and in place.
+*/
+#include "test.h"
+#include "bulk_scan.h"
+
+#include <stdio.h>
+
+static unsigned seed = 12345;
+
+static unsigned rnd(){
+  seed = seed * 1103515245u + 12345u;
+  return seed >> 8;
+}
+
+static std::string space(){
+  static const std::string spaces[] = { "", " ", "\n  ", "\t", "   \r\n        ", "/*c*/", " // line\n ", std::string(40, ' ') };
+  return spaces[rnd() % 8];
+}
+
+static std::string quoted(){
+  char quote = rnd() % 5 == 0 ? '\'' : '"';
+  std::string s(1, quote);
+  int n = rnd() % 60;
+  for(int i = 0; i < n; i++){
+    switch(rnd() % 30){
+      case 0: s += "\\n"; break;
+      case 1: s += quote == '"' ? "\\\"" : "\\'"; break;
+      case 2: s += "\\\\"; break;
+      case 3: s += quote == '"' ? '\'' : '"'; break;
+      default: s += (char)('a' + rnd() % 26);
+    }
+  }
+  return s + quote;
+}
+
+static std::string document(int depth){
+  switch(depth > 3 ? rnd() % 3 : rnd() % 5){
+    case 0: return quoted();
+    case 1: return std::to_string((int)(rnd() % 100000) - 500);
+    case 2: return rnd() % 2 ? "true" : "null";
+    case 3: {
+      std::string r = "[" + space();
+      int n = rnd() % 6;
+      for(int i = 0; i < n; i++){
+        r += (i ? space() + "," + space() : "") + document(depth + 1);
+      }
+      return r + space() + "]";
+    }
+    default: {
+      std::string r = "{" + space();
+      int n = rnd() % 6;
+      for(int i = 0; i < n; i++){
+        r += (i ? space() + "," + space() : "") + (rnd() % 6 ? quoted() : "bare_key");
+        r += space() + ":" + space() + document(depth + 1);
+      }
+      return r + space() + "}";
+    }
+  }
+}
+
+int main(){
+  const ScanInput inputs[] = { SCAN_POINTER, SCAN_STD_STRING, SCAN_IN_PLACE };
+  size_t checks = 0;
+  for(int i = 0; i < 3000; i++){
+    std::string doc = document(0);
+    std::string nul = doc;
+    if(nul.size() > 3){
+      nul[nul.size() / 3] = '\0';
+    }
+    const std::string variants[] = { doc, doc.substr(0, doc.size() / 2), doc.substr(0, doc.size() ? doc.size() - 1 : 0), nul };
+    for(const std::string & in : variants){
+      for(ScanInput input : inputs){
+        ScanResult expected = parseWithoutScan(in, input);
+        ScanResult got = parseWithScan(in, input);
+        checks++;
+        if(!(got == expected)){
+          fprintf(stderr, "input %d of %s: %s %s (%zu) != %s %s (%zu)\n", (int)input, in.substr(0, 60).c_str(),
+            got.error.c_str(), got.json.substr(0, 60).c_str(), got.memory,
+            expected.error.c_str(), expected.json.substr(0, 60).c_str(), expected.memory);
+          testFailures++;
+        }
+      }
+    }
+  }
+  printf("%zu documents parsed both ways\n", checks);
+  return testResult();
+}
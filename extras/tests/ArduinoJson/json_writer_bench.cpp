@@ -0,0 +1,193 @@
+/*
+  ESP-DASH's messages built as a JsonDocument and serialized, against written
+  straight out with makeJsonWriter(): the layout of the HiGrow card set
+  (10 cards, statistics on) and a number card update sent over the websocket.
+  Checks that both give the same bytes, in JSON and in MsgPack.
+*/
+#include "test.h"
+#include <ArduinoJson.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+struct Card {
+  const char * id;
+  const char * type;
+  const char * name;
+  int value;
+};
+
+static const Card higrow[] = {
+  { "temp", "temperature", "BME Temperature/C", 23 },
+  { "press", "number", "BME Pressure/hPa", 1013 },
+  { "alt", "number", "BME Altitude/m", 120 },
+  { "temp2", "temperature", "DHT Temperature/C", 22 },
+  { "hum2", "humidity", "DHT Humidity/%", 45 },
+  { "lux", "number", "BH1750/lx", 812 },
+  { "soil", "humidity", "Soil", 37 },
+  { "salt", "number", "Salt", 12 },
+  { "batt", "number", "Battery/mV", 4012 },
+  { "temp3", "temperature", "18B20 Temperature/C", 21 },
+};
+static const int CARDS = sizeof(higrow) / sizeof(higrow[0]);
+
+// Card ids and names are Strings in ESP-DASH, they are copied into a document
+static std::string ids[CARDS], names[CARDS];
+
+static bool isTemperature(int i){
+  return !strcmp(higrow[i].type, "temperature");
+}
+
+// Like generateLayoutResponse() before the writer
+static void layoutDocument(JsonDocument & doc){
+  JsonObject root = doc.to<JsonObject>();
+  root["response"] = "getLayout";
+  root["version"] = "1";
+  root["size"] = 1234;
+  JsonObject stats = root.createNestedObject("statistics");
+  stats["enabled"] = true;
+  stats["hardware"] = "ESP32";
+  stats["chipId"] = (unsigned long)0x12345678;
+  stats["sketchHash"] = std::string("0123456789abcdef0123456789abcdef");
+  stats["macAddress"] = std::string("24:0A:C4:00:11:22");
+  stats["freeHeap"] = 201344u;
+  stats["wifiMode"] = 1;
+  JsonArray cards = root.createNestedArray("cards");
+  for(int i = 0; i < CARDS; i++){
+    DynamicJsonDocument carddoc(250);
+    JsonObject card = carddoc.to<JsonObject>();
+    card["id"] = ids[i];
+    card["card_type"] = higrow[i].type;
+    card["name"] = names[i];
+    if(isTemperature(i)){
+      card["value_type"] = 0;
+    }
+    card["value"] = higrow[i].value;
+    cards.add(card);
+  }
+}
+
+// The same with a writer, MsgPack needs the member counts upfront
+template<typename TWriter>
+static void layoutWriter(TWriter & json){
+  json.beginObject(5);
+  json.member("response", "getLayout");
+  json.member("version", "1");
+  json.member("size", 1234);
+  json.key("statistics").beginObject(7);
+  json.member("enabled", true);
+  json.member("hardware", "ESP32");
+  json.member("chipId", (unsigned long)0x12345678);
+  json.member("sketchHash", std::string("0123456789abcdef0123456789abcdef"));
+  json.member("macAddress", std::string("24:0A:C4:00:11:22"));
+  json.member("freeHeap", 201344u);
+  json.member("wifiMode", 1);
+  json.endObject();
+  json.key("cards").beginArray(CARDS);
+  for(int i = 0; i < CARDS; i++){
+    json.beginObject(isTemperature(i) ? 5 : 4);
+    json.member("id", ids[i]);
+    json.member("card_type", higrow[i].type);
+    json.member("name", names[i]);
+    if(isTemperature(i)){
+      json.member("value_type", 0);
+    }
+    json.member("value", higrow[i].value);
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+}
+
+static char wsBuffer[256];
+
+// A card update into a buffer of its exact size, as AsyncWebSocket::makeBuffer() would give
+static size_t updateDocument(int i){
+  DynamicJsonDocument doc(250);
+  JsonObject obj = doc.to<JsonObject>();
+  obj["response"] = "updateNumberCard";
+  obj["id"] = ids[i];
+  obj["value"] = higrow[i].value;
+  size_t len = measureJson(doc);
+  char * buffer = (char *)malloc(len + 1);
+  serializeJson(doc, buffer, len + 1);
+  memcpy(wsBuffer, buffer, len + 1);
+  free(buffer);
+  return len;
+}
+
+template<typename TWriter>
+static void writeUpdate(TWriter & json, int i){
+  json.beginObject();
+  json.member("response", "updateNumberCard");
+  json.member("id", ids[i]);
+  json.member("value", higrow[i].value);
+  json.endObject();
+}
+
+static size_t updateWriter(int i){
+  auto measure = makeJsonWriter();
+  writeUpdate(measure, i);
+  size_t len = measure.bytesWritten();
+  char * buffer = (char *)malloc(len + 1);
+  auto json = makeJsonWriter(buffer, len + 1);
+  writeUpdate(json, i);
+  memcpy(wsBuffer, buffer, len + 1);
+  free(buffer);
+  return len;
+}
+
+int main(){
+  for(int i = 0; i < CARDS; i++){
+    ids[i] = higrow[i].id;
+    names[i] = higrow[i].name;
+  }
+
+  // Same bytes either way
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(13) + CARDS * JSON_OBJECT_SIZE(5) + 1000);
+  layoutDocument(doc);
+  std::string fromDocument, fromWriter;
+  serializeJson(doc, fromDocument);
+  auto json = makeJsonWriter(fromWriter);
+  layoutWriter(json);
+  CHECK_EQ(fromWriter, fromDocument);
+  auto measure = makeJsonWriter();
+  layoutWriter(measure);
+  CHECK_EQ(measure.bytesWritten(), fromDocument.size());
+
+  std::string packedDocument, packedWriter;
+  serializeMsgPack(doc, packedDocument);
+  auto msgpack = makeMsgPackWriter(packedWriter);
+  layoutWriter(msgpack);
+  CHECK(packedWriter == packedDocument);
+
+  for(int i = 0; i < CARDS; i++){
+    size_t len = updateDocument(i);
+    std::string expected(wsBuffer);
+    CHECK_EQ(updateWriter(i), len);
+    CHECK_EQ(std::string(wsBuffer), expected);
+  }
+
+  volatile size_t sink = 0;
+  double layoutDoc = benchNanos(200000, [&]{
+    DynamicJsonDocument d(JSON_OBJECT_SIZE(13) + CARDS * JSON_OBJECT_SIZE(5) + 1000);
+    layoutDocument(d);
+    std::string out;
+    serializeJson(d, out);
+    sink = out.size();
+  });
+  double layoutWrite = benchNanos(200000, [&]{
+    std::string out;
+    auto w = makeJsonWriter(out);
+    layoutWriter(w);
+    sink = out.size();
+  });
+  int card = 0;
+  double updateDoc = benchNanos(2000000, [&]{ sink = updateDocument(card++ % CARDS); });
+  double updateWrite = benchNanos(2000000, [&]{ sink = updateWriter(card++ % CARDS); });
+  printf("layout, %zu B      document %7.0f ns, writer %7.0f ns\n", fromDocument.size(), layoutDoc, layoutWrite);
+  printf("number card update  document %7.0f ns, writer %7.0f ns\n", updateDoc, updateWrite);
+  (void)sink;
+  return testResult();
+}
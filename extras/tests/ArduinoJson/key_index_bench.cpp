@@ -0,0 +1,37 @@
+/*
+  obj["key"] on objects of 8, 64 and 512 members. Built once with the key
+  index and once without, ARDUINOJSON_ENABLE_KEY_INDEX comes from the target.
+*/
+#include "test.h"
+#include <ArduinoJson.h>
+
+#include <string>
+#include <vector>
+
+int main(){
+  printf("key index %s\n", ARDUINOJSON_ENABLE_KEY_INDEX ? "on" : "off");
+  for(int n : { 8, 64, 512 }){
+    std::vector<std::string> keys;
+    for(int i = 0; i < n; i++){
+      keys.push_back("card" + std::to_string(i) + "_value");
+    }
+    DynamicJsonDocument doc(200000);
+    JsonObject obj = doc.to<JsonObject>();
+    for(int i = 0; i < n; i++){
+      obj[keys[i]] = i;
+    }
+    for(int i = 0; i < n; i++){
+      CHECK_EQ(obj[keys[i].c_str()].as<int>(), i);
+    }
+    CHECK(obj["missing"].isNull());
+
+    long sum = 0;
+    int i = 0;
+    double ns = benchNanos(2000000, [&]{
+      sum += obj[keys[i].c_str()].as<int>();
+      i = (i + 7) % n;
+    });
+    printf("%4d members  %7.1f ns/lookup  pool %6zu B (%ld)\n", n, ns, doc.memoryUsage(), sum % 7);
+  }
+  return testResult();
+}
@@ -0,0 +1,162 @@
+/*
+  Key lookups on objects large enough to get a key index, checked against a
+  plain list of what the object holds after every add, remove and clear.
+  Built once with ARDUINOJSON_ENABLE_KEY_INDEX and once without, both must
+  find the same members: none that were removed or cleared, every one added
+  since the index was built, and the first of duplicate keys.
+*/
+#include "test.h"
+#include <ArduinoJson.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<std::string, int> > Members;
+
+static std::string key(int i){
+  return "card" + std::to_string(i) + "_value";
+}
+
+static const int * find(const Members & members, const std::string & k){
+  for(const auto & m : members){
+    if(m.first == k){
+      return &m.second;
+    }
+  }
+  return NULL;
+}
+
+// Every key ever used and a few never used, through JsonObject and JsonObjectConst
+static bool matches(JsonObject obj, const Members & members, int keys){
+  bool ok = obj.size() == members.size();
+  JsonObjectConst constObj = obj;
+  for(int i = -3; i < keys; i++){
+    std::string k = i < 0 ? "missing" + std::to_string(i) : key(i);
+    const int * expected = find(members, k);
+    JsonVariant v = obj[k.c_str()];
+    JsonVariantConst cv = constObj[k.c_str()];
+    bool found = expected ? (v.is<int>() && v.as<int>() == *expected && cv.as<int>() == *expected)
+                          : (v.isNull() && cv.isNull() && !obj.containsKey(k));
+    if(!found){
+      fprintf(stderr, "%s: expected %d\n", k.c_str(), expected ? *expected : -1);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static void add(JsonObject obj, Members & members, int i, int value){
+  obj[key(i)] = value;
+  members.push_back(std::make_pair(key(i), value));
+}
+
+static void remove(JsonObject obj, Members & members, int i){
+  obj.remove(key(i));
+  for(auto it = members.begin(); it != members.end(); ++it){
+    if(it->first == key(i)){
+      members.erase(it);
+      break;
+    }
+  }
+}
+
+int main(){
+  // Parsed without a lookup, the first one past the threshold builds the index in the pool
+  DynamicJsonDocument doc(200000);
+  Members members;
+  std::string json = "{";
+  for(int i = 0; i < 64; i++){
+    json += "\"" + key(i) + "\":" + std::to_string(i) + ",";
+    members.push_back(std::make_pair(key(i), i));
+  }
+  json.back() = '}';
+  CHECK(deserializeJson(doc, json) == DeserializationError::Ok);
+  JsonObject obj = doc.as<JsonObject>();
+  size_t before = doc.memoryUsage();
+  CHECK(matches(obj, members, 64));
+  CHECK_EQ(doc.memoryUsage() > before, ARDUINOJSON_ENABLE_KEY_INDEX == 1);
+
+  // Adds go into the index while it has room, and past it
+  for(int i = 64; i < 300; i++){
+    add(obj, members, i, i);
+    if(i % 37 == 0){
+      CHECK(matches(obj, members, 300));
+    }
+  }
+  CHECK(matches(obj, members, 300));
+
+  // Removed members are gone, from the front, the middle and the back
+  for(int i : { 0, 1, 150, 151, 298, 299 }){
+    remove(obj, members, i);
+    CHECK(matches(obj, members, 300));
+  }
+  // a member removed through an iterator too
+  for(JsonObject::iterator it = obj.begin(); it != obj.end(); ++it){
+    if(it->key() == key(200).c_str()){
+      obj.remove(it);
+      break;
+    }
+  }
+  remove(obj, members, 200);
+  CHECK(matches(obj, members, 300));
+  // and a removed key added again has its new value
+  add(obj, members, 150, 1500);
+  add(obj, members, 0, 1000);
+  CHECK(matches(obj, members, 300));
+
+  // Setting an existing member changes it in place
+  obj[key(10)] = 100;
+  for(auto & m : members){
+    if(m.first == key(10)){
+      m.second = 100;
+    }
+  }
+  CHECK(matches(obj, members, 300));
+
+  // Nothing is left after clear(), what is added afterwards is found
+  obj.clear();
+  members.clear();
+  CHECK(matches(obj, members, 300));
+  for(int i = 100; i < 140; i++){
+    add(obj, members, i, -i);
+  }
+  CHECK(matches(obj, members, 300));
+
+  // A nested object keeps its own index, the parent changing does not touch it
+  JsonObject nested = obj.createNestedObject("nested");
+  Members inner;
+  for(int i = 0; i < 40; i++){
+    add(nested, inner, i, 2 * i);
+  }
+  CHECK(matches(nested, inner, 40));
+  remove(obj, members, 100);
+  add(obj, members, 500, 500);
+  CHECK(matches(nested, inner, 40));
+  remove(nested, inner, 5);
+  CHECK(matches(nested, inner, 40));
+
+  // The document starting over drops the index with everything else
+  obj = doc.to<JsonObject>();
+  members.clear();
+  for(int i = 0; i < 20; i++){
+    add(obj, members, i, i + 7);
+  }
+  CHECK(matches(obj, members, 300));
+
+  // Duplicate keys from the parser: the first one wins, with the index or without
+  json = "{";
+  for(int i = 0; i < 40; i++){
+    json += "\"" + key(i % 30) + "\":" + std::to_string(i) + ",";
+  }
+  json.back() = '}';
+  CHECK(deserializeJson(doc, json) == DeserializationError::Ok);
+  obj = doc.as<JsonObject>();
+  CHECK_EQ(obj.size(), (size_t)40);
+  for(int i = 0; i < 30; i++){
+    CHECK_EQ(obj[key(i).c_str()].as<int>(), i);
+  }
+  CHECK(obj[key(35).c_str()].isNull());
+
+  return testResult();
+}
@@ -0,0 +1,31 @@
+/*
+  serializeJson() per value for small integers, 32-bit integers and floats.
+  Built once with ARDUINOJSON_ENABLE_FAST_INTEGERS and
+  ARDUINOJSON_ENABLE_SHORTEST_FLOATS and once with the default formatting,
+  both macros come from the target.
+*/
+#define ARDUINOJSON_USE_DOUBLE 0
+#include "test.h"
+#include <ArduinoJson.h>
+
+#include <random>
+
+int main(){
+  printf("fast integers %s, shortest floats %s\n",
+         ARDUINOJSON_ENABLE_FAST_INTEGERS ? "on" : "off", ARDUINOJSON_ENABLE_SHORTEST_FLOATS ? "on" : "off");
+  std::mt19937_64 rng(46);
+  DynamicJsonDocument small(200000), wide(200000), floats(200000);
+  for(int i = 0; i < 4096; i++){
+    small.add((int)(rng() % 1000));
+    wide.add((uint32_t)rng());
+    floats.add((float)(rng() % 100000) / 100.0f + (float)(rng() % 7) * 0.001f);
+  }
+  static char out[200000];
+  const char * names[] = { "small ints", "32-bit ints", "floats" };
+  DynamicJsonDocument * docs[] = { &small, &wide, &floats };
+  for(int i = 0; i < 3; i++){
+    double ns = benchNanos(200, [&]{ serializeJson(*docs[i], out, sizeof(out)); });
+    printf("%-12s %5.1f ns/value\n", names[i], ns / 4096);
+  }
+  return testResult();
+}
@@ -0,0 +1,177 @@
+/*
+  The number formatting against printf: with ARDUINOJSON_ENABLE_FAST_INTEGERS
+  integers are written exactly like "%llu" and "%lld". With
+  ARDUINOJSON_ENABLE_SHORTEST_FLOATS floats get the digits of the shortest
+  "%.*e" that reads back, and every serialized float reads back with strtof,
+  without it they keep the default formatting. Both macros come from the
+  target. Run with "all" to also round trip every non-negative float bit
+  pattern (2^31).
+*/
+#define ARDUINOJSON_USE_DOUBLE 0
+#include "test.h"
+#include <ArduinoJson.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ARDUINOJSON_NAMESPACE;
+
+static std::string serialized(float value){
+  StaticJsonDocument<64> doc;
+  doc.set(value);
+  std::string out;
+  serializeJson(doc, out);
+  return out;
+}
+
+template<typename T>
+static std::string serializedInteger(T value){
+  StaticJsonDocument<64> doc;
+  doc.set(value);
+  std::string out;
+  serializeJson(doc, out);
+  return out;
+}
+
+#if ARDUINOJSON_ENABLE_SHORTEST_FLOATS
+static float fromBits(uint32_t bits){
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+// Digits and exponent of the first digit of the shortest "%.*e" that reads back
+static void shortestPrintf(float f, std::string & digits, int & exponent){
+  char buf[40];
+  for(int precision = 0; precision < 9; precision++){
+    snprintf(buf, sizeof(buf), "%.*e", precision, f);
+    if(strtof(buf, NULL) == f){
+      break;
+    }
+  }
+  digits.clear();
+  for(const char * c = buf; *c && *c != 'e'; c++){
+    if(*c != '.'){
+      digits += *c;
+    }
+  }
+  exponent = atoi(strchr(buf, 'e') + 1);
+}
+
+static long roundTrip(uint32_t from, uint32_t to){
+  long bad = 0;
+  char buf[40];
+  for(uint64_t bits = from; bits < to; bits++){
+    float f = fromBits((uint32_t)bits);
+    if(!isfinite(f)){
+      continue;
+    }
+    ShortestFloat s(f);
+    snprintf(buf, sizeof(buf), "%ue%d", s.mantissa, s.exponent);
+    bad += strtof(buf, NULL) != f;
+  }
+  return bad;
+}
+#endif
+
+int main(int argc, char ** argv){
+  std::mt19937_64 rng(46);
+  char expected[40];
+
+  // Integers: the first 200000, random widths and the top of the range, and their negatives
+  long integerMismatches = 0;
+  for(uint64_t i = 0; i < 600000; i++){
+    uint64_t v = i < 200000 ? i : i < 400000 ? rng() >> (rng() % 64) : UINT64_MAX - (i - 400000);
+    snprintf(expected, sizeof(expected), "%llu", (unsigned long long)v);
+    integerMismatches += serializedInteger(v) != expected;
+    int64_t n = -(int64_t)(v >> 1);
+    snprintf(expected, sizeof(expected), "%lld", (long long)n);
+    integerMismatches += serializedInteger(n) != expected;
+  }
+  snprintf(expected, sizeof(expected), "%lld", (long long)INT64_MIN);
+  integerMismatches += serializedInteger(INT64_MIN) != expected;
+  CHECK_EQ(integerMismatches, 0L);
+
+#if ARDUINOJSON_ENABLE_SHORTEST_FLOATS
+  // The digits of the shortest printf form that reads back
+  long digitMismatches = 0;
+  for(int i = 0; i < 200000; i++){
+    float f = fromBits((uint32_t)rng() & 0x7fffffff);
+    if(!isfinite(f) || f == 0){
+      continue;
+    }
+    std::string digits;
+    int exponent;
+    shortestPrintf(f, digits, exponent);
+    while(digits.size() > 1 && digits.back() == '0'){
+      digits.pop_back();
+    }
+    ShortestFloat s(f);
+    std::string got = std::to_string(s.mantissa);
+    int gotExponent = s.exponent + (int)got.size() - 1;
+    while(got.size() > 1 && got.back() == '0'){
+      got.pop_back();
+    }
+    if(got != digits || gotExponent != exponent){
+      if(digitMismatches++ < 5){
+        fprintf(stderr, "%.9g: %ue%d, printf %s\n", f, s.mantissa, s.exponent, digits.c_str());
+      }
+    }
+  }
+  CHECK_EQ(digitMismatches, 0L);
+
+  // Any float, negative ones too, reads back from the JSON
+  long textMismatches = 0;
+  for(int i = 0; i < 200000; i++){
+    float f = fromBits((uint32_t)rng());
+    if(!isfinite(f)){
+      continue;
+    }
+    std::string json = serialized(f);
+    if(strtof(json.c_str(), NULL) != f){
+      if(textMismatches++ < 5){
+        fprintf(stderr, "%.9g -> %s\n", f, json.c_str());
+      }
+    }
+  }
+  CHECK_EQ(textMismatches, 0L);
+
+  // Zero has no sign bit to trip over
+  ShortestFloat negativeZero(-0.0f);
+  CHECK_EQ(negativeZero.mantissa, 0u);
+  CHECK_EQ(negativeZero.exponent, 0);
+  CHECK_EQ(serialized(-0.0f), std::string("0"));
+  CHECK_EQ(serialized(0.0f), std::string("0"));
+  CHECK_EQ(serialized(1.0f), std::string("1"));
+  CHECK_EQ(serialized(-2.5f), std::string("-2.5"));
+  CHECK_EQ(serialized(0.1f), std::string("0.1"));
+  CHECK_EQ(serialized(3.14159274f), std::string("3.1415927"));
+  CHECK_EQ(serialized(123.456f), std::string("123.456"));
+  CHECK_EQ(serialized(1e7f), std::string("1e7"));
+  CHECK_EQ(serialized(1.2345678e7f), std::string("1.2345678e7"));
+  CHECK_EQ(serialized(1e-5f), std::string("1e-5"));
+  CHECK_EQ(serialized(1e-45f), std::string("1e-45"));
+  CHECK_EQ(serialized(3.4028235e38f), std::string("3.4028235e38"));
+  CHECK_EQ(serialized(NAN), std::string("NaN"));
+  CHECK_EQ(serialized(-INFINITY), std::string("-Infinity"));
+
+  if(argc > 1 && !strcmp(argv[1], "all")){
+    long bad = roundTrip(0, 0x80000000u);
+    printf("every float: %ld read back differently\n", bad);
+    CHECK_EQ(bad, 0L);
+  }
+#else
+  // Up to 6 decimal places, the way the library always wrote them
+  CHECK_EQ(serialized(0.0f), std::string("0"));
+  CHECK_EQ(serialized(-2.5f), std::string("-2.5"));
+  CHECK_EQ(serialized(123.456f), std::string("123.456"));
+  CHECK_EQ(serialized(3.14159274f), std::string("3.141593"));
+  CHECK_EQ(serialized(NAN), std::string("NaN"));
+#endif
+
+  return testResult();
+}
@@ -0,0 +1,124 @@
+/*
+  JsonPushDeserializer against deserializeJson(): every document of a corpus,
+  valid or not, is split at every byte offset and also fed a byte at a time,
+  and must give the same error, the same document and, when it parses, the
+  same memory usage.
+  Prints the throughput of both on a 2000 card layout.
+*/
+#include "test.h"
+#include <ArduinoJson.h>
+
+#include <string>
+#include <vector>
+
+using namespace ArduinoJson;
+
+struct Parsed {
+  std::string error;
+  std::string json;
+  size_t memory;
+
+  // deserializeJson() can leave an unfinished string holding the pool after an error, memory only counts when Ok
+  bool operator==(const Parsed & other) const {
+    return error == other.error && json == other.json && (error != "Ok" || memory == other.memory);
+  }
+};
+
+static Parsed parsed(DeserializationError err, const DynamicJsonDocument & doc){
+  Parsed p;
+  p.error = err.c_str();
+  serializeJson(doc, p.json);
+  p.memory = doc.memoryUsage();
+  return p;
+}
+
+static Parsed whole(const std::string & in){
+  DynamicJsonDocument doc(2048);
+  DeserializationError err = deserializeJson(doc, in.c_str());
+  return parsed(err, doc);
+}
+
+// Feeds in cut at the given offsets, in increasing order
+static Parsed pushed(const std::string & in, const std::vector<size_t> & cuts){
+  DynamicJsonDocument doc(2048);
+  JsonPushDeserializer parser(doc);
+  DeserializationError err = DeserializationError::NeedMoreInput;
+  size_t pos = 0;
+  for(size_t i = 0; i <= cuts.size() && err == DeserializationError::NeedMoreInput; i++){
+    size_t cut = i < cuts.size() ? cuts[i] : in.size();
+    err = parser.feed(in.data() + pos, cut - pos);
+    pos = cut;
+  }
+  if(err == DeserializationError::NeedMoreInput){
+    err = parser.end();
+  }
+  return parsed(err, doc);
+}
+
+int main(){
+  const std::vector<std::string> corpus = {
+    "{\"a\":1,\"b\":[true,false,null,1.5e3,-2],\"c\":{\"d\":\"x\\ny\\\"z\"}}",
+    "  [ 1 , 2 ,3 ]  ", "[]", "{}", "\"str\"", "'single'", "123", "-1.25", "true", "null",
+    "{a:1, b_c : 'x'}", "{'a':'b','c':[1,2,{'d':null}]}",
+    "/* c */ {\"a\": /* in */ 1 // line\n }", "{\"a\":\"\\u0041\"}",
+    "{\"k\":\"\\t\\r\\b\\f\\/\\\\\\q\"}", "[1,{\"a\":[{},[]]},\"\"]",
+    "[1e400, 12345678901234567890, 0x10]", "{\"x\":" + std::string(70, '1') + "}",
+    "[\"" + std::string(3000, 'x') + "\"]",
+    "[[[[[[[[[[1]]]]]]]]]]", "[[[[[[[[[[[1]]]]]]]]]]]",
+    "{\"a\":1}trailing", "[1 2]", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "{,}", "[,1]",
+    "nul", "tru", "[1 /x]", "/x", "[1]/", "// only comment", "/* unterminated",
+    "{\"a\":\"unterminated", "\"abc", "{\"a\"", "{\"a\":", "[true", "", "   ",
+    "{\"id\":\"t1\",\"card_type\":\"temperature\",\"name\":\"Soil\",\"value\":23}",
+    "[{\"name\":\"Soil\"},{\"name\":\"Soil\"},{\"name\":\"Air\"}]"
+  };
+
+  size_t checks = 0;
+  for(const std::string & in : corpus){
+    Parsed expected = whole(in);
+    for(size_t cut = 0; cut <= in.size(); cut++){
+      Parsed got = pushed(in, std::vector<size_t>(1, cut));
+      checks++;
+      if(!(got == expected)){
+        fprintf(stderr, "%s cut at %zu: %s %s (%zu) != %s %s (%zu)\n", in.substr(0, 40).c_str(), cut,
+          got.error.c_str(), got.json.substr(0, 40).c_str(), got.memory,
+          expected.error.c_str(), expected.json.substr(0, 40).c_str(), expected.memory);
+        testFailures++;
+      }
+    }
+    std::vector<size_t> bytes;
+    for(size_t i = 1; i < in.size(); i++){
+      bytes.push_back(i);
+    }
+    checks++;
+    if(!(pushed(in, bytes) == expected)){
+      fprintf(stderr, "%s a byte at a time differs\n", in.substr(0, 40).c_str());
+      testFailures++;
+    }
+  }
+  printf("%zu splits of %zu documents\n", checks, corpus.size());
+
+  // Throughput on a large layout, whole and in TCP segment and small chunks
+  std::string big = "[";
+  for(int i = 0; i < 2000; i++){
+    big += std::string(i ? "," : "") + "{\"id\":\"card" + std::to_string(i) +
+      "\",\"card_type\":\"temperature\",\"name\":\"Soil moisture\",\"value\":" + std::to_string(i * 7) +
+      ",\"f\":" + std::to_string(i * 0.25) + "}";
+  }
+  big += "]";
+  DynamicJsonDocument doc(1 << 20);
+  DeserializationError err;
+  double ns = benchNanos(50, [&]{ err = deserializeJson(doc, big.c_str()); });
+  CHECK(err == DeserializationError::Ok);
+  printf("deserializeJson      %7.1f MB/s\n", big.size() / ns * 1e3);
+  for(size_t chunk : { (size_t)1460, (size_t)64, (size_t)1 }){
+    ns = benchNanos(chunk == 1 ? 5 : 50, [&]{
+      JsonPushDeserializer parser(doc);
+      for(size_t pos = 0; pos < big.size(); pos += chunk){
+        err = parser.feed(big.data() + pos, std::min(chunk, big.size() - pos));
+      }
+    });
+    CHECK(err == DeserializationError::Ok);
+    printf("push, %4zu B chunks  %7.1f MB/s\n", chunk, big.size() / ns * 1e3);
+  }
+  return testResult();
+}
@@ -0,0 +1,58 @@
+/*
+  Sensor readings as JSON lines and as back to back MsgPack values, for the
+  batch decoders, and a consumer that reads each row into a struct.
+*/
+#pragma once
+
+#include <ArduinoJson.h>
+
+#include <stdio.h>
+#include <string>
+
+struct Reading {
+  unsigned long time;
+  float temp;
+  int hum, lux, soil, salt, batt;
+};
+
+// Reads every row into a Reading and keeps a checksum of them
+struct SumReadings {
+  double sum;
+  size_t count;
+
+  SumReadings() : sum(0), count(0) {}
+
+  bool operator()(JsonDocument & doc){
+    Reading r;
+    r.time = doc["time"];
+    r.temp = doc["temp"];
+    r.hum = doc["hum"];
+    r.lux = doc["lux"];
+    r.soil = doc["soil"];
+    r.salt = doc["salt"];
+    r.batt = doc["batt"];
+    sum += r.time + r.temp + r.hum + r.lux + r.soil + r.salt + r.batt;
+    count++;
+    return true;
+  }
+};
+
+// count records, with a few blank lines in the JSON
+static void makeReadings(size_t count, std::string & lines, std::string & msgpack){
+  lines.reserve(count * 90);
+  unsigned s = 1;
+  StaticJsonDocument<256> doc;
+  char line[256];
+  for(size_t i = 0; i < count; i++){
+    s = s * 1103515245u + 12345u;
+    int n = snprintf(line, sizeof(line), "{\"time\":%lu,\"temp\":%d.%d,\"hum\":%u,\"lux\":%u,\"soil\":%u,\"salt\":%u,\"batt\":%u}\n",
+      1700000000ul + (unsigned long)i * 60, 20 + (int)(s % 10), (int)(s >> 8) % 10,
+      (s >> 4) % 100, (s >> 3) % 2000, (s >> 5) % 100, (s >> 6) % 50, 3500 + (s >> 7) % 700);
+    lines.append(line, n);
+    if(i % 1000 == 0){
+      lines += "\r\n  \n";
+    }
+    deserializeJson(doc, line);
+    serializeMsgPack(doc, msgpack);
+  }
+}
@@ -0,0 +1,79 @@
+/*
+  10M sensor readings (or the count given as argument), each read into a
+  struct: a new document per line, deserializeJsonLines(),
+  deserializeJsonLinesParallel() and deserializeMsgPackStream(). The parallel
+  decoder runs one thread per core; on a single core it is deserializeJsonLines()
+  plus the cost of the thread and of locking the results.
+*/
+#include "test.h"
+#include "record_stream.h"
+
+#include <stdlib.h>
+#include <mutex>
+#include <thread>
+
+static double seconds(std::chrono::steady_clock::time_point start){
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char * name, const SumReadings & r, double s){
+  printf("%-40s %6.2f s  %5.2fM records/s  (%zu, %.0f)\n", name, s, r.count / s / 1e6, r.count, r.sum);
+}
+
+int main(int argc, char ** argv){
+  size_t records = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  std::string lines, msgpack;
+  makeReadings(records, lines, msgpack);
+  unsigned cores = std::thread::hardware_concurrency();
+  printf("%zu records, JSON lines %.0f MB, MsgPack %.0f MB, %u core(s)\n", records, lines.size() / 1e6, msgpack.size() / 1e6, cores);
+
+  {
+    SumReadings r;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t p = 0; p < lines.size();){
+      size_t eol = lines.find('\n', p);
+      if(eol == std::string::npos){
+        eol = lines.size();
+      }
+      if(eol - p > 2){
+        DynamicJsonDocument doc(512);
+        deserializeJson(doc, lines.data() + p, eol - p);
+        r(doc);
+      }
+      p = eol + 1;
+    }
+    report("new DynamicJsonDocument per line", r, seconds(start));
+  }
+  {
+    DynamicJsonDocument doc(512);
+    SumReadings r;
+    auto start = std::chrono::steady_clock::now();
+    CHECK(deserializeJsonLines(doc, lines.data(), lines.size(), std::ref(r)) == DeserializationError::Ok);
+    report("deserializeJsonLines", r, seconds(start));
+  }
+  {
+    unsigned threads = cores ? cores : 1;
+    std::mutex lock;
+    SumReadings r;
+    auto start = std::chrono::steady_clock::now();
+    CHECK(deserializeJsonLinesParallel(512, lines.data(), lines.size(), [&](JsonDocument & d){
+      SumReadings row;
+      row(d);
+      std::lock_guard<std::mutex> guard(lock);
+      r.sum += row.sum;
+      r.count++;
+      return true;
+    }, threads) == DeserializationError::Ok);
+    char name[64];
+    snprintf(name, sizeof(name), "deserializeJsonLinesParallel, %u thread%s", threads, threads > 1 ? "s" : "");
+    report(name, r, seconds(start));
+  }
+  {
+    DynamicJsonDocument doc(512);
+    SumReadings r;
+    auto start = std::chrono::steady_clock::now();
+    CHECK(deserializeMsgPackStream(doc, msgpack.data(), msgpack.size(), std::ref(r)) == DeserializationError::Ok);
+    report("deserializeMsgPackStream", r, seconds(start));
+  }
+  return testResult();
+}
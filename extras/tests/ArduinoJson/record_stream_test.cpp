@@ -0,0 +1,96 @@
+/*
+  deserializeJsonLines(), deserializeJsonLinesParallel() and
+  deserializeMsgPackStream() against deserializeJson() and
+  deserializeMsgPack() called once per record: the same rows from buffers and
+  istreams, blank lines, stopping early, a corrupt line, a truncated value and
+  1 to 8 threads.
+*/
+#include "test.h"
+#include "record_stream.h"
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+
+int main(){
+  const size_t records = 20000;
+  std::string lines, msgpack;
+  makeReadings(records, lines, msgpack);
+
+  // One call per line, what the decoders must match
+  SumReadings expected;
+  DynamicJsonDocument doc(512);
+  for(size_t p = 0; p < lines.size();){
+    size_t eol = lines.find('\n', p);
+    if(eol == std::string::npos){
+      eol = lines.size();
+    }
+    if(lines.find_first_not_of(" \r", p) < eol){
+      CHECK(deserializeJson(doc, lines.data() + p, eol - p) == DeserializationError::Ok);
+      expected(doc);
+    }
+    p = eol + 1;
+  }
+  CHECK_EQ(expected.count, records);
+
+  SumReadings fromLines;
+  CHECK(deserializeJsonLines(doc, lines.data(), lines.size(), std::ref(fromLines)) == DeserializationError::Ok);
+  CHECK_EQ(fromLines.count, records);
+  CHECK_EQ(fromLines.sum, expected.sum);
+
+  SumReadings fromMsgPack;
+  CHECK(deserializeMsgPackStream(doc, msgpack.data(), msgpack.size(), std::ref(fromMsgPack)) == DeserializationError::Ok);
+  CHECK_EQ(fromMsgPack.count, records);
+  CHECK_EQ(fromMsgPack.sum, expected.sum);
+
+  std::istringstream lineStream(lines), msgpackStream(msgpack);
+  SumReadings fromLineStream, fromMsgPackStream;
+  CHECK(deserializeJsonLines(doc, lineStream, std::ref(fromLineStream)) == DeserializationError::Ok);
+  CHECK(deserializeMsgPackStream(doc, msgpackStream, std::ref(fromMsgPackStream)) == DeserializationError::Ok);
+  CHECK_EQ(fromLineStream.count, records);
+  CHECK_EQ(fromLineStream.sum, expected.sum);
+  CHECK_EQ(fromMsgPackStream.count, records);
+  CHECK_EQ(fromMsgPackStream.sum, expected.sum);
+
+  // Every thread count sees every row once
+  for(unsigned threads = 1; threads <= 8; threads++){
+    std::mutex lock;
+    SumReadings parallel;
+    DeserializationError err = deserializeJsonLinesParallel(512, lines.data(), lines.size(), [&](JsonDocument & d){
+      std::lock_guard<std::mutex> guard(lock);
+      return parallel(d);
+    }, threads);
+    CHECK(err == DeserializationError::Ok);
+    CHECK_EQ(parallel.count, records);
+    CHECK_EQ(parallel.sum, expected.sum);
+  }
+  for(size_t len : { (size_t)0, (size_t)1, (size_t)2, (size_t)5 }){
+    std::atomic<size_t> count(0);
+    deserializeJsonLinesParallel(512, lines.data(), len, [&](JsonDocument &){ count++; return true; }, 4);
+    CHECK_EQ(count.load(), (size_t)0);
+  }
+
+  // The callback stops the decoding
+  size_t seen = 0;
+  CHECK(deserializeJsonLines(doc, lines.data(), lines.size(), [&](JsonDocument &){ return ++seen < 10; }) == DeserializationError::Ok);
+  CHECK_EQ(seen, (size_t)10);
+  seen = 0;
+  deserializeMsgPackStream(doc, msgpack.data(), msgpack.size(), [&](JsonDocument &){ return ++seen < 10; });
+  CHECK_EQ(seen, (size_t)10);
+
+  // The first error is returned, the rows before it were seen
+  std::string corrupt = lines;
+  size_t middle = corrupt.find('\n', corrupt.size() / 2) + 1;
+  corrupt.insert(middle, "{\"time\":}x\n");
+  SumReadings beforeError;
+  CHECK(deserializeJsonLines(doc, corrupt.data(), corrupt.size(), std::ref(beforeError)) == DeserializationError::InvalidInput);
+  CHECK(beforeError.count > 0 && beforeError.count < records);
+  std::atomic<size_t> parallelSeen(0);
+  CHECK(deserializeJsonLinesParallel(512, corrupt.data(), corrupt.size(), [&](JsonDocument &){ parallelSeen++; return true; }, 3) == DeserializationError::InvalidInput);
+  CHECK(parallelSeen.load() < records);
+  SumReadings truncated;
+  CHECK(deserializeMsgPackStream(doc, msgpack.data(), msgpack.size() - 1, std::ref(truncated)) == DeserializationError::IncompleteInput);
+  CHECK_EQ(truncated.count, records - 1);
+
+  return testResult();
+}
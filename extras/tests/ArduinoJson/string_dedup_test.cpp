@@ -0,0 +1,113 @@
+/*
+  Pool usage of the HiGrow layout (10 cards, statistics on) built the way
+  ESP-DASH builds it, parsed whole and pushed in chunks, and copied. Built once
+  with ARDUINOJSON_ENABLE_STRING_DEDUPLICATION and once without, the repeated
+  keys and card types are stored once only with it.
+*/
+#include "test.h"
+#include <ArduinoJson.h>
+
+#include <string.h>
+#include <string>
+
+struct Card {
+  const char * type;
+  std::string id;
+  std::string name;
+};
+
+static const Card higrow[] = {
+  { "temperature", "temp", "BME Temperature/C" },
+  { "number", "press", "BME Pressure/hPa" },
+  { "number", "alt", "BME Altitude/m" },
+  { "temperature", "temp2", "DHT Temperature/C" },
+  { "humidity", "hum2", "DHT Humidity/%" },
+  { "number", "lux", "BH1750/lx" },
+  { "humidity", "soil", "Soil" },
+  { "number", "salt", "Salt" },
+  { "number", "batt", "Battery/mV" },
+  { "temperature", "temp3", "18B20 Temperature/C" },
+};
+
+// Like generateLayoutResponse(): literals are linked, ids and names copied
+static void buildLayout(JsonDocument & doc){
+  JsonObject root = doc.to<JsonObject>();
+  root["response"] = "getLayout";
+  root["version"] = "1";
+  root["size"] = 4000;
+  JsonObject stats = root.createNestedObject("statistics");
+  stats["enabled"] = true;
+  stats["hardware"] = "ESP32";
+  stats["chipId"] = 123456789;
+  stats["sketchHash"] = std::string("0123456789abcdef0123456789abcdef");
+  stats["macAddress"] = std::string("24:0A:C4:00:00:01");
+  stats["freeHeap"] = 200000;
+  stats["wifiMode"] = 1;
+  JsonArray cards = root.createNestedArray("cards");
+  for(const Card & c : higrow){
+    JsonObject card = cards.createNestedObject();
+    card["id"] = c.id;
+    card["card_type"] = c.type;
+    card["name"] = c.name;
+    if(!strcmp(c.type, "temperature")){
+      card["value_type"] = 0;
+    }
+    card["value"] = 0;
+  }
+}
+
+// Whether the keys and types repeated across the cards share their storage
+static bool shared(JsonDocument & doc){
+  JsonArray cards = doc["cards"];
+  JsonObject a = cards[0], b = cards[3];
+  bool types = a["card_type"].as<const char *>() == b["card_type"].as<const char *>();
+  bool keys = a.begin()->key().c_str() == b.begin()->key().c_str();
+  return types && keys;
+}
+
+int main(){
+  printf("string deduplication %s\n", ARDUINOJSON_ENABLE_STRING_DEDUPLICATION ? "on" : "off");
+
+  DynamicJsonDocument built(4000);
+  buildLayout(built);
+  std::string json;
+  serializeJson(built, json);
+
+  DynamicJsonDocument parsed(4000);
+  CHECK(deserializeJson(parsed, json.c_str()) == DeserializationError::Ok);
+
+  DynamicJsonDocument pushed(4000);
+  JsonPushDeserializer parser(pushed);
+  DeserializationError err = DeserializationError::NeedMoreInput;
+  for(size_t pos = 0; pos < json.size(); pos += 37){
+    err = parser.feed(json.data() + pos, std::min<size_t>(37, json.size() - pos));
+  }
+  CHECK(err == DeserializationError::Ok);
+
+  DynamicJsonDocument copied(4000);
+  copied.set(parsed);
+
+  // The same document every way
+  std::string out;
+  serializeJson(parsed, out);
+  CHECK_EQ(out, json);
+  out.clear();
+  serializeJson(pushed, out);
+  CHECK_EQ(out, json);
+  out.clear();
+  serializeJson(copied, out);
+  CHECK_EQ(out, json);
+
+  // The parsers and the copy store the same strings the same way
+  CHECK_EQ(pushed.memoryUsage(), parsed.memoryUsage());
+  CHECK_EQ(copied.memoryUsage(), parsed.memoryUsage());
+  // Built with literals, there is nothing to share and nothing to save
+  CHECK(parsed.memoryUsage() >= built.memoryUsage());
+  CHECK_EQ(shared(parsed), ARDUINOJSON_ENABLE_STRING_DEDUPLICATION != 0);
+  CHECK_EQ(shared(pushed), ARDUINOJSON_ENABLE_STRING_DEDUPLICATION != 0);
+  CHECK_EQ(shared(copied), ARDUINOJSON_ENABLE_STRING_DEDUPLICATION != 0);
+
+  printf("json %zu B, pool: built %zu B, parsed %zu B, pushed %zu B, copied %zu B\n",
+    json.size(), built.memoryUsage(), parsed.memoryUsage(), pushed.memoryUsage(), copied.memoryUsage());
+  return testResult();
+}
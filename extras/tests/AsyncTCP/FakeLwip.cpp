@@ -0,0 +1,181 @@
+#include "FakeLwip.h"
+
+#include <map>
+#include <string.h>
+
+extern "C" {
+#include "lwip/dns.h"
+}
+#include "lwip/priv/tcpip_priv.h"
+
+static std::map<uint16_t, tcp_pcb *> listeners;
+static size_t pbufs = 0;
+
+std::recursive_mutex & fakeLwipLock(){
+  static std::recursive_mutex lock;
+  return lock;
+}
+
+static FakePcb * fakeOf(tcp_pcb * pcb){
+  return reinterpret_cast<FakePcb *>(pcb->fake);
+}
+
+FakePcb * fakeLwipAccept(uint16_t port){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  auto it = listeners.find(port);
+  if(it == listeners.end() || !it->second->accept){
+    return NULL;
+  }
+  FakePcb * p = fakeOf(tcp_new_ip_type(IPADDR_TYPE_V4));
+  p->pcb.state = ESTABLISHED;
+  p->pcb.local_port = port;
+  it->second->accept(it->second->callback_arg, &p->pcb, ERR_OK);
+  return p;
+}
+
+bool fakeLwipReceive(FakePcb * p, const std::string & data){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  if(!p->pcb.recv){
+    return false;
+  }
+  pbuf * pb = new pbuf();
+  pb->next = NULL;
+  pb->payload = new char[data.size()];
+  memcpy(pb->payload, data.data(), data.size());
+  pb->tot_len = pb->len = data.size();
+  pbufs++;
+  if(p->pcb.recv(p->pcb.callback_arg, &p->pcb, pb, ERR_OK) != ERR_OK){
+    pbuf_free(pb);
+    return false;
+  }
+  return true;
+}
+
+bool fakeLwipFin(FakePcb * p){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  if(!p->pcb.recv){
+    return false;
+  }
+  return p->pcb.recv(p->pcb.callback_arg, &p->pcb, NULL, ERR_OK) == ERR_OK;
+}
+
+void fakeLwipPoll(FakePcb * p){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  if(p->pcb.poll){
+    p->pcb.poll(p->pcb.callback_arg, &p->pcb);
+  }
+}
+
+size_t fakeLwipAck(FakePcb * p){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  size_t len = p->written.size() - p->acked;
+  p->acked = p->written.size();
+  for(size_t left = len; left && p->pcb.sent; ){
+    uint16_t n = left > 0xFFFF ? 0xFFFF : left;
+    p->pcb.sent(p->pcb.callback_arg, &p->pcb, n);
+    left -= n;
+  }
+  return len;
+}
+
+bool fakeLwipClosed(FakePcb * p){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  return p->closed;
+}
+
+size_t fakeLwipPbufs(){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  return pbufs;
+}
+
+/*
+ * lwIP
+ * */
+
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data * call){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  return fn(call);
+}
+
+void pbuf_free(struct pbuf * p){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  while(p){
+    pbuf * next = p->next;
+    delete[] (char *)p->payload;
+    delete p;
+    pbufs--;
+    p = next;
+  }
+}
+
+err_t dns_gethostbyname(const char * hostname, ip_addr_t * addr, dns_found_callback found, void * arg){
+  return ERR_VAL;
+}
+
+// pcbs are never freed, a test may look at them after AsyncTCP let go
+struct tcp_pcb * tcp_new_ip_type(uint8_t type){
+  FakePcb * p = new FakePcb();
+  memset(&p->pcb, 0, sizeof(p->pcb));
+  p->pcb.state = CLOSED;
+  p->pcb.mss = 1436;
+  p->pcb.fake = p;
+  p->acked = 0;
+  p->closed = false;
+  p->aborted = false;
+  return &p->pcb;
+}
+
+void tcp_arg(struct tcp_pcb * pcb, void * arg){ pcb->callback_arg = arg; }
+void tcp_recv(struct tcp_pcb * pcb, tcp_recv_fn recv){ pcb->recv = recv; }
+void tcp_sent(struct tcp_pcb * pcb, tcp_sent_fn sent){ pcb->sent = sent; }
+void tcp_err(struct tcp_pcb * pcb, tcp_err_fn err){ pcb->errf = err; }
+void tcp_poll(struct tcp_pcb * pcb, tcp_poll_fn poll, uint8_t interval){ pcb->poll = poll; }
+void tcp_accept(struct tcp_pcb * pcb, tcp_accept_fn accept){ pcb->accept = accept; }
+void tcp_accepted(struct tcp_pcb * pcb){}
+
+err_t tcp_write(struct tcp_pcb * pcb, const void * data, uint16_t len, uint8_t apiflags){
+  fakeOf(pcb)->written.append((const char *)data, len);
+  return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb * pcb){ return ERR_OK; }
+void tcp_recved(struct tcp_pcb * pcb, uint16_t len){}
+
+err_t tcp_connect(struct tcp_pcb * pcb, ip_addr_t * addr, uint16_t port, tcp_connected_fn connected){
+  pcb->state = SYN_SENT;
+  return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb * pcb){
+  for(auto it = listeners.begin(); it != listeners.end(); ++it){
+    if(it->second == pcb){
+      listeners.erase(it);
+      break;
+    }
+  }
+  pcb->state = CLOSED;
+  fakeOf(pcb)->closed = true;
+  return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb * pcb){
+  tcp_close(pcb);
+  fakeOf(pcb)->aborted = true;
+}
+
+err_t tcp_bind(struct tcp_pcb * pcb, ip_addr_t * addr, uint16_t port){
+  pcb->local_port = port;
+  return ERR_OK;
+}
+
+struct tcp_pcb * tcp_listen_with_backlog(struct tcp_pcb * pcb, uint8_t backlog){
+  pcb->state = LISTEN;
+  listeners[pcb->local_port] = pcb;
+  return pcb;
+}
+
+uint16_t tcp_sndbuf(struct tcp_pcb * pcb){ return 5744; }
+uint16_t tcp_mss(struct tcp_pcb * pcb){ return pcb->mss; }
+void tcp_nagle_disable(struct tcp_pcb * pcb){ pcb->flags |= 0x40; }
+void tcp_nagle_enable(struct tcp_pcb * pcb){ pcb->flags &= ~0x40; }
+int tcp_nagle_disabled(struct tcp_pcb * pcb){ return (pcb->flags & 0x40) != 0; }
@@ -0,0 +1,37 @@
+/*
+  A stand-in for lwIP under the real AsyncTCP.cpp. The test plays the lwIP
+  thread: it calls the registered callbacks while holding fakeLwipLock(), the
+  lock tcpip_api_call() takes for the calls AsyncTCP makes from its own task.
+*/
+#pragma once
+
+#include <mutex>
+#include <string>
+
+extern "C" {
+#include "lwip/tcp.h"
+}
+
+struct FakePcb {
+  tcp_pcb pcb;
+  std::string written;
+  size_t acked;      // of written
+  bool closed;
+  bool aborted;
+};
+
+std::recursive_mutex & fakeLwipLock();
+
+// A listening server accepts a new connection, NULL if it has none
+FakePcb * fakeLwipAccept(uint16_t port);
+// Data from the peer, false if the client wants lwIP to keep it
+bool fakeLwipReceive(FakePcb * p, const std::string & data);
+// The peer closed its side, false if the client refused the FIN
+bool fakeLwipFin(FakePcb * p);
+void fakeLwipPoll(FakePcb * p);
+// The peer acks everything written so far, the number of bytes it acked
+size_t fakeLwipAck(FakePcb * p);
+// Closed by the client, read under the lock
+bool fakeLwipClosed(FakePcb * p);
+// pbufs the fake handed out and not got back yet
+size_t fakeLwipPbufs();
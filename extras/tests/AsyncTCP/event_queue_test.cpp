@@ -0,0 +1,189 @@
+/*
+  Drives the real event queue of AsyncTCP.cpp from a fake lwIP thread: events
+  of a connection arrive in order, closing a client cancels what it still has
+  queued, a slot reused by a later client does not hand it those events, polls
+  do not pile up, a FIN gets through with no packet left to queue it, and a
+  client without a slot is turned away.
+*/
+#include "test.h"
+#include "FakeLwip.h"
+#include "HostAlloc.h"
+#include "AsyncTCP.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static bool waitFor(std::function<bool()> done){
+  for(int i = 0; i < 2000; i++){
+    if(done()){
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return done();
+}
+
+struct Peer {
+  AsyncClient * client;
+  std::string data;
+  std::atomic<int> packets;
+  std::atomic<int> polls;
+  Peer() : client(NULL), packets(0), polls(0) {}
+};
+
+static std::vector<AsyncClient *> accepted;
+// While set, the async_tcp task waits in the data callback of the first client
+static std::atomic<bool> hold(false);
+static std::atomic<bool> holding(false);
+
+static void track(Peer & peer, AsyncClient * client){
+  peer.client = client;
+  client->onData([](void * arg, AsyncClient * c, void * data, size_t len){
+    Peer * peer = (Peer *)arg;
+    peer->data.append((const char *)data, len);
+    while(hold){
+      holding = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    holding = false;
+    peer->packets++;
+  }, &peer);
+  client->onPoll([](void * arg, AsyncClient * c){
+    ((Peer *)arg)->polls++;
+  }, &peer);
+}
+
+static FakePcb * connect(Peer & peer){
+  size_t before = accepted.size();
+  FakePcb * p = fakeLwipAccept(80);
+  if(accepted.size() != before + 1){
+    return p;
+  }
+  track(peer, accepted.back());
+  return p;
+}
+
+// Parks the async_tcp task in a callback so that events stay queued
+static void block(Peer & peer, FakePcb * p){
+  hold = true;
+  int packets = peer.packets;
+  fakeLwipReceive(p, "-");
+  waitFor([]{ return holding.load(); });
+  peer.packets = packets;
+  peer.data.pop_back();
+}
+
+static void release(Peer & peer){
+  hold = false;
+  waitFor([]{ return !holding.load(); });
+  peer.packets--;
+}
+
+int main(){
+  AsyncServer server(80);
+  server.onClient([](void * arg, AsyncClient * c){
+    accepted.push_back(c);
+  }, NULL);
+  server.begin();
+
+  // Events of a connection are handled in the order lwIP raised them
+  Peer a;
+  FakePcb * pa = connect(a);
+  CHECK(a.client != NULL);
+  std::string expected;
+  for(int i = 0; i < 1000; i++){
+    std::string packet = std::to_string(i) + ",";
+    expected += packet;
+    CHECK(fakeLwipReceive(pa, packet));
+    if(i % 32 == 31){
+      waitFor([&]{ return a.packets == i + 1; });
+    }
+  }
+  CHECK(waitFor([&]{ return a.packets == 1000; }));
+  CHECK(a.data == expected);
+  CHECK(waitFor([]{ return fakeLwipPbufs() == 0; }));
+
+  // Closing a client cancels its queued events, their pbufs are still freed
+  Peer b;
+  FakePcb * pb = connect(b);
+  block(a, pa);
+  for(int i = 0; i < 10; i++){
+    CHECK(fakeLwipReceive(pb, "stale"));
+  }
+  b.client->close(true);
+  delete b.client;
+  CHECK(pb->closed);
+  CHECK(!fakeLwipReceive(pb, "after close"));
+
+  // The next client takes the free slot, the events queued for the last one are not its own
+  Peer c;
+  FakePcb * pc = connect(c);
+  CHECK(c.client != NULL);
+  CHECK(fakeLwipReceive(pc, "fresh"));
+  release(a);
+  CHECK(waitFor([&]{ return c.packets == 1; }));
+  CHECK(waitFor([]{ return fakeLwipPbufs() == 0; }));
+  CHECK_EQ(b.packets.load(), 0);
+  CHECK_EQ(c.data, std::string("fresh"));
+
+  // Polls do not pile up behind a busy task
+  block(a, pa);
+  for(int i = 0; i < 10; i++){
+    fakeLwipPoll(pc);
+  }
+  release(a);
+  CHECK(waitFor([&]{ return c.polls > 0; }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  CHECK_EQ(c.polls.load(), 1);
+  fakeLwipPoll(pc);
+  CHECK(waitFor([&]{ return c.polls == 2; }));
+
+  // With the pool taken by queued data and malloc() failing the FIN still closes the client
+  Peer d;
+  FakePcb * pd = connect(d);
+  tcp_recv_fn recv = pd->pcb.recv;
+  std::atomic<bool> disconnected(false);
+  d.client->onDisconnect([](void * arg, AsyncClient * c){
+    *(std::atomic<bool> *)arg = true;
+  }, &disconnected);
+  block(a, pa);
+  int queued = 0;
+  while(queued < 63 && fakeLwipReceive(pd, "x")){
+    queued++;
+  }
+  CHECK_EQ(queued, 63);
+  hostAllocFail(true);
+  bool fin = fakeLwipFin(pd);
+  hostAllocFail(false);
+  CHECK(fin);
+  release(a);
+  CHECK(waitFor([&]{ return disconnected.load(); }));
+  CHECK(pd->closed);
+  CHECK_EQ(d.data, std::string(63, 'x'));
+  CHECK(waitFor([]{ return fakeLwipPbufs() == 0; }));
+  void * gone = d.client;
+  delete d.client;
+
+  // lwIP may still call back with the deleted client, it is not read any more
+  {
+    std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+    CHECK_EQ((int)recv(gone, &pd->pcb, NULL, ERR_OK), (int)ERR_OK);
+  }
+
+  // With every slot taken a new connection is refused and its pcb closed
+  std::vector<Peer> more(MEMP_NUM_TCP_PCB);
+  size_t taken = 2;
+  for(Peer & peer : more){
+    FakePcb * p = connect(peer);
+    if(!peer.client){
+      CHECK(p->closed);
+      break;
+    }
+    taken++;
+  }
+  CHECK_EQ(taken, (size_t)MEMP_NUM_TCP_PCB);
+  CHECK_EQ(accepted.size(), (size_t)MEMP_NUM_TCP_PCB + 2);
+
+  return testResult();
+}
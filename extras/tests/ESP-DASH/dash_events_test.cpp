@@ -0,0 +1,79 @@
+/*
+  ESP-DASH viewers on the event stream: a reconnecting viewer is sent the
+  layout unless everything it missed was replayed, and an id it kept from
+  before the device restarted never counts as replayed.
+*/
+#include "events_test.h"
+#include "ESPDash.h"
+
+static size_t layouts(const std::vector<EventsTestEvent> & got){
+  size_t n = 0;
+  for(const EventsTestEvent & ev : got){
+    n += ev.event == "layout";
+  }
+  return n;
+}
+
+static std::vector<EventsTestEvent> viewer(const std::string & lastEventId){
+  std::vector<EventsTestEvent> got;
+  std::string pending;
+  FakeConnection * c = eventsTestOpen("/dashevents", lastEventId.empty() ? NULL : lastEventId.c_str(), &pending);
+  CHECK(c != NULL);
+  if(c){
+    got = eventsTestReceive(c, pending);
+    fakeRemoteClose(c);
+    delete c;
+  }
+  return got;
+}
+
+int main(){
+  // Handlers are globals in ESP-DASH, so the server lives as long as they do
+  AsyncWebServer * server = new AsyncWebServer(80);
+  ESPDash.init(*server);
+  ESPDash.addNumberCard("num1", "Light", 300);
+  ESPDash.addTemperatureCard("temp1", "Air", 0, 21);
+  server->begin();
+
+  // A new viewer starts from the layout
+  std::string pending;
+  FakeConnection * a = eventsTestOpen("/dashevents", NULL, &pending);
+  CHECK(a != NULL);
+  if(!a){
+    return testResult();
+  }
+  std::vector<EventsTestEvent> got = eventsTestReceive(a, pending);
+  CHECK_EQ(layouts(got), (size_t)1);
+
+  for(int i = 0; i < 5; i++){
+    ESPDash.updateNumberCard("num1", 300 + i);
+  }
+  got = eventsTestReceive(a, pending);
+  CHECK_EQ(got.size(), (size_t)5);
+  if(got.size() != 5){
+    return testResult();
+  }
+  uint32_t third = got[2].id;
+
+  // Missed two updates and they are still kept, no layout
+  got = viewer(std::to_string((unsigned long)third));
+  CHECK_EQ(layouts(got), (size_t)0);
+  CHECK_EQ(got.size(), (size_t)2);
+
+  // The device restarted since, the browser's id is from the old numbering
+  for(const char * stale : { "1", "3", "5" }){
+    got = viewer(stale);
+    CHECK_EQ(layouts(got), (size_t)1);
+  }
+
+  // A layout change was missed, the viewer needs the new one (the replayed layout event may come on top)
+  ESPDash.addNumberCard("num2", "Battery mV", 3900);
+  got = eventsTestReceive(a, pending);
+  CHECK_EQ(layouts(got), (size_t)1);
+  got = viewer(std::to_string((unsigned long)third));
+  CHECK(layouts(got) >= 1);
+
+  fakeRemoteClose(a);
+  delete a;
+  return testResult();
+}
@@ -0,0 +1,139 @@
+/*
+  How well permessage-deflate does on real ESP-DASH traffic: a dashboard with
+  the usual cards is driven for a while and everything its websocket sends is
+  recorded, then compressed at every window size, with and without context
+  takeover. zlib inflates each message as a browser would.
+*/
+#include "ws_test.h"
+#include "ESPDash.h"
+#include "AsyncWebSocketDeflate.h"
+
+#include <math.h>
+#include <zlib.h>
+
+static bool inflateMessage(z_stream & z, const uint8_t * in, size_t len, std::string & out){
+  std::string data((const char *)in, len);
+  data.append("\x00\x00\xff\xff", 4);
+  out.clear();
+  z.next_in = (Bytef *)&data[0];
+  z.avail_in = data.size();
+  char buf[1024];
+  while(z.avail_in){
+    z.next_out = (Bytef *)buf;
+    z.avail_out = sizeof(buf);
+    int r = inflate(&z, Z_SYNC_FLUSH);
+    if(r != Z_OK && r != Z_BUF_ERROR){
+      return false;
+    }
+    out.append(buf, sizeof(buf) - z.avail_out);
+    if(r != Z_OK){
+      break;
+    }
+  }
+  return true;
+}
+
+static std::vector<std::string> record(){
+  // Handlers are globals in ESP-DASH, so the server lives as long as they do
+  AsyncWebServer * server = new AsyncWebServer(80);
+  ESPDash.init(*server);
+  ESPDash.addTemperatureCard("temp1", "Air", 0, 21);
+  ESPDash.addTemperatureCard("temp2", "Soil", 0, 18);
+  ESPDash.addHumidityCard("hum1", "Air humidity", 40);
+  ESPDash.addHumidityCard("hum2", "Soil moisture", 60);
+  ESPDash.addNumberCard("num1", "Light", 300);
+  ESPDash.addNumberCard("num2", "Battery mV", 3900);
+  ESPDash.addStatusCard("status1", "Pump", false);
+  ESPDash.addGaugeChart("gauge1", "Salt", 30);
+  int x[7] = { 1, 2, 3, 4, 5, 6, 7 };
+  int y[7] = { 2, 5, 10, 12, 18, 8, 5 };
+  ESPDash.addLineChart("chart1", "Moisture, last hours", x, 7, "%", y, 7);
+  server->begin();
+
+  std::vector<std::string> messages;
+  // A browser without deflate records the plain messages
+  FakeConnection * c = wsTestOpen("/dashws");
+  CHECK(c != NULL);
+  if(!c){
+    return messages;
+  }
+  const uint8_t mask[4] = { 9, 8, 7, 6 };
+  std::string wire;
+  fakeReceive(c, wsTestFrame(WS_TEXT, "{\"command\":\"getLayout\"}", mask));
+  for(int t = 0; t < 2000; t++){
+    ESPDash.updateTemperatureCard("temp1", 21 + (int)(3 * sin(t / 50.0)));
+    ESPDash.updateHumidityCard("hum1", 40 + (t / 7) % 20);
+    ESPDash.updateNumberCard("num1", 300 + (t * 37) % 500);
+    if(t % 5 == 0){
+      ESPDash.updateTemperatureCard("temp2", 18 + (t / 200) % 4);
+      ESPDash.updateHumidityCard("hum2", 60 - (t / 40) % 30);
+      ESPDash.updateGaugeChart("gauge1", 30 + (t / 10) % 40);
+    }
+    if(t % 30 == 0){
+      ESPDash.updateNumberCard("num2", 3900 - t / 10);
+      ESPDash.updateStatusCard("status1", (t / 30) % 2 == 0);
+      for(int i = 0; i < 7; i++){
+        y[i] = 2 + (t / 30 + i * 3) % 17;
+      }
+      ESPDash.updateLineChart("chart1", x, 7, y, 7);
+    }
+    if(t % 100 == 0){
+      fakeReceive(c, wsTestFrame(WS_TEXT, "{\"command\":\"getStats\"}", mask));
+    }
+    webTestDrain(c, &wire, 20);
+  }
+  for(const WsTestFrame & f : wsTestFrames(wire)){
+    messages.push_back(f.payload);
+  }
+  fakeRemoteClose(c);
+  delete c;
+  return messages;
+}
+
+int main(){
+  std::vector<std::string> messages = record();
+  size_t raw = 0;
+  for(const std::string & m : messages){
+    raw += m.size();
+  }
+  CHECK(messages.size() > 2000);
+  printf("%zu messages, %zu bytes recorded, %.1f bytes each\n\n", messages.size(), raw, (double)raw / messages.size());
+  printf("%-6s %-9s %8s %12s %10s\n", "window", "takeover", "ratio", "compressed", "ns/msg");
+
+  for(int bits : { 8, 9, 10, 11, 12, 15 }){
+    for(bool noContext : { false, true }){
+      AsyncWebSocketDeflater deflater(bits, noContext);
+      z_stream z;
+      memset(&z, 0, sizeof(z));
+      inflateInit2(&z, -15);
+      size_t sent = 0, compressed = 0, bad = 0;
+      std::string plain;
+      for(const std::string & m : messages){
+        uint8_t * out = NULL;
+        size_t len = deflater.compress((const uint8_t *)m.data(), m.size(), &out);
+        if(len){
+          if(noContext){
+            inflateReset(&z);
+          }
+          bad += !inflateMessage(z, out, len, plain) || plain != m;
+          compressed++;
+        }
+        sent += len ? len : m.size();
+        free(out);
+      }
+      inflateEnd(&z);
+      CHECK_EQ(bad, (size_t)0);
+
+      AsyncWebSocketDeflater timed(bits, noContext);
+      size_t i = 0;
+      double ns = benchNanos(messages.size(), [&]{
+        uint8_t * out = NULL;
+        const std::string & m = messages[i++];
+        timed.compress((const uint8_t *)m.data(), m.size(), &out);
+        free(out);
+      });
+      printf("%-6d %-9s %8.3f %6zu/%-5zu %10.0f\n", bits, noContext ? "no" : "yes", (double)sent / raw, compressed, messages.size(), ns);
+    }
+  }
+  return testResult();
+}
@@ -0,0 +1,101 @@
+/*
+  One message to 1, 4 and 8 WebSocket clients: text() on every client, which
+  copies and frames it per client, against textAll(), which frames one shared
+  buffer once. Counts allocations and add() calls per broadcast.
+*/
+#include "ws_test.h"
+#include "HostAlloc.h"
+#include "ESPAsyncWebServer.h"
+
+static const size_t rounds = 20000;
+static std::vector<AsyncWebSocketClient *> clients;
+
+struct Result {
+  double nanos;
+  double allocs;
+  double adds;
+};
+
+template<typename F>
+static Result measure(std::vector<FakeConnection *> & peers, F broadcast){
+  for(FakeConnection * c : peers){
+    c->adds = 0;
+  }
+  hostAllocReset();
+  double nanos = benchNanos(rounds, [&]{
+    broadcast();
+    for(FakeConnection * c : peers){
+      c->sent.clear();
+      fakeAck(c);
+    }
+  });
+  Result r;
+  r.nanos = nanos;
+  r.allocs = (double)hostAllocStats().count / rounds;
+  r.adds = 0;
+  for(FakeConnection * c : peers){
+    r.adds += c->adds;
+  }
+  r.adds /= rounds * peers.size();
+  return r;
+}
+
+int main(){
+  std::string update = "{\"id\":1,\"type\":\"cards\",\"cards\":[";
+  while(update.size() < 1000){
+    update += "{\"id\":" + std::to_string(update.size()) + ",\"value\":\"23.5\",\"symbol\":\"C\"},";
+  }
+  update.back() = ']';
+  update += "}";
+
+  AsyncWebServer server(80);
+  AsyncWebSocket * ws = new AsyncWebSocket("/ws");
+  ws->onEvent([](AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t * data, size_t len){
+    if(type == WS_EVT_CONNECT){
+      clients.push_back(client);
+    }
+  });
+  server.addHandler(ws);
+  server.begin();
+
+  printf("%-8s %-10s %10s %10s %12s\n", "clients", "path", "ns", "allocs", "adds/client");
+  std::vector<FakeConnection *> peers;
+  for(size_t count : { (size_t)1, (size_t)4, (size_t)8 }){
+    while(peers.size() < count){
+      peers.push_back(wsTestOpen("/ws"));
+      CHECK(peers.back() != NULL);
+    }
+
+    auto perClient = [&]{
+      for(AsyncWebSocketClient * client : clients){
+        client->text(update.c_str(), update.size());
+      }
+    };
+    auto shared = [&]{ ws->textAll(update.c_str(), update.size()); };
+
+    // Both ways put the same frame on every connection
+    for(int way = 0; way < 2; way++){
+      if(way){
+        shared();
+      } else {
+        perClient();
+      }
+      for(FakeConnection * c : peers){
+        std::vector<WsTestFrame> frames = wsTestFrames(c->sent);
+        CHECK_EQ(frames.size(), (size_t)1);
+        CHECK(frames.size() == 1 && frames[0].payload == update && frames[0].opcode == WS_TEXT && frames[0].final);
+        fakeAck(c);
+      }
+    }
+
+    Result a = measure(peers, perClient);
+    Result b = measure(peers, shared);
+    printf("%-8zu %-10s %10.0f %10.2f %12.2f\n", count, "text()", a.nanos, a.allocs, a.adds);
+    printf("%-8zu %-10s %10.0f %10.2f %12.2f\n", count, "textAll()", b.nanos, b.allocs, b.adds);
+  }
+  for(FakeConnection * c : peers){
+    fakeRemoteClose(c);
+    delete c;
+  }
+  return testResult();
+}
@@ -0,0 +1,64 @@
+/*
+  The browser side of HTTP digest authentication: hashes with the mock's
+  mbedtls and Authorization headers for a nonce.
+*/
+#pragma once
+
+#include "mbedtls/md5.h"
+#include "mbedtls/sha256.h"
+
+#include <stdio.h>
+#include <string>
+
+static inline std::string digestHex(const unsigned char * digest, size_t len){
+  std::string hex;
+  char byte[3];
+  for(size_t i = 0; i < len; i++){
+    snprintf(byte, sizeof(byte), "%02x", digest[i]);
+    hex += byte;
+  }
+  return hex;
+}
+
+static inline std::string digestMd5(const std::string & s){
+  mbedtls_md5_context ctx;
+  unsigned char digest[16];
+  mbedtls_md5_init(&ctx);
+  mbedtls_md5_starts(&ctx);
+  mbedtls_md5_update(&ctx, (const unsigned char *)s.data(), s.size());
+  mbedtls_md5_finish(&ctx, digest);
+  mbedtls_md5_free(&ctx);
+  return digestHex(digest, sizeof(digest));
+}
+
+static inline std::string digestSha256(const std::string & s){
+  mbedtls_sha256_context ctx;
+  unsigned char digest[32];
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, (const unsigned char *)s.data(), s.size());
+  mbedtls_sha256_finish(&ctx, digest);
+  mbedtls_sha256_free(&ctx);
+  return digestHex(digest, sizeof(digest));
+}
+
+// Authorization value for GET uri as Mufasa, qop=auth
+static inline std::string digestHeader(const std::string & realm, const std::string & nonce, const char * nc,
+    const std::string & uri = "/dir/index.html", const std::string & password = "Circle Of Life", bool sha256 = false){
+  std::string (*hash)(const std::string &) = sha256 ? digestSha256 : digestMd5;
+  std::string ha1 = hash("Mufasa:" + realm + ":" + password);
+  std::string ha2 = hash("GET:" + uri);
+  std::string response = hash(ha1 + ":" + nonce + ":" + nc + ":0a4f113b:auth:" + ha2);
+  return "username=\"Mufasa\", realm=\"" + realm + "\", nonce=\"" + nonce + "\", uri=\"" + uri + "\"" +
+    (sha256 ? ", algorithm=SHA-256" : "") + ", qop=auth, nc=" + nc + ", cnonce=\"0a4f113b\", response=\"" + response + "\"";
+}
+
+// The nonce of a challenge, empty when there is none
+static inline std::string digestNonce(const std::string & challenge){
+  size_t start = challenge.find("nonce=\"");
+  if(start == std::string::npos){
+    return std::string();
+  }
+  start += 7;
+  return challenge.substr(start, challenge.find('"', start) - start);
+}
@@ -0,0 +1,83 @@
+/*
+  What digest authentication costs per request: checkDigestAuthentication()
+  for the RFC 2617 and RFC 7616 examples, the challenge and stored hash with
+  the allocations they make, and a whole authenticated GET
+  through the server against the same GET without authentication. The mock
+  hashes are plain reference code, the ESP32 hashes SHA-256 in hardware.
+*/
+#include "web_test.h"
+#include "digest_auth.h"
+#include "HostAlloc.h"
+#include "ESPAsyncWebServer.h"
+#include "WebAuthentication.h"
+
+static const char * RFC2617 = "username=\"Mufasa\", realm=\"testrealm@host.com\", nonce=\"dcd98b7102dd2f0e8b11d0f600bfb0c093\", "
+  "uri=\"/dir/index.html\", qop=auth, nc=00000001, cnonce=\"0a4f113b\", response=\"6629fae49393a05397450978507c4ef1\", "
+  "opaque=\"5ccc069c403ebaf9f0171e9517f40e41\"";
+static const char * RFC7616_SHA256 = "username=\"Mufasa\", realm=\"http-auth@example.org\", uri=\"/dir/index.html\", algorithm=SHA-256, "
+  "nonce=\"7ypf/xlj9XXwfDPEoM4URrv/xwf94BcCAzFZH4GiTo0v\", nc=00000001, cnonce=\"f2/wE4q74E6zIJEtWaHKaf5wv/H5QzzpXusqGemxURZJ\", "
+  "qop=auth, response=\"753927fa0e85d155564e2e272a28d1802ca10daf4496794697cf8db5856cb6c1\", opaque=\"FQhe/qaU925kfnzjCev0ciny7QMkPqMAFRtzCUYo5tdS\"";
+
+static const char * REALM = "testrealm@host.com";
+
+int main(){
+  int accepted = 0;
+  double md5 = benchNanos(200000, [&]{
+    accepted += checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", REALM, false, "dcd98b7102dd2f0e8b11d0f600bfb0c093", NULL, NULL);
+  });
+  double stored = benchNanos(200000, [&]{
+    accepted += checkDigestAuthentication(RFC2617, "GET", "Mufasa", "939e7578ed9e3c518a452acee763bce9", REALM, true, "dcd98b7102dd2f0e8b11d0f600bfb0c093", NULL, NULL);
+  });
+  double sha256 = benchNanos(200000, [&]{
+    accepted += checkDigestAuthentication(RFC7616_SHA256, "GET", "Mufasa", "Circle of Life", "http-auth@example.org", false, "7ypf/xlj9XXwfDPEoM4URrv/xwf94BcCAzFZH4GiTo0v", NULL, NULL);
+  });
+  CHECK_EQ(accepted, 600000);
+
+  size_t length = 0;
+  hostAllocReset();
+  double challenge = benchNanos(200000, [&]{ length += requestDigestAuthentication(REALM).length(); });
+  double challengeAllocs = hostAllocStats().count / 200000.0;
+  hostAllocReset();
+  double hash = benchNanos(200000, [&]{ length += generateDigestHash("Mufasa", "Circle Of Life", REALM).length(); });
+  double hashAllocs = hostAllocStats().count / 200000.0;
+  CHECK(length > 0);
+
+  AsyncWebServer server(80);
+  server.on("/open", HTTP_GET, [](AsyncWebServerRequest * request){
+    request->send(200, "text/plain", "welcome");
+  });
+  server.on("/dir/index.html", HTTP_GET, [](AsyncWebServerRequest * request){
+    if(!request->authenticate("Mufasa", "Circle Of Life", REALM)){
+      return request->requestAuthentication(REALM);
+    }
+    request->send(200, "text/plain", "welcome");
+  });
+  server.begin();
+
+  // Every request has its own nonce count, fresh nonces before the window runs out
+  const std::string open = "GET /open HTTP/1.1\r\nHost: esp32.local\r\n\r\n";
+  std::string nonce;
+  unsigned nc = 0;
+  int welcomed = 0;
+  double plain = benchNanos(20000, [&]{ welcomed += webTestBody(webTestExchange({ open })) == "welcome"; });
+  double authenticated = benchNanos(20000, [&]{
+    if(nc % 32 == 0){
+      nonce = digestNonce(requestDigestAuthentication(REALM).c_str());
+    }
+    char count[9];
+    snprintf(count, sizeof(count), "%08x", ++nc);
+    std::string request = "GET /dir/index.html HTTP/1.1\r\nHost: esp32.local\r\nAuthorization: Digest " +
+      digestHeader(REALM, nonce, count) + "\r\n\r\n";
+    welcomed += webTestBody(webTestExchange({ request })) == "welcome";
+  });
+  CHECK_EQ(welcomed, 40000);
+
+  printf("checkDigestAuthentication, MD5           %6.0f ns\n", md5);
+  printf("checkDigestAuthentication, stored HA1    %6.0f ns\n", stored);
+  printf("checkDigestAuthentication, SHA-256       %6.0f ns\n", sha256);
+  printf("requestDigestAuthentication             %6.0f ns  %.1f allocations\n", challenge, challengeAllocs);
+  printf("generateDigestHash                      %6.0f ns  %.1f allocations\n", hash, hashAllocs);
+  printf("GET without authentication               %6.0f ns\n", plain);
+  printf("GET with MD5 digest (client hashes too)  %6.0f ns\n", authenticated);
+  return testResult();
+}
@@ -0,0 +1,155 @@
+/*
+  Digest authentication: the RFC 2617 section 3.5 and RFC 7616 section 3.9.1
+  examples, issued nonces with their nonce counts, expiry and eviction, stale
+  challenges, malformed headers, and a whole exchange through the server.
+*/
+#include "web_test.h"
+#include "digest_auth.h"
+#include "ESPAsyncWebServer.h"
+#include "WebAuthentication.h"
+
+static const char * RFC2617 = "username=\"Mufasa\", realm=\"testrealm@host.com\", nonce=\"dcd98b7102dd2f0e8b11d0f600bfb0c093\", "
+  "uri=\"/dir/index.html\", qop=auth, nc=00000001, cnonce=\"0a4f113b\", response=\"6629fae49393a05397450978507c4ef1\", "
+  "opaque=\"5ccc069c403ebaf9f0171e9517f40e41\"";
+static const char * RFC2617_NONCE = "dcd98b7102dd2f0e8b11d0f600bfb0c093";
+
+static const char * RFC7616_MD5 = "username=\"Mufasa\", realm=\"http-auth@example.org\", uri=\"/dir/index.html\", algorithm=MD5, "
+  "nonce=\"7ypf/xlj9XXwfDPEoM4URrv/xwf94BcCAzFZH4GiTo0v\", nc=00000001, cnonce=\"f2/wE4q74E6zIJEtWaHKaf5wv/H5QzzpXusqGemxURZJ\", "
+  "qop=auth, response=\"8ca523f5e9506fed4657c9700eebdbec\", opaque=\"FQhe/qaU925kfnzjCev0ciny7QMkPqMAFRtzCUYo5tdS\"";
+static const char * RFC7616_SHA256 = "username=\"Mufasa\", realm=\"http-auth@example.org\", uri=\"/dir/index.html\", algorithm=SHA-256, "
+  "nonce=\"7ypf/xlj9XXwfDPEoM4URrv/xwf94BcCAzFZH4GiTo0v\", nc=00000001, cnonce=\"f2/wE4q74E6zIJEtWaHKaf5wv/H5QzzpXusqGemxURZJ\", "
+  "qop=auth, response=\"753927fa0e85d155564e2e272a28d1802ca10daf4496794697cf8db5856cb6c1\", opaque=\"FQhe/qaU925kfnzjCev0ciny7QMkPqMAFRtzCUYo5tdS\"";
+static const char * RFC7616_NONCE = "7ypf/xlj9XXwfDPEoM4URrv/xwf94BcCAzFZH4GiTo0v";
+
+static const char * REALM = "testrealm@host.com";
+
+// Checks a header for an issued nonce, stale tells whether a new challenge should say stale=TRUE
+static bool issued(const std::string & header, bool * stale){
+  *stale = false;
+  return checkDigestAuthentication(header.c_str(), "GET", "Mufasa", "Circle Of Life", NULL, false, NULL, NULL, NULL, stale);
+}
+
+static std::string get(const std::string & authorization){
+  std::string request = "GET /dir/index.html HTTP/1.1\r\nHost: esp32.local\r\n";
+  if(!authorization.empty()){
+    request += "Authorization: Digest " + authorization + "\r\n";
+  }
+  return webTestExchange({ request + "\r\n" });
+}
+
+// The WWW-Authenticate value for SHA-256, or the one without an algorithm, which means MD5
+static std::string challenge(const std::string & response, bool sha256){
+  for(size_t start = response.find("WWW-Authenticate: "); start != std::string::npos; start = response.find("WWW-Authenticate: ", start + 1)){
+    std::string line = response.substr(start, response.find("\r\n", start) - start);
+    if((line.find("algorithm=SHA-256") != std::string::npos) == sha256){
+      return line;
+    }
+  }
+  return std::string();
+}
+
+int main(){
+  // RFC 2617 section 3.5, twice for the cached HA1, and with the stored hash
+  CHECK(checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", REALM, false, RFC2617_NONCE, NULL, NULL));
+  CHECK(checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", REALM, false, RFC2617_NONCE, NULL, NULL));
+  CHECK(checkDigestAuthentication(RFC2617, "GET", "Mufasa", "939e7578ed9e3c518a452acee763bce9", REALM, true, RFC2617_NONCE, NULL, NULL));
+  CHECK(checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", NULL, false, RFC2617_NONCE, "5ccc069c403ebaf9f0171e9517f40e41", "/dir/index.html"));
+  CHECK(!checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle of Life", REALM, false, RFC2617_NONCE, NULL, NULL));
+  CHECK(!checkDigestAuthentication(RFC2617, "POST", "Mufasa", "Circle Of Life", REALM, false, RFC2617_NONCE, NULL, NULL));
+  CHECK(!checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", "other", false, RFC2617_NONCE, NULL, NULL));
+  CHECK(!checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", NULL, false, RFC2617_NONCE, "bad", NULL));
+  CHECK(!checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", NULL, false, RFC2617_NONCE, NULL, "/other"));
+  CHECK(!checkDigestAuthentication(RFC2617, "GET", "Mufasa", "Circle Of Life", REALM, false, "0123", NULL, NULL));
+  CHECK(generateDigestHash("Mufasa", "Circle Of Life", REALM) == "Mufasa:testrealm@host.com:939e7578ed9e3c518a452acee763bce9");
+
+  // RFC 7616 section 3.9.1, MD5 and SHA-256
+  CHECK(checkDigestAuthentication(RFC7616_MD5, "GET", "Mufasa", "Circle of Life", "http-auth@example.org", false, RFC7616_NONCE, NULL, NULL));
+  CHECK(checkDigestAuthentication(RFC7616_SHA256, "GET", "Mufasa", "Circle of Life", "http-auth@example.org", false, RFC7616_NONCE, NULL, NULL));
+  CHECK(checkDigestAuthentication(RFC7616_SHA256, "GET", "Mufasa", "Circle of Life", "http-auth@example.org", false, RFC7616_NONCE, NULL, NULL));
+  CHECK(!checkDigestAuthentication(RFC7616_SHA256, "GET", "Mufasa", "Circle Of Life", "http-auth@example.org", false, RFC7616_NONCE, NULL, NULL));
+
+  // An issued nonce, each nonce count once, out of order within the window
+  bool stale;
+  std::string nonce = digestNonce(requestDigestAuthentication(REALM).c_str());
+  CHECK_EQ(nonce.size(), (size_t)32);
+  CHECK(issued(digestHeader(REALM, nonce, "00000001"), &stale) && !stale);
+  CHECK(!issued(digestHeader(REALM, nonce, "00000001"), &stale) && !stale);
+  CHECK(issued(digestHeader(REALM, nonce, "00000003"), &stale));
+  CHECK(issued(digestHeader(REALM, nonce, "00000002"), &stale));
+  CHECK(!issued(digestHeader(REALM, nonce, "00000002"), &stale));
+  CHECK(issued(digestHeader(REALM, nonce, "00000030"), &stale));
+  CHECK(!issued(digestHeader(REALM, nonce, "00000004"), &stale) && !stale);
+  CHECK(issued(digestHeader(REALM, nonce, "0000002f"), &stale));
+  CHECK(!issued(digestHeader(REALM, nonce, "00000031", "/dir/index.html", "wrong"), &stale) && !stale);
+  // Right credentials on a nonce never issued, after a reboot for instance
+  CHECK(!issued(digestHeader(REALM, "0123456789abcdef0123456789abcdef", "00000001"), &stale) && stale);
+
+  // Expired
+  mockAdvanceMillis(DIGEST_NONCE_LIFETIME);
+  CHECK(!issued(digestHeader(REALM, nonce, "00000031"), &stale) && stale);
+  CHECK(std::string(requestDigestAuthentication(NULL, true).c_str()).find(", stale=TRUE") != std::string::npos);
+
+  // The whole challenge, and one with a realm too long for the stack buffer
+  std::string sent = requestDigestAuthentication(REALM).c_str();
+  std::string opaque = sent.substr(sent.find("opaque=\"") + 8, 32);
+  CHECK_EQ(sent, "realm=\"" + std::string(REALM) + "\", qop=\"auth\", nonce=\"" + digestNonce(sent) + "\", opaque=\"" + opaque + "\"");
+  std::string longRealm(DIGEST_BUFFER_SIZE, 'r');
+  sent = requestDigestAuthentication(longRealm.c_str(), true).c_str();
+  CHECK_EQ(sent.substr(0, longRealm.size() + 8), "realm=\"" + longRealm + "\"");
+  CHECK_EQ(digestNonce(sent).size(), (size_t)32);
+  CHECK(sent.size() > DIGEST_BUFFER_SIZE && sent.compare(sent.size() - 12, 12, ", stale=TRUE") == 0);
+  CHECK(generateDigestHash("Mufasa", "pw", longRealm.c_str()).startsWith(("Mufasa:" + longRealm + ":").c_str()));
+  CHECK_EQ(generateDigestHash("Mufasa", "pw", longRealm.c_str()).length(), 7 + longRealm.size() + 1 + 32);
+
+  // The oldest nonce makes room when the table is full
+  std::string first = digestNonce(requestDigestAuthentication(NULL).c_str());
+  for(int i = 0; i < DIGEST_NONCE_SLOTS; i++){
+    mockAdvanceMillis(1);
+    requestDigestAuthentication(NULL);
+  }
+  std::string last = digestNonce(requestDigestAuthentication(NULL).c_str());
+  CHECK(!issued(digestHeader("Login Required", first, "00000001"), &stale) && stale);
+  CHECK(issued(digestHeader("Login Required", last, "00000001"), &stale));
+
+  // Malformed
+  CHECK(!checkDigestAuthentication("username=\"Mufasa", "GET", "Mufasa", "x", NULL, false, NULL, NULL, NULL));
+  CHECK(!checkDigestAuthentication("", "GET", "Mufasa", "x", NULL, false, NULL, NULL, NULL));
+  CHECK(!checkDigestAuthentication("username", "GET", "Mufasa", "x", NULL, false, NULL, NULL, NULL));
+  // qop=auth is required
+  std::string noQop = digestHeader(REALM, last, "00000002");
+  noQop.erase(noQop.find(", qop=auth"), 10);
+  CHECK(!issued(noQop, &stale));
+
+  // Through the server: challenge, answer with SHA-256 and with MD5, a replay is refused
+  AsyncWebServer server(80);
+  server.on("/dir/index.html", HTTP_GET, [](AsyncWebServerRequest * request){
+    if(!request->authenticate("Mufasa", "Circle Of Life", REALM)){
+      return request->requestAuthentication(REALM);
+    }
+    request->send(200, "text/plain", "welcome");
+  });
+  server.begin();
+  std::string response = get("");
+  CHECK_EQ(response.compare(0, 12, "HTTP/1.1 401"), 0);
+  std::string md5 = challenge(response, false);
+  CHECK(!md5.empty());
+#if DIGEST_SHA256
+  std::string sha256 = challenge(response, true);
+  CHECK(!sha256.empty());
+  CHECK(response.find(sha256) < response.find(md5 + "\r\n"));
+  CHECK_EQ(digestNonce(sha256), digestNonce(md5));
+  response = get(digestHeader(REALM, digestNonce(sha256), "00000001", "/dir/index.html", "Circle Of Life", true));
+  CHECK_EQ(webTestBody(response), std::string("welcome"));
+#endif
+  std::string answer = digestHeader(REALM, digestNonce(md5), "00000002");
+  CHECK_EQ(webTestBody(get(answer)), std::string("welcome"));
+  CHECK_EQ(get(answer).compare(0, 12, "HTTP/1.1 401"), 0);
+
+  // An expired nonce is answered with a stale challenge
+  mockAdvanceMillis(DIGEST_NONCE_LIFETIME);
+  response = get(digestHeader(REALM, digestNonce(md5), "00000003"));
+  CHECK_EQ(response.compare(0, 12, "HTTP/1.1 401"), 0);
+  CHECK(response.find("stale=TRUE") != std::string::npos);
+
+  return testResult();
+}
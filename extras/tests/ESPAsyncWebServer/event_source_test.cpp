@@ -0,0 +1,145 @@
+/*
+  Last-Event-ID replay of AsyncEventSource: a reconnecting viewer gets what it
+  missed, and ids from before a restart, or already dropped from the replay
+  ring, are not taken for recent ones.
+*/
+#include "events_test.h"
+#include "ESPAsyncWebServer.h"
+
+static int connects = 0;
+static bool lastReplayed = false;
+
+static void onConnect(AsyncEventSourceClient * client){
+  connects++;
+  lastReplayed = client->replayed();
+}
+
+static std::string idString(uint32_t id){
+  return std::to_string((unsigned long)id);
+}
+
+// Opens a viewer on url and returns what it got on connect, NULL when refused
+static FakeConnection * reconnect(const char * url, const std::string & lastEventId, std::vector<EventsTestEvent> & got){
+  std::string pending;
+  FakeConnection * c = eventsTestOpen(url, lastEventId.empty() ? NULL : lastEventId.c_str(), &pending);
+  if(c){
+    got = eventsTestReceive(c, pending);
+  }
+  return c;
+}
+
+static void closeViewer(FakeConnection * c){
+  if(c){
+    fakeRemoteClose(c);
+    delete c;
+  }
+}
+
+int main(){
+  // The server deletes its handlers, both have to be on the heap
+  AsyncWebServer * server = new AsyncWebServer(80);
+  AsyncEventSource * events = new AsyncEventSource("/events");
+  events->replay(4);
+  events->onConnect(onConnect);
+  server->addHandler(events);
+  // The same server after a restart, numbering again
+  AsyncEventSource * rebooted = new AsyncEventSource("/rebooted");
+  rebooted->replay(4);
+  rebooted->onConnect(onConnect);
+  server->addHandler(rebooted);
+  server->begin();
+
+  // A first viewer, nothing to replay
+  std::vector<EventsTestEvent> got;
+  FakeConnection * a = reconnect("/events", "", got);
+  CHECK(a != NULL);
+  CHECK_EQ(connects, 1);
+  CHECK(!lastReplayed);
+  CHECK_EQ(events->lastId(), 0u);
+
+  events->send("one");
+  events->send("two");
+  events->send("three");
+  std::string pending;
+  got = eventsTestReceive(a, pending);
+  CHECK_EQ(got.size(), (size_t)3);
+  if(got.size() != 3){
+    return testResult();
+  }
+  uint32_t first = got[0].id;
+  CHECK(first != 0);
+  CHECK_EQ(got[1].id, first + 1);
+  CHECK_EQ(got[2].id, first + 2);
+  CHECK_EQ(events->lastId(), first + 2);
+  CHECK(events->thisBoot(first));
+  CHECK(events->thisBoot(first + 2));
+  CHECK(!events->thisBoot(first - 1));
+  CHECK(!events->thisBoot(first + 3));
+  CHECK(!events->thisBoot(0));
+
+  // Back after missing two events, it gets exactly those
+  FakeConnection * b = reconnect("/events", idString(first), got);
+  CHECK(lastReplayed);
+  CHECK_EQ(got.size(), (size_t)2);
+  if(got.size() == 2){
+    CHECK_EQ(got[0].data, std::string("two"));
+    CHECK_EQ(got[1].id, first + 2);
+  }
+  closeViewer(b);
+
+  // Up to date, nothing to send and nothing missing
+  b = reconnect("/events", idString(first + 2), got);
+  CHECK(lastReplayed);
+  CHECK_EQ(got.size(), (size_t)0);
+  closeViewer(b);
+
+  // The ids of an earlier boot counted from 1 and from somewhere else
+  const char * stale[] = { "1", "2", "3", "4294967295", "junk" };
+  for(const char * id : stale){
+    b = reconnect("/events", id, got);
+    CHECK(!lastReplayed);
+    CHECK_EQ(got.size(), (size_t)0);
+    closeViewer(b);
+  }
+
+  // After a restart the last id a browser kept is from the old numbering
+  rebooted->send("one");
+  rebooted->send("two");
+  CHECK(rebooted->lastId() != events->lastId() - 1);
+  CHECK(!rebooted->thisBoot(events->lastId()));
+  b = reconnect("/rebooted", idString(events->lastId()), got);
+  CHECK(!lastReplayed);
+  CHECK_EQ(got.size(), (size_t)0);
+  closeViewer(b);
+
+  // Too far behind, the oldest events are no longer kept
+  for(int i = 0; i < 4; i++){
+    events->send("more");
+  }
+  b = reconnect("/events", idString(first), got);
+  CHECK(!lastReplayed);
+  CHECK_EQ(got.size(), (size_t)0);
+  closeViewer(b);
+  b = reconnect("/events", idString(first + 2), got);
+  CHECK(lastReplayed);
+  CHECK_EQ(got.size(), (size_t)4);
+  closeViewer(b);
+
+  // Ids passed in are kept, and bound what counts as this boot
+  AsyncEventSource * numbered = new AsyncEventSource("/numbered");
+  numbered->replay(4);
+  numbered->onConnect(onConnect);
+  server->addHandler(numbered);
+  server->begin();
+  numbered->send("ten", NULL, 10);
+  numbered->send("eleven", NULL, 11);
+  CHECK(numbered->thisBoot(10));
+  CHECK(!numbered->thisBoot(9));
+  b = reconnect("/numbered", "10", got);
+  CHECK(lastReplayed);
+  CHECK_EQ(got.size(), (size_t)1);
+  closeViewer(b);
+
+  closeViewer(a);
+  return testResult();
+}
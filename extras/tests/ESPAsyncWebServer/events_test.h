@@ -0,0 +1,82 @@
+/*
+  A browser EventSource over the fake AsyncClient: opens the stream, with the
+  Last-Event-ID it would send after a reconnect, and parses the events.
+*/
+#pragma once
+
+#include "web_test.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct EventsTestEvent {
+  uint32_t id;     // 0 when the event had none
+  std::string event;
+  std::string data;
+};
+
+// Opens the stream at url, what was sent on connect is appended to out
+static inline FakeConnection * eventsTestOpen(const char * url, const char * lastEventId, std::string * out, uint16_t port = 80){
+  FakeConnection * c = fakeConnect(port);
+  if(!c){
+    return NULL;
+  }
+  std::string request = std::string("GET ") + url + " HTTP/1.1\r\n"
+    "Host: esp32.local\r\n"
+    "Accept: text/event-stream\r\n";
+  if(lastEventId){
+    request += std::string("Last-Event-ID: ") + lastEventId + "\r\n";
+  }
+  request += "\r\n";
+  fakeReceive(c, request);
+  std::string response;
+  webTestDrain(c, &response, 5);
+  if(response.compare(0, 15, "HTTP/1.1 200 OK") != 0){
+    if(!c->closed){
+      fakeRemoteClose(c);
+    }
+    delete c;
+    return NULL;
+  }
+  size_t head = response.find("\r\n\r\n");
+  if(out && head != std::string::npos){
+    *out += response.substr(head + 4);
+  }
+  return c;
+}
+
+// Parses the complete events in data and erases them
+static inline std::vector<EventsTestEvent> eventsTestParse(std::string & data){
+  std::vector<EventsTestEvent> events;
+  EventsTestEvent ev = { 0, std::string(), std::string() };
+  size_t p = 0, done = 0;
+  while(true){
+    size_t eol = data.find("\r\n", p);
+    if(eol == std::string::npos){
+      break;
+    }
+    std::string line = data.substr(p, eol - p);
+    p = eol + 2;
+    if(line.empty()){
+      if(!ev.data.empty() || !ev.event.empty() || ev.id){
+        events.push_back(ev);
+      }
+      ev = EventsTestEvent{ 0, std::string(), std::string() };
+      done = p;
+    } else if(line.compare(0, 4, "id: ") == 0){
+      ev.id = strtoul(line.c_str() + 4, NULL, 10);
+    } else if(line.compare(0, 7, "event: ") == 0){
+      ev.event = line.substr(7);
+    } else if(line.compare(0, 6, "data: ") == 0){
+      ev.data += (ev.data.empty() ? "" : "\n") + line.substr(6);
+    }
+  }
+  data.erase(0, done);
+  return events;
+}
+
+// Collects what the server sent on c and parses it
+static inline std::vector<EventsTestEvent> eventsTestReceive(FakeConnection * c, std::string & pending){
+  webTestDrain(c, &pending, 5);
+  return eventsTestParse(pending);
+}
@@ -0,0 +1,129 @@
+/*
+  LinkedList as the WebSocket message queue uses it: a send checks length()
+  against the limit and appends, the ack removes the front, with 32 messages
+  waiting. Also the request headers as SmallVector against LinkedList.
+  The list as it was before is kept below as the baseline.
+*/
+#include "test.h"
+#include "HostAlloc.h"
+#include "Arduino.h"
+#include "StringArray.h"
+
+namespace baseline {
+
+// Singly linked, add() walks to the tail and length() counts
+template <typename T>
+class LinkedList {
+    struct Node {
+      T value;
+      Node * next;
+    };
+    Node * _root;
+    std::function<void(const T&)> _onRemove;
+  public:
+    LinkedList(std::function<void(const T&)> onRemove) : _root(nullptr), _onRemove(onRemove) {}
+    void add(const T & t){
+      Node * it = new Node{ t, nullptr };
+      if(!_root){
+        _root = it;
+      } else {
+        Node * i = _root;
+        while(i->next) i = i->next;
+        i->next = it;
+      }
+    }
+    T & front() const { return _root->value; }
+    size_t length() const {
+      size_t i = 0;
+      for(Node * it = _root; it; it = it->next) i++;
+      return i;
+    }
+    bool remove(const T & t){
+      for(Node * it = _root, * pit = _root; it; pit = it, it = it->next){
+        if(it->value == t){
+          if(it == _root) _root = _root->next;
+          else pit->next = it->next;
+          if(_onRemove) _onRemove(it->value);
+          delete it;
+          return true;
+        }
+      }
+      return false;
+    }
+    void free(){
+      while(_root){
+        Node * it = _root;
+        _root = _root->next;
+        if(_onRemove) _onRemove(it->value);
+        delete it;
+      }
+    }
+};
+
+}
+
+#define QUEUE_DEPTH 32
+
+struct Message {
+  int id;
+};
+
+template<typename List>
+static void queueRound(List & queue, int & next){
+  if(queue.length() < QUEUE_DEPTH + 1){
+    queue.add(new Message{ next++ });
+  }
+  queue.remove(queue.front());
+}
+
+template<typename List>
+static void queueBench(const char * name){
+  List queue([](Message * const & m){ delete m; });
+  int next = 0;
+  for(int i = 0; i < QUEUE_DEPTH; i++){
+    queue.add(new Message{ next++ });
+  }
+  // The oldest message leaves first
+  int first = queue.front()->id;
+  queueRound(queue, next);
+  CHECK_EQ(queue.front()->id, first + 1);
+  CHECK_EQ(queue.length(), (size_t)QUEUE_DEPTH);
+
+  const size_t rounds = 1000000;
+  hostAllocReset();
+  double ns = benchNanos(rounds, [&]{ queueRound(queue, next); });
+  size_t allocs = hostAllocStats().count;
+  CHECK_EQ(queue.length(), (size_t)QUEUE_DEPTH);
+  printf("%-24s %8.1f ns  %4.1f allocations per push/pop\n", name, ns, (double)allocs / rounds);
+  queue.free();
+}
+
+template<typename List>
+static void headerBench(const char * name){
+  size_t seen = 0;
+  const size_t rounds = 200000;
+  hostAllocReset();
+  double ns = benchNanos(rounds, [&]{
+    List headers([](int * const & h){ delete h; });
+    for(int i = 0; i < 8; i++){
+      headers.add(new int(i));
+    }
+    for(const auto & h : headers){
+      seen += *h;
+    }
+    headers.free();
+  });
+  size_t allocs = hostAllocStats().count;
+  CHECK_EQ(seen, rounds * 28);
+  printf("%-24s %8.1f ns  %4.1f allocations per request\n", name, ns, (double)allocs / rounds - 8);
+}
+
+int main(){
+  printf("message queue, %d deep\n", QUEUE_DEPTH);
+  queueBench<baseline::LinkedList<Message*>>("  baseline LinkedList");
+  queueBench<LinkedList<Message*>>("  LinkedList");
+  printf("8 headers, add, iterate, free\n");
+  headerBench<LinkedList<int*>>("  LinkedList");
+  headerBench<SmallVector<int*, 8>>("  SmallVector<8>");
+  return testResult();
+}
@@ -0,0 +1,100 @@
+/*
+  Serves the ESP-DASH page with send_P() and compares the two ways _ack()
+  can hand it to the stack: copied through a send buffer, or referenced in
+  place when it lies in mapped flash. RAM content must always be copied, the
+  stack still reads it after the response is gone.
+*/
+#include "web_test.h"
+#include "HostAlloc.h"
+#include "ESPAsyncWebServer.h"
+#include "soc/soc.h"
+#include "../../../libraries/ESP-DASH/src/webpage.h"
+
+static const uint8_t * content = DASH_HTML;
+
+struct Served {
+  std::string response;
+  FakeConnection stats;
+  size_t windows;
+  size_t peak;
+  double micros;
+};
+
+static Served serve(){
+  Served s;
+  s.response.reserve(DASH_HTML_SIZE + 1024);
+  hostAllocReset();
+  size_t base = hostAllocStats().current;
+  auto start = std::chrono::steady_clock::now();
+  FakeConnection * c = fakeConnect(80);
+  fakeReceive(c, "GET / HTTP/1.1\r\nHost: esp32.local\r\n\r\n");
+  s.windows = 0;
+  while(!c->closed && c->unacked){
+    s.response += c->sent;
+    c->sent.clear();
+    fakeAck(c);
+    s.windows++;
+  }
+  s.response += c->sent;
+  s.micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  s.peak = hostAllocStats().peak - base;
+  s.stats.copied = c->copied;
+  s.stats.referenced = c->referenced;
+  s.stats.references = c->references;
+  if(!c->closed){
+    fakeRemoteClose(c);
+  }
+  delete c;
+  return s;
+}
+
+static bool inside(const std::pair<const char*, size_t> & r, const uint8_t * start, size_t len){
+  return (const uint8_t*)r.first >= start && (const uint8_t*)r.first + r.second <= start + len;
+}
+
+int main(){
+  AsyncWebServer server(80);
+  server.on("/", HTTP_GET, [](AsyncWebServerRequest * request){
+    request->send_P(200, "text/html", content, DASH_HTML_SIZE);
+  });
+  server.begin();
+  const std::string page((const char*)DASH_HTML, DASH_HTML_SIZE);
+
+  // Flash window unset: nothing is mapped, everything goes through a buffer
+  serve();
+  Served copy = serve();
+  CHECK(webTestBody(copy.response) == page);
+  CHECK_EQ(copy.stats.referenced, (size_t)0);
+
+  // Flash window around the page: the body is referenced where it lies
+  mockDromLow = (uintptr_t)DASH_HTML;
+  mockDromHigh = (uintptr_t)(DASH_HTML + DASH_HTML_SIZE);
+  Served mapped = serve();
+  CHECK(webTestBody(mapped.response) == page);
+  CHECK_EQ(mapped.stats.referenced, (size_t)DASH_HTML_SIZE);
+  bool allInFlash = true;
+  for(auto & r : mapped.stats.references){
+    allInFlash = allInFlash && inside(r, DASH_HTML, DASH_HTML_SIZE);
+  }
+  CHECK(allInFlash);
+  CHECK(mapped.peak < copy.peak);
+
+  // The same bytes in RAM are copied even though the window is set
+  std::vector<uint8_t> ram(DASH_HTML, DASH_HTML + DASH_HTML_SIZE);
+  content = ram.data();
+  Served heap = serve();
+  CHECK(webTestBody(heap.response) == page);
+  CHECK_EQ(heap.stats.referenced, (size_t)0);
+
+  // Content running past the end of the window is not mapped either
+  content = DASH_HTML;
+  mockDromHigh = (uintptr_t)(DASH_HTML + DASH_HTML_SIZE - 1);
+  Served straddling = serve();
+  CHECK(webTestBody(straddling.response) == page);
+  CHECK_EQ(straddling.stats.referenced, (size_t)0);
+
+  printf("%-8s %8s %8s %11s %10s %10s\n", "path", "windows", "copied", "referenced", "peak heap", "time");
+  printf("%-8s %8zu %8zu %11zu %10zu %8.0fus\n", "copy", copy.windows, copy.stats.copied, copy.stats.referenced, copy.peak, copy.micros);
+  printf("%-8s %8zu %8zu %11zu %10zu %8.0fus\n", "no-copy", mapped.windows, mapped.stats.copied, mapped.stats.referenced, mapped.peak, mapped.micros);
+  return testResult();
+}
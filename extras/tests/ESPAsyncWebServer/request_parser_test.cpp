@@ -0,0 +1,231 @@
+/*
+  Replays recorded requests through AsyncWebServerRequest split at every byte
+  boundary, and one byte per packet, and checks the parse never depends on
+  where the packets end. Prints the allocations each request costs.
+*/
+#include "web_test.h"
+#include "HostAlloc.h"
+#include "ESPAsyncWebServer.h"
+
+static const char * recorded[] = {
+  // Chrome loading the dashboard
+  "GET / HTTP/1.1\r\n"
+  "Host: 192.168.4.1\r\n"
+  "Connection: keep-alive\r\n"
+  "Upgrade-Insecure-Requests: 1\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/79.0.3945.117 Safari/537.36\r\n"
+  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,image/apng,*/*;q=0.8\r\n"
+  "Accept-Encoding: gzip, deflate, br\r\n"
+  "Accept-Language: en-US,en;q=0.9\r\n"
+  "\r\n",
+  // Query string with escapes, a bare key and folded whitespace in a value
+  "GET /api/set%20value?card=12&name=hello+world&flag&pct=50%25 HTTP/1.1\r\n"
+  "Host: esp32.local\r\n"
+  "X-Long:    spaced   value  \r\n"
+  "Accept: */*\r\n"
+  "\r\n",
+  // Form post with a body
+  "POST /settings HTTP/1.1\r\n"
+  "Host: esp32.local\r\n"
+  "Content-Type: application/x-www-form-urlencoded\r\n"
+  "Content-Length: 27\r\n"
+  "\r\n"
+  "ssid=HiGrow&interval=300&x=",
+  // WebSocket upgrade as ESP-DASH's page sends it
+  "GET /dashws HTTP/1.1\r\n"
+  "Host: 192.168.4.1\r\n"
+  "Connection: Upgrade\r\n"
+  "Upgrade: websocket\r\n"
+  "Sec-WebSocket-Version: 13\r\n"
+  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+  "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n"
+  "\r\n",
+  // Digest credentials, HTTP/1.0, bare \n line ends
+  "GET /admin HTTP/1.0\n"
+  "Host: esp32.local\n"
+  "Authorization: Digest username=\"admin\", realm=\"HiGrow\", nonce=\"0123456789abcdef0123456789abcdef\", uri=\"/admin\", "
+  "qop=auth, nc=00000001, cnonce=\"0a4f113b\", response=\"6629fae49393a05397450978507c4ef1\"\n"
+  "\n",
+  // EventSource reconnect
+  "GET /events HTTP/1.1\r\n"
+  "Host: 192.168.4.1\r\n"
+  "Accept: text/event-stream\r\n"
+  "Cache-Control: no-cache\r\n"
+  "Last-Event-ID: 41\r\n"
+  "\r\n",
+};
+
+static String parsed;
+
+// What a handler sees of the request, as one comparable string
+static void describe(AsyncWebServerRequest * request){
+  parsed = String(request->methodToString()) + " " + request->url() + " v" + String(request->version());
+  parsed += " host=" + request->host();
+  parsed += " type=" + request->contentType() + " len=" + String((unsigned)request->contentLength());
+  parsed += " conn=" + String(request->requestedConnTypeToString());
+  parsed += " br=" + String((int)request->acceptsEncoding("br"));
+  for(size_t i = 0; i < request->headers(); i++){
+    parsed += "\n  " + request->headerName(i) + ": [" + request->header(i) + "]";
+  }
+  for(size_t i = 0; i < request->params(); i++){
+    AsyncWebParameter * p = request->getParam(i);
+    parsed += "\n  " + String(p->isPost() ? "post " : "get ") + p->name() + "=[" + p->value() + "]";
+  }
+}
+
+static std::string replay(const std::string & request, size_t split, bool bytewise){
+  parsed = "";
+  std::vector<std::string> pieces;
+  if(bytewise){
+    for(char c : request){
+      pieces.push_back(std::string(1, c));
+    }
+  } else {
+    pieces.push_back(request.substr(0, split));
+    pieces.push_back(request.substr(split));
+  }
+  webTestExchange(pieces);
+  return parsed.c_str();
+}
+
+// A handler that takes everything and only wants one header
+class OneHeaderHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest * request) override {
+    request->addInterestingHeader("X-Keep");
+    return true;
+  }
+  void handleRequest(AsyncWebServerRequest * request) override {
+    seenHeaders = request->headers();
+    keep = request->header("X-Keep");
+    dropVisible = request->hasHeader("X-Drop-0");
+    request->send(204);
+  }
+  bool isRequestHandlerTrivial() override { return false; }
+  size_t seenHeaders = 0;
+  String keep;
+  bool dropVisible = true;
+};
+
+static std::string withHeaders(size_t count){
+  std::string r = "GET /x HTTP/1.1\r\nHost: h\r\nX-Keep: yes\r\n";
+  for(size_t i = 0; i < count; i++){
+    r += "X-Drop-" + std::to_string(i) + ": some value that nobody reads\r\n";
+  }
+  return r + "\r\n";
+}
+
+static void testSplits(){
+  AsyncWebServer server(80);
+  server.onNotFound(describe);
+  server.begin();
+
+  for(const char * r : recorded){
+    std::string request = r;
+    std::string reference = replay(request, request.size(), false);
+    CHECK(reference.size() > 0);
+    size_t mismatches = 0;
+    for(size_t split = 1; split < request.size(); split++){
+      if(replay(request, split, false) != reference){
+        if(!mismatches++){
+          fprintf(stderr, "split at %zu differs:\n%s\nexpected:\n%s\n", split, parsed.c_str(), reference.c_str());
+        }
+      }
+    }
+    if(replay(request, 0, true) != reference){
+      fprintf(stderr, "bytewise differs:\n%s\nexpected:\n%s\n", parsed.c_str(), reference.c_str());
+      mismatches++;
+    }
+    CHECK_EQ(mismatches, (size_t)0);
+  }
+
+  // Spot checks of what the reference parse found
+  replay(recorded[1], 7, false);
+  std::string p = parsed.c_str();
+  CHECK(p.find("GET /api/set value v1") == 0);
+  CHECK(p.find("get name=[hello world]") != std::string::npos);
+  CHECK(p.find("get flag=[]") != std::string::npos);
+  CHECK(p.find("get pct=[50%]") != std::string::npos);
+  CHECK(p.find("X-Long: [spaced   value]") != std::string::npos);
+
+  replay(recorded[2], 100, false);
+  p = parsed.c_str();
+  CHECK(p.find("POST /settings") == 0);
+  CHECK(p.find("post interval=[300]") != std::string::npos);
+  CHECK(p.find("post x=[]") != std::string::npos);
+
+  replay(recorded[3], 3, false);
+  CHECK(std::string(parsed.c_str()).find("conn=RCT_WS") != std::string::npos);
+  replay(recorded[5], 30, false);
+  CHECK(std::string(parsed.c_str()).find("conn=RCT_EVENT") != std::string::npos);
+  replay(recorded[4], 50, false);
+  p = parsed.c_str();
+  CHECK(p.find("GET /admin v0 host=esp32.local") == 0);
+  CHECK(p.find("response=\"6629fae49393a05397450978507c4ef1\"]") != std::string::npos);
+}
+
+static void testInterestingHeaders(){
+  AsyncWebServer server(80);
+  OneHeaderHandler * handler = new OneHeaderHandler();
+  server.addHandler(handler);
+  server.begin();
+
+  webTestExchange({ withHeaders(20) });
+  CHECK_EQ(handler->seenHeaders, (size_t)1);
+  CHECK_EQ(std::string(handler->keep.c_str()), std::string("yes"));
+  CHECK(!handler->dropVisible);
+
+  // Headers nobody asked for cost nothing: 2 or 20 of them, same allocations
+  std::vector<std::string> two = { withHeaders(2) };
+  std::vector<std::string> twenty = { withHeaders(20) };
+  webTestExchange(two);
+  hostAllocReset();
+  webTestExchange(two);
+  size_t few = hostAllocStats().count;
+  hostAllocReset();
+  webTestExchange(twenty);
+  size_t many = hostAllocStats().count;
+  CHECK_EQ(many, few);
+
+  // Too many header bytes for the arena is a 431, not a bigger heap
+  std::string huge = "GET /x HTTP/1.1\r\nX-Big: " + std::string(WEB_REQUEST_HEAD_SIZE, 'a') + "\r\n\r\n";
+  std::string answer = webTestExchange({ huge.substr(0, 20), huge.substr(20) });
+  CHECK(answer.find("HTTP/1.1 431") == 0);
+}
+
+static void reportAllocations(){
+  // A handler that answers without reading anything, so only the server's own cost is counted
+  AsyncWebServer server(80);
+  server.onNotFound([](AsyncWebServerRequest * request){ request->send(200); });
+  server.begin();
+
+  printf("%-40s %8s %8s %10s\n", "request", "whole", "split", "peak bytes");
+  for(const char * r : recorded){
+    std::string request = r;
+    std::vector<std::string> pieces = { request };
+    webTestExchange(pieces);
+    hostAllocReset();
+    size_t base = hostAllocStats().current;
+    webTestExchange(pieces);
+    HostAllocStats whole = hostAllocStats();
+    size_t splitAllocs = 0;
+    for(size_t split = 1; split < request.size(); split++){
+      pieces = { request.substr(0, split), request.substr(split) };
+      hostAllocReset();
+      webTestExchange(pieces);
+      splitAllocs += hostAllocStats().count;
+    }
+    std::string line = request.substr(0, request.find('\n'));
+    while(!line.empty() && line.back() == '\r'){
+      line.pop_back();
+    }
+    printf("%-40.40s %8zu %8.1f %10zu\n", line.c_str(), whole.count, (double)splitAllocs / (request.size() - 1), whole.peak - base);
+  }
+}
+
+int main(){
+  testSplits();
+  testInterestingHeaders();
+  reportAllocations();
+  return testResult();
+}
@@ -0,0 +1,86 @@
+/*
+  Handler dispatch with the compiled route table against the linear walk over
+  the handler list, with 5, 50 and 500 routes. Both must pick the same handler.
+*/
+#include "web_test.h"
+#include "ESPAsyncWebServer.h"
+#include "WebHandlerImpl.h"
+#include "WebRouteTable.h"
+
+static AsyncWebServerRequest * held = NULL;
+
+// Leaves the request open so it can be dispatched over and over
+static AsyncWebServerRequest * openRequest(const std::string & method, const std::string & url, FakeConnection ** connection){
+  held = NULL;
+  *connection = fakeConnect(80);
+  fakeReceive(*connection, method + " " + url + " HTTP/1.1\r\nHost: esp32.local\r\n\r\n");
+  return held;
+}
+
+static AsyncWebHandler * linear(const LinkedList<AsyncWebHandler*> & handlers, AsyncWebServerRequest * request){
+  for(const auto & h : handlers){
+    if(h->filter(request) && h->canHandle(request)){
+      return h;
+    }
+  }
+  return NULL;
+}
+
+static void addRoute(LinkedList<AsyncWebHandler*> & handlers, const String & uri, WebRequestMethodComposite method){
+  AsyncCallbackWebHandler * h = new AsyncCallbackWebHandler();
+  h->setUri(uri);
+  h->setMethod(method);
+  h->onRequest([](AsyncWebServerRequest *){});
+  handlers.add(h);
+}
+
+int main(){
+  AsyncWebServer server(80);
+  server.onNotFound([](AsyncWebServerRequest * request){ held = request; });
+  server.begin();
+
+  static const char * urls[][2] = {
+    { "GET", "/" },
+    { "GET", "/api/3/3" },
+    { "GET", "/api/3/3/sub" },
+    { "GET", "/api/36/499" },
+    { "POST", "/p10" },
+    { "GET", "/p10" },
+    { "GET", "/static/css/app.css" },
+    { "GET", "/nothing/here" },
+  };
+
+  printf("%-6s %-25s %12s %12s\n", "routes", "request", "table ns", "linear ns");
+  for(int n : { 5, 50, 500 }){
+    LinkedList<AsyncWebHandler*> handlers([](AsyncWebHandler * h){ delete h; });
+    LinkedList<AsyncWebRewrite*> rewrites([](AsyncWebRewrite * r){ delete r; });
+    addRoute(handlers, "/", HTTP_GET);
+    for(int i = 0; i < n - 1; i++){
+      addRoute(handlers, String("/api/") + String(i % 37) + "/" + String(i), HTTP_GET);
+      if(i % 10 == 0){
+        addRoute(handlers, String("/p") + String(i), HTTP_POST);
+      }
+    }
+    addRoute(handlers, "/static/*", HTTP_GET);
+
+    AsyncWebRouteTable table;
+    CHECK(table.build(handlers, rewrites));
+
+    for(const auto & u : urls){
+      FakeConnection * c;
+      AsyncWebServerRequest * request = openRequest(u[0], u[1], &c);
+      CHECK(request != NULL);
+      if(!request){
+        continue;
+      }
+      CHECK(table.attach(request) == linear(handlers, request));
+      size_t rounds = 2000000 / (n + 20);
+      double tableNs = benchNanos(rounds, [&]{ table.attach(request); });
+      double linearNs = benchNanos(rounds, [&]{ linear(handlers, request); });
+      printf("%-6d %-4s %-20s %12.0f %12.0f\n", n, u[0], u[1], tableNs, linearNs);
+      fakeRemoteClose(c);
+      delete c;
+    }
+  }
+  return testResult();
+}
@@ -0,0 +1,108 @@
+/*
+  Streams large responses through the fake client with the peer acking every
+  send window, and counts what the heap sees on the way. With pooled send
+  buffers the allocations of a response do not grow with its size.
+*/
+#include "web_test.h"
+#include "HostAlloc.h"
+#include "ESPAsyncWebServer.h"
+
+static std::string body;
+
+static size_t fill(uint8_t * buffer, size_t maxLen, size_t index){
+  size_t n = std::min(maxLen, body.size() - index);
+  memcpy(buffer, body.data() + index, n);
+  return n;
+}
+
+struct Streamed {
+  HostAllocStats heap;
+  size_t base;
+  size_t windows;
+  bool intact;
+};
+
+// Unlike take() this keeps the capacity of the fake's send log, so the
+// harness itself does not allocate once per window
+static void collect(FakeConnection * c, std::string & response){
+  response += c->sent;
+  c->sent.clear();
+}
+
+// With refuse set the stack turns down the headers and every third window,
+// what add() did not take must still go out once, in order
+static Streamed stream(const char * url, size_t size, bool refuse = false){
+  std::string request = std::string("GET ") + url + " HTTP/1.1\r\nHost: esp32.local\r\n\r\n";
+  std::vector<std::string> pieces = { request };
+  body.resize(size);
+  std::string response;
+  response.reserve(size + 4096);
+  Streamed s;
+  hostAllocReset();
+  s.base = hostAllocStats().current;
+  FakeConnection * c = fakeConnect(80);
+  c->refuse = refuse;
+  fakeReceive(c, request);
+  c->refuse = false;
+  s.windows = 0;
+  while(!c->closed && s.windows < 10000){
+    collect(c, response);
+    if(!c->unacked){
+      fakePoll(c);
+      if(!c->unacked){
+        break;
+      }
+    }
+    c->refuse = refuse && s.windows % 3 == 1;
+    fakeAck(c);
+    c->refuse = false;
+    s.windows++;
+  }
+  collect(c, response);
+  s.heap = hostAllocStats();
+  if(!c->closed){
+    fakeRemoteClose(c);
+  }
+  delete c;
+  s.intact = webTestBody(response) == body;
+  return s;
+}
+
+int main(){
+  body.resize(200 * 1024);
+  for(size_t i = 0; i < body.size(); i++){
+    body[i] = 'a' + (i * 7) % 26;
+  }
+  const std::string pattern = body;
+
+  AsyncWebServer server(80);
+  server.on("/sized", HTTP_GET, [](AsyncWebServerRequest * request){
+    request->send("application/octet-stream", body.size(), fill);
+  });
+  server.on("/chunked", HTTP_GET, [](AsyncWebServerRequest * request){
+    request->sendChunked("application/octet-stream", fill);
+  });
+  server.begin();
+
+  printf("%-9s %7s %8s %7s %9s %10s %11s\n", "response", "size", "windows", "allocs", "per window", "bytes", "peak bytes");
+  for(const char * url : { "/sized", "/chunked" }){
+    // The first response fills the pool, after that it is reused
+    body = pattern;
+    stream(url, 20 * 1024);
+    size_t allocs[2];
+    int i = 0;
+    for(size_t size : { (size_t)20 * 1024, (size_t)200 * 1024 }){
+      body = pattern;
+      Streamed s = stream(url, size);
+      CHECK(s.intact);
+      allocs[i++] = s.heap.count;
+      printf("%-9s %6zuK %8zu %7zu %9.2f %10zu %11zu\n", url, size / 1024, s.windows, s.heap.count,
+             (double)s.heap.count / s.windows, s.heap.bytes, s.heap.peak - s.base);
+    }
+    // Ten times the body, ten times the windows, same allocations
+    CHECK_EQ(allocs[1], allocs[0]);
+    body = pattern;
+    CHECK(stream(url, 20 * 1024, true).intact);
+  }
+  return testResult();
+}
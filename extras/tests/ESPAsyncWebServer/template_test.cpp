@@ -0,0 +1,119 @@
+/*
+  Renders AsyncWebTemplate pages through _fillBuffer() at every buffer size
+  from one byte up, so placeholders and values are cut at each possible
+  point, and once through the server. Unterminated and oversized
+  placeholders stay literal text, an empty template renders nothing.
+*/
+#include "web_test.h"
+#include "ESPAsyncWebServer.h"
+#include "AsyncWebTemplate.h"
+
+static std::string longValue(size_t n){
+  std::string s;
+  for(size_t i = 0; i < n; i++){
+    s += 'A' + i % 26;
+  }
+  return s;
+}
+
+// Everything the response renders with buffers of len bytes
+static std::string render(const AsyncWebTemplate & tpl, size_t len){
+  AsyncTemplateResponse response(200, "text/html", tpl);
+  std::vector<uint8_t> buf(len);
+  std::string out;
+  for(int rounds = 0; rounds < 100000; rounds++){
+    size_t n = response._fillBuffer(buf.data(), len);
+    if(!n){
+      break;
+    }
+    out.append((const char*)buf.data(), n);
+  }
+  return out;
+}
+
+static bool renders(const AsyncWebTemplate & tpl, const std::string & expected, size_t maxLen){
+  bool ok = true;
+  for(size_t len = 1; len <= maxLen; len++){
+    std::string out = render(tpl, len);
+    if(out != expected){
+      fprintf(stderr, "buffer of %zu: %s\n", len, out.c_str());
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static int bound(char * buf, size_t len, const std::string & value){
+  return snprintf(buf, len, "%s", value.c_str());
+}
+
+int main(){
+  const std::string mid = longValue(100);
+  const std::string big = longValue(300);
+
+  // Short and long values, a name used twice, escapes next to placeholders
+  static const char page[] = "<p>%a%|%mid%|%%%a%%%|%unbound%|%a%%mid%</p>";
+  AsyncWebTemplate tpl(page);
+  CHECK(tpl.valid());
+  CHECK_EQ(tpl.placeholders(), (size_t)8);
+  CHECK(tpl.bind("a", [](char * buf, size_t len){ return (size_t)snprintf(buf, len, "x"); }));
+  CHECK(tpl.bind("mid", [&](char * buf, size_t len){ return (size_t)bound(buf, len, mid); }));
+  CHECK(!tpl.bind("missing", [](char *, size_t){ return (size_t)0; }));
+  std::string expected = "<p>x|" + mid + "|%x%||x" + mid + "</p>";
+  CHECK(renders(tpl, expected, 2 * WEB_TEMPLATE_VALUE_LENGTH + 8));
+
+  // A value longer than WEB_TEMPLATE_VALUE_LENGTH is cut, wherever it lands
+  static const char cut[] = "[%big%][%big%]";
+  AsyncWebTemplate cutTpl(cut);
+  CHECK(cutTpl.bind("big", [&](char * buf, size_t len){ return (size_t)bound(buf, len, big); }));
+  std::string part = big.substr(0, WEB_TEMPLATE_VALUE_LENGTH - 1);
+  CHECK(renders(cutTpl, "[" + part + "][" + part + "]", 2 * WEB_TEMPLATE_VALUE_LENGTH + 8));
+
+  // Unterminated, split by whitespace, or a name one past the limit: all literal
+  std::string name(TEMPLATE_PARAM_NAME_LENGTH, 'n');
+  std::string literal = "50% off, 10 % 3, %" + name + "n% and %a";
+  AsyncWebTemplate literalTpl((const uint8_t*)literal.data(), literal.size());
+  CHECK_EQ(literalTpl.placeholders(), (size_t)0);
+  CHECK(!literalTpl.bind("a", [](char *, size_t){ return (size_t)0; }));
+  CHECK(renders(literalTpl, literal, 64));
+
+  // The longest name that is still a placeholder
+  std::string longest = "<%" + name + "%>";
+  AsyncWebTemplate longestTpl((const uint8_t*)longest.data(), longest.size());
+  CHECK_EQ(longestTpl.placeholders(), (size_t)1);
+  CHECK(longestTpl.bind(name.c_str(), [](char * buf, size_t len){ return (size_t)snprintf(buf, len, "ok"); }));
+  CHECK(renders(longestTpl, "<ok>", 16));
+
+  // A trailing '%' is not an escape
+  static const char trailing[] = "100%";
+  AsyncWebTemplate trailingTpl(trailing);
+  CHECK_EQ(trailingTpl.placeholders(), (size_t)0);
+  CHECK(renders(trailingTpl, "100%", 8));
+
+  static const char empty[] = "";
+  AsyncWebTemplate emptyTpl(empty);
+  CHECK(emptyTpl.valid());
+  CHECK_EQ(emptyTpl.placeholders(), (size_t)0);
+  CHECK_EQ(render(emptyTpl, 16), std::string());
+
+  AsyncWebServer server(80);
+  server.on("/page", HTTP_GET, [&](AsyncWebServerRequest * request){
+    request->send(200, "text/html", tpl);
+  });
+  server.on("/empty", HTTP_GET, [&](AsyncWebServerRequest * request){
+    request->send(200, "text/html", emptyTpl);
+  });
+  server.begin();
+
+  std::string response = webTestExchange({ "GET /page HTTP/1.1\r\nHost: esp32.local\r\n\r\n" });
+  CHECK(response.find("Transfer-Encoding: chunked") != std::string::npos);
+  CHECK_EQ(webTestBody(response), expected);
+
+  response = webTestExchange({ "GET /empty HTTP/1.1\r\nHost: esp32.local\r\n\r\n" });
+  CHECK(response.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+  // Just the last chunk, its size padded like every other
+  CHECK(response.find("\r\n\r\n0   \r\n\r\n") != std::string::npos);
+  CHECK_EQ(webTestBody(response), std::string());
+
+  return testResult();
+}
@@ -0,0 +1,75 @@
+/*
+  Drives one connection of a server through the fake AsyncClient.
+*/
+#pragma once
+
+#include "test.h"
+#include "AsyncTCPFake.h"
+
+#include <string>
+#include <vector>
+
+// Acks and polls until the server closes the connection or stops writing
+static inline void webTestDrain(FakeConnection * c, std::string * out, int rounds = 1000){
+  int idle = 0;
+  while(rounds-- && !c->closed && idle < 3){
+    bool pending = c->unacked != 0;
+    std::string sent = c->take();
+    if(out){
+      *out += sent;
+    }
+    fakeAck(c);
+    fakePoll(c);
+    idle = (!pending && !c->unacked) ? idle + 1 : 0;
+  }
+  if(out){
+    *out += c->take();
+  }
+}
+
+// Sends a request in the given pieces and returns everything the server answered
+static inline std::string webTestExchange(const std::vector<std::string> & pieces, uint16_t port = 80){
+  std::string out;
+  FakeConnection * c = fakeConnect(port);
+  if(!c){
+    return out;
+  }
+  for(const std::string & piece : pieces){
+    fakeReceive(c, piece);
+    out += c->take();
+  }
+  webTestDrain(c, &out);
+  if(!c->closed){
+    fakeRemoteClose(c);
+  }
+  delete c;
+  return out;
+}
+
+// Body of an HTTP response, chunked transfer coding undone
+static inline std::string webTestBody(const std::string & response){
+  size_t start = response.find("\r\n\r\n");
+  if(start == std::string::npos){
+    return std::string();
+  }
+  std::string head = response.substr(0, start);
+  std::string body = response.substr(start + 4);
+  if(head.find("Transfer-Encoding: chunked") == std::string::npos){
+    return body;
+  }
+  std::string out;
+  size_t p = 0;
+  while(p < body.size()){
+    size_t eol = body.find("\r\n", p);
+    if(eol == std::string::npos){
+      break;
+    }
+    size_t len = strtoul(body.substr(p, eol - p).c_str(), NULL, 16);
+    if(!len){
+      break;
+    }
+    out += body.substr(eol + 2, len);
+    p = eol + 2 + len + 2;
+  }
+  return out;
+}
@@ -0,0 +1,243 @@
+/*
+  permessage-deflate against zlib as the reference peer: what the deflater
+  writes inflates with zlib at every window size, with and without context
+  takeover, webSocketInflate() reads what zlib writes, and a negotiated socket
+  keeps the client's LZ77 history in step even when the queue drops or
+  coalesces messages around a failed send.
+*/
+#include "ws_test.h"
+#include "ESPAsyncWebServer.h"
+#include "AsyncWebSocketDeflate.h"
+
+#include <algorithm>
+#include <zlib.h>
+
+// A client inflater, keeping its window from one message to the next unless reset
+struct Inflater {
+  z_stream z;
+  Inflater(){ memset(&z, 0, sizeof(z)); inflateInit2(&z, -15); }
+  ~Inflater(){ inflateEnd(&z); }
+  void reset(){ inflateReset(&z); }
+  bool message(const std::string & in, std::string & out){
+    std::string data = in + std::string("\x00\x00\xff\xff", 4);
+    out.clear();
+    z.next_in = (Bytef *)&data[0];
+    z.avail_in = data.size();
+    char buf[1024];
+    while(z.avail_in){
+      z.next_out = (Bytef *)buf;
+      z.avail_out = sizeof(buf);
+      int r = inflate(&z, Z_SYNC_FLUSH);
+      if(r != Z_OK && r != Z_BUF_ERROR && r != Z_STREAM_END){
+        return false;
+      }
+      out.append(buf, sizeof(buf) - z.avail_out);
+      if(r != Z_OK){
+        break;
+      }
+    }
+    return true;
+  }
+};
+
+// A message as zlib would send it, the 00 00 FF FF tail cut off
+static std::string zlibDeflate(const std::string & in, int level, bool final = false){
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  deflateInit2(&z, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+  std::string out(in.size() + 64, '\0');
+  z.next_in = (Bytef *)in.data();
+  z.avail_in = in.size();
+  z.next_out = (Bytef *)&out[0];
+  z.avail_out = out.size();
+  deflate(&z, final ? Z_FINISH : Z_SYNC_FLUSH);
+  out.resize(out.size() - z.avail_out);
+  deflateEnd(&z);
+  if(!final){
+    out.resize(out.size() - 4);
+  }
+  return out;
+}
+
+static std::string cardUpdate(int i){
+  static const char * kinds[] = { "updateTemperatureCard", "updateHumidityCard", "updateNumberCard" };
+  return std::string("{\"response\":\"") + kinds[i % 3] + "\",\"id\":\"card" + std::to_string(i % 12) +
+         "\",\"value\":" + std::to_string((i * 37) % 101) + "}";
+}
+
+static std::vector<std::string> traffic(){
+  std::vector<std::string> messages;
+  for(int i = 0; i < 1500; i++){
+    messages.push_back(cardUpdate(i));
+  }
+  std::string noise;
+  srand(7692);
+  for(int i = 0; i < 700; i++){
+    noise += (char)rand();
+  }
+  messages.push_back(noise);
+  messages.push_back("");
+  messages.push_back("a");
+  messages.push_back(std::string(1350, 'a'));
+  for(int i = 0; i < 100; i++){
+    messages.push_back(cardUpdate(i * 7));
+  }
+  return messages;
+}
+
+static std::vector<std::string> received;
+
+static void onEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t * data, size_t len){
+  if(type == WS_EVT_DATA){
+    received.push_back(std::string((const char *)data, len));
+  }
+}
+
+// Acks what the server sent and inflates every frame the way the client would
+static bool readMessages(FakeConnection * c, Inflater & client, std::vector<std::string> & messages){
+  std::string wire;
+  webTestDrain(c, &wire, 50);
+  bool ok = true;
+  for(const WsTestFrame & f : wsTestFrames(wire)){
+    std::string plain = f.payload;
+    if(f.rsv1){
+      ok = client.message(f.payload, plain) && ok;
+    }
+    messages.push_back(plain);
+  }
+  return ok;
+}
+
+int main(){
+  const std::vector<std::string> messages = traffic();
+
+  // The deflater at every window size, zlib inflating with the window it keeps
+  for(int bits = 8; bits <= 15; bits++){
+    for(bool noContext : { false, true }){
+      AsyncWebSocketDeflater deflater(bits, noContext);
+      CHECK(deflater.valid());
+      Inflater client;
+      size_t raw = 0, sent = 0, bad = 0;
+      for(const std::string & m : messages){
+        uint8_t * out = NULL;
+        size_t len = deflater.compress((const uint8_t *)m.data(), m.size(), &out);
+        raw += m.size();
+        if(len){
+          if(noContext){
+            client.reset();
+          }
+          std::string plain;
+          bad += !client.message(std::string((const char *)out, len), plain) || plain != m;
+          sent += len;
+        } else {
+          // Sent as it is, the deflater starts over and the client window can stay
+          sent += m.size();
+        }
+        free(out);
+      }
+      CHECK_EQ(bad, (size_t)0);
+      CHECK(sent < raw);
+    }
+  }
+
+  // webSocketInflate() on what zlib writes
+  std::vector<std::string> inputs(messages.begin(), messages.begin() + 300);
+  inputs.push_back(std::string(4000, 'x'));
+  inputs.push_back(messages[1500]);
+  const int levels[] = { 1, 6, 9 };
+  size_t inflated = 0;
+  for(size_t i = 0; i < inputs.size(); i++){
+    std::string packed = zlibDeflate(inputs[i], levels[i % 3], i == inputs.size() - 1);
+    if(i != inputs.size() - 1){
+      packed += std::string("\x00\x00\xff\xff", 4);
+    }
+    std::string out(WS_DEFLATE_MAX_MESSAGE, '\0');
+    size_t outLen = out.size();
+    if(webSocketInflate((const uint8_t *)packed.data(), packed.size(), (uint8_t *)&out[0], &outLen) && out.substr(0, outLen) == inputs[i]){
+      inflated++;
+    }
+  }
+  CHECK_EQ(inflated, inputs.size());
+  std::string big = zlibDeflate(std::string(WS_DEFLATE_MAX_MESSAGE + 1, 'y'), 6) + std::string("\x00\x00\xff\xff", 4);
+  std::string out(WS_DEFLATE_MAX_MESSAGE, '\0');
+  size_t outLen = out.size();
+  bool full = false;
+  CHECK(!webSocketInflate((const uint8_t *)big.data(), big.size(), (uint8_t *)&out[0], &outLen, &full));
+  CHECK(full);
+  std::string garbage = "\xff\xff\xff\xff\xff\xff";
+  outLen = out.size();
+  CHECK(!webSocketInflate((const uint8_t *)garbage.data(), garbage.size(), (uint8_t *)&out[0], &outLen, &full));
+  CHECK(!full);
+
+  // A negotiated socket, both ways
+  AsyncWebServer server(80);
+  AsyncWebSocket * ws = new AsyncWebSocket("/ws");
+  ws->deflate(true);
+  ws->onEvent(onEvent);
+  server.addHandler(ws);
+  server.begin();
+  FakeConnection * c = wsTestOpen("/ws", "permessage-deflate; client_max_window_bits");
+  CHECK(c != NULL);
+  if(!c){
+    return testResult();
+  }
+  Inflater client;
+  std::vector<std::string> got;
+  bool ok = true;
+  for(size_t i = 0; i < 200; i++){
+    ws->textAll(messages[i].c_str(), messages[i].size());
+    ok = readMessages(c, client, got) && ok;
+  }
+  CHECK(ok);
+  CHECK(got == std::vector<std::string>(messages.begin(), messages.begin() + 200));
+
+  const uint8_t mask[4] = { 1, 2, 3, 4 };
+  fakeReceive(c, wsTestFrame(WS_TEXT, zlibDeflate(messages[5], 6), mask, true, true));
+  CHECK_EQ(received.size(), (size_t)1);
+  CHECK(!received.empty() && received[0] == messages[5]);
+
+  // A message that was compressed and then failed to send is in the history already,
+  // dropping or coalescing it would leave the client unable to follow the next ones
+  AsyncWebSocketClient * wsClient = ws->client(1);
+  CHECK(wsClient != NULL);
+  for(AwsQueuePolicy policy : { WS_QUEUE_DROP_OLDEST, WS_QUEUE_COALESCE }){
+    wsClient->queuePolicy(policy);
+    c->refuse = true;
+    std::vector<std::string> queued;
+    for(int i = 0; i <= WS_MAX_QUEUED_MESSAGES + 2; i++){
+      std::string m = cardUpdate(i);
+      AsyncWebSocketMessageBuffer * buffer = ws->makeBuffer(m.size());
+      memcpy(buffer->get(), m.data(), m.size());
+      wsClient->text(buffer, 1);
+      queued.push_back(m);
+    }
+    c->refuse = false;
+    got.clear();
+    ok = readMessages(c, client, got);
+    CHECK(ok);
+    CHECK(!got.empty() && got[0] == queued[0]);
+    for(const std::string & m : got){
+      ok = ok && std::find(queued.begin(), queued.end(), m) != queued.end();
+    }
+    CHECK(ok);
+    // And the next message still inflates against the client's window
+    got.clear();
+    ws->textAll(messages[0].c_str(), messages[0].size());
+    CHECK(readMessages(c, client, got));
+    CHECK(got.size() == 1 && got[0] == messages[0]);
+  }
+
+  // Too big once inflated closes with 1009, the compressed frame itself is small
+  c->take();
+  fakeReceive(c, wsTestFrame(WS_TEXT, zlibDeflate(std::string(WS_DEFLATE_MAX_MESSAGE + 1, 'y'), 6), mask, true, true));
+  std::string closing = c->take();
+  std::vector<WsTestFrame> frames = wsTestFrames(closing);
+  CHECK(frames.size() == 1 && frames[0].opcode == WS_DISCONNECT);
+  CHECK(!frames.empty() && frames[0].payload.substr(0, 2) == std::string("\x03\xf1", 2));
+
+  if(!c->closed){
+    fakeRemoteClose(c);
+  }
+  delete c;
+  return testResult();
+}
@@ -0,0 +1,193 @@
+/*
+  Client frames cut into TCP segments at every point: a header that ends
+  with its segment raises no empty data event, split control frames are
+  answered once complete and a close reason is passed on by its length,
+  reassemble() delivers whole messages up to its limit and closes with 1009
+  past it, and onMessageStream() gets a message in order across frames.
+*/
+#include "ws_test.h"
+#include "ESPAsyncWebServer.h"
+
+struct Event {
+  AwsEventType type;
+  std::string data;
+  uint16_t code;
+  bool final;
+};
+
+static std::vector<Event> events;
+
+static void onEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t * data, size_t len){
+  if(type != WS_EVT_DATA && type != WS_EVT_ERROR){
+    return;
+  }
+  Event e;
+  e.type = type;
+  e.data.assign((const char *)data, len);
+  e.code = (type == WS_EVT_ERROR) ? *(uint16_t *)arg : 0;
+  e.final = (type == WS_EVT_DATA) && ((AwsFrameInfo *)arg)->final;
+  if(type == WS_EVT_ERROR){
+    // Passed on as a string
+    CHECK_EQ(data[len], (uint8_t)0);
+  }
+  events.push_back(e);
+}
+
+struct Part {
+  std::string data;
+  size_t index;
+  bool final;
+};
+
+static std::vector<Part> parts;
+
+static const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+// Sends wire in segments cut at the given offsets
+static void sendCut(FakeConnection * c, const std::string & wire, std::vector<size_t> cuts){
+  size_t from = 0;
+  cuts.push_back(wire.size());
+  for(size_t cut : cuts){
+    if(cut > from){
+      fakeReceive(c, wire.substr(from, cut - from));
+      from = cut;
+    }
+  }
+}
+
+// What the server sent back, acked
+static std::vector<WsTestFrame> answers(FakeConnection * c){
+  std::string wire = c->take();
+  fakeAck(c);
+  return wsTestFrames(wire);
+}
+
+static std::string concat(const std::vector<Event> & list){
+  std::string out;
+  for(const Event & e : list){
+    out += e.data;
+  }
+  return out;
+}
+
+int main(){
+  AsyncWebServer server(80);
+  AsyncWebSocket * ws = new AsyncWebSocket("/ws");
+  ws->onEvent(onEvent);
+  server.addHandler(ws);
+  AsyncWebSocket * stream = new AsyncWebSocket("/stream");
+  stream->onMessageStream([](AsyncWebSocket *, AsyncWebSocketClient *, uint8_t opcode, uint8_t * data, size_t len, size_t index, bool final){
+    parts.push_back({ std::string((const char *)data, len), index, final });
+  });
+  server.addHandler(stream);
+  server.begin();
+
+  FakeConnection * c = wsTestOpen("/ws");
+  CHECK(c != NULL);
+  if(!c){
+    return testResult();
+  }
+
+  // A header cut anywhere, and cut off from its payload: one event per payload piece, none empty
+  std::string hello = wsTestFrame(WS_TEXT, "hello", mask);
+  for(size_t cut = 1; cut < hello.size(); cut++){
+    events.clear();
+    sendCut(c, hello, { cut });
+    bool ok = !events.empty() && concat(events) == "hello" && events.back().final;
+    for(const Event & e : events){
+      ok = ok && e.type == WS_EVT_DATA && !e.data.empty();
+    }
+    CHECK(ok);
+  }
+  events.clear();
+  sendCut(c, hello, { 1, 6 });
+  CHECK_EQ(events.size(), (size_t)1);
+
+  // An empty frame whose header ends the segment is still a message
+  events.clear();
+  fakeReceive(c, wsTestFrame(WS_TEXT, "", mask));
+  CHECK(events.size() == 1 && events[0].data.empty() && events[0].final);
+
+  // A ping cut anywhere is answered once, with its payload
+  c->take();
+  std::string ping = wsTestFrame(WS_PING, "abc", mask);
+  for(size_t cut = 1; cut < ping.size(); cut++){
+    sendCut(c, ping, { cut });
+    std::vector<WsTestFrame> sent = answers(c);
+    CHECK(sent.size() == 1 && sent[0].opcode == WS_PONG && sent[0].payload == "abc");
+  }
+  // also between the pieces of a fragmented message
+  events.clear();
+  std::string wire = wsTestFrame(WS_TEXT, "first ", mask, false) + ping + wsTestFrame(WS_CONTINUATION, "second", mask);
+  sendCut(c, wire, { 3, 10, 14, 17 });
+  CHECK_EQ(concat(events), std::string("first second"));
+  std::vector<WsTestFrame> sent = answers(c);
+  CHECK(sent.size() == 1 && sent[0].opcode == WS_PONG && sent[0].payload == "abc");
+
+  // reassemble(): whole messages up to the limit however they are cut
+  ws->reassemble(16);
+  for(size_t cut = 1; cut < 24; cut++){
+    events.clear();
+    wire = wsTestFrame(WS_TEXT, "01234567", mask, false) + wsTestFrame(WS_CONTINUATION, "89abcdef", mask);
+    sendCut(c, wire, { cut, cut + 7 });
+    CHECK(events.size() == 1 && events[0].data == "0123456789abcdef" && events[0].final);
+  }
+  // one byte more closes with 1009
+  events.clear();
+  c->take();
+  wire = wsTestFrame(WS_TEXT, "01234567", mask, false) + wsTestFrame(WS_CONTINUATION, "89abcdefg", mask);
+  sendCut(c, wire, { 5, 14 });
+  CHECK(events.empty());
+  sent = answers(c);
+  CHECK(sent.size() == 1 && sent[0].opcode == WS_DISCONNECT && sent[0].payload.substr(0, 2) == std::string("\x03\xf1", 2));
+  if(!c->closed){
+    fakeRemoteClose(c);
+  }
+  delete c;
+
+  // A close cut anywhere: its reason goes by length, the frame holds no terminator
+  for(size_t cut : { (size_t)1, (size_t)2, (size_t)6, (size_t)8, (size_t)10 }){
+    c = wsTestOpen("/ws");
+    CHECK(c != NULL);
+    if(!c){
+      break;
+    }
+    events.clear();
+    std::string payload = std::string("\x03\xf0", 2) + "bye";
+    sendCut(c, wsTestFrame(WS_DISCONNECT, payload, mask), { cut });
+    CHECK(events.size() == 1 && events[0].type == WS_EVT_ERROR && events[0].code == 1008 && events[0].data == "bye");
+    sent = answers(c);
+    CHECK(sent.size() == 1 && sent[0].opcode == WS_DISCONNECT && sent[0].payload == payload);
+    if(!c->closed){
+      fakeRemoteClose(c);
+    }
+    delete c;
+  }
+
+  // onMessageStream(): in order across frames and segments, final once at the end
+  c = wsTestOpen("/stream");
+  CHECK(c != NULL);
+  if(!c){
+    return testResult();
+  }
+  const std::string message = "the quick brown fox jumps over the lazy dog";
+  wire = wsTestFrame(WS_BINARY, message.substr(0, 10), mask, false)
+       + wsTestFrame(WS_CONTINUATION, message.substr(10, 20), mask, false)
+       + wsTestFrame(WS_CONTINUATION, message.substr(30), mask);
+  for(size_t cut = 1; cut < wire.size(); cut += 3){
+    parts.clear();
+    sendCut(c, wire, { cut, cut + 1, wire.size() - 1 });
+    std::string got;
+    bool ok = !parts.empty() && parts.back().final;
+    for(size_t i = 0; i < parts.size(); i++){
+      ok = ok && parts[i].index == got.size() && !parts[i].data.empty() && parts[i].final == (i == parts.size() - 1);
+      got += parts[i].data;
+    }
+    CHECK(ok);
+    CHECK_EQ(got, message);
+  }
+  fakeRemoteClose(c);
+  delete c;
+
+  return testResult();
+}
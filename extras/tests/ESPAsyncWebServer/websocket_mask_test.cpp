@@ -0,0 +1,143 @@
+/*
+  RFC 6455 masking: webSocketMask() against the byte loop it replaced, client
+  frames unmasked in phase however they are split into packets, and the frames
+  the server writes itself. Prints word-wise against byte-wise throughput.
+*/
+#include "ws_test.h"
+#include "ESPAsyncWebServer.h"
+
+#include <string.h>
+
+void webSocketMask(uint8_t *data, size_t len, const uint8_t *mask, size_t offset);
+size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool mask, uint8_t *data, size_t len);
+
+static void byteMask(uint8_t * data, size_t len, const uint8_t * mask, size_t offset){
+  for(size_t i = 0; i < len; i++){
+    data[i] ^= mask[(offset + i) & 3];
+  }
+}
+
+static std::vector<std::string> messages;
+static std::string partial;
+
+static void onEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t * data, size_t len){
+  if(type != WS_EVT_DATA){
+    return;
+  }
+  AwsFrameInfo * info = (AwsFrameInfo *)arg;
+  partial.append((const char *)data, len);
+  if(info->final && info->index + len == info->len){
+    messages.push_back(partial);
+    partial.clear();
+  }
+}
+
+int main(){
+  // Section 5.7 of RFC 6455: a masked "Hello"
+  uint8_t hello[] = { 0x7f, 0x9f, 0x4d, 0x51, 0x58 };
+  const uint8_t key[] = { 0x37, 0xfa, 0x21, 0x3d };
+  webSocketMask(hello, sizeof(hello), key, 0);
+  CHECK(memcmp(hello, "Hello", 5) == 0);
+
+  // Every alignment, length and mask phase against the byte loop
+  srand(6455);
+  int mismatches = 0;
+  for(int round = 0; round < 200000; round++){
+    uint8_t buf[80], ref[80], mask[4];
+    for(uint8_t & b : buf){
+      b = rand();
+    }
+    for(uint8_t & b : mask){
+      b = rand();
+    }
+    memcpy(ref, buf, sizeof(buf));
+    size_t start = rand() % 8, len = rand() % 64, offset = rand() % 13;
+    webSocketMask(buf + start, len, mask, offset);
+    byteMask(ref + start, len, mask, offset);
+    mismatches += memcmp(buf, ref, sizeof(buf)) != 0;
+  }
+  CHECK_EQ(mismatches, 0);
+
+  // A client frame split at every byte still unmasks to the same message
+  AsyncWebServer server(80);
+  // The server deletes its handlers
+  AsyncWebSocket * ws = new AsyncWebSocket("/ws");
+  ws->onEvent(onEvent);
+  server.addHandler(ws);
+  server.begin();
+  std::string payload;
+  for(int i = 0; i < 300; i++){
+    payload += (char)('A' + i % 53);
+  }
+  std::string frame = wsTestFrame(WS_TEXT, payload, key);
+  FakeConnection * c = wsTestOpen("/ws");
+  CHECK(c != NULL);
+  for(size_t split = 1; c && split < frame.size(); split++){
+    fakeReceive(c, frame.substr(0, split));
+    fakeReceive(c, frame.substr(split));
+  }
+  CHECK_EQ(messages.size(), frame.size() - 1);
+  size_t intact = 0;
+  for(const std::string & m : messages){
+    intact += m == payload;
+  }
+  CHECK_EQ(intact, messages.size());
+
+  // And sent a byte at a time
+  messages.clear();
+  for(size_t i = 0; c && i < frame.size(); i++){
+    fakeReceive(c, frame.substr(i, 1));
+  }
+  CHECK_EQ(messages.size(), (size_t)1);
+  CHECK(!messages.empty() && messages[0] == payload);
+
+  // Frames the server masks itself, assembled on the stack and on the heap
+  for(size_t len : { (size_t)5, (size_t)300 }){
+    c->take();
+    std::string sent = payload.substr(0, len);
+    std::string copy = sent;
+    // A frame the stack turns down leaves the payload unmasked for the retry
+    c->refuse = true;
+    CHECK_EQ(webSocketSendFrame(c->client, true, WS_BINARY, true, (uint8_t *)&copy[0], copy.size()), (size_t)0);
+    c->refuse = false;
+    CHECK(copy == sent);
+    CHECK_EQ(webSocketSendFrame(c->client, true, WS_BINARY, true, (uint8_t *)&copy[0], copy.size()), len);
+    CHECK(copy == sent);
+    std::string wire = c->take();
+    fakeAck(c);
+    CHECK(wire.size() > 1 && (wire[1] & 0x80));
+    std::vector<WsTestFrame> frames = wsTestFrames(wire);
+    CHECK_EQ(frames.size(), (size_t)1);
+    CHECK(!frames.empty() && frames[0].payload == sent && frames[0].opcode == WS_BINARY);
+  }
+
+  // A frame is one add(), the stack takes all of it or nothing
+  for(size_t len : { (size_t)5, (size_t)300, (size_t)2000 }){
+    c->take();
+    std::string sent(len, 'p');
+    size_t adds = c->adds;
+    CHECK_EQ(webSocketSendFrame(c->client, true, WS_BINARY, false, (uint8_t *)&sent[0], sent.size()), len);
+    CHECK_EQ(c->adds, adds + 1);
+    std::string wire = c->take();
+    fakeAck(c);
+    std::vector<WsTestFrame> frames = wsTestFrames(wire);
+    CHECK(frames.size() == 1 && frames[0].payload == sent);
+  }
+  if(c){
+    fakeRemoteClose(c);
+    delete c;
+  }
+
+  // Throughput over 1 MB starting off a word boundary
+  static uint8_t big[1 << 20];
+  uint8_t mask[4] = { 1, 2, 3, 4 };
+  double word = benchNanos(200, [&]{ webSocketMask(big + 1, sizeof(big) - 1, mask, 3); });
+  double byte = benchNanos(200, [&]{
+    volatile uint8_t * d = big + 1;
+    for(size_t i = 0; i < sizeof(big) - 1; i++){
+      d[i] ^= mask[(3 + i) & 3];
+    }
+  });
+  printf("mask 1 MB: word-wise %.0f MB/s, byte-wise %.0f MB/s\n", (1 << 20) / word * 1000, (1 << 20) / byte * 1000);
+  return testResult();
+}
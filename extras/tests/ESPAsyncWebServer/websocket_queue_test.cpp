@@ -0,0 +1,164 @@
+/*
+  The send queue of a WebSocket client against a peer that reads nothing:
+  queueIsFull() turns true at exactly WS_MAX_QUEUED_MESSAGES, the drop
+  policy keeps the queue there, and WS_QUEUE_BLOCK holds at most
+  WS_QUEUE_BLOCK_LIMIT messages and closes a client that stays full for
+  WS_QUEUE_BLOCK_TIMEOUT. A broadcast is one message the clients share, each
+  sends it at its own pace, and its buffer goes once the last one is done.
+*/
+#include "ws_test.h"
+#include "HostAlloc.h"
+#include "ESPAsyncWebServer.h"
+
+static AsyncWebSocket * ws;
+static uint32_t nextId = 1;
+
+struct Stalled {
+  FakeConnection * c;
+  AsyncWebSocketClient * client;
+};
+
+// A socket whose stack turns every frame down, so nothing leaves the queue
+static Stalled stall(AwsQueuePolicy policy){
+  Stalled s;
+  s.c = wsTestOpen("/ws");
+  s.client = s.c ? ws->client(nextId++) : NULL;
+  if(s.client){
+    s.client->queuePolicy(policy);
+    s.c->refuse = true;
+  }
+  return s;
+}
+
+// The payload of every message the connection sent so far
+static std::vector<std::string> received(FakeConnection * c){
+  std::string wire;
+  webTestDrain(c, &wire);
+  std::vector<std::string> messages;
+  std::string message;
+  for(const WsTestFrame & f : wsTestFrames(wire)){
+    message += f.payload;
+    if(f.final){
+      messages.push_back(message);
+      message.clear();
+    }
+  }
+  return messages;
+}
+
+static void finish(Stalled & s){
+  if(!s.c->closed){
+    fakeRemoteClose(s.c);
+  }
+  delete s.c;
+}
+
+int main(){
+  AsyncWebServer server(80);
+  ws = new AsyncWebSocket("/ws");
+  int slow = 0;
+  ws->onSlowClient([&](AsyncWebSocket *, AsyncWebSocketClient *, size_t queued){
+    CHECK_EQ(queued, (size_t)WS_MAX_QUEUED_MESSAGES);
+    slow++;
+  });
+  server.addHandler(ws);
+  server.begin();
+
+  // Full at the limit, not one message past it
+  Stalled d = stall(WS_QUEUE_DROP_NEWEST);
+  CHECK(d.client != NULL);
+  if(!d.client){
+    return testResult();
+  }
+  for(int i = 0; i < WS_MAX_QUEUED_MESSAGES - 1; i++){
+    d.client->text("m");
+  }
+  CHECK_EQ(d.client->queueLength(), (size_t)WS_MAX_QUEUED_MESSAGES - 1);
+  CHECK(!d.client->queueIsFull());
+  CHECK_EQ(slow, 0);
+  d.client->text("m");
+  CHECK(d.client->queueIsFull());
+  CHECK_EQ(slow, 1);
+  for(int i = 0; i < 3; i++){
+    d.client->text("m");
+  }
+  CHECK_EQ(d.client->queueLength(), (size_t)WS_MAX_QUEUED_MESSAGES);
+  CHECK_EQ(d.client->droppedMessages(), (uint32_t)3);
+  CHECK_EQ(slow, 1);
+  finish(d);
+
+  // Blocking queues past the limit up to WS_QUEUE_BLOCK_LIMIT, then drops
+  Stalled b = stall(WS_QUEUE_BLOCK);
+  CHECK(b.client != NULL);
+  if(!b.client){
+    return testResult();
+  }
+  for(int i = 0; i < 3 * WS_QUEUE_BLOCK_LIMIT; i++){
+    b.client->text("m");
+  }
+  CHECK_EQ(b.client->queueLength(), (size_t)WS_QUEUE_BLOCK_LIMIT);
+  CHECK_EQ(b.client->droppedMessages(), (uint32_t)(2 * WS_QUEUE_BLOCK_LIMIT));
+  CHECK_EQ(slow, 2);
+
+  // and is closed once the queue stayed full for WS_QUEUE_BLOCK_TIMEOUT
+  mockAdvanceMillis(WS_QUEUE_BLOCK_TIMEOUT - 1);
+  fakePoll(b.c);
+  CHECK(!b.c->closed);
+  mockAdvanceMillis(1);
+  fakePoll(b.c);
+  CHECK(b.c->closed);
+  CHECK_EQ(ws->count(), (size_t)0);
+  finish(b);
+
+  // A blocked client that drains in time stays
+  Stalled r = stall(WS_QUEUE_BLOCK);
+  CHECK(r.client != NULL);
+  if(!r.client){
+    return testResult();
+  }
+  for(int i = 0; i < WS_MAX_QUEUED_MESSAGES; i++){
+    r.client->text("m");
+  }
+  CHECK(r.client->queueIsFull());
+  mockAdvanceMillis(WS_QUEUE_BLOCK_TIMEOUT / 2);
+  r.c->refuse = false;
+  webTestDrain(r.c, NULL);
+  CHECK_EQ(r.client->queueLength(), (size_t)0);
+  mockAdvanceMillis(WS_QUEUE_BLOCK_TIMEOUT);
+  fakePoll(r.c);
+  CHECK(!r.c->closed);
+  CHECK_EQ(r.client->droppedMessages(), (uint32_t)0);
+  finish(r);
+
+  // textAll() queues one message in every client, a stalled client holds on to it alone
+  Stalled slowPeer = stall(WS_QUEUE_DROP_NEWEST);
+  Stalled fastPeer = stall(WS_QUEUE_DROP_NEWEST);
+  CHECK(slowPeer.client != NULL && fastPeer.client != NULL);
+  if(!slowPeer.client || !fastPeer.client){
+    return testResult();
+  }
+  fastPeer.c->refuse = false;
+  const std::string big(20000, 'b');
+  size_t before = hostAllocStats().current;
+  AsyncWebSocketMessageBuffer * buffer = ws->makeBuffer((uint8_t *)big.data(), big.size());
+  ws->textAll(buffer);
+  CHECK_EQ(buffer->count(), (uint32_t)1);
+  CHECK_EQ(slowPeer.client->queueLength(), (size_t)1);
+  CHECK_EQ(fastPeer.client->queueLength(), (size_t)1);
+  std::vector<std::string> got = received(fastPeer.c);
+  CHECK(got.size() == 1 && got[0] == big);
+  CHECK_EQ(fastPeer.client->queueLength(), (size_t)0);
+  got.clear();
+  CHECK(hostAllocStats().current >= before + big.size());
+  // sent from the start at its own pace, then the buffer is freed
+  slowPeer.c->refuse = false;
+  got = received(slowPeer.c);
+  CHECK(got.size() == 1 && got[0] == big);
+  CHECK_EQ(slowPeer.client->queueLength(), (size_t)0);
+  got.clear();
+  CHECK(hostAllocStats().current < before + big.size());
+  finish(slowPeer);
+  finish(fastPeer);
+
+  return testResult();
+}
@@ -0,0 +1,118 @@
+/*
+  The web server on the real AsyncTCP over the fake lwIP, built once with one
+  async_tcp task (worker_bench_1) and once with two (worker_bench_2). Client
+  threads open connections at the same time. Each request serializes a JSON
+  document and broadcasts it to a WebSocket and an EventSource client, so
+  every lock the workers share is taken. Prints requests per second; the
+  speedup is bounded by the cores the host has.
+*/
+#include "test.h"
+#include "FakeLwip.h"
+#include "ESPAsyncWebServer.h"
+#include "ArduinoJson.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const int connections = 4;
+static const int requests = 20000;
+
+static FakePcb * open(const char * request){
+  FakePcb * p = fakeLwipAccept(80);
+  if(p){
+    fakeLwipReceive(p, request);
+  }
+  return p;
+}
+
+// Whether the response in written is complete
+static bool complete(FakePcb * p){
+  std::lock_guard<std::recursive_mutex> lock(fakeLwipLock());
+  size_t head = p->written.find("\r\n\r\n");
+  size_t length = p->written.find("Content-Length: ");
+  return head != std::string::npos && length != std::string::npos
+      && p->written.size() >= head + 4 + strtoul(p->written.c_str() + length + 16, NULL, 10);
+}
+
+// Acks the response, then closes like a browser does after Connection: close
+static bool finish(FakePcb * p){
+  for(int i = 0; i < 1000000; i++){
+    fakeLwipAck(p);
+    if(complete(p)){
+      fakeLwipFin(p);
+      while(!fakeLwipClosed(p)){
+        std::this_thread::yield();
+      }
+      return true;
+    }
+    std::this_thread::yield();
+  }
+  return false;
+}
+
+int main(){
+  AsyncWebServer server(80);
+  AsyncWebSocket * ws = new AsyncWebSocket("/ws");
+  server.addHandler(ws);
+  AsyncEventSource * events = new AsyncEventSource("/events");
+  server.addHandler(events);
+  std::atomic<int> served(0);
+  server.on("/json", HTTP_GET, [&](AsyncWebServerRequest * request){
+    DynamicJsonDocument doc(4096);
+    JsonArray cards = doc.createNestedArray("cards");
+    for(int i = 0; i < 32; i++){
+      JsonObject card = cards.createNestedObject();
+      card["id"] = i;
+      card["value"] = 23.5 + i;
+      card["symbol"] = "C";
+    }
+    String json;
+    serializeJson(doc, json);
+    ws->textAll(json.c_str(), json.length());
+    events->send(json.c_str(), "update");
+    request->send(200, "application/json", json);
+    served++;
+  });
+  server.begin();
+
+  // Listeners that read everything broadcast
+  FakePcb * wsPeer = open("GET /ws HTTP/1.1\r\nHost: esp32.local\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+  FakePcb * eventsPeer = open("GET /events HTTP/1.1\r\nHost: esp32.local\r\n\r\n");
+  CHECK(wsPeer != NULL && eventsPeer != NULL);
+  if(!wsPeer || !eventsPeer){
+    return testResult();
+  }
+
+  std::atomic<int> failed(0);
+  std::atomic<int> running(connections);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> peers;
+  for(int t = 0; t < connections; t++){
+    peers.emplace_back([&]{
+      for(int i = 0; i < requests / connections; i++){
+        FakePcb * p = open("GET /json HTTP/1.1\r\nHost: esp32.local\r\n\r\n");
+        if(!p || !finish(p)){
+          failed++;
+        }
+      }
+      running--;
+    });
+  }
+  while(running){
+    fakeLwipAck(wsPeer);
+    fakeLwipAck(eventsPeer);
+    std::this_thread::yield();
+  }
+  for(std::thread & t : peers){
+    t.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  CHECK_EQ(failed.load(), 0);
+  CHECK_EQ(served.load(), requests);
+  printf("%d async_tcp task(s), %d connections at a time, %u core(s): %.0f requests/s\n",
+         ASYNC_WORKERS, connections, std::thread::hardware_concurrency(), served / seconds);
+  return testResult();
+}
@@ -0,0 +1,120 @@
+/*
+  The client end of a WebSocket over the fake AsyncClient: the upgrade, masked
+  client frames and a parser for what the server sends back.
+*/
+#pragma once
+
+#include "web_test.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct WsTestFrame {
+  bool final;
+  bool rsv1;
+  uint8_t opcode;
+  std::string payload;
+};
+
+// Opens a socket on the server at url, NULL if the upgrade was refused
+static inline FakeConnection * wsTestOpen(const char * url, const char * extensions = NULL, uint16_t port = 80){
+  FakeConnection * c = fakeConnect(port);
+  if(!c){
+    return NULL;
+  }
+  std::string request = std::string("GET ") + url + " HTTP/1.1\r\n"
+    "Host: esp32.local\r\n"
+    "Connection: Upgrade\r\n"
+    "Upgrade: websocket\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n";
+  if(extensions){
+    request += std::string("Sec-WebSocket-Extensions: ") + extensions + "\r\n";
+  }
+  request += "\r\n";
+  fakeReceive(c, request);
+  std::string response;
+  webTestDrain(c, &response, 5);
+  if(response.compare(0, 12, "HTTP/1.1 101") != 0){
+    if(!c->closed){
+      fakeRemoteClose(c);
+    }
+    delete c;
+    return NULL;
+  }
+  return c;
+}
+
+// A client frame, masked with mask as RFC 6455 requires
+static inline std::string wsTestFrame(uint8_t opcode, const std::string & payload, const uint8_t mask[4], bool final = true, bool rsv1 = false){
+  std::string f;
+  f += (char)((final ? 0x80 : 0) | (rsv1 ? 0x40 : 0) | (opcode & 0x0F));
+  size_t len = payload.size();
+  if(len < 126){
+    f += (char)(0x80 | len);
+  } else if(len < 65536){
+    f += (char)(0x80 | 126);
+    f += (char)(len >> 8);
+    f += (char)len;
+  } else {
+    f += (char)(0x80 | 127);
+    for(int i = 7; i >= 0; i--){
+      f += (char)((uint64_t)len >> (8 * i));
+    }
+  }
+  f.append((const char *)mask, 4);
+  for(size_t i = 0; i < len; i++){
+    f += (char)(payload[i] ^ mask[i & 3]);
+  }
+  return f;
+}
+
+// Splits what the server sent into frames, unmasking any masked ones. Incomplete
+// frames stay in data.
+static inline std::vector<WsTestFrame> wsTestFrames(std::string & data){
+  std::vector<WsTestFrame> frames;
+  size_t p = 0;
+  while(data.size() - p >= 2){
+    const uint8_t * d = (const uint8_t *)data.data() + p;
+    size_t head = 2;
+    uint64_t len = d[1] & 0x7F;
+    if(len == 126){
+      if(data.size() - p < 4){
+        break;
+      }
+      len = ((uint64_t)d[2] << 8) | d[3];
+      head = 4;
+    } else if(len == 127){
+      if(data.size() - p < 10){
+        break;
+      }
+      len = 0;
+      for(int i = 0; i < 8; i++){
+        len = (len << 8) | d[2 + i];
+      }
+      head = 10;
+    }
+    bool masked = d[1] & 0x80;
+    const uint8_t * mask = d + head;
+    if(masked){
+      head += 4;
+    }
+    if(data.size() - p < head + len){
+      break;
+    }
+    WsTestFrame f;
+    f.final = d[0] & 0x80;
+    f.rsv1 = d[0] & 0x40;
+    f.opcode = d[0] & 0x0F;
+    f.payload.assign((const char *)d + head, len);
+    if(masked){
+      for(size_t i = 0; i < len; i++){
+        f.payload[i] ^= mask[i & 3];
+      }
+    }
+    frames.push_back(f);
+    p += head + len;
+  }
+  data.erase(0, p);
+  return frames;
+}
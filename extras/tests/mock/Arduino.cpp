@@ -0,0 +1,207 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "soc/soc.h"
+#include "HostAlloc.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static std::atomic<unsigned long> mockMillisOffset(0);
+static const std::chrono::steady_clock::time_point mockStart = std::chrono::steady_clock::now();
+
+unsigned long millis(){
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mockStart).count() + mockMillisOffset;
+}
+
+unsigned long micros(){
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mockStart).count() + mockMillisOffset * 1000UL;
+}
+
+void mockAdvanceMillis(unsigned long ms){
+  mockMillisOffset += ms;
+}
+
+void delay(unsigned long ms){
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield(){
+  std::this_thread::yield();
+}
+
+static uint32_t mockRandomState = 0x2545F491;
+
+static uint32_t mockNextRandom(){
+  uint32_t x = mockRandomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return mockRandomState = x;
+}
+
+void randomSeed(unsigned long seed){
+  mockRandomState = seed ? seed : 0x2545F491;
+}
+
+long random(long max){
+  return max > 0 ? (long)(mockNextRandom() % (unsigned long)max) : 0;
+}
+
+long random(long min, long max){
+  return min < max ? min + random(max - min) : min;
+}
+
+extern "C" uint32_t esp_random(void){
+  static std::atomic<uint32_t> state((uint32_t)std::chrono::high_resolution_clock::now().time_since_epoch().count() | 1);
+  uint32_t x = state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  state = x;
+  return x;
+}
+
+extern "C" int ets_printf(const char * format, ...){
+  if(!getenv("MOCK_VERBOSE")){
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  int n = vfprintf(stderr, format, args);
+  va_end(args);
+  return n;
+}
+
+std::string String::_number(long long v, unsigned char base){
+  if(v < 0 && base == 10){
+    return "-" + _number((unsigned long long)-v, base);
+  }
+  return _number((unsigned long long)v, base);
+}
+
+std::string String::_number(unsigned long long v, unsigned char base){
+  if(base < 2 || base > 36){
+    base = 10;
+  }
+  char buf[66];
+  char * p = buf + sizeof(buf) - 1;
+  *p = 0;
+  do {
+    unsigned d = v % base;
+    *--p = d < 10 ? '0' + d : 'a' + d - 10;
+    v /= base;
+  } while(v);
+  return p;
+}
+
+std::string String::_decimal(double v, unsigned char decimals){
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+  return buf;
+}
+
+size_t Print::printf(const char * format, ...){
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  if(len <= 0){
+    return 0;
+  }
+  std::vector<char> buf(len + 1);
+  va_start(args, format);
+  vsnprintf(buf.data(), buf.size(), format, args);
+  va_end(args);
+  return write((const uint8_t *)buf.data(), len);
+}
+
+size_t Stream::readBytes(char * buffer, size_t length){
+  size_t n = 0;
+  while(n < length){
+    int c = read();
+    if(c < 0){
+      break;
+    }
+    buffer[n++] = (char)c;
+  }
+  return n;
+}
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c){
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t * buffer, size_t size){
+  if(getenv("MOCK_VERBOSE")){
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap(){
+  size_t used = hostAllocStats().current;
+  return used < 320000 ? 320000 - used : 0;
+}
+
+WiFiClass WiFi;
+
+uintptr_t mockDromLow = 0;
+uintptr_t mockDromHigh = 0;
+
+struct MockPartition {
+  esp_partition_t partition;
+  const void * data;
+};
+static std::vector<MockPartition> mockPartitions;
+
+void mockPartition(const char * label, const void * data, size_t size){
+  MockPartition p;
+  memset(&p, 0, sizeof(p));
+  p.partition.type = ESP_PARTITION_TYPE_DATA;
+  p.partition.subtype = ESP_PARTITION_SUBTYPE_ANY;
+  p.partition.address = 0x300000 + 0x10000 * mockPartitions.size();
+  p.partition.size = size;
+  strncpy(p.partition.label, label, sizeof(p.partition.label) - 1);
+  p.data = data;
+  mockPartitions.push_back(p);
+}
+
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char * label){
+  for(auto & p : mockPartitions){
+    if(p.partition.type == type && (!label || strcmp(label, p.partition.label) == 0)){
+      return &p.partition;
+    }
+  }
+  return NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t * partition, size_t offset, size_t size, spi_flash_mmap_memory_t memory, const void ** out, spi_flash_mmap_handle_t * handle){
+  for(auto & p : mockPartitions){
+    if(&p.partition == partition){
+      if(offset + size > partition->size){
+        return ESP_FAIL;
+      }
+      *out = (const uint8_t *)p.data + offset;
+      *handle = 1;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle){
+}
@@ -0,0 +1,266 @@
+/*
+  Host replacement for the parts of the ESP32 Arduino core the libraries use.
+  Only what the tests need is here, behaviour follows the core where it matters.
+*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#define ESP32 1
+#define ARDUINO 10805
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define F(s) ((const __FlashStringHelper *)(s))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p) pgm_read_byte(p)
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p) (*(const void * const *)(p))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strstr_P strstr
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+#define IRAM_ATTR
+
+#include "freertos/FreeRTOS.h"
+
+class __FlashStringHelper;
+
+extern "C" int ets_printf(const char * format, ...) __attribute__((format(printf, 1, 2)));
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Moves millis() and micros() forward without sleeping
+void mockAdvanceMillis(unsigned long ms);
+
+class String {
+  std::string _s;
+  static std::string _number(long long v, unsigned char base);
+  static std::string _number(unsigned long long v, unsigned char base);
+  static std::string _decimal(double v, unsigned char decimals);
+public:
+  String(){}
+  String(const char * c){ if(c) _s = c; }
+  String(const __FlashStringHelper * c){ if(c) _s = (const char *)c; }
+  String(const String &) = default;
+  String(String &&) = default;
+  String & operator=(const String &) = default;
+  String & operator=(String &&) = default;
+  String & operator=(const char * c){ _s = c ? c : ""; return *this; }
+  explicit String(char c) : _s(1, c) {}
+  explicit String(unsigned char v, unsigned char base = 10) : _s(_number((unsigned long long)v, base)) {}
+  explicit String(int v, unsigned char base = 10) : _s(_number((long long)v, base)) {}
+  explicit String(unsigned int v, unsigned char base = 10) : _s(_number((unsigned long long)v, base)) {}
+  explicit String(long v, unsigned char base = 10) : _s(_number((long long)v, base)) {}
+  explicit String(unsigned long v, unsigned char base = 10) : _s(_number((unsigned long long)v, base)) {}
+  explicit String(long long v, unsigned char base = 10) : _s(_number(v, base)) {}
+  explicit String(unsigned long long v, unsigned char base = 10) : _s(_number(v, base)) {}
+  explicit String(float v, unsigned char decimals = 2) : _s(_decimal(v, decimals)) {}
+  explicit String(double v, unsigned char decimals = 2) : _s(_decimal(v, decimals)) {}
+
+  unsigned int length() const { return _s.size(); }
+  const char * c_str() const { return _s.c_str(); }
+  char * begin(){ return &_s[0]; }
+  char * end(){ return &_s[0] + _s.size(); }
+  bool reserve(unsigned int size){ _s.reserve(size); return true; }
+
+  bool concat(const String & s){ _s += s._s; return true; }
+  bool concat(const char * c){ if(!c) return false; _s += c; return true; }
+  bool concat(const char * c, unsigned int len){ if(!c) return false; _s.append(c, len); return true; }
+  bool concat(const __FlashStringHelper * c){ return concat((const char *)c); }
+  bool concat(char c){ _s += c; return true; }
+  bool concat(unsigned char v){ return concat(String(v)); }
+  bool concat(int v){ return concat(String(v)); }
+  bool concat(unsigned int v){ return concat(String(v)); }
+  bool concat(long v){ return concat(String(v)); }
+  bool concat(unsigned long v){ return concat(String(v)); }
+  bool concat(long long v){ return concat(String(v)); }
+  bool concat(unsigned long long v){ return concat(String(v)); }
+  bool concat(float v){ return concat(String(v)); }
+  bool concat(double v){ return concat(String(v)); }
+
+  template<typename T> String & operator+=(const T & v){ concat(v); return *this; }
+  String & operator+=(const char * c){ concat(c); return *this; }
+  String & operator+=(char c){ concat(c); return *this; }
+
+  bool operator==(const String & o) const { return _s == o._s; }
+  bool operator==(const char * c) const { return _s == (c ? c : ""); }
+  bool operator!=(const String & o) const { return _s != o._s; }
+  bool operator!=(const char * c) const { return !(*this == c); }
+  bool operator<(const String & o) const { return _s < o._s; }
+  explicit operator bool() const { return true; }
+  int compareTo(const String & o) const { return _s.compare(o._s); }
+  bool equals(const String & o) const { return _s == o._s; }
+  bool equals(const char * c) const { return *this == c; }
+  bool equalsIgnoreCase(const String & o) const { return _s.size() == o._s.size() && strcasecmp(_s.c_str(), o._s.c_str()) == 0; }
+  bool startsWith(const String & o) const { return _s.compare(0, o._s.size(), o._s) == 0; }
+  bool startsWith(const String & o, unsigned int offset) const { return offset <= _s.size() && _s.compare(offset, o._s.size(), o._s) == 0; }
+  bool endsWith(const String & o) const { return _s.size() >= o._s.size() && _s.compare(_s.size() - o._s.size(), o._s.size(), o._s) == 0; }
+
+  char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  void setCharAt(unsigned int i, char c){ if(i < _s.size()) _s[i] = c; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char & operator[](unsigned int i){ return _s[i]; }
+  void getBytes(unsigned char * buf, unsigned int size, unsigned int index = 0) const { toCharArray((char *)buf, size, index); }
+  void toCharArray(char * buf, unsigned int size, unsigned int index = 0) const {
+    if(!size) return;
+    size_t n = index < _s.size() ? std::min<size_t>(size - 1, _s.size() - index) : 0;
+    memcpy(buf, _s.c_str() + index, n);
+    buf[n] = 0;
+  }
+
+  int indexOf(char c, unsigned int from = 0) const { size_t p = _s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String & o, unsigned int from = 0) const { size_t p = _s.find(o._s, from); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(char c) const { size_t p = _s.rfind(c); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(const String & o) const { size_t p = _s.rfind(o._s); return p == std::string::npos ? -1 : (int)p; }
+  String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from).c_str()) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if(from > to) std::swap(from, to);
+    return from < _s.size() ? String(_s.substr(from, to - from).c_str()) : String();
+  }
+
+  void replace(char a, char b){ std::replace(_s.begin(), _s.end(), a, b); }
+  void replace(const String & a, const String & b){
+    if(a._s.empty()) return;
+    size_t p = 0;
+    while((p = _s.find(a._s, p)) != std::string::npos){ _s.replace(p, a._s.size(), b._s); p += b._s.size(); }
+  }
+  void remove(unsigned int index){ if(index < _s.size()) _s.erase(index); }
+  void remove(unsigned int index, unsigned int count){ if(index < _s.size()) _s.erase(index, count); }
+  void toLowerCase(){ for(auto & c : _s) c = tolower(c); }
+  void toUpperCase(){ for(auto & c : _s) c = toupper(c); }
+  void trim(){
+    while(!_s.empty() && isspace((unsigned char)_s.back())) _s.pop_back();
+    size_t i = 0;
+    while(i < _s.size() && isspace((unsigned char)_s[i])) i++;
+    _s.erase(0, i);
+  }
+  long toInt() const { return atol(_s.c_str()); }
+  float toFloat() const { return atof(_s.c_str()); }
+  double toDouble() const { return atof(_s.c_str()); }
+};
+
+class StringSumHelper : public String {
+public:
+  StringSumHelper(const String & s) : String(s) {}
+  StringSumHelper(const char * c) : String(c) {}
+};
+
+template<typename T> StringSumHelper operator+(const String & a, const T & b){ StringSumHelper r(a); r += b; return r; }
+inline StringSumHelper operator+(const String & a, const char * b){ StringSumHelper r(a); r += b; return r; }
+inline StringSumHelper operator+(const char * a, const String & b){ StringSumHelper r(a); r += b; return r; }
+
+class Print {
+public:
+  virtual ~Print(){}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t * buffer, size_t size){
+    size_t n = 0;
+    while(size--) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char * s){ return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+  size_t write(const char * s, size_t size){ return write((const uint8_t *)s, size); }
+  size_t print(const String & s){ return write(s.c_str(), s.length()); }
+  size_t print(const char * s){ return write(s); }
+  size_t print(const __FlashStringHelper * s){ return write((const char *)s); }
+  size_t print(char c){ return write((uint8_t)c); }
+  size_t print(int v){ return print(String(v)); }
+  size_t print(unsigned int v){ return print(String(v)); }
+  size_t print(long v){ return print(String(v)); }
+  size_t print(unsigned long v){ return print(String(v)); }
+  size_t print(double v, int decimals = 2){ return print(String(v, decimals)); }
+  size_t println(){ return write("\r\n"); }
+  template<typename T> size_t println(const T & v){ return print(v) + println(); }
+  size_t printf(const char * format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush(){}
+  size_t readBytes(char * buffer, size_t length);
+  size_t readBytes(uint8_t * buffer, size_t length){ return readBytes((char *)buffer, length); }
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long){}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t * buffer, size_t size) override;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  using Print::write;
+};
+extern HardwareSerial Serial;
+
+class IPAddress {
+  uint32_t _address;
+public:
+  IPAddress() : _address(0) {}
+  IPAddress(uint32_t address) : _address(address) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+  operator uint32_t() const { return _address; }
+  bool operator==(const IPAddress & o) const { return _address == o._address; }
+  bool operator!=(const IPAddress & o) const { return _address != o._address; }
+  uint8_t operator[](int i) const { return (_address >> (8 * i)) & 0xFF; }
+  String toString() const;
+};
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint64_t getEfuseMac(){ return 0x0000AABBCCDDEEFFULL; }
+  String getSketchMD5(){ return "d41d8cd98f00b204e9800998ecf8427e"; }
+  void restart(){ exit(0); }
+};
+extern EspClass ESP;
+
+// size_t is unsigned int on the chip, so mixed calls like std::min(sizeof(x), 1u) compile
+// there. The host's size_t is wider and needs these to take them.
+namespace std {
+template<typename A, typename B, typename = typename enable_if<!is_same<A, B>::value>::type>
+typename common_type<A, B>::type min(A a, B b){ return a < b ? a : b; }
+template<typename A, typename B, typename = typename enable_if<!is_same<A, B>::value>::type>
+typename common_type<A, B>::type max(A a, B b){ return a > b ? a : b; }
+}
+using std::min;
+using std::max;
+#define _min(a,b) ((a)<(b)?(a):(b))
+#define _max(a,b) ((a)>(b)?(a):(b))
+
+#endif
@@ -0,0 +1,589 @@
+#include "Arduino.h"
+#include "AsyncTCPFake.h"
+
+#include <algorithm>
+#include <map>
+
+static std::map<uint16_t, AsyncServer *> fakeServers;
+
+static FakeConnection * fakeOf(tcp_pcb * pcb){
+  return pcb ? reinterpret_cast<FakeConnection *>(pcb->fake) : NULL;
+}
+
+FakeConnection::FakeConnection()
+  : client(NULL), window(FAKE_TCP_SND_BUF), unacked(0), copied(0), referenced(0), adds(0), sends(0), closed(false), refuse(false)
+{
+  memset(&pcb, 0, sizeof(pcb));
+  pcb.state = ESTABLISHED;
+  pcb.mss = 1436;
+  pcb.local_ip.u_addr.ip4.addr = IPAddress(192, 168, 4, 1);
+  pcb.remote_ip.u_addr.ip4.addr = IPAddress(192, 168, 4, 2);
+  pcb.local_port = 80;
+  pcb.remote_port = 50000;
+  pcb.fake = this;
+}
+
+std::string FakeConnection::take(){
+  std::string s;
+  s.swap(sent);
+  return s;
+}
+
+FakeConnection * fakeConnect(uint16_t port){
+  auto it = fakeServers.find(port);
+  if(it == fakeServers.end()){
+    return NULL;
+  }
+  FakeConnection * c = new FakeConnection();
+  c->pcb.local_port = port;
+  AsyncServer::_s_accept(it->second, &c->pcb, ERR_OK);
+  return c;
+}
+
+void fakeReceive(FakeConnection * c, const char * data, size_t len){
+  if(!c->client){
+    return;
+  }
+  pbuf pb;
+  pb.next = NULL;
+  pb.payload = (void *)data;
+  pb.tot_len = pb.len = len;
+  AsyncClient::_s_recv(c->client, &c->pcb, &pb, ERR_OK);
+}
+
+void fakeReceive(FakeConnection * c, const std::string & data){
+  fakeReceive(c, data.data(), data.size());
+}
+
+void fakeAck(FakeConnection * c, size_t len){
+  len = std::min(len, c->unacked);
+  c->unacked -= len;
+  c->window += len;
+  if(c->client && len){
+    AsyncClient::_s_sent(c->client, &c->pcb, len);
+  }
+}
+
+void fakePoll(FakeConnection * c){
+  if(c->client){
+    AsyncClient::_s_poll(c->client, &c->pcb);
+  }
+}
+
+void fakeRemoteClose(FakeConnection * c){
+  if(c->client){
+    AsyncClient::_s_recv(c->client, &c->pcb, NULL, ERR_OK);
+  }
+}
+
+void fakeError(FakeConnection * c, int8_t err){
+  c->closed = true;
+  if(c->client){
+    AsyncClient::_s_error(c->client, err);
+  }
+}
+
+void pbuf_free(struct pbuf * p){
+}
+
+/*
+  Async TCP Client
+ */
+
+AsyncClient::AsyncClient(tcp_pcb * pcb)
+: _pcb(pcb)
+, _connect_cb(0)
+, _connect_cb_arg(0)
+, _discard_cb(0)
+, _discard_cb_arg(0)
+, _sent_cb(0)
+, _sent_cb_arg(0)
+, _error_cb(0)
+, _error_cb_arg(0)
+, _recv_cb(0)
+, _recv_cb_arg(0)
+, _pb_cb(0)
+, _pb_cb_arg(0)
+, _timeout_cb(0)
+, _timeout_cb_arg(0)
+, _poll_cb(0)
+, _poll_cb_arg(0)
+, _pcb_busy(false)
+, _pcb_sent_at(0)
+, _close_pcb(false)
+, _ack_pcb(true)
+, _rx_ack_len(0)
+, _rx_last_packet(0)
+, _rx_since_timeout(0)
+, _ack_timeout(ASYNC_MAX_ACK_TIME)
+, _connect_port(0)
+, prev(NULL)
+, next(NULL)
+, _in_lwip_thread(false)
+, _slot(0)
+{
+  if(_pcb){
+    _rx_last_packet = millis();
+    fakeOf(_pcb)->client = this;
+  }
+}
+
+AsyncClient::~AsyncClient(){
+  if(_pcb){
+    _close();
+  }
+}
+
+AsyncClient & AsyncClient::operator=(const AsyncClient & other){
+  if(_pcb){
+    _close();
+  }
+  _pcb = other._pcb;
+  if(_pcb){
+    fakeOf(_pcb)->client = this;
+  }
+  return *this;
+}
+
+AsyncClient & AsyncClient::operator+=(const AsyncClient & other){
+  if(next == NULL){
+    next = (AsyncClient *)(&other);
+    next->prev = this;
+  } else {
+    AsyncClient * c = next;
+    while(c->next != NULL){
+      c = c->next;
+    }
+    c->next = (AsyncClient *)(&other);
+    c->next->prev = c;
+  }
+  return *this;
+}
+
+bool AsyncClient::operator==(const AsyncClient & other){
+  return _pcb == other._pcb;
+}
+
+bool AsyncClient::connect(IPAddress ip, uint16_t port){
+  return false;
+}
+
+bool AsyncClient::connect(const char * host, uint16_t port){
+  return false;
+}
+
+int8_t AsyncClient::_close(){
+  if(_pcb){
+    FakeConnection * c = fakeOf(_pcb);
+    c->closed = true;
+    c->client = NULL;
+    _pcb = NULL;
+    if(_discard_cb){
+      _discard_cb(_discard_cb_arg, this);
+    }
+  }
+  return ERR_OK;
+}
+
+int8_t AsyncClient::_connected(void * pcb, int8_t err){
+  return ERR_OK;
+}
+
+void AsyncClient::_error(int8_t err){
+  if(_pcb){
+    fakeOf(_pcb)->client = NULL;
+    _pcb = NULL;
+  }
+  if(_error_cb){
+    _error_cb(_error_cb_arg, this, err);
+  }
+  if(_discard_cb){
+    _discard_cb(_discard_cb_arg, this);
+  }
+}
+
+int8_t AsyncClient::_sent(tcp_pcb * pcb, uint16_t len){
+  _rx_last_packet = millis();
+  _pcb_busy = false;
+  if(_sent_cb){
+    _sent_cb(_sent_cb_arg, this, len, (millis() - _pcb_sent_at));
+  }
+  return ERR_OK;
+}
+
+int8_t AsyncClient::_recv(tcp_pcb * pcb, pbuf * pb, int8_t err){
+  if(!_pcb || pcb != _pcb){
+    return ERR_OK;
+  }
+  if(pb == NULL){
+    return _close();
+  }
+  while(pb != NULL){
+    _rx_last_packet = millis();
+    _ack_pcb = true;
+    pbuf * b = pb;
+    pb = b->next;
+    if(_pb_cb){
+      _pb_cb(_pb_cb_arg, this, b);
+    } else {
+      if(_recv_cb){
+        _recv_cb(_recv_cb_arg, this, b->payload, b->len);
+      }
+      if(!_ack_pcb){
+        _rx_ack_len += b->len;
+      }
+    }
+  }
+  return ERR_OK;
+}
+
+int8_t AsyncClient::_poll(tcp_pcb * pcb){
+  if(_close_pcb){
+    _close_pcb = false;
+    _close();
+    return ERR_OK;
+  }
+  uint32_t now = millis();
+  if(_pcb_busy && _ack_timeout && (now - _pcb_sent_at) >= _ack_timeout){
+    _pcb_busy = false;
+    if(_timeout_cb){
+      _timeout_cb(_timeout_cb_arg, this, (now - _pcb_sent_at));
+    }
+    return ERR_OK;
+  }
+  if(_rx_since_timeout && (now - _rx_last_packet) >= (_rx_since_timeout * 1000)){
+    _close();
+    return ERR_OK;
+  }
+  if(_poll_cb){
+    _poll_cb(_poll_cb_arg, this);
+  }
+  return ERR_OK;
+}
+
+void AsyncClient::_dns_found(struct ip_addr * ipaddr){
+}
+
+int8_t AsyncClient::abort(){
+  if(_pcb){
+    FakeConnection * c = fakeOf(_pcb);
+    c->closed = true;
+    c->client = NULL;
+    _pcb = NULL;
+  }
+  return ERR_ABRT;
+}
+
+void AsyncClient::close(bool now){
+  if(now){
+    _close();
+  } else {
+    _close_pcb = true;
+  }
+}
+
+void AsyncClient::stop(){
+  close(false);
+}
+
+bool AsyncClient::free(){
+  return !_pcb || _pcb->state == CLOSED || _pcb->state > ESTABLISHED;
+}
+
+size_t AsyncClient::space(){
+  if(_pcb && _pcb->state == ESTABLISHED){
+    return fakeOf(_pcb)->window;
+  }
+  return 0;
+}
+
+size_t AsyncClient::add(const char * data, size_t size, uint8_t apiflags){
+  if(!_pcb || size == 0 || data == NULL){
+    return 0;
+  }
+  size_t room = space();
+  FakeConnection * c = fakeOf(_pcb);
+  if(!room || c->refuse){
+    return 0;
+  }
+  size_t will_send = (room < size) ? room : size;
+  c->sent.append(data, will_send);
+  c->window -= will_send;
+  c->unacked += will_send;
+  c->adds++;
+  if(apiflags & ASYNC_WRITE_FLAG_COPY){
+    c->copied += will_send;
+  } else {
+    c->referenced += will_send;
+    c->references.push_back(std::make_pair(data, will_send));
+  }
+  return will_send;
+}
+
+bool AsyncClient::send(){
+  if(!_pcb){
+    return false;
+  }
+  fakeOf(_pcb)->sends++;
+  _pcb_busy = true;
+  _pcb_sent_at = millis();
+  return true;
+}
+
+size_t AsyncClient::write(const char * data){
+  if(data == NULL){
+    return 0;
+  }
+  return write(data, strlen(data));
+}
+
+size_t AsyncClient::write(const char * data, size_t size, uint8_t apiflags){
+  size_t will_send = add(data, size, apiflags);
+  if(!will_send || !send()){
+    return 0;
+  }
+  return will_send;
+}
+
+size_t AsyncClient::ack(size_t len){
+  if(len > _rx_ack_len){
+    len = _rx_ack_len;
+  }
+  _rx_ack_len -= len;
+  return len;
+}
+
+void AsyncClient::ackPacket(struct pbuf * pb){
+}
+
+uint8_t AsyncClient::state(){
+  return _pcb ? _pcb->state : 0;
+}
+
+bool AsyncClient::connecting(){
+  return _pcb && _pcb->state > CLOSED && _pcb->state < ESTABLISHED;
+}
+
+bool AsyncClient::connected(){
+  return _pcb && _pcb->state == ESTABLISHED;
+}
+
+bool AsyncClient::disconnecting(){
+  return _pcb && _pcb->state > ESTABLISHED;
+}
+
+bool AsyncClient::disconnected(){
+  return !_pcb || _pcb->state == CLOSED;
+}
+
+bool AsyncClient::freeable(){
+  return free();
+}
+
+bool AsyncClient::canSend(){
+  return space() > 0;
+}
+
+uint16_t AsyncClient::getMss(){
+  return _pcb ? _pcb->mss : 0;
+}
+
+uint32_t AsyncClient::getRxTimeout(){
+  return _rx_since_timeout;
+}
+
+void AsyncClient::setRxTimeout(uint32_t timeout){
+  _rx_since_timeout = timeout;
+}
+
+uint32_t AsyncClient::getAckTimeout(){
+  return _ack_timeout;
+}
+
+void AsyncClient::setAckTimeout(uint32_t timeout){
+  _ack_timeout = timeout;
+}
+
+void AsyncClient::setNoDelay(bool nodelay){
+}
+
+bool AsyncClient::getNoDelay(){
+  return false;
+}
+
+uint32_t AsyncClient::getRemoteAddress(){
+  return _pcb ? _pcb->remote_ip.u_addr.ip4.addr : 0;
+}
+
+uint16_t AsyncClient::getRemotePort(){
+  return _pcb ? _pcb->remote_port : 0;
+}
+
+uint32_t AsyncClient::getLocalAddress(){
+  return _pcb ? _pcb->local_ip.u_addr.ip4.addr : 0;
+}
+
+uint16_t AsyncClient::getLocalPort(){
+  return _pcb ? _pcb->local_port : 0;
+}
+
+IPAddress AsyncClient::remoteIP(){
+  return IPAddress(getRemoteAddress());
+}
+
+uint16_t AsyncClient::remotePort(){
+  return getRemotePort();
+}
+
+IPAddress AsyncClient::localIP(){
+  return IPAddress(getLocalAddress());
+}
+
+uint16_t AsyncClient::localPort(){
+  return getLocalPort();
+}
+
+void AsyncClient::onConnect(AcConnectHandler cb, void * arg){
+  _connect_cb = cb;
+  _connect_cb_arg = arg;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler cb, void * arg){
+  _discard_cb = cb;
+  _discard_cb_arg = arg;
+}
+
+void AsyncClient::onAck(AcAckHandler cb, void * arg){
+  _sent_cb = cb;
+  _sent_cb_arg = arg;
+}
+
+void AsyncClient::onError(AcErrorHandler cb, void * arg){
+  _error_cb = cb;
+  _error_cb_arg = arg;
+}
+
+void AsyncClient::onData(AcDataHandler cb, void * arg){
+  _recv_cb = cb;
+  _recv_cb_arg = arg;
+}
+
+void AsyncClient::onPacket(AcPacketHandler cb, void * arg){
+  _pb_cb = cb;
+  _pb_cb_arg = arg;
+}
+
+void AsyncClient::onTimeout(AcTimeoutHandler cb, void * arg){
+  _timeout_cb = cb;
+  _timeout_cb_arg = arg;
+}
+
+void AsyncClient::onPoll(AcConnectHandler cb, void * arg){
+  _poll_cb = cb;
+  _poll_cb_arg = arg;
+}
+
+const char * AsyncClient::errorToString(int8_t error){
+  return error == ERR_OK ? "OK" : "Error";
+}
+
+const char * AsyncClient::stateToString(){
+  return connected() ? "Established" : "Closed";
+}
+
+int8_t AsyncClient::_s_poll(void * arg, struct tcp_pcb * pcb){
+  return reinterpret_cast<AsyncClient *>(arg)->_poll(pcb);
+}
+
+int8_t AsyncClient::_s_recv(void * arg, struct tcp_pcb * pcb, struct pbuf * pb, int8_t err){
+  return reinterpret_cast<AsyncClient *>(arg)->_recv(pcb, pb, err);
+}
+
+int8_t AsyncClient::_s_sent(void * arg, struct tcp_pcb * pcb, uint16_t len){
+  return reinterpret_cast<AsyncClient *>(arg)->_sent(pcb, len);
+}
+
+void AsyncClient::_s_error(void * arg, int8_t err){
+  reinterpret_cast<AsyncClient *>(arg)->_error(err);
+}
+
+int8_t AsyncClient::_s_connected(void * arg, void * pcb, int8_t err){
+  return reinterpret_cast<AsyncClient *>(arg)->_connected(pcb, err);
+}
+
+void AsyncClient::_s_dns_found(const char * name, struct ip_addr * ipaddr, void * arg){
+}
+
+/*
+  Async TCP Server
+ */
+
+AsyncServer::AsyncServer(IPAddress addr, uint16_t port)
+: _port(port)
+, _addr(addr)
+, _noDelay(false)
+, _in_lwip_thread(false)
+, _pcb(0)
+, _connect_cb(0)
+, _connect_cb_arg(0)
+{}
+
+AsyncServer::AsyncServer(uint16_t port)
+: _port(port)
+, _addr((uint32_t)IPADDR_ANY)
+, _noDelay(false)
+, _in_lwip_thread(false)
+, _pcb(0)
+, _connect_cb(0)
+, _connect_cb_arg(0)
+{}
+
+AsyncServer::~AsyncServer(){
+  end();
+}
+
+void AsyncServer::onClient(AcConnectHandler cb, void * arg){
+  _connect_cb = cb;
+  _connect_cb_arg = arg;
+}
+
+int8_t AsyncServer::_s_accept(void * arg, tcp_pcb * pcb, int8_t err){
+  return reinterpret_cast<AsyncServer *>(arg)->_accept(pcb, err);
+}
+
+int8_t AsyncServer::_accept(tcp_pcb * pcb, int8_t err){
+  if(!_connect_cb){
+    fakeOf(pcb)->closed = true;
+    return ERR_OK;
+  }
+  AsyncClient * c = new AsyncClient(pcb);
+  _in_lwip_thread = true;
+  c->_in_lwip_thread = true;
+  _connect_cb(_connect_cb_arg, c);
+  c->_in_lwip_thread = false;
+  _in_lwip_thread = false;
+  return ERR_OK;
+}
+
+void AsyncServer::begin(){
+  fakeServers[_port] = this;
+}
+
+void AsyncServer::end(){
+  auto it = fakeServers.find(_port);
+  if(it != fakeServers.end() && it->second == this){
+    fakeServers.erase(it);
+  }
+}
+
+void AsyncServer::setNoDelay(bool nodelay){
+  _noDelay = nodelay;
+}
+
+bool AsyncServer::getNoDelay(){
+  return _noDelay;
+}
+
+uint8_t AsyncServer::status(){
+  return fakeServers.count(_port) ? LISTEN : CLOSED;
+}
@@ -0,0 +1,45 @@
+/*
+  AsyncClient and AsyncServer without a network: a test accepts connections,
+  feeds them data and acks, and reads back what the server wrote. Everything
+  runs on the calling thread, in the order the test drives it.
+*/
+#pragma once
+
+#include "AsyncTCP.h"
+#include "lwip/tcp.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#define FAKE_TCP_SND_BUF 5744
+
+struct FakeConnection {
+  tcp_pcb pcb;
+  AsyncClient * client;                 // NULL once the client is deleted
+  std::string sent;                     // every byte the client added, in order
+  size_t window;                        // what space() reports
+  size_t unacked;
+  size_t copied;                        // bytes added with ASYNC_WRITE_FLAG_COPY
+  size_t referenced;                    // bytes added without it, lwIP would keep the pointer
+  std::vector<std::pair<const char *, size_t>> references;
+  size_t adds;
+  size_t sends;
+  bool closed;                          // closed or aborted by the client
+  bool refuse;                          // add() fails while set, like tcp_write() out of memory
+
+  FakeConnection();
+  // What was sent since the last call
+  std::string take();
+};
+
+// Accepts a connection on the server listening on port, NULL when there is none
+FakeConnection * fakeConnect(uint16_t port = 80);
+void fakeReceive(FakeConnection * c, const char * data, size_t len);
+void fakeReceive(FakeConnection * c, const std::string & data);
+// Acks len bytes, everything outstanding by default
+void fakeAck(FakeConnection * c, size_t len = (size_t)-1);
+void fakePoll(FakeConnection * c);
+// The peer closed its side
+void fakeRemoteClose(FakeConnection * c);
+void fakeError(FakeConnection * c, int8_t err);
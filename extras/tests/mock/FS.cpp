@@ -0,0 +1,70 @@
+#include "FS.h"
+
+using namespace fs;
+
+size_t File::write(const uint8_t * buffer, size_t size){
+  if(!_file || !_write){
+    return 0;
+  }
+  _file->data.replace(_pos, std::min(size, _file->data.size() - _pos), (const char *)buffer, size);
+  _pos += size;
+  return size;
+}
+
+int File::read(){
+  uint8_t c;
+  return read(&c, 1) ? c : -1;
+}
+
+int File::peek(){
+  return (_file && _pos < _file->data.size()) ? (uint8_t)_file->data[_pos] : -1;
+}
+
+size_t File::read(uint8_t * buffer, size_t size){
+  if(!_file || _pos >= _file->data.size()){
+    return 0;
+  }
+  size_t n = std::min(size, _file->data.size() - _pos);
+  memcpy(buffer, _file->data.data() + _pos, n);
+  _pos += n;
+  return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode){
+  if(!_file){
+    return false;
+  }
+  size_t base = mode == SeekSet ? 0 : mode == SeekCur ? _pos : _file->data.size();
+  if(base + pos > _file->data.size()){
+    return false;
+  }
+  _pos = base + pos;
+  return true;
+}
+
+File FS::open(const char * path, const char * mode){
+  bool write = mode && (mode[0] == 'w' || mode[0] == 'a');
+  auto it = _files.find(path);
+  if(it == _files.end()){
+    if(!write){
+      return File();
+    }
+    std::shared_ptr<MockFile> file(new MockFile());
+    file->path = path;
+    it = _files.insert(std::make_pair(std::string(path), file)).first;
+  } else if(mode && mode[0] == 'w'){
+    it->second->data.clear();
+  }
+  File f(it->second, write);
+  if(mode && mode[0] == 'a'){
+    f.seek(0, SeekEnd);
+  }
+  return f;
+}
+
+void FS::put(const char * path, const std::string & data){
+  std::shared_ptr<MockFile> file(new MockFile());
+  file->path = path;
+  file->data = data;
+  _files[path] = file;
+}
@@ -0,0 +1,70 @@
+/*
+  In-memory file system with the File/FS interface of the core. Files are
+  added by the tests with FS::put().
+*/
+#pragma once
+
+#include "Arduino.h"
+#include <map>
+#include <memory>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct MockFile {
+  std::string path;
+  std::string data;
+};
+
+class File : public Stream {
+public:
+  File(){}
+  File(std::shared_ptr<MockFile> file, bool write) : _file(file), _pos(0), _write(write) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t * buffer, size_t size) override;
+  int available() override { return _file ? (int)(_file->data.size() - _pos) : 0; }
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t * buffer, size_t size);
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const { return _pos; }
+  size_t size() const { return _file ? _file->data.size() : 0; }
+  void close(){ _file.reset(); }
+  const char * name() const { return _file ? _file->path.c_str() : ""; }
+  bool isDirectory(){ return false; }
+  File openNextFile(const char * mode = "r"){ return File(); }
+  operator bool() const { return (bool)_file; }
+  using Print::write;
+
+private:
+  std::shared_ptr<MockFile> _file;
+  size_t _pos = 0;
+  bool _write = false;
+};
+
+class FS {
+public:
+  File open(const char * path, const char * mode = "r");
+  File open(const String & path, const char * mode = "r"){ return open(path.c_str(), mode); }
+  bool exists(const char * path){ return _files.count(path) != 0; }
+  bool exists(const String & path){ return exists(path.c_str()); }
+  bool remove(const char * path){ return _files.erase(path) != 0; }
+  bool remove(const String & path){ return remove(path.c_str()); }
+  // Test side
+  void put(const char * path, const std::string & data);
+  void clear(){ _files.clear(); }
+
+private:
+  std::map<std::string, std::shared_ptr<MockFile>> _files;
+};
+
+}
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,156 @@
+#include "freertos/FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+unsigned long millis();
+
+struct mock_queue {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::string> items;
+  size_t length;
+  size_t itemSize;
+};
+
+struct mock_task {
+  TaskFunction_t function;
+  void * parameters;
+  std::string name;
+};
+
+static thread_local mock_task * currentTask = NULL;
+
+template<typename Ready>
+static bool waitFor(mock_queue * q, std::unique_lock<std::mutex> & lock, TickType_t wait, Ready ready){
+  if(wait == portMAX_DELAY){
+    q->changed.wait(lock, ready);
+    return true;
+  }
+  return q->changed.wait_for(lock, std::chrono::milliseconds(wait), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize){
+  mock_queue * q = new mock_queue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t queue){
+  delete queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t q, const void * item, TickType_t wait, bool front){
+  std::unique_lock<std::mutex> lock(q->mutex);
+  if(!waitFor(q, lock, wait, [q]{ return q->items.size() < q->length; })){
+    return pdFAIL;
+  }
+  std::string data((const char *)item, item ? q->itemSize : 0);
+  if(front){
+    q->items.push_front(data);
+  } else {
+    q->items.push_back(data);
+  }
+  q->changed.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void * item, TickType_t wait){
+  return queueSend(queue, item, wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void * item, TickType_t wait){
+  return queueSend(queue, item, wait, true);
+}
+
+static BaseType_t queueReceive(QueueHandle_t q, void * item, TickType_t wait, bool remove){
+  std::unique_lock<std::mutex> lock(q->mutex);
+  if(!waitFor(q, lock, wait, [q]{ return !q->items.empty(); })){
+    return pdFAIL;
+  }
+  if(item){
+    memcpy(item, q->items.front().data(), q->items.front().size());
+  }
+  if(remove){
+    q->items.pop_front();
+    q->changed.notify_all();
+  }
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item, TickType_t wait){
+  return queueReceive(queue, item, wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void * item, TickType_t wait){
+  return queueReceive(queue, item, wait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q){
+  std::lock_guard<std::mutex> lock(q->mutex);
+  return q->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q){
+  std::lock_guard<std::mutex> lock(q->mutex);
+  return q->length - q->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void){
+  SemaphoreHandle_t s = xQueueCreate(1, 0);
+  xQueueSend(s, NULL, 0);
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void){
+  return xQueueCreate(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait){
+  return xQueueReceive(semaphore, NULL, wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore){
+  return xQueueSend(semaphore, NULL, 0);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char * name, uint32_t stackDepth, void * parameters, UBaseType_t priority, TaskHandle_t * handle, BaseType_t core){
+  mock_task * task = new mock_task();
+  task->function = function;
+  task->parameters = parameters;
+  task->name = name ? name : "";
+  std::thread([task]{
+    currentTask = task;
+    task->function(task->parameters);
+  }).detach();
+  if(handle){
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task){
+  // A task can only end itself here, threads can not be killed
+}
+
+void vTaskDelay(TickType_t ticks){
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void){
+  return currentTask;
+}
+
+TickType_t xTaskGetTickCount(void){
+  return millis();
+}
+
+BaseType_t xPortGetCoreID(void){
+  return 1;
+}
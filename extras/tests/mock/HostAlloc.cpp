@@ -0,0 +1,78 @@
+#include "HostAlloc.h"
+
+#include <atomic>
+#include <malloc.h>
+
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void __libc_free(void * ptr);
+}
+
+static std::atomic<size_t> allocCount(0);
+static std::atomic<size_t> allocBytes(0);
+static std::atomic<size_t> allocCurrent(0);
+static std::atomic<size_t> allocPeak(0);
+static thread_local bool allocFail = false;
+
+static void * tracked(void * p){
+  if(p){
+    size_t size = malloc_usable_size(p);
+    allocCount++;
+    allocBytes += size;
+    size_t now = allocCurrent += size;
+    size_t peak = allocPeak;
+    while(now > peak && !allocPeak.compare_exchange_weak(peak, now)){}
+  }
+  return p;
+}
+
+static void untrack(void * p){
+  if(p){
+    allocCurrent -= malloc_usable_size(p);
+  }
+}
+
+extern "C" void * malloc(size_t size){
+  if(allocFail){
+    return NULL;
+  }
+  return tracked(__libc_malloc(size));
+}
+
+extern "C" void * calloc(size_t count, size_t size){
+  if(allocFail){
+    return NULL;
+  }
+  return tracked(__libc_calloc(count, size));
+}
+
+extern "C" void * realloc(void * ptr, size_t size){
+  untrack(ptr);
+  return tracked(__libc_realloc(ptr, size));
+}
+
+extern "C" void free(void * ptr){
+  untrack(ptr);
+  __libc_free(ptr);
+}
+
+HostAllocStats hostAllocStats(){
+  HostAllocStats s;
+  s.count = allocCount;
+  s.bytes = allocBytes;
+  s.current = allocCurrent;
+  s.peak = allocPeak;
+  return s;
+}
+
+void hostAllocReset(){
+  allocCount = 0;
+  allocBytes = 0;
+  allocPeak = (size_t)allocCurrent;
+}
+
+void hostAllocFail(bool fail){
+  allocFail = fail;
+}
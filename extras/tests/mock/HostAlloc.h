@@ -0,0 +1,20 @@
+/*
+  Counts heap use of the whole process: malloc() and friends are wrapped, so
+  operator new, std::string and the libraries' own allocations all show up.
+*/
+#pragma once
+
+#include <stddef.h>
+
+struct HostAllocStats {
+  size_t count;     // allocations since the last reset
+  size_t bytes;     // bytes handed out by them
+  size_t current;   // bytes in use now
+  size_t peak;      // most bytes in use at once since the last reset
+};
+
+HostAllocStats hostAllocStats();
+// Zeroes the count and sets the peak to what is in use now
+void hostAllocReset();
+// While set, malloc() and friends of the calling thread return NULL
+void hostAllocFail(bool fail);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Arduino.h"
+
+class WiFiClass {
+public:
+  IPAddress localIP(){ return IPAddress(192, 168, 4, 1); }
+  IPAddress softAPIP(){ return IPAddress(192, 168, 4, 1); }
+  String macAddress(){ return "AA:BB:CC:DD:EE:FF"; }
+  int getMode(){ return 2; } // WIFI_AP
+};
+extern WiFiClass WiFi;
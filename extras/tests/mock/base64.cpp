@@ -0,0 +1,160 @@
+#include "libb64/cencode.h"
+#include "libb64/cdecode.h"
+
+static const char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void base64_init_encodestate(base64_encodestate * state){
+  state->step = step_A;
+  state->result = 0;
+  state->stepcount = 0;
+}
+
+char base64_encode_value(char value){
+  return (unsigned char)value > 63 ? '=' : base64Alphabet[(int)value];
+}
+
+int base64_encode_block(const char * plaintext, int length, char * code, base64_encodestate * state){
+  const unsigned char * in = (const unsigned char *)plaintext;
+  const unsigned char * const end = in + length;
+  char * out = code;
+  char result = state->result;
+  switch(state->step){
+    for(;;){
+    case step_A:
+      if(in == end){
+        state->result = result;
+        state->step = step_A;
+        return out - code;
+      }
+      result = (*in >> 2) & 0x3f;
+      *out++ = base64_encode_value(result);
+      result = (*in++ & 0x03) << 4;
+    case step_B:
+      if(in == end){
+        state->result = result;
+        state->step = step_B;
+        return out - code;
+      }
+      result |= (*in >> 4) & 0x0f;
+      *out++ = base64_encode_value(result);
+      result = (*in++ & 0x0f) << 2;
+    case step_C:
+      if(in == end){
+        state->result = result;
+        state->step = step_C;
+        return out - code;
+      }
+      result |= (*in >> 6) & 0x03;
+      *out++ = base64_encode_value(result);
+      *out++ = base64_encode_value(*in++ & 0x3f);
+      state->stepcount++;
+    }
+  }
+  return out - code;
+}
+
+int base64_encode_blockend(char * code, base64_encodestate * state){
+  char * out = code;
+  switch(state->step){
+  case step_B:
+    *out++ = base64_encode_value(state->result);
+    *out++ = '=';
+    *out++ = '=';
+    break;
+  case step_C:
+    *out++ = base64_encode_value(state->result);
+    *out++ = '=';
+    break;
+  case step_A:
+    break;
+  }
+  *out = 0;
+  return out - code;
+}
+
+int base64_encode_chars(const char * plaintext, int length, char * code){
+  base64_encodestate state;
+  base64_init_encodestate(&state);
+  int len = base64_encode_block(plaintext, length, code, &state);
+  return len + base64_encode_blockend(code + len, &state);
+}
+
+int base64_decode_value(char value){
+  const char * p = base64Alphabet;
+  for(int i = 0; *p; i++, p++){
+    if(*p == value){
+      return i;
+    }
+  }
+  return -1;
+}
+
+void base64_init_decodestate(base64_decodestate * state){
+  state->step = step_a;
+  state->plainchar = 0;
+}
+
+int base64_decode_block(const char * code, const int length, char * plaintext, base64_decodestate * state){
+  const char * in = code;
+  const char * const end = code + length;
+  char * out = plaintext;
+  int fragment;
+  *out = state->plainchar;
+  switch(state->step){
+    for(;;){
+    case step_a:
+      do {
+        if(in == end){
+          state->step = step_a;
+          state->plainchar = *out;
+          return out - plaintext;
+        }
+        fragment = base64_decode_value(*in++);
+      } while(fragment < 0);
+      *out = (fragment & 0x3f) << 2;
+    case step_b:
+      do {
+        if(in == end){
+          state->step = step_b;
+          state->plainchar = *out;
+          return out - plaintext;
+        }
+        fragment = base64_decode_value(*in++);
+      } while(fragment < 0);
+      *out++ |= (fragment & 0x30) >> 4;
+      *out = (fragment & 0x0f) << 4;
+    case step_c:
+      do {
+        if(in == end){
+          state->step = step_c;
+          state->plainchar = *out;
+          return out - plaintext;
+        }
+        fragment = base64_decode_value(*in++);
+      } while(fragment < 0);
+      *out++ |= (fragment & 0x3c) >> 2;
+      *out = (fragment & 0x03) << 6;
+    case step_d:
+      do {
+        if(in == end){
+          state->step = step_d;
+          state->plainchar = *out;
+          return out - plaintext;
+        }
+        fragment = base64_decode_value(*in++);
+      } while(fragment < 0);
+      *out++ |= (fragment & 0x3f);
+    }
+  }
+  return out - plaintext;
+}
+
+int base64_decode_chars(const char * code, const int length, char * plaintext){
+  base64_decodestate state;
+  base64_init_decodestate(&state);
+  int len = base64_decode_block(code, length, plaintext, &state);
+  if(len > 0){
+    plaintext[len] = 0;
+  }
+  return len;
+}
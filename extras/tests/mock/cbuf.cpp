@@ -0,0 +1,103 @@
+#include "cbuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+cbuf::cbuf(size_t size)
+  : next(NULL), _size(size), _buf(new char[size]), _bufend(_buf + size), _begin(_buf), _end(_begin) {}
+
+cbuf::~cbuf(){
+  delete[] _buf;
+}
+
+size_t cbuf::resizeAdd(size_t addSize){
+  return resize(_size + addSize);
+}
+
+size_t cbuf::resize(size_t newSize){
+  size_t bytes = available();
+  if(newSize < bytes || newSize == _size){
+    return _size;
+  }
+  char * buf = new char[newSize];
+  peek(buf, bytes);
+  delete[] _buf;
+  _buf = buf;
+  _bufend = _buf + newSize;
+  _size = newSize;
+  _begin = _buf;
+  _end = _buf + bytes;
+  return _size;
+}
+
+size_t cbuf::available() const {
+  if(_end >= _begin){
+    return _end - _begin;
+  }
+  return _size - (_begin - _end);
+}
+
+size_t cbuf::room() const {
+  // One byte stays free so a full buffer does not look empty
+  if(_end >= _begin){
+    return _size - (_end - _begin) - 1;
+  }
+  return _begin - _end - 1;
+}
+
+int cbuf::peek(){
+  return empty() ? -1 : (unsigned char)*_begin;
+}
+
+size_t cbuf::peek(char * dst, size_t size){
+  size_t bytes = available();
+  size_t n = size < bytes ? size : bytes;
+  size_t first = (size_t)(_bufend - _begin);
+  if(first > n){
+    first = n;
+  }
+  memcpy(dst, _begin, first);
+  memcpy(dst + first, _buf, n - first);
+  return n;
+}
+
+int cbuf::read(){
+  if(empty()){
+    return -1;
+  }
+  char c = *_begin;
+  _begin = _wrap(_begin + 1);
+  return (unsigned char)c;
+}
+
+size_t cbuf::read(char * dst, size_t size){
+  size_t n = dst ? peek(dst, size) : (size < available() ? size : available());
+  return remove(n);
+}
+
+size_t cbuf::remove(size_t size){
+  size_t bytes = available();
+  size_t n = size < bytes ? size : bytes;
+  size_t first = (size_t)(_bufend - _begin);
+  _begin = n < first ? _begin + n : _buf + (n - first);
+  return n;
+}
+
+size_t cbuf::write(char c){
+  if(full()){
+    return 0;
+  }
+  *_end = c;
+  _end = _wrap(_end + 1);
+  return 1;
+}
+
+size_t cbuf::write(const char * src, size_t size){
+  size_t r = room();
+  size_t n = size < r ? size : r;
+  for(size_t i = 0; i < n; i++){
+    *_end = src[i];
+    _end = _wrap(_end + 1);
+  }
+  return n;
+}
@@ -0,0 +1,35 @@
+/*
+  Host partition table: a test registers a data partition backed by a host
+  buffer, mapping it hands out that buffer.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+typedef uint32_t spi_flash_mmap_handle_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NOT_FOUND 0x105
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0, ESP_PARTITION_TYPE_DATA = 1 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+typedef enum { SPI_FLASH_MMAP_DATA, SPI_FLASH_MMAP_INST } spi_flash_mmap_memory_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char * label);
+esp_err_t esp_partition_mmap(const esp_partition_t * partition, size_t offset, size_t size, spi_flash_mmap_memory_t memory, const void ** out, spi_flash_mmap_handle_t * handle);
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
+
+// Test side: registers the partition under label, data stays owned by the caller
+void mockPartition(const char * label, const void * data, size_t size);
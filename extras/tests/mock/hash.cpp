@@ -0,0 +1,250 @@
+/*
+  MD5, SHA-1 and SHA-256 for the mbedtls and ROM entry points the libraries
+  call. Plain reference implementations, speed is not a concern here.
+*/
+#include "mbedtls/md5.h"
+#include "mbedtls/sha256.h"
+
+#include <string.h>
+
+static inline uint32_t rol(uint32_t x, int n){ return (x << n) | (x >> (32 - n)); }
+static inline uint32_t ror(uint32_t x, int n){ return (x >> n) | (x << (32 - n)); }
+
+/* MD5, RFC 1321 */
+
+static const uint32_t md5K[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+static const int md5R[64] = {
+  7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+  5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+  4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+  6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void md5Block(uint32_t state[4], const unsigned char block[64]){
+  uint32_t w[16];
+  for(int i = 0; i < 16; i++){
+    w[i] = block[i * 4] | (block[i * 4 + 1] << 8) | (block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  for(int i = 0; i < 64; i++){
+    uint32_t f;
+    int g;
+    if(i < 16){ f = (b & c) | (~b & d); g = i; }
+    else if(i < 32){ f = (d & b) | (~d & c); g = (5 * i + 1) & 15; }
+    else if(i < 48){ f = b ^ c ^ d; g = (3 * i + 5) & 15; }
+    else { f = c ^ (b | ~d); g = (7 * i) & 15; }
+    uint32_t t = d;
+    d = c;
+    c = b;
+    b = b + rol(a + f + md5K[i] + w[g], md5R[i]);
+    a = t;
+  }
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+}
+
+void mbedtls_md5_init(mbedtls_md5_context * ctx){
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md5_free(mbedtls_md5_context * ctx){
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md5_starts(mbedtls_md5_context * ctx){
+  ctx->total[0] = ctx->total[1] = 0;
+  ctx->state[0] = 0x67452301;
+  ctx->state[1] = 0xefcdab89;
+  ctx->state[2] = 0x98badcfe;
+  ctx->state[3] = 0x10325476;
+}
+
+void mbedtls_md5_update(mbedtls_md5_context * ctx, const unsigned char * input, size_t len){
+  while(len--){
+    ctx->buffer[ctx->total[0]++ & 63] = *input++;
+    if(!(ctx->total[0] & 63)){
+      md5Block(ctx->state, ctx->buffer);
+    }
+  }
+}
+
+void mbedtls_md5_finish(mbedtls_md5_context * ctx, unsigned char output[16]){
+  uint64_t bits = (uint64_t)ctx->total[0] * 8;
+  unsigned char pad = 0x80;
+  mbedtls_md5_update(ctx, &pad, 1);
+  pad = 0;
+  while((ctx->total[0] & 63) != 56){
+    mbedtls_md5_update(ctx, &pad, 1);
+  }
+  unsigned char length[8];
+  for(int i = 0; i < 8; i++){
+    length[i] = bits >> (8 * i);
+  }
+  mbedtls_md5_update(ctx, length, 8);
+  for(int i = 0; i < 16; i++){
+    output[i] = ctx->state[i / 4] >> (8 * (i % 4));
+  }
+}
+
+/* SHA-256, FIPS 180-4 */
+
+static const uint32_t sha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void sha256Block(uint32_t state[8], const unsigned char block[64]){
+  uint32_t w[64];
+  for(int i = 0; i < 16; i++){
+    w[i] = ((uint32_t)block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for(int i = 16; i < 64; i++){
+    uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t v[8];
+  memcpy(v, state, sizeof(v));
+  for(int i = 0; i < 64; i++){
+    uint32_t s1 = ror(v[4], 6) ^ ror(v[4], 11) ^ ror(v[4], 25);
+    uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+    uint32_t t1 = v[7] + s1 + ch + sha256K[i] + w[i];
+    uint32_t s0 = ror(v[0], 2) ^ ror(v[0], 13) ^ ror(v[0], 22);
+    uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+    memmove(v + 1, v, 7 * sizeof(uint32_t));
+    v[4] += t1;
+    v[0] = t1 + s0 + maj;
+  }
+  for(int i = 0; i < 8; i++){
+    state[i] += v[i];
+  }
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context * ctx){
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context * ctx){
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_starts(mbedtls_sha256_context * ctx, int is224){
+  static const uint32_t init[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  ctx->total[0] = ctx->total[1] = 0;
+  memcpy(ctx->state, init, sizeof(init));
+  ctx->is224 = 0;
+}
+
+void mbedtls_sha256_update(mbedtls_sha256_context * ctx, const unsigned char * input, size_t len){
+  while(len--){
+    ctx->buffer[ctx->total[0]++ & 63] = *input++;
+    if(!(ctx->total[0] & 63)){
+      sha256Block(ctx->state, ctx->buffer);
+    }
+  }
+}
+
+void mbedtls_sha256_finish(mbedtls_sha256_context * ctx, unsigned char output[32]){
+  uint64_t bits = (uint64_t)ctx->total[0] * 8;
+  unsigned char pad = 0x80;
+  mbedtls_sha256_update(ctx, &pad, 1);
+  pad = 0;
+  while((ctx->total[0] & 63) != 56){
+    mbedtls_sha256_update(ctx, &pad, 1);
+  }
+  unsigned char length[8];
+  for(int i = 0; i < 8; i++){
+    length[i] = bits >> (56 - 8 * i);
+  }
+  mbedtls_sha256_update(ctx, length, 8);
+  for(int i = 0; i < 32; i++){
+    output[i] = ctx->state[i / 4] >> (24 - 8 * (i % 4));
+  }
+}
+
+/* SHA-1, FIPS 180-4, with the ROM's context layout as AsyncWebSocket declares it */
+
+extern "C" {
+
+typedef struct {
+  uint32_t state[5];
+  uint32_t count[2];
+  unsigned char buffer[64];
+} SHA1_CTX;
+
+void SHA1Transform(uint32_t state[5], const unsigned char buffer[64]){
+  uint32_t w[80];
+  for(int i = 0; i < 16; i++){
+    w[i] = ((uint32_t)buffer[i * 4] << 24) | (buffer[i * 4 + 1] << 16) | (buffer[i * 4 + 2] << 8) | buffer[i * 4 + 3];
+  }
+  for(int i = 16; i < 80; i++){
+    w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+  for(int i = 0; i < 80; i++){
+    uint32_t f, k;
+    if(i < 20){ f = (b & c) | (~b & d); k = 0x5a827999; }
+    else if(i < 40){ f = b ^ c ^ d; k = 0x6ed9eba1; }
+    else if(i < 60){ f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+    else { f = b ^ c ^ d; k = 0xca62c1d6; }
+    uint32_t t = rol(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = rol(b, 30);
+    b = a;
+    a = t;
+  }
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+}
+
+void SHA1Init(SHA1_CTX * context){
+  context->state[0] = 0x67452301;
+  context->state[1] = 0xefcdab89;
+  context->state[2] = 0x98badcfe;
+  context->state[3] = 0x10325476;
+  context->state[4] = 0xc3d2e1f0;
+  context->count[0] = context->count[1] = 0;
+}
+
+void SHA1Update(SHA1_CTX * context, const unsigned char * data, uint32_t len){
+  while(len--){
+    context->buffer[context->count[0]++ & 63] = *data++;
+    if(!(context->count[0] & 63)){
+      SHA1Transform(context->state, context->buffer);
+    }
+  }
+}
+
+void SHA1Final(unsigned char digest[20], SHA1_CTX * context){
+  uint64_t bits = (uint64_t)context->count[0] * 8;
+  unsigned char pad = 0x80;
+  SHA1Update(context, &pad, 1);
+  pad = 0;
+  while((context->count[0] & 63) != 56){
+    SHA1Update(context, &pad, 1);
+  }
+  unsigned char length[8];
+  for(int i = 0; i < 8; i++){
+    length[i] = bits >> (56 - 8 * i);
+  }
+  SHA1Update(context, length, 8);
+  for(int i = 0; i < 20; i++){
+    digest[i] = context->state[i / 4] >> (24 - 8 * (i % 4));
+  }
+}
+
+}
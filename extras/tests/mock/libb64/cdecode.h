@@ -0,0 +1,21 @@
+#pragma once
+
+typedef enum { step_a, step_b, step_c, step_d } base64_decodestep;
+
+typedef struct {
+  base64_decodestep step;
+  char plainchar;
+} base64_decodestate;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void base64_init_decodestate(base64_decodestate * state);
+int base64_decode_value(char value);
+int base64_decode_block(const char * code, const int length, char * plaintext, base64_decodestate * state);
+int base64_decode_chars(const char * code, const int length, char * plaintext);
+#ifdef __cplusplus
+}
+#endif
+
+#define base64_decode_expected_len(n) ((n * 3) / 4)
@@ -0,0 +1,39 @@
+/*
+  Host lwIP: only the types and calls AsyncTCP makes. The stack itself is
+  faked by the tests, see AsyncTCP/FakeLwip.cpp.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef MEMP_NUM_TCP_PCB
+#define MEMP_NUM_TCP_PCB 16
+#endif
+
+typedef int8_t err_t;
+typedef int esp_err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_BUF -2
+#define ERR_TIMEOUT -3
+#define ERR_RTE -4
+#define ERR_INPROGRESS -5
+#define ERR_VAL -6
+#define ERR_WOULDBLOCK -7
+#define ERR_USE -8
+#define ERR_ALREADY -9
+#define ERR_ISCONN -10
+#define ERR_CONN -11
+#define ERR_IF -12
+#define ERR_ABRT -13
+#define ERR_RST -14
+#define ERR_CLSD -15
+#define ERR_ARG -16
+
+#define IPADDR_TYPE_V4 0
+#define IPADDR_ANY 0
+
+typedef struct ip4_addr { uint32_t addr; } ip4_addr_t;
+typedef struct ip_addr { union { ip4_addr_t ip4; } u_addr; uint8_t type; } ip_addr_t;
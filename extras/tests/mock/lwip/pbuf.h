@@ -0,0 +1,12 @@
+#pragma once
+
+#include "opt.h"
+
+struct pbuf {
+  struct pbuf * next;
+  void * payload;
+  uint16_t tot_len;
+  uint16_t len;
+};
+
+void pbuf_free(struct pbuf * p);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "../opt.h"
+
+struct tcpip_api_call_data { int unused; };
+typedef err_t (*tcpip_api_call_fn)(struct tcpip_api_call_data * call);
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data * call);
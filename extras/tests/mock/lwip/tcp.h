@@ -0,0 +1,55 @@
+#pragma once
+
+#include "opt.h"
+#include "pbuf.h"
+
+enum tcp_state { CLOSED = 0, LISTEN = 1, SYN_SENT = 2, SYN_RCVD = 3, ESTABLISHED = 4, FIN_WAIT_1 = 5, CLOSE_WAIT = 7 };
+
+struct tcp_pcb;
+typedef err_t (*tcp_recv_fn)(void * arg, struct tcp_pcb * pcb, struct pbuf * p, err_t err);
+typedef err_t (*tcp_sent_fn)(void * arg, struct tcp_pcb * pcb, uint16_t len);
+typedef void (*tcp_err_fn)(void * arg, err_t err);
+typedef err_t (*tcp_poll_fn)(void * arg, struct tcp_pcb * pcb);
+typedef err_t (*tcp_connected_fn)(void * arg, struct tcp_pcb * pcb, err_t err);
+typedef err_t (*tcp_accept_fn)(void * arg, struct tcp_pcb * newpcb, err_t err);
+
+struct tcp_pcb {
+  enum tcp_state state;
+  uint16_t mss;
+  ip_addr_t local_ip, remote_ip;
+  uint16_t local_port, remote_port;
+  uint8_t flags;
+  // Host fake: callbacks as registered and the fake's own connection state
+  void * callback_arg;
+  tcp_recv_fn recv;
+  tcp_sent_fn sent;
+  tcp_err_fn errf;
+  tcp_poll_fn poll;
+  tcp_accept_fn accept;
+  void * fake;
+};
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+struct tcp_pcb * tcp_new_ip_type(uint8_t type);
+void tcp_arg(struct tcp_pcb * pcb, void * arg);
+void tcp_recv(struct tcp_pcb * pcb, tcp_recv_fn recv);
+void tcp_sent(struct tcp_pcb * pcb, tcp_sent_fn sent);
+void tcp_err(struct tcp_pcb * pcb, tcp_err_fn err);
+void tcp_poll(struct tcp_pcb * pcb, tcp_poll_fn poll, uint8_t interval);
+void tcp_accept(struct tcp_pcb * pcb, tcp_accept_fn accept);
+void tcp_accepted(struct tcp_pcb * pcb);
+err_t tcp_write(struct tcp_pcb * pcb, const void * data, uint16_t len, uint8_t apiflags);
+err_t tcp_output(struct tcp_pcb * pcb);
+void tcp_recved(struct tcp_pcb * pcb, uint16_t len);
+err_t tcp_connect(struct tcp_pcb * pcb, ip_addr_t * addr, uint16_t port, tcp_connected_fn connected);
+err_t tcp_close(struct tcp_pcb * pcb);
+void tcp_abort(struct tcp_pcb * pcb);
+err_t tcp_bind(struct tcp_pcb * pcb, ip_addr_t * addr, uint16_t port);
+struct tcp_pcb * tcp_listen_with_backlog(struct tcp_pcb * pcb, uint8_t backlog);
+uint16_t tcp_sndbuf(struct tcp_pcb * pcb);
+uint16_t tcp_mss(struct tcp_pcb * pcb);
+void tcp_nagle_disable(struct tcp_pcb * pcb);
+void tcp_nagle_enable(struct tcp_pcb * pcb);
+int tcp_nagle_disabled(struct tcp_pcb * pcb);
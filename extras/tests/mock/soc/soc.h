@@ -0,0 +1,13 @@
+/*
+  Host memory map: the flash data window is a range the tests choose, by
+  default one that contains no host address.
+*/
+#pragma once
+
+#include <stdint.h>
+
+extern uintptr_t mockDromLow;
+extern uintptr_t mockDromHigh;
+
+#define SOC_DROM_LOW mockDromLow
+#define SOC_DROM_HIGH mockDromHigh
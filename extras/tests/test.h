@@ -0,0 +1,59 @@
+/*
+  Checks and timing for the host tests. Include it first, before Arduino.h
+  brings in its min/max macros.
+*/
+#pragma once
+
+#include <chrono>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+
+static int testFailures = 0;
+
+template<typename T>
+static std::string testShow(const T & v){
+  std::ostringstream s;
+  s << v;
+  return s.str();
+}
+
+static inline std::string testShow(const std::string & v){ return "\"" + v + "\""; }
+static inline std::string testShow(const char * v){ return v ? testShow(std::string(v)) : "NULL"; }
+
+#define CHECK(cond) do { \
+    if(!(cond)){ \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      testFailures++; \
+    } \
+  } while(0)
+
+#define CHECK_EQ(a, b) do { \
+    auto _a = (a); \
+    auto _b = (b); \
+    if(!(_a == _b)){ \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %s != %s\n", __FILE__, __LINE__, #a, #b, testShow(_a).c_str(), testShow(_b).c_str()); \
+      testFailures++; \
+    } \
+  } while(0)
+
+// Exit code for main()
+static inline int testResult(){
+  if(testFailures){
+    fprintf(stderr, "%d check(s) failed\n", testFailures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
+
+// Nanoseconds per call of f, over n calls
+template<typename F>
+static double benchNanos(size_t n, F f){
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < n; i++){
+    f();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / n;
+}
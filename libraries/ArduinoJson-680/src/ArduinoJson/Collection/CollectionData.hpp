@@ -6,6 +6,7 @@
 
 namespace ARDUINOJSON_NAMESPACE {
 
+class KeyIndex;
 class MemoryPool;
 class VariantData;
 class VariantSlot;
@@ -13,6 +14,9 @@ class VariantSlot;
 class CollectionData {
   VariantSlot *_head;
   VariantSlot *_tail;
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  KeyIndex *_index;  // null until a lookup goes through many keys
+#endif
 
  public:
   // Must be a POD!
@@ -42,6 +46,10 @@ class CollectionData {
   template <typename TAdaptedString>
   VariantData *get(TAdaptedString key) const;
 
+  // Same as get(key), but may index the keys in the pool
+  template <typename TAdaptedString>
+  VariantData *get(TAdaptedString key, MemoryPool *pool);
+
   VariantSlot *head() const {
     return _head;
   }
@@ -65,6 +73,9 @@ class CollectionData {
   template <typename TAdaptedString>
   VariantSlot *getSlot(TAdaptedString key) const;
 
+  template <typename TAdaptedString>
+  VariantSlot *getSlot(TAdaptedString key, MemoryPool *pool);
+
   VariantSlot *getPreviousSlot(VariantSlot *) const;
 };
 }  // namespace ARDUINOJSON_NAMESPACE
@@ -6,6 +6,7 @@
 
 #include "../Variant/VariantData.hpp"
 #include "CollectionData.hpp"
+#include "KeyIndex.hpp"
 
 namespace ARDUINOJSON_NAMESPACE {
 
@@ -20,6 +21,9 @@ inline VariantSlot* CollectionData::addSlot(MemoryPool* pool) {
     _head = slot;
     _tail = slot;
   }
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  _index = 0;  // the key is not known yet
+#endif
 
   slot->clear();
   return slot;
@@ -31,14 +35,24 @@ inline VariantData* CollectionData::add(MemoryPool* pool) {
 
 template <typename TAdaptedString>
 inline VariantData* CollectionData::add(TAdaptedString key, MemoryPool* pool) {
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  KeyIndex* index = _index;
+#endif
   VariantSlot* slot = addSlot(pool);
   if (!slotSetKey(slot, key, pool)) return 0;
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  // keep the index if the new key still fits, rebuild it later otherwise
+  if (index && index->insert(slot)) _index = index;
+#endif
   return slot->data();
 }
 
 inline void CollectionData::clear() {
   _head = 0;
   _tail = 0;
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  _index = 0;
+#endif
 }
 
 template <typename TAdaptedString>
@@ -90,6 +104,10 @@ inline bool CollectionData::equalsArray(const CollectionData& other) const {
 
 template <typename TAdaptedString>
 inline VariantSlot* CollectionData::getSlot(TAdaptedString key) const {
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  // keys in flash cannot be hashed
+  if (_index && key.data()) return _index->find(key);
+#endif
   VariantSlot* slot = _head;
   while (slot) {
     if (key.equals(slot->key())) break;
@@ -98,6 +116,27 @@ inline VariantSlot* CollectionData::getSlot(TAdaptedString key) const {
   return slot;
 }
 
+template <typename TAdaptedString>
+inline VariantSlot* CollectionData::getSlot(TAdaptedString key,
+                                            MemoryPool* pool) {
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  if (_index) return getSlot(key);
+  size_t skipped = 0;
+  VariantSlot* slot = _head;
+  while (slot) {
+    if (key.equals(slot->key())) break;
+    slot = slot->next();
+    skipped++;
+  }
+  if (skipped >= ARDUINOJSON_KEY_INDEX_THRESHOLD)
+    _index = KeyIndex::create(_head, pool);
+  return slot;
+#else
+  (void)pool;
+  return getSlot(key);
+#endif
+}
+
 inline VariantSlot* CollectionData::getSlot(size_t index) const {
   return _head->next(index);
 }
@@ -118,6 +157,12 @@ inline VariantData* CollectionData::get(TAdaptedString key) const {
   return slot ? slot->data() : 0;
 }
 
+template <typename TAdaptedString>
+inline VariantData* CollectionData::get(TAdaptedString key, MemoryPool* pool) {
+  VariantSlot* slot = getSlot(key, pool);
+  return slot ? slot->data() : 0;
+}
+
 inline VariantData* CollectionData::get(size_t index) const {
   VariantSlot* slot = getSlot(index);
   return slot ? slot->data() : 0;
@@ -125,6 +170,9 @@ inline VariantData* CollectionData::get(size_t index) const {
 
 inline void CollectionData::remove(VariantSlot* slot) {
   if (!slot) return;
+#if ARDUINOJSON_ENABLE_KEY_INDEX
+  _index = 0;
+#endif
   VariantSlot* prev = getPreviousSlot(slot);
   VariantSlot* next = slot->next();
   if (prev)
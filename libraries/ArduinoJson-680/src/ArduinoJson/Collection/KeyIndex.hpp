@@ -0,0 +1,88 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Memory/MemoryPool.hpp"
+#include "../Variant/SlotFunctions.hpp"
+
+#include <stdint.h>  // uint32_t
+#include <string.h>  // memset, strcmp
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// Open-addressed hash table of the slots of an object, allocated from the
+// memory pool like the slots. It is dropped as soon as the object changes in
+// a way it cannot follow, the pool does not get the memory back.
+class KeyIndex {
+ public:
+  // Returns null if the pool is full
+  static KeyIndex* create(VariantSlot* head, MemoryPool* pool) {
+    if (!pool) return 0;
+    size_t count = slotSize(head);
+    size_t capacity = 8;
+    while (capacity < count * 2) capacity *= 2;
+    // slots link to each other with a distance counted in slots, so the index
+    // must take a whole number of them
+    size_t bytes = sizeof(KeyIndex) + capacity * sizeof(VariantSlot*);
+    bytes = (bytes + sizeof(VariantSlot) - 1) / sizeof(VariantSlot);
+    KeyIndex* index = reinterpret_cast<KeyIndex*>(
+        pool->allocRight(bytes * sizeof(VariantSlot)));
+    if (!index) return 0;
+    index->_capacity = capacity;
+    index->_count = 0;
+    memset(index->slots(), 0, capacity * sizeof(VariantSlot*));
+    for (VariantSlot* slot = head; slot; slot = slot->next())
+      index->insert(slot);
+    return index;
+  }
+
+  // The first slot with this key, like the linear search
+  template <typename TAdaptedString>
+  VariantSlot* find(TAdaptedString key) const {
+    size_t mask = _capacity - 1;
+    for (size_t i = hash(key.data()) & mask;; i = (i + 1) & mask) {
+      VariantSlot* slot = slots()[i];
+      if (!slot || key.equals(slot->key())) return slot;
+    }
+  }
+
+  // Returns false when the table is too full to take the slot
+  bool insert(VariantSlot* slot) {
+    const char* key = slot->key();
+    if (!key) return true;
+    if ((_count + 1) * 4 > _capacity * 3) return false;
+    size_t mask = _capacity - 1;
+    for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+      VariantSlot*& entry = slots()[i];
+      if (!entry) {
+        entry = slot;
+        _count++;
+        return true;
+      }
+      // duplicate key, the first one wins
+      if (!strcmp(entry->key(), key)) return true;
+    }
+  }
+
+ private:
+  // FNV-1a
+  static uint32_t hash(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+      h ^= static_cast<uint8_t>(*s++);
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  VariantSlot** slots() const {
+    return reinterpret_cast<VariantSlot**>(const_cast<KeyIndex*>(this) + 1);
+  }
+
+  size_t _capacity;  // power of two
+  size_t _count;
+};
+
+}  // namespace ARDUINOJSON_NAMESPACE
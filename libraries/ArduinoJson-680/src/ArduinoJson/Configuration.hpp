@@ -48,6 +48,11 @@
 #define ARDUINOJSON_ENABLE_STD_STREAM 0
 #endif
 
+// Nor std::thread
+#ifndef ARDUINOJSON_ENABLE_STD_THREAD
+#define ARDUINOJSON_ENABLE_STD_THREAD 0
+#endif
+
 // Limit nesting as the stack is likely to be small
 #ifndef ARDUINOJSON_DEFAULT_NESTING_LIMIT
 #define ARDUINOJSON_DEFAULT_NESTING_LIMIT 10
@@ -79,6 +84,15 @@
 #define ARDUINOJSON_ENABLE_STD_STREAM 1
 #endif
 
+// And std::thread, if the compiler has C++11
+#ifndef ARDUINOJSON_ENABLE_STD_THREAD
+#if __cplusplus >= 201103L
+#define ARDUINOJSON_ENABLE_STD_THREAD 1
+#else
+#define ARDUINOJSON_ENABLE_STD_THREAD 0
+#endif
+#endif
+
 // On a computer, the stack is large so we can increase nesting limit
 #ifndef ARDUINOJSON_DEFAULT_NESTING_LIMIT
 #define ARDUINOJSON_DEFAULT_NESTING_LIMIT 50
@@ -144,3 +158,46 @@
 #ifndef ARDUINOJSON_TAB
 #define ARDUINOJSON_TAB "  "
 #endif
+
+// Index the keys of large objects to find members in constant time
+// CAUTION: adds one pointer to every slot, see JSON_OBJECT_SIZE(), and the
+// index takes two to four pointers per key from the document
+#ifndef ARDUINOJSON_ENABLE_KEY_INDEX
+#define ARDUINOJSON_ENABLE_KEY_INDEX 0
+#endif
+
+// Number of keys a lookup must go past before the object gets an index
+#ifndef ARDUINOJSON_KEY_INDEX_THRESHOLD
+#define ARDUINOJSON_KEY_INDEX_THRESHOLD 16
+#endif
+
+// Store identical strings once in the memory pool
+// CAUTION: each string copied is compared with all the ones in the pool
+#ifndef ARDUINOJSON_ENABLE_STRING_DEDUPLICATION
+#define ARDUINOJSON_ENABLE_STRING_DEDUPLICATION 0
+#endif
+
+// Write integers two digits at a time, from a table of the 100 pairs
+// CAUTION: the table takes 200 bytes of flash
+#ifndef ARDUINOJSON_ENABLE_FAST_INTEGERS
+#define ARDUINOJSON_ENABLE_FAST_INTEGERS 0
+#endif
+
+// Write floats with the fewest digits that read back as the same value
+// (doubles are not affected)
+// CAUTION: floats may come out with more or fewer digits than with the default
+// formatting, which prints up to 6 decimal places
+#ifndef ARDUINOJSON_ENABLE_SHORTEST_FLOATS
+#define ARDUINOJSON_ENABLE_SHORTEST_FLOATS 0
+#endif
+
+// Skip spaces and copy strings in bulk when the input is in memory and its
+// length is known (pointer and size, String, std::string), with SSE2, AVX2 or
+// NEON when the compiler targets them
+#ifndef ARDUINOJSON_ENABLE_BULK_SCAN
+#if ARDUINOJSON_EMBEDDED_MODE
+#define ARDUINOJSON_ENABLE_BULK_SCAN 0
+#else
+#define ARDUINOJSON_ENABLE_BULK_SCAN 1
+#endif
+#endif
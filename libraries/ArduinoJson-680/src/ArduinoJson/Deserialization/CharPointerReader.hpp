@@ -4,6 +4,10 @@
 
 #pragma once
 
+#if ARDUINOJSON_ENABLE_STD_STRING
+#include <string>
+#endif
+
 namespace ARDUINOJSON_NAMESPACE {
 
 class UnsafeCharPointerReader {
@@ -38,6 +42,19 @@ class SafeCharPointerReader {
   bool ended() const {
     return _ptr == _end;
   }
+
+  // The characters not read yet are [ptr(), end()), for the bulk scans
+  const char* ptr() const {
+    return _ptr;
+  }
+
+  const char* end() const {
+    return _end;
+  }
+
+  void skipTo(const char* ptr) {
+    _ptr = ptr;
+  }
 };
 
 template <typename TChar>
@@ -56,4 +73,10 @@ inline SafeCharPointerReader makeReader(const ::String& input) {
 }
 #endif
 
+#if ARDUINOJSON_ENABLE_STD_STRING
+inline SafeCharPointerReader makeReader(const std::string& input) {
+  return SafeCharPointerReader(input.c_str(), input.size());
+}
+#endif
+
 }  // namespace ARDUINOJSON_NAMESPACE
@@ -22,7 +22,8 @@ class DeserializationError {
     InvalidInput,
     NoMemory,
     NotSupported,
-    TooDeep
+    TooDeep,
+    NeedMoreInput  // JsonPushDeserializer only
   };
 
   DeserializationError() {}
@@ -88,6 +89,8 @@ class DeserializationError {
         return "IncompleteInput";
       case NotSupported:
         return "NotSupported";
+      case NeedMoreInput:
+        return "NeedMoreInput";
       default:
         return "???";
     }
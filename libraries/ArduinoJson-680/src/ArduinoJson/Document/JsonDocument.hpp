@@ -176,7 +176,7 @@ class JsonDocument : public Visitable {
   // get(const __FlashStringHelper*) const
   template <typename TChar>
   FORCE_INLINE VariantRef get(TChar* key) {
-    return VariantRef(&_pool, _data.get(adaptString(key)));
+    return VariantRef(&_pool, _data.get(adaptString(key), &_pool));
   }
 
   // get(const std::string&) const
@@ -184,7 +184,7 @@ class JsonDocument : public Visitable {
   template <typename TString>
   FORCE_INLINE typename enable_if<IsString<TString>::value, VariantRef>::type
   get(const TString& key) {
-    return VariantRef(&_pool, _data.get(adaptString(key)));
+    return VariantRef(&_pool, _data.get(adaptString(key), &_pool));
   }
 
   // getOrCreate(char*)
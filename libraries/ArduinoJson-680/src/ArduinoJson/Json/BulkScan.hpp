@@ -0,0 +1,175 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Deserialization/CharPointerReader.hpp"
+
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#define ARDUINOJSON_HAS_SIMD 1
+#elif defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define ARDUINOJSON_HAS_SIMD 1
+#elif defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define ARDUINOJSON_HAS_SIMD 1
+#else
+#define ARDUINOJSON_HAS_SIMD 0
+#endif
+
+namespace ARDUINOJSON_NAMESPACE {
+
+#if ARDUINOJSON_HAS_SIMD
+// A block of bytes compared all at once
+class SimdBlock {
+ public:
+#if defined(__AVX2__)
+  static const size_t size = 32;
+
+  explicit SimdBlock(const char *p)
+      : _v(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))) {}
+
+  // All ones in the bytes equal to c
+  SimdBlock operator==(char c) const {
+    return SimdBlock(_mm256_cmpeq_epi8(_v, _mm256_set1_epi8(c)));
+  }
+
+  SimdBlock operator|(const SimdBlock &other) const {
+    return SimdBlock(_mm256_or_si256(_v, other._v));
+  }
+
+  // Offset of the first byte that is all ones, size if none is
+  size_t firstSet() const {
+    uint32_t mask = uint32_t(_mm256_movemask_epi8(_v));
+    return mask ? size_t(__builtin_ctz(mask)) : size;
+  }
+
+  // Offset of the first byte that is all zeros, size if none is
+  size_t firstClear() const {
+    uint32_t mask = ~uint32_t(_mm256_movemask_epi8(_v));
+    return mask ? size_t(__builtin_ctz(mask)) : size;
+  }
+
+ private:
+  explicit SimdBlock(__m256i v) : _v(v) {}
+  __m256i _v;
+#elif defined(__SSE2__)
+  static const size_t size = 16;
+
+  explicit SimdBlock(const char *p)
+      : _v(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+
+  SimdBlock operator==(char c) const {
+    return SimdBlock(_mm_cmpeq_epi8(_v, _mm_set1_epi8(c)));
+  }
+
+  SimdBlock operator|(const SimdBlock &other) const {
+    return SimdBlock(_mm_or_si128(_v, other._v));
+  }
+
+  size_t firstSet() const {
+    uint32_t mask = uint32_t(_mm_movemask_epi8(_v));
+    return mask ? size_t(__builtin_ctz(mask)) : size;
+  }
+
+  size_t firstClear() const {
+    uint32_t mask = ~uint32_t(_mm_movemask_epi8(_v)) & 0xFFFF;
+    return mask ? size_t(__builtin_ctz(mask)) : size;
+  }
+
+ private:
+  explicit SimdBlock(__m128i v) : _v(v) {}
+  __m128i _v;
+#else  // NEON
+  static const size_t size = 16;
+
+  explicit SimdBlock(const char *p)
+      : _v(vld1q_u8(reinterpret_cast<const uint8_t *>(p))) {}
+
+  SimdBlock operator==(char c) const {
+    return SimdBlock(vceqq_u8(_v, vdupq_n_u8(uint8_t(c))));
+  }
+
+  SimdBlock operator|(const SimdBlock &other) const {
+    return SimdBlock(vorrq_u8(_v, other._v));
+  }
+
+  size_t firstSet() const {
+    return firstNonZeroNibble(_v);
+  }
+
+  size_t firstClear() const {
+    return firstNonZeroNibble(vmvnq_u8(_v));
+  }
+
+ private:
+  explicit SimdBlock(uint8x16_t v) : _v(v) {}
+
+  // NEON has no movemask: narrowing keeps four bits of each byte
+  static size_t firstNonZeroNibble(uint8x16_t v) {
+    uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+    return mask ? size_t(__builtin_ctzll(mask) >> 2) : size;
+  }
+
+  uint8x16_t _v;
+#endif
+};
+#endif
+
+// First character of [p, end) that is not a space
+inline const char *scanSpaces(const char *p, const char *end) {
+#if ARDUINOJSON_HAS_SIMD
+  while (size_t(end - p) >= SimdBlock::size) {
+    SimdBlock block(p);
+    size_t n = ((block == ' ') | (block == '\t') | (block == '\r') |
+                (block == '\n'))
+                   .firstClear();
+    p += n;
+    if (n < SimdBlock::size) return p;
+  }
+#endif
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+  return p;
+}
+
+// First character of [p, end) that a string can't simply copy: the closing
+// quote, a backslash, or a terminator
+inline const char *scanStringChars(const char *p, const char *end,
+                                   char stopChar) {
+#if ARDUINOJSON_HAS_SIMD
+  while (size_t(end - p) >= SimdBlock::size) {
+    SimdBlock block(p);
+    size_t n =
+        ((block == stopChar) | (block == '\\') | (block == '\0')).firstSet();
+    p += n;
+    if (n < SimdBlock::size) return p;
+  }
+#endif
+  while (p < end && *p != stopChar && *p != '\\' && *p != '\0') p++;
+  return p;
+}
+
+// Other readers don't have their input in memory, they go one char at a time
+template <typename TReader>
+inline void skipSpacesInBulk(TReader &) {}
+
+inline void skipSpacesInBulk(SafeCharPointerReader &reader) {
+  reader.skipTo(scanSpaces(reader.ptr(), reader.end()));
+}
+
+template <typename TReader, typename TBuilder>
+inline void readStringCharsInBulk(TReader &, char, TBuilder &) {}
+
+template <typename TBuilder>
+inline void readStringCharsInBulk(SafeCharPointerReader &reader, char stopChar,
+                                  TBuilder &builder) {
+  const char *p = reader.ptr();
+  const char *q = scanStringChars(p, reader.end(), stopChar);
+  builder.append(p, size_t(q - p));
+  reader.skipTo(q);
+}
+
+}  // namespace ARDUINOJSON_NAMESPACE
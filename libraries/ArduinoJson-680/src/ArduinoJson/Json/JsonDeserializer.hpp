@@ -10,6 +10,7 @@
 #include "../Numbers/isInteger.hpp"
 #include "../Polyfills/type_traits.hpp"
 #include "../Variant/VariantData.hpp"
+#include "BulkScan.hpp"
 #include "EscapeSequence.hpp"
 
 namespace ARDUINOJSON_NAMESPACE {
@@ -183,6 +184,9 @@ class JsonDeserializer {
 
     move();
     for (;;) {
+#if ARDUINOJSON_ENABLE_BULK_SCAN
+      readStringCharsInBulk(_reader, stopChar, builder);
+#endif
       char c = current();
       move();
       if (c == stopChar) break;
@@ -282,6 +286,9 @@ class JsonDeserializer {
         case '\r':
         case '\n':
           move();
+#if ARDUINOJSON_ENABLE_BULK_SCAN
+          skipSpacesInBulk(_reader);
+#endif
           continue;
 
         // comments
@@ -0,0 +1,169 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include <string.h>  // for memchr
+
+#include "../Document/DynamicJsonDocument.hpp"
+#include "BulkScan.hpp"
+#include "JsonDeserializer.hpp"
+
+#if ARDUINOJSON_ENABLE_STD_STREAM
+#include <istream>
+#include <string>
+#endif
+
+#if ARDUINOJSON_ENABLE_STD_THREAD
+#include <atomic>
+#include <thread>
+#include <vector>
+#endif
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// Decodes JSON lines, one document per line, and calls callback(doc) for each
+// one. Blank lines are skipped. doc is cleared and reused from one line to the
+// next, copy what must outlive the call. The callback returns false to stop.
+// Returns the error of the first line that doesn't parse, Ok otherwise.
+template <typename TChar, typename TCallback>
+DeserializationError deserializeJsonLines(
+    JsonDocument &doc, TChar *input, size_t inputSize, TCallback callback,
+    NestingLimit nestingLimit = NestingLimit()) {
+  const char *p = reinterpret_cast<const char *>(input);
+  const char *end = p + inputSize;
+  while (p < end) {
+    const char *eol =
+        static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+    if (!eol) eol = end;
+    if (scanSpaces(p, eol) != eol) {
+      DeserializationError err =
+          deserializeJson(doc, p, size_t(eol - p), nestingLimit);
+      if (err) return err;
+      if (!callback(doc)) break;
+    }
+    if (eol == end) break;
+    p = eol + 1;
+  }
+  return DeserializationError::Ok;
+}
+
+#if ARDUINOJSON_ENABLE_STD_STREAM
+template <typename TCallback>
+DeserializationError deserializeJsonLines(
+    JsonDocument &doc, std::istream &input, TCallback callback,
+    NestingLimit nestingLimit = NestingLimit()) {
+  std::string line;
+  while (std::getline(input, line)) {
+    const char *end = line.data() + line.size();
+    if (scanSpaces(line.data(), end) == end) continue;
+    DeserializationError err = deserializeJson(doc, line, nestingLimit);
+    if (err) return err;
+    if (!callback(doc)) break;
+  }
+  return DeserializationError::Ok;
+}
+#endif
+
+#if ARDUINOJSON_ENABLE_STD_THREAD
+// Lets the other threads know when one of them stops
+template <typename TCallback>
+class SharedJsonLinesCallback {
+ public:
+  SharedJsonLinesCallback(TCallback &callback, std::atomic<bool> &stop)
+      : _callback(&callback), _stop(&stop) {}
+
+  bool operator()(JsonDocument &doc) {
+    if (*_stop) return false;
+    if ((*_callback)(doc)) return true;
+    *_stop = true;
+    return false;
+  }
+
+  void stop() {
+    *_stop = true;
+  }
+
+ private:
+  TCallback *_callback;
+  std::atomic<bool> *_stop;
+};
+
+// Decodes the lines in [begin, end) in a document of its own
+template <typename TCallback>
+class JsonLinesWorker {
+ public:
+  JsonLinesWorker(size_t docCapacity, const char *begin, const char *end,
+                  SharedJsonLinesCallback<TCallback> callback,
+                  NestingLimit nestingLimit, DeserializationError &error)
+      : _docCapacity(docCapacity),
+        _begin(begin),
+        _end(end),
+        _callback(callback),
+        _nestingLimit(nestingLimit),
+        _error(&error) {}
+
+  void operator()() {
+    DynamicJsonDocument doc(_docCapacity);
+    *_error = deserializeJsonLines(doc, _begin, size_t(_end - _begin),
+                                   _callback, _nestingLimit);
+    if (*_error) _callback.stop();
+  }
+
+ private:
+  size_t _docCapacity;
+  const char *_begin;
+  const char *_end;
+  SharedJsonLinesCallback<TCallback> _callback;
+  NestingLimit _nestingLimit;
+  DeserializationError *_error;
+};
+
+// Same as deserializeJsonLines(), with the input split on line boundaries
+// between threadCount threads, each with a DynamicJsonDocument of docCapacity
+// bytes.
+// CAUTION: the callback runs on several threads at once, the lines come in no
+// particular order, and decoding stops at the first error but other threads
+// may have gone past that line.
+template <typename TChar, typename TCallback>
+DeserializationError deserializeJsonLinesParallel(
+    size_t docCapacity, TChar *input, size_t inputSize, TCallback callback,
+    unsigned threadCount = std::thread::hardware_concurrency(),
+    NestingLimit nestingLimit = NestingLimit()) {
+  if (threadCount == 0) threadCount = 1;
+  const char *begin = reinterpret_cast<const char *>(input);
+  const char *end = begin + inputSize;
+
+  std::atomic<bool> stop(false);
+  SharedJsonLinesCallback<TCallback> sharedCallback(callback, stop);
+  std::vector<DeserializationError> errors(threadCount,
+                                           DeserializationError::Ok);
+  std::vector<std::thread> threads;
+  const char *partBegin = begin;
+  for (unsigned i = 1; i <= threadCount && partBegin < end; i++) {
+    // each part ends after the first newline past its share of the input
+    const char *partEnd = begin + inputSize / threadCount * i;
+    if (i == threadCount || partEnd >= end) {
+      partEnd = end;
+    } else if (partEnd > partBegin) {
+      const char *eol = static_cast<const char *>(
+          memchr(partEnd - 1, '\n', size_t(end - partEnd + 1)));
+      partEnd = eol ? eol + 1 : end;
+    } else {
+      continue;
+    }
+    threads.push_back(std::thread(JsonLinesWorker<TCallback>(
+        docCapacity, partBegin, partEnd, sharedCallback, nestingLimit,
+        errors[i - 1])));
+    partBegin = partEnd;
+  }
+  for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+  for (size_t i = 0; i < errors.size(); i++)
+    if (errors[i]) return errors[i];
+  return DeserializationError::Ok;
+}
+#endif
+
+}  // namespace ARDUINOJSON_NAMESPACE
@@ -0,0 +1,378 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Deserialization/DeserializationError.hpp"
+#include "../Deserialization/NestingLimit.hpp"
+#include "../Document/JsonDocument.hpp"
+#include "../Memory/MemoryPool.hpp"
+#include "../Numbers/isFloat.hpp"
+#include "../Numbers/isInteger.hpp"
+#include "../Variant/VariantData.hpp"
+#include "EscapeSequence.hpp"
+
+// Deepest nesting the push deserializer can follow, it keeps one pointer per
+// level
+#ifndef ARDUINOJSON_PUSH_NESTING_LIMIT
+#define ARDUINOJSON_PUSH_NESTING_LIMIT ARDUINOJSON_DEFAULT_NESTING_LIMIT
+#endif
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// Parses JSON handed over in chunks of any size, as it arrives from the
+// network. feed() returns NeedMoreInput until the document is complete, then
+// Ok. A number or literal at the top level only ends with the input, end()
+// tells it did. Strings are always copied into the document's pool, the
+// chunks are not kept. The result is the same as deserializeJson() on the
+// whole input.
+class JsonPushDeserializer {
+ public:
+  JsonPushDeserializer(JsonDocument &doc,
+                       NestingLimit nestingLimit = NestingLimit())
+      : _pool(&doc.memoryPool()), _root(&doc.data()) {
+    _nestingLimit = nestingLimit.value < ARDUINOJSON_PUSH_NESTING_LIMIT
+                        ? nestingLimit.value
+                        : ARDUINOJSON_PUSH_NESTING_LIMIT;
+    doc.clear();
+    reset();
+  }
+
+  // Starts over with an empty document
+  void reset() {
+    _pool->clear();
+    _root->setNull();
+    _target = _root;
+    _state = EXPECT_VALUE;
+    _lexer = LEX_NONE;
+    _depth = 0;
+    _consumed = 0;
+    _error = DeserializationError::NeedMoreInput;
+  }
+
+  // Parses the next chunk. Once the document is complete the rest of the
+  // chunk is left alone, consumed() tells where it starts.
+  DeserializationError feed(const char *data, size_t len) {
+    size_t i = 0;
+    while (i < len && _error == DeserializationError::NeedMoreInput) {
+      if (_lexer == LEX_STRING) {
+        // The plain characters of a string go in a tight loop
+        char c = data[i];
+        while (c != _stopChar && c != '\\' && c != '\0') {
+          appendChar(c);
+          if (++i == len) break;
+          c = data[i];
+        }
+        if (i == len) break;
+      }
+      if (step(data[i])) i++;
+    }
+    _consumed = i;
+    return _error;
+  }
+
+  DeserializationError feed(const uint8_t *data, size_t len) {
+    return feed(reinterpret_cast<const char *>(data), len);
+  }
+
+  // No more input: completes a top-level number or literal, IncompleteInput
+  // if the document is not complete
+  DeserializationError end() {
+    if (_error != DeserializationError::NeedMoreInput) return _error;
+    if (_lexer == LEX_LITERAL) completeLiteral();
+    if (_error == DeserializationError::NeedMoreInput)
+      _error = DeserializationError::IncompleteInput;
+    return _error;
+  }
+
+  DeserializationError error() const {
+    return _error;
+  }
+
+  // Bytes of the last chunk that were parsed
+  size_t consumed() const {
+    return _consumed;
+  }
+
+ private:
+  enum State {
+    EXPECT_VALUE,
+    EXPECT_FIRST_ELEMENT,  // after '['
+    EXPECT_FIRST_KEY,      // after '{'
+    EXPECT_KEY,
+    EXPECT_COLON,
+    EXPECT_SEPARATOR,  // ',' or the closing bracket
+    COMPLETE
+  };
+
+  enum Lexer {
+    LEX_NONE,  // between tokens
+    LEX_STRING,
+    LEX_ESCAPE,
+    LEX_LITERAL,
+    LEX_BARE_KEY,
+    LEX_SLASH,
+    LEX_BLOCK_COMMENT,
+    LEX_BLOCK_COMMENT_STAR,
+    LEX_LINE_COMMENT
+  };
+
+  // Returns false when c must be looked at again in the new state
+  bool step(char c) {
+    switch (_lexer) {
+      case LEX_STRING:
+        if (c == _stopChar) return completeString();
+        if (c == '\0') return fail(DeserializationError::IncompleteInput);
+        if (c == '\\') {
+          _lexer = LEX_ESCAPE;
+          return true;
+        }
+        appendChar(c);
+        return true;
+
+      case LEX_ESCAPE:
+        if (c == '\0') return fail(DeserializationError::IncompleteInput);
+        if (c == 'u') return fail(DeserializationError::NotSupported);
+        appendChar(EscapeSequence::unescapeChar(c));
+        _lexer = LEX_STRING;
+        return true;
+
+      case LEX_LITERAL:
+        if (canBeInNonQuotedString(c) && _literalLength < sizeof(_literal) - 1) {
+          _literal[_literalLength++] = c;
+          return true;
+        }
+        completeLiteral();
+        return false;
+
+      case LEX_BARE_KEY:
+        if (canBeInNonQuotedString(c)) {
+          appendChar(c);
+          return true;
+        }
+        completeString();
+        return false;
+
+      case LEX_SLASH:
+        if (c == '*')
+          _lexer = LEX_BLOCK_COMMENT;
+        else if (c == '/')
+          _lexer = LEX_LINE_COMMENT;
+        else
+          return fail(DeserializationError::InvalidInput);
+        return true;
+
+      case LEX_BLOCK_COMMENT:
+      case LEX_BLOCK_COMMENT_STAR:
+        if (c == '\0') return fail(DeserializationError::IncompleteInput);
+        if (c == '/' && _lexer == LEX_BLOCK_COMMENT_STAR)
+          _lexer = LEX_NONE;
+        else
+          _lexer = c == '*' ? LEX_BLOCK_COMMENT_STAR : LEX_BLOCK_COMMENT;
+        return true;
+
+      case LEX_LINE_COMMENT:
+        if (c == '\0') return fail(DeserializationError::IncompleteInput);
+        if (c == '\n') _lexer = LEX_NONE;
+        return true;
+
+      case LEX_NONE:
+        break;
+    }
+
+    switch (c) {
+      case '\0':
+        return fail(DeserializationError::IncompleteInput);
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        return true;
+      case '/':
+        _lexer = LEX_SLASH;
+        return true;
+    }
+
+    switch (_state) {
+      case EXPECT_VALUE:
+        return startValue(c);
+
+      case EXPECT_FIRST_ELEMENT:
+        if (c == ']') return closeCollection();
+        if (!addElement()) return false;
+        return startValue(c);
+
+      case EXPECT_FIRST_KEY:
+        if (c == '}') return closeCollection();
+      // fall through
+
+      case EXPECT_KEY:
+        _slot = _stack[_depth - 1]->addSlot(_pool);
+        if (!_slot) return fail(DeserializationError::NoMemory);
+        _stringIsKey = true;
+        if (isQuote(c)) {
+          startString(c);
+          return true;
+        }
+        if (!canBeInNonQuotedString(c))
+          return fail(DeserializationError::InvalidInput);
+        startString(0);
+        _lexer = LEX_BARE_KEY;
+        return false;
+
+      case EXPECT_COLON:
+        if (c != ':') return fail(DeserializationError::InvalidInput);
+        _target = _slot->data();
+        _state = EXPECT_VALUE;
+        return true;
+
+      case EXPECT_SEPARATOR:
+        if (c == (_isArray[_depth - 1] ? ']' : '}')) return closeCollection();
+        if (c != ',') return fail(DeserializationError::InvalidInput);
+        if (_isArray[_depth - 1])
+          addElement();
+        else
+          _state = EXPECT_KEY;
+        return true;
+
+      case COMPLETE:
+        break;
+    }
+    return false;
+  }
+
+  bool startValue(char c) {
+    if (c == '[' || c == '{') {
+      bool isArray = c == '[';
+      CollectionData *collection =
+          isArray ? &_target->toArray() : &_target->toObject();
+      if (_depth >= _nestingLimit)
+        return fail(DeserializationError::TooDeep);
+      _stack[_depth] = collection;
+      _isArray[_depth++] = isArray;
+      _state = isArray ? EXPECT_FIRST_ELEMENT : EXPECT_FIRST_KEY;
+      return true;
+    }
+    if (isQuote(c)) {
+      _stringIsKey = false;
+      startString(c);
+      return true;
+    }
+    _literalLength = 0;
+    _lexer = LEX_LITERAL;
+    return false;
+  }
+
+  bool addElement() {
+    VariantSlot *slot = _stack[_depth - 1]->addSlot(_pool);
+    if (!slot) return fail(DeserializationError::NoMemory);
+    _target = slot->data();
+    _state = EXPECT_VALUE;
+    return true;
+  }
+
+  bool closeCollection() {
+    _depth--;
+    completeValue();
+    return true;
+  }
+
+  void completeValue() {
+    _lexer = LEX_NONE;
+    if (_depth) {
+      _state = EXPECT_SEPARATOR;
+    } else {
+      _state = COMPLETE;
+      _error = DeserializationError::Ok;
+    }
+  }
+
+  // Same as StringBuilder, which cannot be kept between chunks
+  void startString(char stopChar) {
+    _stopChar = stopChar;
+    _string = _pool->allocExpandableString();
+    _stringLength = 0;
+    _lexer = LEX_STRING;
+  }
+
+  void appendChar(char c) {
+    if (!_string.value) return;
+    if (_stringLength >= _string.size) {
+      _string.value = 0;
+      return;
+    }
+    _string.value[_stringLength++] = c;
+  }
+
+  bool completeString() {
+    appendChar('\0');
+    if (!_string.value) return fail(DeserializationError::NoMemory);
+    _pool->freezeString(_string, _stringLength);
+    if (_stringIsKey) {
+      _slot->setOwnedKey(_string.value);
+      _lexer = LEX_NONE;
+      _state = EXPECT_COLON;
+    } else {
+      _target->setOwnedString(_string.value);
+      completeValue();
+    }
+    return true;
+  }
+
+  void completeLiteral() {
+    _literal[_literalLength] = 0;
+    if (isInteger(_literal)) {
+      _target->setInteger(parseInteger<Integer>(_literal));
+    } else if (isFloat(_literal)) {
+      _target->setFloat(parseFloat<Float>(_literal));
+    } else if (!strcmp(_literal, "true")) {
+      _target->setBoolean(true);
+    } else if (!strcmp(_literal, "false")) {
+      _target->setBoolean(false);
+    } else if (strcmp(_literal, "null")) {
+      fail(DeserializationError::InvalidInput);
+      return;
+    }
+    completeValue();
+  }
+
+  bool fail(DeserializationError::Code code) {
+    _error = code;
+    return false;
+  }
+
+  static inline bool isBetween(char c, char min, char max) {
+    return min <= c && c <= max;
+  }
+
+  static inline bool canBeInNonQuotedString(char c) {
+    return isBetween(c, '0', '9') || isBetween(c, '_', 'z') ||
+           isBetween(c, 'A', 'Z') || c == '+' || c == '-' || c == '.';
+  }
+
+  static inline bool isQuote(char c) {
+    return c == '\'' || c == '\"';
+  }
+
+  MemoryPool *_pool;
+  VariantData *_root;
+  VariantData *_target;  // receives the next value
+  VariantSlot *_slot;    // member whose key is being read
+  CollectionData *_stack[ARDUINOJSON_PUSH_NESTING_LIMIT];
+  bool _isArray[ARDUINOJSON_PUSH_NESTING_LIMIT];
+  uint8_t _depth;
+  uint8_t _nestingLimit;
+  uint8_t _state;
+  uint8_t _lexer;
+  char _stopChar;
+  bool _stringIsKey;
+  StringSlot _string;
+  size_t _stringLength;
+  char _literal[64];
+  uint8_t _literalLength;
+  size_t _consumed;
+  DeserializationError _error;
+};
+
+}  // namespace ARDUINOJSON_NAMESPACE
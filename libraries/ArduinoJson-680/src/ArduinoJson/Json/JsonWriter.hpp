@@ -0,0 +1,222 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Polyfills/type_traits.hpp"
+#include "../Serialization/DummyWriter.hpp"
+#include "../Serialization/ReferenceWriter.hpp"
+#include "../Serialization/serialize.hpp"
+#include "TextFormatter.hpp"
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// Writes JSON as the calls come, without a JsonDocument:
+//   makeJsonWriter(Serial).beginObject().member("id", 3).endObject();
+// The writer adds the commas and colons, the caller is responsible for the
+// structure: a key() before each value of an object, one end for each begin.
+// Up to 32 levels of nesting.
+template <typename TWriter>
+class JsonWriter {
+ public:
+  explicit JsonWriter(TWriter writer)
+      : _writer(writer),
+        _bytesWritten(0),
+        _hasElements(0),
+        _depth(0),
+        _afterKey(false) {}
+
+  // The sizes are for MsgPackWriter compatibility, JSON doesn't need them
+  JsonWriter &beginObject(size_t = 0) {
+    return open('{');
+  }
+
+  JsonWriter &endObject() {
+    return close('}');
+  }
+
+  JsonWriter &beginArray(size_t = 0) {
+    return open('[');
+  }
+
+  JsonWriter &endArray() {
+    return close(']');
+  }
+
+  JsonWriter &key(const char *k) {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    formatter.writeString(k);
+    formatter.writeRaw(':');
+    _afterKey = true;
+    return commit(formatter);
+  }
+
+#if ARDUINOJSON_ENABLE_ARDUINO_STRING
+  JsonWriter &key(const ::String &k) {
+    return key(k.c_str());
+  }
+#endif
+
+#if ARDUINOJSON_ENABLE_STD_STRING
+  JsonWriter &key(const std::string &k) {
+    return key(k.c_str());
+  }
+#endif
+
+  JsonWriter &value(bool b) {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    formatter.writeBoolean(b);
+    return commit(formatter);
+  }
+
+  // A null pointer writes null
+  JsonWriter &value(const char *s) {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    formatter.writeString(s);
+    return commit(formatter);
+  }
+
+#if ARDUINOJSON_ENABLE_ARDUINO_STRING
+  JsonWriter &value(const ::String &s) {
+    return value(s.c_str());
+  }
+#endif
+
+#if ARDUINOJSON_ENABLE_STD_STRING
+  JsonWriter &value(const std::string &s) {
+    return value(s.c_str());
+  }
+#endif
+
+  template <typename T>
+  typename enable_if<is_integral<T>::value && is_signed<T>::value,
+                     JsonWriter &>::type
+  value(T n) {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    if (n >= 0)
+      formatter.writePositiveInteger(static_cast<UInt>(n));
+    else
+      formatter.writeNegativeInteger(~static_cast<UInt>(n) + 1);
+    return commit(formatter);
+  }
+
+  template <typename T>
+  typename enable_if<is_integral<T>::value && is_unsigned<T>::value,
+                     JsonWriter &>::type
+  value(T n) {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    formatter.writePositiveInteger(static_cast<UInt>(n));
+    return commit(formatter);
+  }
+
+  template <typename T>
+  typename enable_if<is_floating_point<T>::value, JsonWriter &>::type value(
+      T n) {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    formatter.writeFloat(static_cast<Float>(n));
+    return commit(formatter);
+  }
+
+  JsonWriter &null() {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    formatter.writeRaw("null");
+    return commit(formatter);
+  }
+
+  template <typename TKey, typename TValue>
+  JsonWriter &member(const TKey &k, const TValue &v) {
+    return key(k).value(v);
+  }
+
+  size_t bytesWritten() const {
+    return _bytesWritten;
+  }
+
+ private:
+  JsonWriter &open(char bracket) {
+    TextFormatter<TWriter> formatter(_writer);
+    separate(formatter);
+    formatter.writeRaw(bracket);
+    _hasElements <<= 1;
+    _depth++;
+    return commit(formatter);
+  }
+
+  JsonWriter &close(char bracket) {
+    TextFormatter<TWriter> formatter(_writer);
+    formatter.writeRaw(bracket);
+    _hasElements >>= 1;
+    _depth--;
+    return commit(formatter);
+  }
+
+  // Writes the comma that goes before all the elements but the first
+  void separate(TextFormatter<TWriter> &formatter) {
+    if (_afterKey) {
+      _afterKey = false;
+      return;
+    }
+    if (_depth == 0) return;
+    if (_hasElements & 1) formatter.writeRaw(',');
+    _hasElements |= 1;
+  }
+
+  JsonWriter &commit(const TextFormatter<TWriter> &formatter) {
+    _bytesWritten += formatter.bytesWritten();
+    return *this;
+  }
+
+  TWriter _writer;
+  size_t _bytesWritten;
+  uint32_t _hasElements;  // one bit per level, the innermost is bit 0
+  uint8_t _depth;
+  bool _afterKey;
+};
+
+template <typename TPrint>
+inline typename enable_if<IsPrint<TPrint>::value,
+                          JsonWriter<ReferenceWriter<TPrint> > >::type
+makeJsonWriter(TPrint &destination) {
+  return JsonWriter<ReferenceWriter<TPrint> >(
+      ReferenceWriter<TPrint>(destination));
+}
+
+#if ARDUINOJSON_ENABLE_STD_STREAM
+template <typename TStream>
+inline typename enable_if<is_base_of<std::ostream, TStream>::value,
+                          JsonWriter<StreamWriter> >::type
+makeJsonWriter(TStream &os) {
+  return JsonWriter<StreamWriter>(StreamWriter(os));
+}
+#endif
+
+// Appends to the string
+template <typename TString>
+inline typename enable_if<IsWriteableString<TString>::value,
+                          JsonWriter<DynamicStringWriter<TString> > >::type
+makeJsonWriter(TString &str) {
+  return JsonWriter<DynamicStringWriter<TString> >(
+      DynamicStringWriter<TString>(str));
+}
+
+// Writes at most bufferSize - 1 characters and a terminator, like
+// serializeJson(doc, buffer, bufferSize)
+inline JsonWriter<StaticStringWriter> makeJsonWriter(char *buffer,
+                                                     size_t bufferSize) {
+  return JsonWriter<StaticStringWriter>(StaticStringWriter(buffer, bufferSize));
+}
+
+// Writes nothing, bytesWritten() gives the length, like measureJson()
+inline JsonWriter<DummyWriter> makeJsonWriter() {
+  return JsonWriter<DummyWriter>(DummyWriter());
+}
+
+}  // namespace ARDUINOJSON_NAMESPACE
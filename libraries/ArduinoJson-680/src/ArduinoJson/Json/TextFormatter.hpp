@@ -8,11 +8,23 @@
 #include <string.h>  // for strlen
 #include "../Numbers/FloatParts.hpp"
 #include "../Numbers/Integer.hpp"
+#include "../Numbers/ShortestFloat.hpp"
 #include "../Polyfills/attributes.hpp"
 #include "EscapeSequence.hpp"
 
 namespace ARDUINOJSON_NAMESPACE {
 
+#if ARDUINOJSON_ENABLE_FAST_INTEGERS
+// "00" to "99"
+inline const char *digitPairs() {
+  static const char pairs[] =
+      "0001020304050607080910111213141516171819202122232425262728293031323334"
+      "3536373839404142434445464748495051525354555657585960616263646566676869"
+      "707172737475767778798081828384858687888990919293949596979899";
+  return pairs;
+}
+#endif
+
 template <typename TWriter>
 class TextFormatter {
  public:
@@ -61,6 +73,11 @@ class TextFormatter {
 
     if (isinf(value)) return writeRaw("Infinity");
 
+    writePositiveFloat(value);
+  }
+
+  template <typename T>
+  void writePositiveFloat(T value) {
     FloatParts<T> parts(value);
 
     writePositiveInteger(parts.integral);
@@ -77,6 +94,47 @@ class TextFormatter {
     }
   }
 
+#if ARDUINOJSON_ENABLE_SHORTEST_FLOATS
+  void writePositiveFloat(float value) {
+    ShortestFloat shortest(value);
+
+    char buffer[16];
+    char *end = buffer + sizeof(buffer);
+    char *digits = formatPositiveInteger(shortest.mantissa, end);
+    int16_t count = int16_t(end - digits);
+    // exponent of the first digit
+    int16_t exponent = int16_t(shortest.exponent + count - 1);
+
+    if (value >= ARDUINOJSON_POSITIVE_EXPONENTIATION_THRESHOLD ||
+        (value > 0 && value <= ARDUINOJSON_NEGATIVE_EXPONENTIATION_THRESHOLD)) {
+      writeRaw(*digits);
+      if (count > 1) {
+        writeRaw('.');
+        writeRaw(digits + 1, end);
+      }
+      if (exponent < 0) {
+        writeRaw("e-");
+        writePositiveInteger(-exponent);
+      }
+      if (exponent > 0) {
+        writeRaw('e');
+        writePositiveInteger(exponent);
+      }
+    } else if (shortest.exponent >= 0) {
+      writeRaw(digits, end);
+      for (int16_t i = 0; i < shortest.exponent; i++) writeRaw('0');
+    } else if (exponent >= 0) {
+      writeRaw(digits, digits + exponent + 1);
+      writeRaw('.');
+      writeRaw(digits + exponent + 1, end);
+    } else {
+      writeRaw("0.");
+      for (int16_t i = -1; i > exponent; i--) writeRaw('0');
+      writeRaw(digits, end);
+    }
+  }
+#endif
+
   void writeNegativeInteger(UInt value) {
     writeRaw('-');
     writePositiveInteger(value);
@@ -86,16 +144,32 @@ class TextFormatter {
   void writePositiveInteger(T value) {
     char buffer[22];
     char *end = buffer + sizeof(buffer);
-    char *begin = end;
+    writeRaw(formatPositiveInteger(value, end), end);
+  }
 
-    // write the string in reverse order
+  // Writes the digits in reverse order, from end, returns the first one
+  template <typename T>
+  static char *formatPositiveInteger(T value, char *end) {
+    char *begin = end;
+#if ARDUINOJSON_ENABLE_FAST_INTEGERS
+    while (value >= 100) {
+      begin -= 2;
+      memcpy(begin, digitPairs() + 2 * size_t(value % 100), 2);
+      value = T(value / 100);
+    }
+    if (value >= 10) {
+      begin -= 2;
+      memcpy(begin, digitPairs() + 2 * size_t(value), 2);
+    } else {
+      *--begin = char(value + '0');
+    }
+#else
     do {
       *--begin = char(value % 10 + '0');
       value = T(value / 10);
     } while (value);
-
-    // and dump it in the right order
-    writeRaw(begin, end);
+#endif
+    return begin;
   }
 
   void writeDecimals(uint32_t value, int8_t width) {
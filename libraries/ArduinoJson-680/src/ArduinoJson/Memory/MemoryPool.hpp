@@ -70,9 +70,24 @@ class MemoryPool {
   void freezeString(StringSlot& s, size_t newSize) {
     _left -= (s.size - newSize);
     s.size = newSize;
+    s.value = dedupString(s.value);
     checkInvariants();
   }
 
+  // Called once the last string allocated is filled in: returns an identical
+  // string already in the pool, if any, and gives the new one back
+  char* dedupString(char* s) {
+#if ARDUINOJSON_ENABLE_STRING_DEDUPLICATION
+    char* dup = findString(s);
+    if (dup) {
+      _left = s;
+      checkInvariants();
+      return dup;
+    }
+#endif
+    return s;
+  }
+
   void clear() {
     _left = _begin;
     _right = _end;
@@ -107,6 +122,21 @@ class MemoryPool {
     return allocRight<StringSlot>();
   }
 
+#if ARDUINOJSON_ENABLE_STRING_DEDUPLICATION
+  // Looks for s among the strings stored before it. Raw values are not
+  // terminated, but the bytes matched are the same all the same.
+  char* findString(const char* s) const {
+    for (char* next = _begin; next < s; ++next) {
+      char* begin = next;
+      for (const char* it = s; *it == *next; ++it, ++next) {
+        if (!*next) return begin;
+      }
+      while (*next) ++next;
+    }
+    return 0;
+  }
+#endif
+
   void checkInvariants() {
     ARDUINOJSON_ASSERT(_begin <= _left);
     ARDUINOJSON_ASSERT(_left <= _right);
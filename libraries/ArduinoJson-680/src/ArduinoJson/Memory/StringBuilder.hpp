@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <string.h>  // for memcpy
+
 #include "MemoryPool.hpp"
 
 namespace ARDUINOJSON_NAMESPACE {
@@ -19,7 +21,15 @@ class StringBuilder {
   }
 
   void append(const char* s, size_t n) {
-    while (n-- > 0) append(*s++);
+    if (!_slot.value) return;
+
+    if (n > _slot.size - _size) {
+      _slot.value = 0;
+      return;
+    }
+
+    memcpy(_slot.value + _size, s, n);
+    _size += n;
   }
 
   void append(char c) {
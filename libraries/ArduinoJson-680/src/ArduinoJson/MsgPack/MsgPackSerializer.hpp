@@ -36,32 +36,14 @@ class MsgPackSerializer {
   }
 
   void visitArray(const CollectionData& array) {
-    size_t n = array.size();
-    if (n < 0x10) {
-      writeByte(uint8_t(0x90 + array.size()));
-    } else if (n < 0x10000) {
-      writeByte(0xDC);
-      writeInteger(uint16_t(n));
-    } else {
-      writeByte(0xDD);
-      writeInteger(uint32_t(n));
-    }
+    writeArrayHeader(array.size());
     for (VariantSlot* slot = array.head(); slot; slot = slot->next()) {
       slot->data()->accept(*this);
     }
   }
 
   void visitObject(const CollectionData& object) {
-    size_t n = object.size();
-    if (n < 0x10) {
-      writeByte(uint8_t(0x80 + n));
-    } else if (n < 0x10000) {
-      writeByte(0xDE);
-      writeInteger(uint16_t(n));
-    } else {
-      writeByte(0xDF);
-      writeInteger(uint32_t(n));
-    }
+    writeObjectHeader(object.size());
     for (VariantSlot* slot = object.head(); slot; slot = slot->next()) {
       visitString(slot->key());
       slot->data()->accept(*this);
@@ -143,6 +125,32 @@ class MsgPackSerializer {
     writeByte(0xC0);
   }
 
+  // The header of an array of n elements, the elements follow
+  void writeArrayHeader(size_t n) {
+    if (n < 0x10) {
+      writeByte(uint8_t(0x90 + n));
+    } else if (n < 0x10000) {
+      writeByte(0xDC);
+      writeInteger(uint16_t(n));
+    } else {
+      writeByte(0xDD);
+      writeInteger(uint32_t(n));
+    }
+  }
+
+  // The header of an object of n members, the key/value pairs follow
+  void writeObjectHeader(size_t n) {
+    if (n < 0x10) {
+      writeByte(uint8_t(0x80 + n));
+    } else if (n < 0x10000) {
+      writeByte(0xDE);
+      writeInteger(uint16_t(n));
+    } else {
+      writeByte(0xDF);
+      writeInteger(uint32_t(n));
+    }
+  }
+
   size_t bytesWritten() const {
     return _bytesWritten;
   }
@@ -0,0 +1,56 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Deserialization/CharPointerReader.hpp"
+#include "../StringStorage/StringCopier.hpp"
+#include "MsgPackDeserializer.hpp"
+
+#if ARDUINOJSON_ENABLE_STD_STREAM
+#include <istream>
+#endif
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// Decodes MessagePack values written back to back, as successive calls to
+// serializeMsgPack() do, and calls callback(doc) for each one. doc is cleared
+// and reused from one value to the next, copy what must outlive the call. The
+// callback returns false to stop.
+// Returns the error of the first value that doesn't parse, Ok otherwise.
+template <typename TChar, typename TCallback>
+DeserializationError deserializeMsgPackStream(
+    JsonDocument &doc, TChar *input, size_t inputSize, TCallback callback,
+    NestingLimit nestingLimit = NestingLimit()) {
+  // shared with the deserializers, which leave it after the value they read
+  SafeCharPointerReader reader(reinterpret_cast<const char *>(input),
+                               inputSize);
+  while (!reader.ended()) {
+    doc.clear();
+    DeserializationError err =
+        MsgPackDeserializer<SafeCharPointerReader &, StringCopier>(
+            doc.memoryPool(), reader, StringCopier(&doc.memoryPool()),
+            nestingLimit.value)
+            .parse(doc.data());
+    if (err) return err;
+    if (!callback(doc)) break;
+  }
+  return DeserializationError::Ok;
+}
+
+#if ARDUINOJSON_ENABLE_STD_STREAM
+template <typename TCallback>
+DeserializationError deserializeMsgPackStream(
+    JsonDocument &doc, std::istream &input, TCallback callback,
+    NestingLimit nestingLimit = NestingLimit()) {
+  while (input.peek() != std::istream::traits_type::eof()) {
+    DeserializationError err = deserializeMsgPack(doc, input, nestingLimit);
+    if (err) return err;
+    if (!callback(doc)) break;
+  }
+  return DeserializationError::Ok;
+}
+#endif
+
+}  // namespace ARDUINOJSON_NAMESPACE
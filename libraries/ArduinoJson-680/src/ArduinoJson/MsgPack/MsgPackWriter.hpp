@@ -0,0 +1,177 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Polyfills/type_traits.hpp"
+#include "../Serialization/DummyWriter.hpp"
+#include "../Serialization/ReferenceWriter.hpp"
+#include "../Serialization/serialize.hpp"
+#include "MsgPackSerializer.hpp"
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// Writes MessagePack as the calls come, without a JsonDocument. Same calls as
+// JsonWriter, except that MessagePack needs the number of elements upfront:
+//   makeMsgPackWriter(Serial).beginObject(1).member("id", 3).endObject();
+template <typename TWriter>
+class MsgPackWriter {
+ public:
+  explicit MsgPackWriter(TWriter writer) : _writer(writer), _bytesWritten(0) {}
+
+  // n is the number of members
+  MsgPackWriter &beginObject(size_t n) {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    serializer.writeObjectHeader(n);
+    return commit(serializer);
+  }
+
+  MsgPackWriter &endObject() {
+    return *this;
+  }
+
+  MsgPackWriter &beginArray(size_t n) {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    serializer.writeArrayHeader(n);
+    return commit(serializer);
+  }
+
+  MsgPackWriter &endArray() {
+    return *this;
+  }
+
+  MsgPackWriter &key(const char *k) {
+    return value(k);
+  }
+
+#if ARDUINOJSON_ENABLE_ARDUINO_STRING
+  MsgPackWriter &key(const ::String &k) {
+    return value(k.c_str());
+  }
+#endif
+
+#if ARDUINOJSON_ENABLE_STD_STRING
+  MsgPackWriter &key(const std::string &k) {
+    return value(k.c_str());
+  }
+#endif
+
+  MsgPackWriter &value(bool b) {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    serializer.visitBoolean(b);
+    return commit(serializer);
+  }
+
+  // A null pointer writes nil
+  MsgPackWriter &value(const char *s) {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    serializer.visitString(s);
+    return commit(serializer);
+  }
+
+#if ARDUINOJSON_ENABLE_ARDUINO_STRING
+  MsgPackWriter &value(const ::String &s) {
+    return value(s.c_str());
+  }
+#endif
+
+#if ARDUINOJSON_ENABLE_STD_STRING
+  MsgPackWriter &value(const std::string &s) {
+    return value(s.c_str());
+  }
+#endif
+
+  template <typename T>
+  typename enable_if<is_integral<T>::value && is_signed<T>::value,
+                     MsgPackWriter &>::type
+  value(T n) {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    if (n >= 0)
+      serializer.visitPositiveInteger(static_cast<UInt>(n));
+    else
+      serializer.visitNegativeInteger(~static_cast<UInt>(n) + 1);
+    return commit(serializer);
+  }
+
+  template <typename T>
+  typename enable_if<is_integral<T>::value && is_unsigned<T>::value,
+                     MsgPackWriter &>::type
+  value(T n) {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    serializer.visitPositiveInteger(static_cast<UInt>(n));
+    return commit(serializer);
+  }
+
+  template <typename T>
+  typename enable_if<is_floating_point<T>::value, MsgPackWriter &>::type value(
+      T n) {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    serializer.visitFloat(static_cast<Float>(n));
+    return commit(serializer);
+  }
+
+  MsgPackWriter &null() {
+    MsgPackSerializer<TWriter> serializer(_writer);
+    serializer.visitNull();
+    return commit(serializer);
+  }
+
+  template <typename TKey, typename TValue>
+  MsgPackWriter &member(const TKey &k, const TValue &v) {
+    return key(k).value(v);
+  }
+
+  size_t bytesWritten() const {
+    return _bytesWritten;
+  }
+
+ private:
+  MsgPackWriter &commit(const MsgPackSerializer<TWriter> &serializer) {
+    _bytesWritten += serializer.bytesWritten();
+    return *this;
+  }
+
+  TWriter _writer;
+  size_t _bytesWritten;
+};
+
+template <typename TPrint>
+inline typename enable_if<IsPrint<TPrint>::value,
+                          MsgPackWriter<ReferenceWriter<TPrint> > >::type
+makeMsgPackWriter(TPrint &destination) {
+  return MsgPackWriter<ReferenceWriter<TPrint> >(
+      ReferenceWriter<TPrint>(destination));
+}
+
+#if ARDUINOJSON_ENABLE_STD_STREAM
+template <typename TStream>
+inline typename enable_if<is_base_of<std::ostream, TStream>::value,
+                          MsgPackWriter<StreamWriter> >::type
+makeMsgPackWriter(TStream &os) {
+  return MsgPackWriter<StreamWriter>(StreamWriter(os));
+}
+#endif
+
+// Appends to the string
+template <typename TString>
+inline typename enable_if<IsWriteableString<TString>::value,
+                          MsgPackWriter<DynamicStringWriter<TString> > >::type
+makeMsgPackWriter(TString &str) {
+  return MsgPackWriter<DynamicStringWriter<TString> >(
+      DynamicStringWriter<TString>(str));
+}
+
+// Writes at most bufferSize - 1 bytes, like serializeMsgPack(doc, buffer, n)
+inline MsgPackWriter<StaticStringWriter> makeMsgPackWriter(char *buffer,
+                                                           size_t bufferSize) {
+  return MsgPackWriter<StaticStringWriter>(
+      StaticStringWriter(buffer, bufferSize));
+}
+
+// Writes nothing, bytesWritten() gives the length, like measureMsgPack()
+inline MsgPackWriter<DummyWriter> makeMsgPackWriter() {
+  return MsgPackWriter<DummyWriter>(DummyWriter());
+}
+
+}  // namespace ARDUINOJSON_NAMESPACE
@@ -17,6 +17,14 @@
                       ARDUINOJSON_CONCAT4(E, F, G, H))
 
 #define ARDUINOJSON_NAMESPACE                                                  \
-  ARDUINOJSON_CONCAT8(ArduinoJson, ARDUINOJSON_VERSION_MAJOR,                  \
-                      ARDUINOJSON_VERSION_MINOR, ARDUINOJSON_VERSION_REVISION, \
-                      _, ARDUINOJSON_USE_LONG_LONG, _, ARDUINOJSON_USE_DOUBLE)
+  ARDUINOJSON_CONCAT4(                                                         \
+      ARDUINOJSON_CONCAT8(ArduinoJson, ARDUINOJSON_VERSION_MAJOR,              \
+                          ARDUINOJSON_VERSION_MINOR,                           \
+                          ARDUINOJSON_VERSION_REVISION, _,                     \
+                          ARDUINOJSON_USE_LONG_LONG, _,                        \
+                          ARDUINOJSON_USE_DOUBLE),                             \
+      _, ARDUINOJSON_ENABLE_KEY_INDEX,                                         \
+      ARDUINOJSON_CONCAT4(ARDUINOJSON_ENABLE_STRING_DEDUPLICATION,             \
+                          ARDUINOJSON_ENABLE_FAST_INTEGERS,                    \
+                          ARDUINOJSON_ENABLE_SHORTEST_FLOATS,                  \
+                          ARDUINOJSON_CONCAT2(_, ARDUINOJSON_ENABLE_BULK_SCAN)))
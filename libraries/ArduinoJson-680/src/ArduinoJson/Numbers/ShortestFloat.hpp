@@ -0,0 +1,244 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>  // for memcpy
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// The shortest decimal that reads back as the same float, the closest to the
+// exact value when several have that length.
+// This is Ulf Adams' Ryu algorithm ("Ryu: fast float-to-string conversion",
+// PLDI 2018), 32-bit version.
+struct ShortestFloat {
+  uint32_t mantissa;
+  int16_t exponent;  // value == mantissa * 10^exponent
+
+  // value must be positive and finite
+  ShortestFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t ieeeMantissa = bits & ((1u << 23) - 1);
+    uint32_t ieeeExponent = (bits >> 23) & 0xFF;  // without the sign, -0.0f is zero too
+    if (ieeeExponent == 0 && ieeeMantissa == 0) {
+      mantissa = 0;
+      exponent = 0;
+      return;
+    }
+
+    // value == m2 * 2^e2, with two more bits for the halfway points
+    int32_t e2;
+    uint32_t m2;
+    if (ieeeExponent == 0) {
+      e2 = 1 - 127 - 23 - 2;
+      m2 = ieeeMantissa;
+    } else {
+      e2 = int32_t(ieeeExponent) - 127 - 23 - 2;
+      m2 = (1u << 23) | ieeeMantissa;
+    }
+    bool acceptBounds = (m2 & 1) == 0;
+
+    // the decimals in [mm, mp] * 2^e2 round to value
+    uint32_t mv = 4 * m2;
+    uint32_t mp = 4 * m2 + 2;
+    uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+    uint32_t mm = 4 * m2 - 1 - mmShift;
+
+    // same interval in units of 10^e10
+    uint32_t vr, vp, vm;
+    int32_t e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    uint8_t lastRemovedDigit = 0;
+    if (e2 >= 0) {
+      uint32_t q = log10Pow2(e2);
+      e10 = int32_t(q);
+      int32_t k = POW5_INV_BITCOUNT + pow5bits(int32_t(q)) - 1;
+      int32_t i = -e2 + int32_t(q) + k;
+      vr = mulShift(mv, pow5Inv(q), i);
+      vp = mulShift(mp, pow5Inv(q), i);
+      vm = mulShift(mm, pow5Inv(q), i);
+      if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+        // the loop below does not run, but rounding needs the next digit
+        int32_t l = POW5_INV_BITCOUNT + pow5bits(int32_t(q - 1)) - 1;
+        lastRemovedDigit = uint8_t(
+            mulShift(mv, pow5Inv(q - 1), -e2 + int32_t(q) - 1 + l) % 10);
+      }
+      if (q <= 9) {
+        // only one of mp, mv, and mm can be a multiple of 5
+        if (mv % 5 == 0)
+          vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+        else if (acceptBounds)
+          vmIsTrailingZeros = multipleOfPowerOf5(mm, q);
+        else
+          vp -= multipleOfPowerOf5(mp, q);
+      }
+    } else {
+      uint32_t q = log10Pow5(-e2);
+      e10 = int32_t(q) + e2;
+      int32_t i = -e2 - int32_t(q);
+      int32_t k = pow5bits(i) - POW5_BITCOUNT;
+      int32_t j = int32_t(q) - k;
+      vr = mulShift(mv, pow5(uint32_t(i)), j);
+      vp = mulShift(mp, pow5(uint32_t(i)), j);
+      vm = mulShift(mm, pow5(uint32_t(i)), j);
+      if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+        j = int32_t(q) - 1 - (pow5bits(i + 1) - POW5_BITCOUNT);
+        lastRemovedDigit =
+            uint8_t(mulShift(mv, pow5(uint32_t(i + 1)), j) % 10);
+      }
+      if (q <= 1) {
+        // mv == 4 * m2 has at least two trailing zero bits
+        vrIsTrailingZeros = true;
+        if (acceptBounds)
+          vmIsTrailingZeros = mmShift == 1;
+        else
+          --vp;
+      } else if (q < 31) {
+        vrIsTrailingZeros = (mv & ((1u << (q - 1)) - 1)) == 0;
+      }
+    }
+
+    // remove the digits as long as the result stays in the interval
+    int32_t removed = 0;
+    uint32_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+      // rare: the bound or the value may be an exact decimal
+      while (vp / 10 > vm / 10) {
+        vmIsTrailingZeros &= vm % 10 == 0;
+        vrIsTrailingZeros &= lastRemovedDigit == 0;
+        lastRemovedDigit = uint8_t(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+      if (vmIsTrailingZeros) {
+        while (vm % 10 == 0) {
+          vrIsTrailingZeros &= lastRemovedDigit == 0;
+          lastRemovedDigit = uint8_t(vr % 10);
+          vr /= 10;
+          vp /= 10;
+          vm /= 10;
+          ++removed;
+        }
+      }
+      // exactly halfway: round to even
+      if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+        lastRemovedDigit = 4;
+      output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) ||
+                     lastRemovedDigit >= 5);
+    } else {
+      // usually more than one digit goes, try two at a time first
+      if (vp / 100 > vm / 100) {
+        lastRemovedDigit = uint8_t(vr % 100 / 10);
+        vr /= 100;
+        vp /= 100;
+        vm /= 100;
+        removed += 2;
+      }
+      while (vp / 10 > vm / 10) {
+        lastRemovedDigit = uint8_t(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+      output = vr + (vr == vm || lastRemovedDigit >= 5);
+    }
+    mantissa = output;
+    exponent = int16_t(e10 + removed);
+  }
+
+ private:
+  static const int32_t POW5_INV_BITCOUNT = 59;
+  static const int32_t POW5_BITCOUNT = 61;
+
+  // ceil(log2(5^e)), 1 for e == 0
+  static int32_t pow5bits(int32_t e) {
+    return int32_t((uint32_t(e) * 1217359) >> 19) + 1;
+  }
+
+  // floor(log10(2^e))
+  static uint32_t log10Pow2(int32_t e) {
+    return (uint32_t(e) * 78913) >> 18;
+  }
+
+  // floor(log10(5^e))
+  static uint32_t log10Pow5(int32_t e) {
+    return (uint32_t(e) * 732923) >> 20;
+  }
+
+  static bool multipleOfPowerOf5(uint32_t value, uint32_t p) {
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+      value /= 5;
+      count++;
+    }
+    return count >= p;
+  }
+
+  // (m * factor) >> shift, with shift > 32
+  static uint32_t mulShift(uint32_t m, uint64_t factor, int32_t shift) {
+    uint64_t bits0 = uint64_t(m) * uint32_t(factor);
+    uint64_t bits1 = uint64_t(m) * uint32_t(factor >> 32);
+    uint64_t sum = (bits0 >> 32) + bits1;
+    return uint32_t(sum >> (shift - 32));
+  }
+
+  // 2^(pow5bits(i) - 1 + POW5_INV_BITCOUNT) / 5^i, rounded up
+  static uint64_t pow5Inv(uint32_t i) {
+    static const uint64_t factors[] = {
+        0x0800000000000001ULL, 0x0666666666666667ULL,
+        0x051EB851EB851EB9ULL, 0x04189374BC6A7EFAULL,
+        0x068DB8BAC710CB2AULL, 0x053E2D6238DA3C22ULL,
+        0x0431BDE82D7B634EULL, 0x06B5FCA6AF2BD216ULL,
+        0x055E63B88C230E78ULL, 0x044B82FA09B5A52DULL,
+        0x06DF37F675EF6EAEULL, 0x057F5FF85E592558ULL,
+        0x0465E6604B7A8447ULL, 0x0709709A125DA071ULL,
+        0x05A126E1A84AE6C1ULL, 0x0480EBE7B9D58567ULL,
+        0x0734ACA5F6226F0BULL, 0x05C3BD5191B525A3ULL,
+        0x049C97747490EAE9ULL, 0x0760F253EDB4AB0EULL,
+        0x05E72843249088D8ULL, 0x04B8ED0283A6D3E0ULL,
+        0x078E480405D7B966ULL, 0x060B6CD004AC9452ULL,
+        0x04D5F0A66A23A9DBULL, 0x07BCB43D769F762BULL,
+        0x063090312BB2C4EFULL, 0x04F3A68DBC8F03F3ULL,
+        0x07EC3DAF94180651ULL, 0x065697BFA9ACD1DAULL,
+        0x051212FFBAF0A7E2ULL};
+    return factors[i];
+  }
+
+  // 5^i, on POW5_BITCOUNT bits
+  static uint64_t pow5(uint32_t i) {
+    static const uint64_t factors[] = {
+        0x1000000000000000ULL, 0x1400000000000000ULL,
+        0x1900000000000000ULL, 0x1F40000000000000ULL,
+        0x1388000000000000ULL, 0x186A000000000000ULL,
+        0x1E84800000000000ULL, 0x1312D00000000000ULL,
+        0x17D7840000000000ULL, 0x1DCD650000000000ULL,
+        0x12A05F2000000000ULL, 0x174876E800000000ULL,
+        0x1D1A94A200000000ULL, 0x12309CE540000000ULL,
+        0x16BCC41E90000000ULL, 0x1C6BF52634000000ULL,
+        0x11C37937E0800000ULL, 0x16345785D8A00000ULL,
+        0x1BC16D674EC80000ULL, 0x1158E460913D0000ULL,
+        0x15AF1D78B58C4000ULL, 0x1B1AE4D6E2EF5000ULL,
+        0x10F0CF064DD59200ULL, 0x152D02C7E14AF680ULL,
+        0x1A784379D99DB420ULL, 0x108B2A2C28029094ULL,
+        0x14ADF4B7320334B9ULL, 0x19D971E4FE8401E7ULL,
+        0x1027E72F1F128130ULL, 0x1431E0FAE6D7217CULL,
+        0x193E5939A08CE9DBULL, 0x1F8DEF8808B02452ULL,
+        0x13B8B5B5056E16B3ULL, 0x18A6E32246C99C60ULL,
+        0x1ED09BEAD87C0378ULL, 0x13426172C74D822BULL,
+        0x1812F9CF7920E2B6ULL, 0x1E17B84357691B64ULL,
+        0x12CED32A16A1B11EULL, 0x178287F49C4A1D66ULL,
+        0x1D6329F1C35CA4BFULL, 0x125DFA371A19E6F7ULL,
+        0x16F578C4E0A060B5ULL, 0x1CB2D6F618C878E3ULL,
+        0x11EFC659CF7D4B8DULL, 0x166BB7F0435C9E71ULL,
+        0x1C06A5EC5433C60DULL};
+    return factors[i];
+  }
+};
+}  // namespace ARDUINOJSON_NAMESPACE
@@ -33,6 +33,13 @@ inline VariantData *objectGet(const CollectionData *obj, TAdaptedString key) {
   return obj->get(key);
 }
 
+template <typename TAdaptedString>
+inline VariantData *objectGet(CollectionData *obj, TAdaptedString key,
+                              MemoryPool *pool) {
+  if (!obj) return 0;
+  return obj->get(key, pool);
+}
+
 template <typename TAdaptedString>
 void objectRemove(CollectionData *obj, TAdaptedString key) {
   if (!obj) return;
@@ -48,7 +55,7 @@ inline VariantData *objectGetOrCreate(CollectionData *obj, TAdaptedString key,
   if (key.isNull()) return 0;
 
   // search a matching key
-  VariantData *var = obj->get(key);
+  VariantData *var = obj->get(key, pool);
   if (var) return var;
 
   return obj->add(key, pool);
@@ -223,7 +223,7 @@ class ObjectRef : public ObjectRefBase<CollectionData>,
  private:
   template <typename TAdaptedString>
   FORCE_INLINE VariantRef get_impl(TAdaptedString key) const {
-    return VariantRef(_pool, objectGet(_data, key));
+    return VariantRef(_pool, objectGet(_data, key, _pool));
   }
 
   template <typename TAdaptedString>
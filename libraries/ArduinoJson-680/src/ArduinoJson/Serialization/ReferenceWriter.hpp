@@ -0,0 +1,43 @@
+// ArduinoJson - arduinojson.org
+// Copyright Benoit Blanchon 2014-2018
+// MIT License
+
+#pragma once
+
+#include "../Polyfills/type_traits.hpp"
+#include "DynamicStringWriter.hpp"
+
+#if ARDUINOJSON_ENABLE_STD_STREAM
+#include <ostream>
+#endif
+
+namespace ARDUINOJSON_NAMESPACE {
+
+// A Print, as opposed to a string or a stream, which have their own writers
+template <typename T>
+struct IsPrint
+    : integral_constant<bool, !IsWriteableString<T>::value
+#if ARDUINOJSON_ENABLE_STD_STREAM
+                                  && !is_base_of<std::ostream, T>::value
+#endif
+                        > {
+};
+
+// Forwards to a Print held by reference, so that the writer can be copied
+template <typename TPrint>
+class ReferenceWriter {
+ public:
+  explicit ReferenceWriter(TPrint &print) : _print(&print) {}
+
+  size_t write(uint8_t c) {
+    return _print->write(c);
+  }
+
+  size_t write(const uint8_t *s, size_t n) {
+    return _print->write(s, n);
+  }
+
+ private:
+  TPrint *_print;
+};
+}  // namespace ARDUINOJSON_NAMESPACE
@@ -14,24 +14,21 @@ namespace ARDUINOJSON_NAMESPACE {
 
 class StreamWriter {
  public:
-  explicit StreamWriter(std::ostream& os) : _os(os) {}
+  explicit StreamWriter(std::ostream& os) : _os(&os) {}
 
   size_t write(uint8_t c) {
-    _os << c;
+    *_os << c;
     return 1;
   }
 
   size_t write(const uint8_t* s, size_t n) {
-    _os.write(reinterpret_cast<const char*>(s),
+    _os->write(reinterpret_cast<const char*>(s),
               static_cast<std::streamsize>(n));
     return n;
   }
 
  private:
-  // cannot be assigned
-  StreamWriter& operator=(const StreamWriter&);
-
-  std::ostream& _os;
+  std::ostream* _os;
 };
 }  // namespace ARDUINOJSON_NAMESPACE
 
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <string.h>  // for memmove
+
 namespace ARDUINOJSON_NAMESPACE {
 
 class StringMover {
@@ -16,6 +18,12 @@ class StringMover {
       *(*_writePtr)++ = char(c);
     }
 
+    // s is in the input, which the string overwrites as it goes
+    void append(const char* s, size_t n) {
+      memmove(*_writePtr, s, n);
+      *_writePtr += n;
+    }
+
     char* complete() const {
       *(*_writePtr)++ = 0;
       return _startPtr;
@@ -24,8 +24,9 @@ class FlashStringAdapter {
     if (!_str) return NULL;
     size_t n = size() + 1;  // copy the terminator
     char* dup = pool->allocFrozenString(n);
-    if (dup) memcpy_P(dup, reinterpret_cast<const char*>(_str), n);
-    return dup;
+    if (!dup) return NULL;
+    memcpy_P(dup, reinterpret_cast<const char*>(_str), n);
+    return pool->dedupString(dup);
   }
 
   const char* data() const {
@@ -16,8 +16,9 @@ class RamStringAdapter : public ConstRamStringAdapter {
     if (!_str) return NULL;
     size_t n = size() + 1;
     char* dup = pool->allocFrozenString(n);
-    if (dup) memcpy(dup, _str, n);
-    return dup;
+    if (!dup) return NULL;
+    memcpy(dup, _str, n);
+    return pool->dedupString(dup);
   }
 
   bool isStatic() const {
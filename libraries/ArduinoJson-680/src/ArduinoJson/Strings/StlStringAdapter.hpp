@@ -15,8 +15,9 @@ class StlStringAdapter {
   char* save(MemoryPool* pool) const {
     size_t n = _str->length() + 1;
     char* dup = pool->allocFrozenString(n);
-    if (dup) memcpy(dup, _str->c_str(), n);
-    return dup;
+    if (!dup) return NULL;
+    memcpy(dup, _str->c_str(), n);
+    return pool->dedupString(dup);
   }
 
   bool isNull() const {
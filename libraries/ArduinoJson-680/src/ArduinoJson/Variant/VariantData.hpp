@@ -294,11 +294,16 @@ class VariantData {
     return isObject() ? _content.asCollection.get(key) : 0;
   }
 
+  template <typename TAdaptedString>
+  VariantData *get(TAdaptedString key, MemoryPool *pool) {
+    return isObject() ? _content.asCollection.get(key, pool) : 0;
+  }
+
   template <typename TAdaptedString>
   VariantData *getOrCreate(TAdaptedString key, MemoryPool *pool) {
     if (isNull()) toObject();
     if (!isObject()) return 0;
-    VariantData *var = _content.asCollection.get(key);
+    VariantData *var = _content.asCollection.get(key, pool);
     if (var) return var;
     return _content.asCollection.add(key, pool);
   }
@@ -112,13 +112,15 @@ inline VariantRef VariantRef::get(size_t index) const {
 
 template <typename TChar>
 inline VariantRef VariantRef::get(TChar *key) const {
-  return VariantRef(_pool, _data != 0 ? _data->get(adaptString(key)) : 0);
+  return VariantRef(_pool,
+                    _data != 0 ? _data->get(adaptString(key), _pool) : 0);
 }
 
 template <typename TString>
 inline typename enable_if<IsString<TString>::value, VariantRef>::type
 VariantRef::get(const TString &key) const {
-  return VariantRef(_pool, _data != 0 ? _data->get(adaptString(key)) : 0);
+  return VariantRef(_pool,
+                    _data != 0 ? _data->get(adaptString(key), _pool) : 0);
 }
 
 template <typename TChar>
@@ -35,17 +35,33 @@ extern "C"{
 #define ASYNCTCP_RUNNING_CORE 1
 #endif
 
+// Events waiting for each async_tcp task, every one of them comes from a preallocated pool
+#ifndef ASYNC_QUEUE_LENGTH
+#define ASYNC_QUEUE_LENGTH 64
+#endif
+
+#define ASYNC_PACKETS (ASYNC_QUEUE_LENGTH * ASYNC_WORKERS)
+
+// Clients whose queued events can be cancelled on close, one per possible pcb
+#ifndef ASYNC_MAX_CLIENTS
+#define ASYNC_MAX_CLIENTS MEMP_NUM_TCP_PCB
+#endif
+
+#define ASYNC_NO_SLOT 0xFFFF
+
 /*
  * TCP/IP Event Task
  * */
 
 typedef enum {
-    LWIP_TCP_SENT, LWIP_TCP_RECV, LWIP_TCP_ERROR, LWIP_TCP_POLL, LWIP_TCP_CLEAR
+    LWIP_TCP_SENT, LWIP_TCP_RECV, LWIP_TCP_ERROR, LWIP_TCP_POLL
 } lwip_event_t;
 
 typedef struct {
         lwip_event_t event;
         void *arg;
+        uint16_t slot;          // client slot at the time the event was queued
+        uint16_t generation;    // slot generation at the time the event was queued
         union {
                 struct {
                         void * pcb;
@@ -77,72 +93,214 @@ typedef struct {
         };
 } lwip_event_packet_t;
 
-static xQueueHandle _async_queue;
-static TaskHandle_t _async_service_task_handle = NULL;
+/*
+ * Every client with a pcb owns a slot. Closing a client bumps the generation of its slot,
+ * which cancels all of its queued events at once: they are dropped when they are dequeued
+ * instead of draining and re-filling the whole queue on every close.
+ * Packets come from a fixed pool as large as the queue, malloc() is only the fallback.
+ * lwIP does not offer a refused FIN again, so every slot keeps a packet of its own for it,
+ * and the slot is not handed out again before that packet is back.
+ * */
+
+static xQueueHandle _async_queues[ASYNC_WORKERS];
+static TaskHandle_t _async_service_task_handles[ASYNC_WORKERS];
+
+typedef struct {
+        AsyncClient * client;
+        uint16_t generation;
+        bool poll_pending;      // a poll is queued already, another one adds nothing
+        bool fin_queued;        // fin is in the queue
+        lwip_event_packet_t fin;
+} async_client_slot_t;
+
+static async_client_slot_t _async_slots[ASYNC_MAX_CLIENTS];
+static lwip_event_packet_t _async_packets[ASYNC_PACKETS];
+static lwip_event_packet_t * _async_free_packets[ASYNC_PACKETS];
+static uint16_t _async_free_count = 0;
+static portMUX_TYPE _async_mux = portMUX_INITIALIZER_UNLOCKED;
 
 static inline bool _init_async_event_queue(){
-    if(!_async_queue){
-        _async_queue = xQueueCreate(32, sizeof(lwip_event_packet_t *));
-        if(!_async_queue){
-            return false;
+    if(!_async_queues[0]){
+        portENTER_CRITICAL(&_async_mux);
+        for(uint16_t i = 0; i < ASYNC_PACKETS; i++){
+            _async_free_packets[i] = &_async_packets[i];
+        }
+        _async_free_count = ASYNC_PACKETS;
+        portEXIT_CRITICAL(&_async_mux);
+    }
+    for(uint8_t i = 0; i < ASYNC_WORKERS; i++){
+        if(!_async_queues[i]){
+            _async_queues[i] = xQueueCreate(ASYNC_QUEUE_LENGTH, sizeof(lwip_event_packet_t *));
+            if(!_async_queues[i]){
+                return false;
+            }
         }
     }
     return true;
 }
 
-static inline bool _send_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSend(_async_queue, e, portMAX_DELAY) == pdPASS;
-}
-
-static inline bool _prepend_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSendToFront(_async_queue, e, portMAX_DELAY) == pdPASS;
-}
-
-static inline bool _get_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueReceive(_async_queue, e, portMAX_DELAY) == pdPASS;
+static void _attach_async_slot(AsyncClient * client){
+    if(client->_slot != ASYNC_NO_SLOT){
+        return;
+    }
+    portENTER_CRITICAL(&_async_mux);
+    for(uint16_t i = 0; i < ASYNC_MAX_CLIENTS; i++){
+        if(!_async_slots[i].client && !_async_slots[i].fin_queued){
+            _async_slots[i].client = client;
+            _async_slots[i].poll_pending = false;
+            client->_slot = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_async_mux);
+    if(client->_slot == ASYNC_NO_SLOT){
+        // Its events could not be told apart from those of a later client, the caller refuses it
+        log_w("no free slot for 0x%08x", (uint32_t)client);
+    }
 }
 
-static bool _remove_events_with_arg(void * arg){
-    lwip_event_packet_t * first_packet = NULL;
-    lwip_event_packet_t * packet = NULL;
-
-    if(!_async_queue){
-        return false;
+static void _detach_async_slot(AsyncClient * client){
+    if(client->_slot == ASYNC_NO_SLOT){
+        return;
     }
-    //figure out which is the first packet so we can keep the order
-    while(!first_packet){
-        if(xQueueReceive(_async_queue, &first_packet, 0) != pdPASS){
-            return false;
+    portENTER_CRITICAL(&_async_mux);
+    async_client_slot_t * slot = &_async_slots[client->_slot];
+    slot->client = NULL;
+    slot->generation++;
+    slot->poll_pending = false;
+    client->_slot = ASYNC_NO_SLOT;
+    portEXIT_CRITICAL(&_async_mux);
+}
+
+// Called with _async_mux held. The client may be deleted already, lwIP can still hold it as
+// the argument of a callback, so it is only compared with the slots and never read
+static uint16_t _find_async_slot(void * arg){
+    if(arg){
+        for(uint16_t i = 0; i < ASYNC_MAX_CLIENTS; i++){
+            if(_async_slots[i].client == arg){
+                return i;
+            }
         }
-        //discard packet if matching
-        if((int)first_packet->arg == (int)arg){
-            //ets_printf("X: 0x%08x\n", (uint32_t)first_packet->arg);
-            free(first_packet);
-            first_packet = NULL;
-        //return first packet to the back of the queue
-        } else if(xQueueSend(_async_queue, &first_packet, portMAX_DELAY) != pdPASS){
-            return false;
+    }
+    return ASYNC_NO_SLOT;
+}
+
+static lwip_event_packet_t * _alloc_async_event(lwip_event_t event, void * arg){
+    lwip_event_packet_t * e = NULL;
+    uint16_t generation = 0;
+    portENTER_CRITICAL(&_async_mux);
+    uint16_t slot = _find_async_slot(arg);
+    if(slot == ASYNC_NO_SLOT){
+        // Closed already, nobody is left to handle the event
+        portEXIT_CRITICAL(&_async_mux);
+        return NULL;
+    }
+    if(event == LWIP_TCP_POLL){
+        // Polls are periodic, with one already waiting a second one is dropped instead of
+        // letting an idle connection fill the queue or block the lwIP thread
+        if(_async_slots[slot].poll_pending){
+            portEXIT_CRITICAL(&_async_mux);
+            return NULL;
         }
+        _async_slots[slot].poll_pending = true;
     }
-
-    while(xQueuePeek(_async_queue, &packet, 0) == pdPASS && packet != first_packet){
-        if(xQueueReceive(_async_queue, &packet, 0) != pdPASS){
-            return false;
+    generation = _async_slots[slot].generation;
+    if(_async_free_count){
+        e = _async_free_packets[--_async_free_count];
+    }
+    portEXIT_CRITICAL(&_async_mux);
+    if(!e){
+        e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+        if(!e){
+            if(event == LWIP_TCP_POLL){
+                portENTER_CRITICAL(&_async_mux);
+                if(_async_slots[slot].generation == generation){
+                    _async_slots[slot].poll_pending = false;
+                }
+                portEXIT_CRITICAL(&_async_mux);
+            }
+            return NULL;
         }
-        if((int)packet->arg == (int)arg){
-            //ets_printf("X: 0x%08x\n", (uint32_t)packet->arg);
-            free(packet);
-            packet = NULL;
-        } else if(xQueueSend(_async_queue, &packet, portMAX_DELAY) != pdPASS){
-            return false;
+    }
+    e->event = event;
+    e->arg = arg;
+    e->slot = slot;
+    e->generation = generation;
+    return e;
+}
+
+// Takes the packet the slot keeps for the FIN of its client, it can not run out
+static lwip_event_packet_t * _alloc_async_fin(void * arg){
+    lwip_event_packet_t * e = NULL;
+    portENTER_CRITICAL(&_async_mux);
+    uint16_t slot = _find_async_slot(arg);
+    if(slot != ASYNC_NO_SLOT && !_async_slots[slot].fin_queued){
+        _async_slots[slot].fin_queued = true;
+        e = &_async_slots[slot].fin;
+        e->event = LWIP_TCP_RECV;
+        e->arg = arg;
+        e->slot = slot;
+        e->generation = _async_slots[slot].generation;
+    }
+    portEXIT_CRITICAL(&_async_mux);
+    return e;
+}
+
+static void _free_async_event(lwip_event_packet_t * e){
+    if(e == &_async_slots[e->slot].fin){
+        portENTER_CRITICAL(&_async_mux);
+        _async_slots[e->slot].fin_queued = false;
+        portEXIT_CRITICAL(&_async_mux);
+    } else if(e >= _async_packets && e < _async_packets + ASYNC_PACKETS){
+        portENTER_CRITICAL(&_async_mux);
+        _async_free_packets[_async_free_count++] = e;
+        portEXIT_CRITICAL(&_async_mux);
+    } else {
+        free((void*)(e));
+    }
+}
+
+// Takes back an event that never made it into a queue
+static void _drop_async_event(lwip_event_packet_t * e){
+    if(e->event == LWIP_TCP_POLL){
+        portENTER_CRITICAL(&_async_mux);
+        if(_async_slots[e->slot].generation == e->generation){
+            _async_slots[e->slot].poll_pending = false;
         }
+        portEXIT_CRITICAL(&_async_mux);
     }
-    return true;
+    _free_async_event(e);
+}
+
+// Every event has the slot of its client, a connection always lands on the same worker
+// and its events keep their order
+static inline bool _send_async_event(lwip_event_packet_t ** e, TickType_t wait = portMAX_DELAY){
+    xQueueHandle queue = _async_queues[(*e)->slot % ASYNC_WORKERS];
+    return queue && xQueueSend(queue, e, wait) == pdPASS;
+}
+
+static inline bool _get_async_event(xQueueHandle queue, lwip_event_packet_t ** e){
+    return queue && xQueueReceive(queue, e, portMAX_DELAY) == pdPASS;
+}
+
+// Checks that the client of the event still holds its slot and, for a poll, lets the next one in
+static bool _async_event_cancelled(lwip_event_packet_t * e){
+    portENTER_CRITICAL(&_async_mux);
+    async_client_slot_t * slot = &_async_slots[e->slot];
+    bool cancelled = slot->generation != e->generation || slot->client != e->arg;
+    if(!cancelled && e->event == LWIP_TCP_POLL){
+        slot->poll_pending = false;
+    }
+    portEXIT_CRITICAL(&_async_mux);
+    return cancelled;
 }
 
 static void _handle_async_event(lwip_event_packet_t * e){
-    if(e->event == LWIP_TCP_CLEAR){
-        _remove_events_with_arg(e->arg);
+    if(_async_event_cancelled(e)){
+        //ets_printf("X: 0x%08x\n", (uint32_t)e->arg);
+        if(e->event == LWIP_TCP_RECV && e->recv.pb){
+            pbuf_free(e->recv.pb);
+        }
     } else if(e->event == LWIP_TCP_RECV){
         //ets_printf("%c: 0x%08x 0x%08x\n", e->recv.pb?'R':'D', e->arg, e->recv.pcb);
         AsyncClient::_s_recv(e->arg, e->recv.pcb, e->recv.pb, e->recv.err);
@@ -155,24 +313,27 @@ static void _handle_async_event(lwip_event_packet_t * e){
     } else if(e->event == LWIP_TCP_ERROR){
         AsyncClient::_s_error(e->arg, e->error.err);
     }
-    free((void*)(e));
+    _free_async_event(e);
 }
 
 static void _async_service_task(void *pvParameters){
+    uint8_t worker = (uintptr_t)pvParameters;
     lwip_event_packet_t * packet = NULL;
     for (;;) {
-        if(_get_async_event(&packet)){
+        if(_get_async_event(_async_queues[worker], &packet)){
             _handle_async_event(packet);
         }
     }
     vTaskDelete(NULL);
-    _async_service_task_handle = NULL;
+    _async_service_task_handles[worker] = NULL;
 }
 /*
 static void _stop_async_task(){
-    if(_async_service_task_handle){
-        vTaskDelete(_async_service_task_handle);
-        _async_service_task_handle = NULL;
+    for(uint8_t i = 0; i < ASYNC_WORKERS; i++){
+        if(_async_service_task_handles[i]){
+            vTaskDelete(_async_service_task_handles[i]);
+            _async_service_task_handles[i] = NULL;
+        }
     }
 }
 */
@@ -180,10 +341,17 @@ static bool _start_async_task(){
     if(!_init_async_event_queue()){
         return false;
     }
-    if(!_async_service_task_handle){
-        xTaskCreatePinnedToCore(_async_service_task, "async_tcp", 8192, NULL, 3, &_async_service_task_handle, ASYNCTCP_RUNNING_CORE);
-        if(!_async_service_task_handle){
-            return false;
+    for(uint8_t i = 0; i < ASYNC_WORKERS; i++){
+        if(!_async_service_task_handles[i]){
+            // The first worker keeps the usual name and core, the others take turns on the rest
+            char name[16] = "async_tcp";
+            if(i){
+                snprintf(name, sizeof(name), "async_tcp%u", i);
+            }
+            xTaskCreatePinnedToCore(_async_service_task, name, 8192, (void*)(uintptr_t)i, 3, &_async_service_task_handles[i], (ASYNCTCP_RUNNING_CORE + i) % portNUM_PROCESSORS);
+            if(!_async_service_task_handles[i]){
+                return false;
+            }
         }
     }
     return true;
@@ -193,59 +361,69 @@ static bool _start_async_task(){
  * LwIP Callbacks
  * */
 
-static int8_t _tcp_clear_events(void * arg) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
-    e->event = LWIP_TCP_CLEAR;
-    e->arg = arg;
-    if (!_prepend_async_event(&e)) {
-        free((void*)(e));
-    }
-    return ERR_OK;
-}
-
 static int8_t _tcp_poll(void * arg, struct tcp_pcb * pcb) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
-    e->event = LWIP_TCP_POLL;
-    e->arg = arg;
+    lwip_event_packet_t * e = _alloc_async_event(LWIP_TCP_POLL, arg);
+    if(!e){
+        return ERR_OK;
+    }
     e->poll.pcb = pcb;
-    if (!_send_async_event(&e)) {
-        free((void*)(e));
+    if (!_send_async_event(&e, 0)) {
+        _drop_async_event(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_t err) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
-    e->event = LWIP_TCP_RECV;
-    e->arg = arg;
+    if(!pb){
+        // A FIN is not offered again, without a slot the client is closed already
+        lwip_event_packet_t * e = _alloc_async_fin(arg);
+        if(!e){
+            return ERR_OK;
+        }
+        e->recv.pcb = pcb;
+        e->recv.pb = NULL;
+        e->recv.err = err;
+        if (!_send_async_event(&e)) {
+            _free_async_event(e);
+        }
+        return ERR_OK;
+    }
+    lwip_event_packet_t * e = _alloc_async_event(LWIP_TCP_RECV, arg);
+    if(!e){
+        // lwIP keeps the data and offers it again later
+        return ERR_MEM;
+    }
     e->recv.pcb = pcb;
     e->recv.pb = pb;
     e->recv.err = err;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
+        return ERR_MEM;
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_sent(void * arg, struct tcp_pcb * pcb, uint16_t len) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
-    e->event = LWIP_TCP_SENT;
-    e->arg = arg;
+    lwip_event_packet_t * e = _alloc_async_event(LWIP_TCP_SENT, arg);
+    if(!e){
+        return ERR_OK;
+    }
     e->sent.pcb = pcb;
     e->sent.len = len;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
     return ERR_OK;
 }
 
 static void _tcp_error(void * arg, int8_t err) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
-    e->event = LWIP_TCP_ERROR;
-    e->arg = arg;
+    lwip_event_packet_t * e = _alloc_async_event(LWIP_TCP_ERROR, arg);
+    if(!e){
+        return;
+    }
     e->error.err = err;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_async_event(e);
     }
 }
 
@@ -431,12 +609,14 @@ AsyncClient::AsyncClient(tcp_pcb* pcb)
 , prev(NULL)
 , next(NULL)
 , _in_lwip_thread(false)
+, _slot(ASYNC_NO_SLOT)
 {
     //ets_printf("+: 0x%08x\n", (uint32_t)this);
 
     _pcb = pcb;
     if(_pcb){
         _rx_last_packet = millis();
+        _attach_async_slot(this);
         tcp_arg(_pcb, this);
         tcp_recv(_pcb, &_tcp_recv);
         tcp_sent(_pcb, &_tcp_sent);
@@ -449,6 +629,7 @@ AsyncClient::AsyncClient(tcp_pcb* pcb)
 AsyncClient::~AsyncClient(){
     if(_pcb)
         _close();
+    _detach_async_slot(this);
 
     //ets_printf("-: 0x%08x\n", (uint32_t)this);
 }
@@ -467,9 +648,14 @@ bool AsyncClient::connect(IPAddress ip, uint16_t port){
     addr.type = IPADDR_TYPE_V4;
     addr.u_addr.ip4.addr = ip;
 
+    _attach_async_slot(this);
+    if(_slot == ASYNC_NO_SLOT){
+        return false;
+    }
     tcp_pcb* pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
     if (!pcb){
         log_e("pcb == NULL");
+        _detach_async_slot(this);
         return false;
     }
 
@@ -490,6 +676,7 @@ AsyncClient& AsyncClient::operator=(const AsyncClient& other){
     _pcb = other._pcb;
     if (_pcb) {
         _rx_last_packet = millis();
+        _attach_async_slot(this);
         tcp_arg(_pcb, this);
         tcp_recv(_pcb, &_tcp_recv);
         tcp_sent(_pcb, &_tcp_sent);
@@ -525,7 +712,7 @@ int8_t AsyncClient::_close(){
         tcp_recv(_pcb, NULL);
         tcp_err(_pcb, NULL);
         tcp_poll(_pcb, NULL, 0);
-        _tcp_clear_events(this);
+        _detach_async_slot(this);
         if(_in_lwip_thread){
             err = tcp_close(_pcb);
         } else {
@@ -542,6 +729,7 @@ int8_t AsyncClient::_close(){
 }
 
 void AsyncClient::_error(int8_t err) {
+    _detach_async_slot(this);
     if(_pcb){
         tcp_arg(_pcb, NULL);
         tcp_sent(_pcb, NULL);
@@ -1103,6 +1291,12 @@ int8_t AsyncServer::_accept(tcp_pcb* pcb, int8_t err){
             tcp_nagle_enable(pcb);
 
         AsyncClient *c = new AsyncClient(pcb);
+        if(c && c->_slot == ASYNC_NO_SLOT){
+            // More clients than slots, turn this one away
+            c->_in_lwip_thread = true;
+            delete c;
+            return ERR_OK;
+        }
         if(c){
             _in_lwip_thread = true;
             c->_in_lwip_thread = true;
@@ -31,6 +31,12 @@ extern "C" {
 
 class AsyncClient;
 
+// Number of async_tcp tasks. Each connection is served by one of them so its events stay
+// in order, with more than one the callbacks of different connections run concurrently.
+#ifndef ASYNC_WORKERS
+#define ASYNC_WORKERS 1
+#endif
+
 #define ASYNC_MAX_ACK_TIME 5000
 #define ASYNC_WRITE_FLAG_COPY 0x01 //will allocate new buffer to hold the data while sending (else will hold reference to the data given)
 #define ASYNC_WRITE_FLAG_MORE 0x02 //will not send PSH flag, meaning that there should be more data to be sent before the application should react.
@@ -164,6 +170,7 @@ class AsyncClient {
     static void _s_dns_found(const char *name, struct ip_addr *ipaddr, void *arg);
 
     bool _in_lwip_thread;
+    uint16_t _slot; // event queue slot, see AsyncTCP.cpp
 };
 
 class AsyncServer {
@@ -2,6 +2,51 @@
 #include <functional>
 
 AsyncWebSocket ws("/dashws");
+// Read-only viewers: the same updates as server-sent events, "layout" events carry the whole layout
+AsyncEventSource events("/dashevents");
+
+// Websocket queue key of a card, a newer update replaces the one still queued for a slow client
+#define DASH_NUMBER_CARD 1
+#define DASH_TEMPERATURE_CARD 2
+#define DASH_HUMIDITY_CARD 3
+#define DASH_STATUS_CARD 4
+#define DASH_SLIDER_CARD 5
+#define DASH_LINE_CHART 6
+#define DASH_GAUGE_CHART 7
+#define DASH_CARD_KEY(type, index) (((uint32_t)(type) << 16) | ((uint32_t)(index) + 1))
+
+// Send a card update to every websocket client and event stream viewer
+static void sendUpdate(AsyncWebSocketMessageBuffer * buffer, uint32_t key){
+    events.send((const char *)buffer->get());
+    ws.textAll(buffer, key);
+}
+
+// The message of every single-value card update
+template <typename TWriter>
+static void writeCardUpdate(TWriter& json, const char * response, const String& id, int value){
+    json.beginObject();
+    json.member("response", response);
+    json.member("id", id);
+    json.member("value", value);
+    json.endObject();
+}
+
+// Write a card update straight into a websocket buffer of the exact size, no document in between
+static void sendCardUpdate(const char * response, const String& id, int value, uint32_t key){
+    auto measure = makeJsonWriter();
+    writeCardUpdate(measure, response, id, value);
+    size_t len = measure.bytesWritten();
+    AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
+    if (buffer) {
+        auto json = makeJsonWriter((char *)buffer->get(), len + 1);
+        writeCardUpdate(json, response, id, value);
+        sendUpdate(buffer, key);
+    }else{
+        #if defined(DEBUG_MODE)
+            //Serial.println("[DASH] Websocket Buffer Error");
+        #endif
+    }
+}
 
 
 // Handle Websocket Requests
@@ -91,7 +136,9 @@ void ESPDashClass::onWsEvent(AsyncWebSocket * server, AsyncWebSocketClient * cli
                                     ESPDash._sliderChangedFunc(sliderId, sliderValue);
                                     // Send Confirmation
                                     ESPDash.slider_card_value[i] = sliderValue;
-                                    ws.textAll("{\"response\": \"updateSliderCard\", \"id\": \""+(String)sliderId+"\", \"value\": "+sliderValue+"}");
+                                    String update = "{\"response\": \"updateSliderCard\", \"id\": \""+(String)sliderId+"\", \"value\": "+sliderValue+"}";
+                                    events.send(update.c_str());
+                                    ws.textAll(update);
                                     return;
                                 }
                             }
@@ -116,13 +163,32 @@ void ESPDashClass::onWsEvent(AsyncWebSocket * server, AsyncWebSocketClient * cli
 // Public Functions //
 //////////////////////
 
-void ESPDashClass::init(AsyncWebServer& server){
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        // Send File
-        AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", DASH_HTML, DASH_HTML_SIZE);
-        response->addHeader("Content-Encoding","gzip");
-        request->send(response);        
-    });
+void ESPDashClass::init(AsyncWebServer& server, const uint8_t* bundle){
+    AsyncWebBundleHandler* bundleHandler = (bundle != NULL) ? new AsyncWebBundleHandler("/", bundle) : NULL;
+    if(bundleHandler != NULL && bundleHandler->valid()){
+        // Serve every page asset straight from the bundle
+        server.addHandler(bundleHandler);
+    }else{
+        delete bundleHandler;
+        server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
+            // Send File
+            AsyncWebServerResponse *response;
+            #if DASH_BROTLI
+                if(request->acceptsEncoding("br")){
+                    response = request->beginResponse_P(200, "text/html", DASH_HTML_BR, DASH_HTML_BR_SIZE);
+                    response->addHeader("Content-Encoding","br");
+                }else{
+                    response = request->beginResponse_P(200, "text/html", DASH_HTML, DASH_HTML_SIZE);
+                    response->addHeader("Content-Encoding","gzip");
+                }
+                response->addHeader("Vary","Accept-Encoding");
+            #else
+                response = request->beginResponse_P(200, "text/html", DASH_HTML, DASH_HTML_SIZE);
+                response->addHeader("Content-Encoding","gzip");
+            #endif
+            request->send(response);        
+        });
+    }
 
     #if DEBUG_MODE == 1
         server.on("/debug", HTTP_GET, [&](AsyncWebServerRequest *request){
@@ -133,7 +199,38 @@ void ESPDashClass::init(AsyncWebServer& server){
     #endif
 
     ws.onEvent(onWsEvent);
+    // Card updates only need their latest value, a stalled client must not make the others lose them
+    ws.queuePolicy(WS_QUEUE_COALESCE);
+    // The card updates repeat themselves, compressed they are a fraction of the size
+    ws.deflate(true);
+    // Button and slider messages are handled whole, even when the browser splits them
+    ws.reassemble(1024);
     server.addHandler(&ws);
+
+    events.onConnect(onEventsConnect);
+    events.replay(DASH_EVENTS_REPLAY);
+    server.addHandler(&events);
+}
+
+
+// A viewer that is new, missed too much or missed a layout change starts from the whole layout
+void ESPDashClass::onEventsConnect(AsyncEventSourceClient * client){
+    if(client->replayed() && events.thisBoot(client->lastId()) && client->lastId() > ESPDash.layout_event_id)
+        return;
+    String result = "";
+    ESPDash.generateLayoutResponse(result);
+    client->send(result.c_str(), "layout", events.lastId());
+}
+
+// Websocket clients ask for the new layout, viewers are sent it
+void ESPDashClass::sendLayoutUpdate(){
+    ws.textAll("{\"response\": \"updateLayout\"}");
+    layout_event_id = events.lastId();
+    if(events.count()){
+        String result = "";
+        generateLayoutResponse(result);
+        events.send(result.c_str(), "layout");
+    }
 }
 
 
@@ -156,7 +253,7 @@ void ESPDashClass::addNumberCard(const char* _id, const char* _name){
                 number_card_name[i] = _name;
                 number_card_value[i] = 0;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -180,7 +277,7 @@ void ESPDashClass::addNumberCard(const char* _id, const char* _name, int _value)
                 number_card_name[i] = _name;
                 number_card_value[i] = _value;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -201,21 +298,7 @@ void ESPDashClass::updateNumberCard(const char* _id, int _value){
 
             number_card_value[i] = _value;
 
-            DynamicJsonDocument doc(250);
-            JsonObject object = doc.to<JsonObject>();
-            object["response"] = "updateNumberCard";
-            object["id"] = number_card_id[i];
-            object["value"] = number_card_value[i];
-            size_t len = measureJson(doc);
-            AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
-            if (buffer) {
-                serializeJson(doc, (char *)buffer->get(), len + 1);
-                ws.textAll(buffer);
-            }else{
-                #if defined(DEBUG_MODE)
-                    //Serial.println("[DASH] Websocket Buffer Error");
-                #endif
-            }
+            sendCardUpdate("updateNumberCard", number_card_id[i], number_card_value[i], DASH_CARD_KEY(DASH_NUMBER_CARD, i));
             break;
         }
     }
@@ -242,7 +325,7 @@ void ESPDashClass::addTemperatureCard(const char* _id, const char* _name, int _t
                 temperature_card_type[i] = _type;
                 temperature_card_value[i] = 0;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -267,7 +350,7 @@ void ESPDashClass::addTemperatureCard(const char* _id, const char* _name, int _t
                 temperature_card_type[i] = _type;
                 temperature_card_value[i] = _value;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -288,21 +371,7 @@ void ESPDashClass::updateTemperatureCard(const char* _id, int _value){
 
             temperature_card_value[i] = _value;
 
-            DynamicJsonDocument doc(250);
-            JsonObject object = doc.to<JsonObject>();
-            object["response"] = "updateTemperatureCard";
-            object["id"] = temperature_card_id[i];
-            object["value"] = temperature_card_value[i];
-            size_t len = measureJson(doc);
-            AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
-            if (buffer) {
-                serializeJson(doc, (char *)buffer->get(), len + 1);
-                ws.textAll(buffer);
-            }else{
-                #if defined(DEBUG_MODE)
-                    //Serial.println("[DASH] Websocket Buffer Error");
-                #endif
-            }
+            sendCardUpdate("updateTemperatureCard", temperature_card_id[i], temperature_card_value[i], DASH_CARD_KEY(DASH_TEMPERATURE_CARD, i));
             break;
         }
     }
@@ -328,7 +397,7 @@ void ESPDashClass::addHumidityCard(const char* _id, const char* _name){
                 humidity_card_name[i] = _name;
                 humidity_card_value[i] = 0;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -352,7 +421,7 @@ void ESPDashClass::addHumidityCard(const char* _id, const char* _name, int _valu
                 humidity_card_name[i] = _name;
                 humidity_card_value[i] = _value;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -373,21 +442,7 @@ void ESPDashClass::updateHumidityCard(const char* _id, int _value){
 
             humidity_card_value[i] = _value;
 
-            DynamicJsonDocument doc(250);
-            JsonObject object = doc.to<JsonObject>();
-            object["response"] = "updateHumidityCard";
-            object["id"] = humidity_card_id[i];
-            object["value"] = humidity_card_value[i];
-            size_t len = measureJson(doc);
-            AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
-            if (buffer) {
-                serializeJson(doc, (char *)buffer->get(), len + 1);
-                ws.textAll(buffer);
-            }else{
-                #if defined(DEBUG_MODE)
-                    //Serial.println("[DASH] Websocket Buffer Error");
-                #endif
-            }
+            sendCardUpdate("updateHumidityCard", humidity_card_id[i], humidity_card_value[i], DASH_CARD_KEY(DASH_HUMIDITY_CARD, i));
             break;
         }
     }
@@ -413,7 +468,7 @@ void ESPDashClass::addStatusCard(const char* _id, const char* _name){
                 status_card_name[i] = _name;
                 status_card_value[i] = 0;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -437,7 +492,7 @@ void ESPDashClass::addStatusCard(const char* _id, const char* _name, int _value)
                 status_card_name[i] = _name;
                 status_card_value[i] = _value;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -465,7 +520,7 @@ void ESPDashClass::addStatusCard(const char* _id, const char* _name, bool _value
                     status_card_value[i] = 0;
                 }
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -490,21 +545,7 @@ void ESPDashClass::updateStatusCard(const char* _id, bool _value){
                 status_card_value[i] = 0;
             }
 
-            DynamicJsonDocument doc(250);
-            JsonObject object = doc.to<JsonObject>();
-            object["response"] = "updateStatusCard";
-            object["id"] = status_card_id[i];
-            object["value"] = status_card_value[i];
-            size_t len = measureJson(doc);
-            AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
-            if (buffer) {
-                serializeJson(doc, (char *)buffer->get(), len + 1);
-                ws.textAll(buffer);
-            }else{
-                #if defined(DEBUG_MODE)
-                    //Serial.println("[DASH] Websocket Buffer Error");
-                #endif
-            }
+            sendCardUpdate("updateStatusCard", status_card_id[i], status_card_value[i], DASH_CARD_KEY(DASH_STATUS_CARD, i));
             break;
         }
     }
@@ -523,21 +564,7 @@ void ESPDashClass::updateStatusCard(const char* _id, int _value){
 
                 status_card_value[i] = _value;
 
-                DynamicJsonDocument doc(250);
-                JsonObject object = doc.to<JsonObject>();
-                object["response"] = "updateStatusCard";
-                object["id"] = status_card_id[i];
-                object["value"] = status_card_value[i];
-                size_t len = measureJson(doc);
-                AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
-                if (buffer) {
-                    serializeJson(doc, (char *)buffer->get(), len + 1);
-                    ws.textAll(buffer);
-                }else{
-                    #if defined(DEBUG_MODE)
-                        //Serial.println("[DASH] Websocket Buffer Error");
-                    #endif
-                }
+                sendCardUpdate("updateStatusCard", status_card_id[i], status_card_value[i], DASH_CARD_KEY(DASH_STATUS_CARD, i));
                 break;
             }
         }
@@ -592,7 +619,7 @@ void ESPDashClass::addSliderCard(const char* _id, const char* _name, int _type){
                 slider_card_type[i]  = _type;
                 slider_card_value[i] = 0;
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -612,21 +639,7 @@ void ESPDashClass::updateSliderCard(const char* _id, int _value){
 
             slider_card_value[i] = _value;
 
-            DynamicJsonDocument doc(250);
-            JsonObject object = doc.to<JsonObject>();
-            object["response"] = "updateSliderCard";
-            object["id"] = slider_card_id[i];
-            object["value"] = slider_card_value[i];
-            size_t len = measureJson(doc);
-            AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
-            if (buffer) {
-                serializeJson(doc, (char *)buffer->get(), len + 1);
-                ws.textAll(buffer);
-            }else{
-                #if defined(DEBUG_MODE)
-                    //Serial.println("[DASH] Websocket Buffer Error (updateSliderCard())");
-                #endif
-            }
+            sendCardUpdate("updateSliderCard", slider_card_id[i], slider_card_value[i], DASH_CARD_KEY(DASH_SLIDER_CARD, i));
             break;
         }
     }
@@ -663,7 +676,7 @@ void ESPDashClass::addLineChart(const char* _id, const char* _name, int _x_axis_
                     line_chart_y_axis_value[i][v] = _y_axis_value[v];
                 }
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -697,7 +710,7 @@ void ESPDashClass::addLineChart(const char* _id, const char* _name, String _x_ax
                     line_chart_y_axis_value[i][v] = _y_axis_value[v];
                 }
 
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -742,7 +755,7 @@ void ESPDashClass::updateLineChart(const char* _id, int _x_axis_value[], int _x_
                 AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
                 if (buffer) {
                     serializeJson(doc, (char *)buffer->get(), len + 1);
-                    ws.textAll(buffer);
+                    sendUpdate(buffer, DASH_CARD_KEY(DASH_LINE_CHART, i));
                 }else{
                     #if defined(DEBUG_MODE)
                         //Serial.println("[DASH] Websocket Buffer Error");
@@ -790,7 +803,7 @@ void ESPDashClass::updateLineChart(const char* _id, String _x_axis_value[], int
                 AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
                 if (buffer) {
                     serializeJson(doc, (char *)buffer->get(), len + 1);
-                    ws.textAll(buffer);
+                    sendUpdate(buffer, DASH_CARD_KEY(DASH_LINE_CHART, i));
                 }else{
                     #if defined(DEBUG_MODE)
                         //Serial.println("[DASH] Websocket Buffer Error");
@@ -820,7 +833,7 @@ void ESPDashClass::addGaugeChart(const char* _id, const char* _name){
                 gauge_chart_id[i] = _id;
                 gauge_chart_name[i] = _name;
                 gauge_chart_value[i] = 0;
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -842,7 +855,7 @@ void ESPDashClass::addGaugeChart(const char* _id, const char* _name, int _value)
                 gauge_chart_id[i] = _id;
                 gauge_chart_name[i] = _name;
                 gauge_chart_value[i] = _value;
-                ws.textAll("{\"response\": \"updateLayout\"}");
+                sendLayoutUpdate();
                 break;
             }
         }
@@ -863,21 +876,7 @@ void ESPDashClass::updateGaugeChart(const char* _id, int _value){
 
             gauge_chart_value[i] = _value;
 
-            DynamicJsonDocument doc(250);
-            JsonObject object = doc.to<JsonObject>();
-            object["response"] = "updateGaugeChart";
-            object["id"] = gauge_chart_id[i];
-            object["value"] = gauge_chart_value[i];
-            size_t len = measureJson(doc);
-            AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
-            if (buffer) {
-                serializeJson(doc, (char *)buffer->get(), len + 1);
-                ws.textAll(buffer);
-            }else{
-                #if defined(DEBUG_MODE)
-                    //Serial.println("[DASH] Websocket Buffer Error");
-                #endif
-            }
+            sendCardUpdate("updateGaugeChart", gauge_chart_id[i], gauge_chart_value[i], DASH_CARD_KEY(DASH_GAUGE_CHART, i));
             break;
         }
     }
@@ -897,148 +896,143 @@ void ESPDashClass::generateLayoutResponse(String& result){
 
     size_t CAPACITY = getTotalResponseCapacity();
 
-    DynamicJsonDocument doc(CAPACITY+1000);
-    JsonObject root = doc.to<JsonObject>();
-    root["response"] = "getLayout";
-    root["version"] = "1";
-    root["size"] = CAPACITY+1000;
+    // Written straight into result card by card, the layout never exists as a document
+    auto json = makeJsonWriter(result);
+    json.beginObject();
+    json.member("response", "getLayout");
+    json.member("version", "1");
+    json.member("size", CAPACITY+1000);
     // Add Stats
-    JsonObject stats = root.createNestedObject("statistics");
+    json.key("statistics").beginObject();
     if(stats_enabled){
-        stats["enabled"] = true;
-        stats["hardware"] = HARDWARE;
+        json.member("enabled", true);
+        json.member("hardware", HARDWARE);
         #if defined(ESP8266)
-            stats["chipId"] = String(ESP.getChipId());
-            stats["sketchHash"] = ESP.getSketchMD5();
-            stats["macAddress"] = String(WiFi.macAddress());
-            stats["freeHeap"] = ESP.getFreeHeap();
-            stats["wifiMode"] = int(WiFi.getMode());
+            json.member("chipId", String(ESP.getChipId()));
+            json.member("sketchHash", ESP.getSketchMD5());
+            json.member("macAddress", String(WiFi.macAddress()));
+            json.member("freeHeap", ESP.getFreeHeap());
+            json.member("wifiMode", int(WiFi.getMode()));
         #elif defined(ESP32)
-            stats["chipId"] = ESP.getEfuseMac();
-            stats["sketchHash"] = ESP.getSketchMD5();
-            stats["macAddress"] = String(WiFi.macAddress());
-            stats["freeHeap"] = ESP.getFreeHeap();
-            stats["wifiMode"] = int(WiFi.getMode());
+            json.member("chipId", ESP.getEfuseMac());
+            json.member("sketchHash", ESP.getSketchMD5());
+            json.member("macAddress", String(WiFi.macAddress()));
+            json.member("freeHeap", ESP.getFreeHeap());
+            json.member("wifiMode", int(WiFi.getMode()));
         #endif
     }else{
-        stats["enabled"] = false;
+        json.member("enabled", false);
     }
+    json.endObject();
     // Add Cards
-    JsonArray cards = root.createNestedArray("cards");
+    json.key("cards").beginArray();
     for(int i=0; i < NUMBER_CARD_LIMIT; i++){
         if(number_card_id[i] != ""){
-            DynamicJsonDocument carddoc(250);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = number_card_id[i];
-            jsoncard["card_type"] = "number";
-            jsoncard["name"] = number_card_name[i];
-            jsoncard["value"] = number_card_value[i];
-            cards.add(jsoncard);
+            json.beginObject();
+            json.member("id", number_card_id[i]);
+            json.member("card_type", "number");
+            json.member("name", number_card_name[i]);
+            json.member("value", number_card_value[i]);
+            json.endObject();
         }
     }
 
     for(int i=0; i < TEMPERATURE_CARD_LIMIT; i++){
         if(temperature_card_id[i] != ""){
-            DynamicJsonDocument carddoc(250);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = temperature_card_id[i];
-            jsoncard["card_type"] = "temperature";
-            jsoncard["name"] = temperature_card_name[i];
-            jsoncard["value_type"] = temperature_card_type[i];
-            jsoncard["value"] = temperature_card_value[i];
-            cards.add(jsoncard);
+            json.beginObject();
+            json.member("id", temperature_card_id[i]);
+            json.member("card_type", "temperature");
+            json.member("name", temperature_card_name[i]);
+            json.member("value_type", temperature_card_type[i]);
+            json.member("value", temperature_card_value[i]);
+            json.endObject();
         }
     }
 
     for(int i=0; i < HUMIDITY_CARD_LIMIT; i++){
         if(humidity_card_id[i] != ""){
-            DynamicJsonDocument carddoc(250);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = humidity_card_id[i];
-            jsoncard["card_type"] = "humidity";
-            jsoncard["name"] = humidity_card_name[i];
-            jsoncard["value"] = humidity_card_value[i];
-            cards.add(jsoncard);
+            json.beginObject();
+            json.member("id", humidity_card_id[i]);
+            json.member("card_type", "humidity");
+            json.member("name", humidity_card_name[i]);
+            json.member("value", humidity_card_value[i]);
+            json.endObject();
         }
     }
 
     for(int i=0; i < STATUS_CARD_LIMIT; i++){
         if(status_card_id[i] != ""){
-            DynamicJsonDocument carddoc(250);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = status_card_id[i];
-            jsoncard["card_type"] = "status";
-            jsoncard["name"] = status_card_name[i];
-            jsoncard["value"] = status_card_value[i];
-            cards.add(jsoncard);
+            json.beginObject();
+            json.member("id", status_card_id[i]);
+            json.member("card_type", "status");
+            json.member("name", status_card_name[i]);
+            json.member("value", status_card_value[i]);
+            json.endObject();
         }
     }
 
     for(int i=0; i < BUTTON_CARD_LIMIT; i++){
         if(button_card_id[i] != ""){
-            DynamicJsonDocument carddoc(250);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = button_card_id[i];
-            jsoncard["card_type"] = "button";
-            jsoncard["name"] = button_card_name[i];
-            cards.add(jsoncard);
+            json.beginObject();
+            json.member("id", button_card_id[i]);
+            json.member("card_type", "button");
+            json.member("name", button_card_name[i]);
+            json.endObject();
         }
     }
 
     for(int i=0; i < LINE_CHART_LIMIT; i++){
         if(line_chart_id[i] != ""){
-            DynamicJsonDocument carddoc(1000);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = line_chart_id[i];
-            jsoncard["card_type"] = "lineChart";
-            jsoncard["name"] = line_chart_name[i];
-            JsonArray xaxis = jsoncard.createNestedArray("x_axis_value");
+            json.beginObject();
+            json.member("id", line_chart_id[i]);
+            json.member("card_type", "lineChart");
+            json.member("name", line_chart_name[i]);
+            json.key("x_axis_value").beginArray();
             if(line_chart_x_axis_type[i]){ // If type = String
                 for(int v = 0; v < line_chart_x_axis_size[i]; v++){
-                    xaxis.add(line_chart_x_axis_value_string[i][v]);
+                    json.value(line_chart_x_axis_value_string[i][v]);
                 }
             }else{ // If type = Integer
                 for(int v = 0; v < line_chart_x_axis_size[i]; v++){
-                    xaxis.add(line_chart_x_axis_value_int[i][v]);
+                    json.value(line_chart_x_axis_value_int[i][v]);
                 }
             }
+            json.endArray();
 
-            jsoncard["y_axis_name"] = line_chart_y_axis_name[i];
-            JsonArray yaxis = jsoncard.createNestedArray("y_axis_value");
+            json.member("y_axis_name", line_chart_y_axis_name[i]);
+            json.key("y_axis_value").beginArray();
             for(int v=0; v < line_chart_y_axis_size[i]; v++){
-                yaxis.add(line_chart_y_axis_value[i][v]);
+                json.value(line_chart_y_axis_value[i][v]);
             }
-
-            cards.add(jsoncard);
+            json.endArray();
+            json.endObject();
         }
     }
 
     for(int i=0; i < GAUGE_CHART_LIMIT; i++){
         if(gauge_chart_id[i] != ""){
-            DynamicJsonDocument carddoc(250);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = gauge_chart_id[i];
-            jsoncard["card_type"] = "gaugeChart";
-            jsoncard["value"] = gauge_chart_value[i];
-            jsoncard["name"] = gauge_chart_name[i];
-            cards.add(jsoncard);
+            json.beginObject();
+            json.member("id", gauge_chart_id[i]);
+            json.member("card_type", "gaugeChart");
+            json.member("value", gauge_chart_value[i]);
+            json.member("name", gauge_chart_name[i]);
+            json.endObject();
         }
     }
 
     for(int i=0; i < SLIDER_CARD_LIMIT; i++){
         if(slider_card_id[i] != ""){
-            DynamicJsonDocument carddoc(250);
-            JsonObject jsoncard = carddoc.to<JsonObject>();
-            jsoncard["id"] = slider_card_id[i];
-            jsoncard["card_type"] = "slider";
-            jsoncard["name"] = slider_card_name[i];
-            jsoncard["value"] = slider_card_value[i];
-            jsoncard["type"] = slider_card_type[i];
-            cards.add(jsoncard);
+            json.beginObject();
+            json.member("id", slider_card_id[i]);
+            json.member("card_type", "slider");
+            json.member("name", slider_card_name[i]);
+            json.member("value", slider_card_value[i]);
+            json.member("type", slider_card_type[i]);
+            json.endObject();
         }
     }
-
-    serializeJson(doc, result);
+    json.endArray();
+    json.endObject();
 
     #if defined(DEBUG_MODE)
         //Serial.println("Free HEAP = after = JSON Serialization: "+String(ESP.getFreeHeap()));
@@ -40,8 +40,21 @@
     #include "ArduinoJson.h"
 #endif
 
+#include "AsyncWebBundle.h"
+
+// Also embed a brotli copy of the webpage (~165KB more flash), served to clients sending "Accept-Encoding: br"
+// Browsers only advertise br over https, so on a plain http soft-AP the gzip copy is what gets served
+#ifndef DASH_BROTLI
+#define DASH_BROTLI 0
+#endif
+
 #include "webpage.h"
 
+// Updates kept for event stream viewers (/dashevents) that reconnect, so they only get what they missed
+#ifndef DASH_EVENTS_REPLAY
+#define DASH_EVENTS_REPLAY 16
+#endif
+
 typedef std::function<void(const char* buttonId)> DashButtonHandler;
 typedef std::function<void(const char* sliderId, int sliderValue)> DashSliderHandler;
 
@@ -81,7 +94,7 @@ typedef std::function<void(const char* sliderId, int sliderValue)> DashSliderHan
 class ESPDashClass{
 
     public:
-        void init(AsyncWebServer& server);
+        void init(AsyncWebServer& server, const uint8_t* bundle = NULL); // Serve the webpage from an asset bundle (bundle.js) instead of DASH_HTML
         void disableStats();    // To Disable Stats and disable reboot
 
         void addNumberCard(const char* _id, const char* _name); // Add Number card with default value
@@ -131,6 +144,7 @@ class ESPDashClass{
         
     private:
         bool stats_enabled = true;
+        uint32_t layout_event_id = 0; // events.lastId() when the layout last changed
         DashButtonHandler _buttonClickFunc;
         DashSliderHandler _sliderChangedFunc;
         // Button Cards
@@ -216,6 +230,8 @@ class ESPDashClass{
         
 
         static void onWsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len);
+        static void onEventsConnect(AsyncEventSourceClient * client);
+        void sendLayoutUpdate();
         void generateLayoutResponse(String& result);
         void generateStatsResponse(String& result);
         void generateRebootResponse(String& result);
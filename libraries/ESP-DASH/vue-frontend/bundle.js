@@ -0,0 +1,193 @@
+// Asset Bundle Nodejs Script
+// 1 - Walk a web directory (default: dist)
+// 2 - Compress every file with gzip and brotli, keep gzip plus brotli when smaller
+// 3 - Deduplicate identical payloads and strings
+// 4 - Emit one indexed blob ( webbundle.h as PROGMEM array, or webbundle.bin as flash partition image )
+//
+// Usage: node bundle.js [webDir] [output.h|output.bin] [symbolName]
+//
+// Files that are already gzipped (app.js.gz) are unpacked first and served under their
+// original name, so data/dash can be packed as-is:
+//   node bundle.js ../../../data/dash ../../../webbundle.h WEB_BUNDLE
+//
+// Blob layout (little endian, see AsyncWebBundle.h):
+//   header  : magic "AWB1", u16 version, u16 count, u32 total size, u32 reserved
+//   entries : count x { u32 hash, u32 path, u32 type, u32 offset, u32 length, u32 etag, u8 encoding, u8[3] pad }
+//             sorted by (hash, encoding); path/type are offsets of NUL terminated strings
+//   strings : NUL terminated paths and content types, shared between entries
+//   data    : compressed payloads, 4 byte aligned, identical payloads stored once
+
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const crypto = require('crypto');
+
+const MAGIC = 'AWB1';
+const VERSION = 1;
+const HEADER_SIZE = 16;
+const ENTRY_SIZE = 28;
+
+const ENCODING_IDENTITY = 0;
+const ENCODING_GZIP = 1;
+const ENCODING_BROTLI = 2;
+
+const MIME_TYPES = {
+    '.html': 'text/html',
+    '.htm': 'text/html',
+    '.css': 'text/css',
+    '.json': 'application/json',
+    '.js': 'application/javascript',
+    '.png': 'image/png',
+    '.gif': 'image/gif',
+    '.jpg': 'image/jpeg',
+    '.ico': 'image/x-icon',
+    '.svg': 'image/svg+xml',
+    '.eot': 'font/eot',
+    '.woff': 'font/woff',
+    '.woff2': 'font/woff2',
+    '.ttf': 'font/ttf',
+    '.xml': 'text/xml',
+    '.pdf': 'application/pdf',
+    '.zip': 'application/zip'
+};
+
+// Formats that are already compressed are not worth another pass
+const STORE_ONLY = ['.png', '.gif', '.jpg', '.woff', '.woff2', '.zip'];
+
+// FNV-1a, must match _bundleHash() in AsyncWebBundle.cpp
+function fnv1a(bytes){
+    let hash = 0x811c9dc5;
+    for (let i = 0; i < bytes.length; i++) {
+        hash ^= bytes[i];
+        hash = Math.imul(hash, 0x01000193) >>> 0;
+    }
+    return hash >>> 0;
+}
+
+function walk(dir, files){
+    for (const name of fs.readdirSync(dir).sort()) {
+        const full = path.join(dir, name);
+        if (fs.statSync(full).isDirectory()) walk(full, files);
+        else files.push(full);
+    }
+    return files;
+}
+
+function compress(raw, ext){
+    const variants = [];
+    if (STORE_ONLY.includes(ext)) {
+        variants.push({ encoding: ENCODING_IDENTITY, data: raw });
+        return variants;
+    }
+    const gz = zlib.gzipSync(raw, { level: zlib.constants.Z_BEST_COMPRESSION });
+    const br = zlib.brotliCompressSync(raw, {
+        params: {
+            [zlib.constants.BROTLI_PARAM_MODE]: ext == '.woff2' ? zlib.constants.BROTLI_MODE_FONT : zlib.constants.BROTLI_MODE_TEXT,
+            [zlib.constants.BROTLI_PARAM_QUALITY]: zlib.constants.BROTLI_MAX_QUALITY,
+            [zlib.constants.BROTLI_PARAM_SIZE_HINT]: raw.length
+        }
+    });
+    // gzip is always kept: browsers only advertise br over https, so it is the usual fallback
+    if (gz.length < raw.length) variants.push({ encoding: ENCODING_GZIP, data: gz });
+    else variants.push({ encoding: ENCODING_IDENTITY, data: raw });
+    if (br.length < gz.length && br.length < raw.length) variants.push({ encoding: ENCODING_BROTLI, data: br });
+    return variants;
+}
+
+function align4(n){
+    return (n + 3) & ~3;
+}
+
+function pack(webDir){
+    const entries = [];
+    for (const file of walk(webDir, [])) {
+        let urlPath = '/' + path.relative(webDir, file).split(path.sep).join('/');
+        let raw = fs.readFileSync(file);
+        if (urlPath.endsWith('.gz')) {
+            urlPath = urlPath.slice(0, -3);
+            raw = zlib.gunzipSync(raw);
+        }
+        const ext = path.extname(urlPath).toLowerCase();
+        const type = MIME_TYPES[ext] || 'text/plain';
+        const etag = fnv1a(raw);
+        for (const v of compress(raw, ext)) {
+            entries.push({ path: urlPath, hash: fnv1a(Buffer.from(urlPath, 'utf8')), type: type, etag: etag, encoding: v.encoding, data: v.data, rawSize: raw.length });
+        }
+    }
+    entries.sort((a, b) => (a.hash - b.hash) || (a.encoding - b.encoding));
+
+    // String table, shared between variants of the same path and equal content types
+    const strings = new Map();
+    let stringsSize = 0;
+    const stringsBase = HEADER_SIZE + entries.length * ENTRY_SIZE;
+    function intern(str){
+        if (!strings.has(str)) {
+            strings.set(str, stringsBase + stringsSize);
+            stringsSize += Buffer.byteLength(str, 'utf8') + 1;
+        }
+        return strings.get(str);
+    }
+    for (const e of entries) {
+        e.pathOffset = intern(e.path);
+        e.typeOffset = intern(e.type);
+    }
+
+    // Content addressed payloads
+    const payloads = new Map();
+    let dataSize = 0;
+    const dataBase = align4(stringsBase + stringsSize);
+    for (const e of entries) {
+        const key = crypto.createHash('sha256').update(e.data).digest('hex');
+        if (!payloads.has(key)) {
+            payloads.set(key, { offset: dataBase + dataSize, data: e.data });
+            dataSize = align4(dataSize + e.data.length);
+        }
+        e.dataOffset = payloads.get(key).offset;
+    }
+
+    const total = dataBase + dataSize;
+    const blob = Buffer.alloc(total);
+    blob.write(MAGIC, 0, 'ascii');
+    blob.writeUInt16LE(VERSION, 4);
+    blob.writeUInt16LE(entries.length, 6);
+    blob.writeUInt32LE(total, 8);
+    entries.forEach((e, i) => {
+        const o = HEADER_SIZE + i * ENTRY_SIZE;
+        blob.writeUInt32LE(e.hash, o);
+        blob.writeUInt32LE(e.pathOffset, o + 4);
+        blob.writeUInt32LE(e.typeOffset, o + 8);
+        blob.writeUInt32LE(e.dataOffset, o + 12);
+        blob.writeUInt32LE(e.data.length, o + 16);
+        blob.writeUInt32LE(e.etag, o + 20);
+        blob.writeUInt8(e.encoding, o + 24);
+    });
+    for (const [str, offset] of strings) blob.write(str + '\0', offset, 'utf8');
+    for (const p of payloads.values()) p.data.copy(blob, p.offset);
+
+    return { blob: blob, entries: entries };
+}
+
+const webDir = process.argv[2] || __dirname + '/dist';
+const output = process.argv[3] || __dirname + '/dist/webbundle.h';
+const symbol = process.argv[4] || 'WEB_BUNDLE';
+
+const { blob, entries } = pack(webDir);
+const names = ['identity', 'gzip', 'br'];
+for (const e of entries) {
+    console.log(`${e.path} [${names[e.encoding]}] ${e.rawSize} -> ${e.data.length}`);
+}
+console.log(`Bundle: ${entries.length} entries, ${blob.length} bytes`);
+
+if (output.endsWith('.bin')) {
+    fs.writeFileSync(output, blob);
+} else {
+    let bytes = [];
+    for (let i = 0; i < blob.length; i++) bytes.push('0x' + blob[i].toString(16).padStart(2, '0'));
+    let source =
+`
+// Generated by bundle.js from ${path.basename(path.resolve(webDir))}, do not edit
+const uint32_t ${symbol}_SIZE = ${blob.length};
+const uint8_t ${symbol}[] PROGMEM __attribute__((aligned(4))) = { ${bytes} };
+`;
+    fs.writeFileSync(output, source, 'utf8');
+}
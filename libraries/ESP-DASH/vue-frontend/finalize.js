@@ -1,6 +1,6 @@
 // Finalize Nodejs Script
 // 1 - Append JS in HTML Document
-// 2 - Gzip HTML
+// 2 - Gzip HTML ( and Brotli, kept behind DASH_BROTLI )
 // 3 - Covert to Raw Bytes
 // 4 - ( Save to File: webpage.h ) in dist Folder
 
@@ -40,11 +40,29 @@ let html = `
 const gzippedIndex = zlib.gzipSync(html, {'level': zlib.constants.Z_BEST_COMPRESSION});
 let indexHTML = getByteArray(gzippedIndex);
 
+// Brotli the same document, only compiled in when DASH_BROTLI is set
+const brotliIndex = zlib.brotliCompressSync(html, {
+    params: {
+        [zlib.constants.BROTLI_PARAM_MODE]: zlib.constants.BROTLI_MODE_TEXT,
+        [zlib.constants.BROTLI_PARAM_QUALITY]: zlib.constants.BROTLI_MAX_QUALITY,
+        [zlib.constants.BROTLI_PARAM_SIZE_HINT]: Buffer.byteLength(html)
+    }
+});
+let indexHTMLBrotli = getByteArray(brotliIndex);
+
+let brotliSource =
+`
+#if DASH_BROTLI
+const uint32_t DASH_HTML_BR_SIZE = ${indexHTMLBrotli.length};
+const uint8_t DASH_HTML_BR[] PROGMEM = { ${indexHTMLBrotli} };
+#endif
+`;
+
 let source = 
 `
 const uint32_t DASH_HTML_SIZE = ${indexHTML.length};
 const uint8_t DASH_HTML[] PROGMEM = { ${indexHTML} };
-`;
+` + brotliSource;
 
 
 fs.writeFileSync(__dirname+'/dist/webpage.h', source, 'utf8');
@@ -59,7 +77,7 @@ gzip(input, {numiterations: 15}, (err, output) => {
 `
 const uint32_t DASH_HTML_SIZE = ${indexHTML.length};
 const uint8_t DASH_HTML[] PROGMEM = { ${indexHTML} };
-`;
+` + brotliSource;
 
     fs.writeFileSync(__dirname + '/dist/webpage_zopfli.h', source, 'utf8');
 });
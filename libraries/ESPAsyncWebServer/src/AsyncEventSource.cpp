@@ -19,6 +19,21 @@
 */
 #include "Arduino.h"
 #include "AsyncEventSource.h"
+#ifdef ESP32
+#include "esp_system.h"
+#endif
+
+// Where the numbering starts, different on every boot so ids a browser kept from before a restart are not taken for new ones
+static uint32_t eventIdBase(){
+#if defined(ESP32)
+  uint32_t r = esp_random();
+#elif defined(ESP8266)
+  uint32_t r = RANDOM_REG32;
+#else
+  uint32_t r = rand();
+#endif
+  return r >> 1; // leaves 2^31 ids before the counter wraps
+}
 
 static String generateEventMessage(const char *message, const char *event, uint32_t id, uint32_t reconnect){
   String ev = "";
@@ -104,10 +119,50 @@ static String generateEventMessage(const char *message, const char *event, uint3
   return ev;
 }
 
+#if ASYNC_WEB_LOCKING
+// Reference counts of the events that clients on several workers share
+static portMUX_TYPE _eventRefMux = portMUX_INITIALIZER_UNLOCKED;
+#define EVENT_REF_LOCK()   portENTER_CRITICAL(&_eventRefMux)
+#define EVENT_REF_UNLOCK() portEXIT_CRITICAL(&_eventRefMux)
+#else
+#define EVENT_REF_LOCK()
+#define EVENT_REF_UNLOCK()
+#endif
+
+// Event
+
+AsyncEventSourceEvent::AsyncEventSourceEvent(const String& event, uint32_t id)
+: _data(nullptr), _len(event.length()), _id(id), _count(0)
+{
+  _data = (uint8_t*)malloc(_len);
+  if(_data == nullptr)
+    _len = 0;
+  else
+    memcpy(_data, event.c_str(), _len);
+}
+
+AsyncEventSourceEvent::~AsyncEventSourceEvent(){
+  free(_data);
+}
+
+void AsyncEventSourceEvent::retain(){
+  EVENT_REF_LOCK();
+  _count++;
+  EVENT_REF_UNLOCK();
+}
+
+void AsyncEventSourceEvent::release(){
+  EVENT_REF_LOCK();
+  bool last = --_count == 0;
+  EVENT_REF_UNLOCK();
+  if(last)
+    delete this;
+}
+
 // Message
 
 AsyncEventSourceMessage::AsyncEventSourceMessage(const char * data, size_t len)
-: _data(nullptr), _len(len), _sent(0), _acked(0)
+: _data(nullptr), _len(len), _sent(0), _acked(0), _event(nullptr)
 {
   _data = (uint8_t*)malloc(_len+1);
   if(_data == nullptr){
@@ -118,9 +173,17 @@ AsyncEventSourceMessage::AsyncEventSourceMessage(const char * data, size_t len)
   }
 }
 
+AsyncEventSourceMessage::AsyncEventSourceMessage(AsyncEventSourceEvent * event)
+: _data((uint8_t*)event->data()), _len(event->length()), _sent(0), _acked(0), _event(event)
+{
+  _event->retain();
+}
+
 AsyncEventSourceMessage::~AsyncEventSourceMessage() {
-     if(_data != NULL)
-        free(_data);
+  if(_event != nullptr)
+    _event->release();
+  else if(_data != NULL)
+    free(_data);
 }
 
 size_t AsyncEventSourceMessage::ack(size_t len, uint32_t time) {
@@ -137,11 +200,12 @@ size_t AsyncEventSourceMessage::ack(size_t len, uint32_t time) {
 }
 
 size_t AsyncEventSourceMessage::send(AsyncClient *client) {
-  const size_t len = _len - _sent;
-  if(client->space() < len){
+  // As much as fits, the rest goes out on the next ack
+  const size_t len = std::min(_len - _sent, client->space());
+  if(!len){
     return 0;
   }
-  size_t sent = client->add((const char *)_data, len);
+  size_t sent = client->add((const char *)_data + _sent, len);
   if(client->canSend())
     client->send();
   _sent += sent;
@@ -156,8 +220,9 @@ AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, A
   _client = request->client();
   _server = server;
   _lastId = 0;
+  _replayed = false;
   if(request->hasHeader("Last-Event-ID"))
-    _lastId = atoi(request->getHeader("Last-Event-ID")->value().c_str());
+    _lastId = strtoul(request->getHeader("Last-Event-ID")->value().c_str(), NULL, 10);
     
   _client->setRxTimeout(0);
   _client->onError(NULL, NULL);
@@ -184,12 +249,14 @@ void AsyncEventSourceClient::_queueMessage(AsyncEventSourceMessage *dataMessage)
     return;
   }
 
+  AsyncWebLockGuard l(_lock);
   _messageQueue.add(dataMessage);
 
   _runQueue();
 }
 
 void AsyncEventSourceClient::_onAck(size_t len, uint32_t time){
+  AsyncWebLockGuard l(_lock);
   while(len && !_messageQueue.isEmpty()){
     len = _messageQueue.front()->ack(len, time);
     if(_messageQueue.front()->finished())
@@ -200,6 +267,7 @@ void AsyncEventSourceClient::_onAck(size_t len, uint32_t time){
 }
 
 void AsyncEventSourceClient::_onPoll(){
+  AsyncWebLockGuard l(_lock);
   if(!_messageQueue.isEmpty()){
     _runQueue();
   }
@@ -229,6 +297,11 @@ void AsyncEventSourceClient::send(const char *message, const char *event, uint32
   _queueMessage(new AsyncEventSourceMessage(ev.c_str(), ev.length()));
 }
 
+void AsyncEventSourceClient::_queueEvent(AsyncEventSourceEvent *event){
+  if(connected())
+    _queueMessage(new AsyncEventSourceMessage(event));
+}
+
 void AsyncEventSourceClient::_runQueue(){
   while(!_messageQueue.isEmpty() && _messageQueue.front()->finished()){
     _messageQueue.remove(_messageQueue.front());
@@ -236,8 +309,12 @@ void AsyncEventSourceClient::_runQueue(){
 
   for(auto i = _messageQueue.begin(); i != _messageQueue.end(); ++i)
   {
-    if(!(*i)->sent())
+    if(!(*i)->sent()){
       (*i)->send(_client);
+      // The next message may only follow once this one is out
+      if(!(*i)->sent())
+        break;
+    }
   }
 }
 
@@ -248,10 +325,16 @@ AsyncEventSource::AsyncEventSource(const String& url)
   : _url(url)
   , _clients(LinkedList<AsyncEventSourceClient *>([](AsyncEventSourceClient *c){ delete c; }))
   , _connectcb(NULL)
+  , _replay(LinkedList<AsyncEventSourceEvent *>([](AsyncEventSourceEvent *e){ e->release(); }))
+  , _replayLength(0)
+  , _firstId(0)
+  , _lastId(0)
+  , _evictedId(0)
 {}
 
 AsyncEventSource::~AsyncEventSource(){
   close();
+  _replay.free();
 }
 
 void AsyncEventSource::onConnect(ArEventHandlerFunction cb){
@@ -272,35 +355,79 @@ void AsyncEventSource::_addClient(AsyncEventSourceClient * client){
     free(temp);
   }*/
   
+  AsyncWebLockGuard l(_lock);
   _clients.add(client);
+  if(_replayTo(client))
+    client->_setReplayed();
   if(_connectcb)
     _connectcb(client);
 }
 
 void AsyncEventSource::_handleDisconnect(AsyncEventSourceClient * client){
+  AsyncWebLockGuard l(_lock);
   _clients.remove(client);
 }
 
 void AsyncEventSource::close(){
+  AsyncWebLockGuard l(_lock);
   for(const auto &c: _clients){
     if(c->connected())
       c->close();
   }
 }
 
+void AsyncEventSource::replay(size_t events){
+  AsyncWebLockGuard l(_lock);
+  _replayLength = events;
+  while(_replay.length() > _replayLength){
+    _evictedId = _replay.front()->id();
+    _replay.remove(_replay.front());
+  }
+}
+
+// Queues the events a reconnecting client missed, false if some of them are no longer kept
+bool AsyncEventSource::_replayTo(AsyncEventSourceClient * client){
+  uint32_t lastId = client->lastId();
+  if(!_replayLength || !thisBoot(lastId) || lastId < _evictedId)
+    return false;
+  for(const auto &e: _replay){
+    if(e->id() > lastId)
+      client->_queueEvent(e);
+  }
+  return true;
+}
+
 void AsyncEventSource::send(const char *message, const char *event, uint32_t id, uint32_t reconnect){
-  if(_clients.isEmpty())
+  AsyncWebLockGuard l(_lock);
+  if(_replayLength && !id)
+    id = (_lastId ? _lastId : eventIdBase()) + 1;
+  if(id){
+    if(!_lastId)
+      _firstId = id;
+    _lastId = id;
+  }
+  bool keep = _replayLength && id;
+  if(_clients.isEmpty() && !keep)
     return;
 
-  String ev = generateEventMessage(message, event, id, reconnect);
-  for(const auto &c: _clients){
-    if(c->connected()) {
-      c->write(ev.c_str(), ev.length());
+  // Formatted once, every client sends the same copy
+  AsyncEventSourceEvent *ev = new AsyncEventSourceEvent(generateEventMessage(message, event, id, reconnect), id);
+  ev->retain();
+  if(ev->length()){
+    if(keep){
+      ev->retain();
+      _replay.add(ev);
+      replay(_replayLength);
+    }
+    for(const auto &c: _clients){
+      c->_queueEvent(ev);
     }
   }
+  ev->release();
 }
 
 size_t AsyncEventSource::count() const {
+  AsyncWebLockGuard l(_lock);
   return _clients.count_if([](AsyncEventSourceClient *c){
     return c->connected();
   });
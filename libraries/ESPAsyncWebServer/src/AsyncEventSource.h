@@ -33,6 +33,25 @@ class AsyncEventSourceResponse;
 class AsyncEventSourceClient;
 typedef std::function<void(AsyncEventSourceClient *client)> ArEventHandlerFunction;
 
+// One formatted event, shared by the replay ring and the queue of every client sending it
+class AsyncEventSourceEvent {
+  private:
+    uint8_t * _data;
+    size_t _len;
+    uint32_t _id;
+    uint32_t _count;
+  public:
+    AsyncEventSourceEvent(const String& event, uint32_t id);
+    ~AsyncEventSourceEvent();
+    AsyncEventSourceEvent(const AsyncEventSourceEvent&) = delete;
+    AsyncEventSourceEvent& operator=(const AsyncEventSourceEvent&) = delete;
+    const uint8_t * data() const { return _data; }
+    size_t length() const { return _len; }
+    uint32_t id() const { return _id; }
+    void retain();
+    void release();
+};
+
 class AsyncEventSourceMessage {
   private:
     uint8_t * _data; 
@@ -40,8 +59,10 @@ class AsyncEventSourceMessage {
     size_t _sent;
     //size_t _ack;
     size_t _acked; 
+    AsyncEventSourceEvent * _event; // _data is the shared event's when set
   public:
     AsyncEventSourceMessage(const char * data, size_t len);
+    AsyncEventSourceMessage(AsyncEventSourceEvent * event);
     ~AsyncEventSourceMessage();
     size_t ack(size_t len, uint32_t time __attribute__((unused)));
     size_t send(AsyncClient *client);
@@ -54,7 +75,9 @@ class AsyncEventSourceClient {
     AsyncClient *_client;
     AsyncEventSource *_server;
     uint32_t _lastId;
+    bool _replayed;
     LinkedList<AsyncEventSourceMessage *> _messageQueue;
+    AsyncWebLock _lock;     // _messageQueue, an event sent from another worker can queue while this one sends
     void _queueMessage(AsyncEventSourceMessage *dataMessage);
     void _runQueue();
 
@@ -69,8 +92,12 @@ class AsyncEventSourceClient {
     void send(const char *message, const char *event=NULL, uint32_t id=0, uint32_t reconnect=0);
     bool connected() const { return (_client != NULL) && _client->connected(); }
     uint32_t lastId() const { return _lastId; }
+    //the events missed since lastId() were sent again on connect, the client is up to date
+    bool replayed() const { return _replayed; }
 
     //system callbacks (do not call)
+    void _queueEvent(AsyncEventSourceEvent *event);
+    void _setReplayed(){ _replayed = true; }
     void _onAck(size_t len, uint32_t time);
     void _onPoll(); 
     void _onTimeout(uint32_t time);
@@ -81,7 +108,14 @@ class AsyncEventSource: public AsyncWebHandler {
   private:
     String _url;
     LinkedList<AsyncEventSourceClient *> _clients;
+    mutable AsyncWebLock _lock; // _clients, the replay ring and the ids
     ArEventHandlerFunction _connectcb;
+    LinkedList<AsyncEventSourceEvent *> _replay;
+    size_t _replayLength;
+    uint32_t _firstId;   // of the first event sent since boot
+    uint32_t _lastId;    // of the latest event sent
+    uint32_t _evictedId; // of the latest event dropped from the replay ring
+    bool _replayTo(AsyncEventSourceClient * client);
   public:
     AsyncEventSource(const String& url);
     ~AsyncEventSource();
@@ -91,12 +125,18 @@ class AsyncEventSource: public AsyncWebHandler {
     void onConnect(ArEventHandlerFunction cb);
     void send(const char *message, const char *event=NULL, uint32_t id=0, uint32_t reconnect=0);
     size_t count() const; //number clinets connected
+    //keep the last events for clients that reconnect with a Last-Event-ID, events sent with id 0 are then numbered
+    void replay(size_t events);
+    uint32_t lastId() const { return _lastId; }
+    //the id is one this server sent since boot, a Last-Event-ID from before a restart is not
+    bool thisBoot(uint32_t id) const { return _lastId && id >= _firstId && id <= _lastId; }
 
     //system callbacks (do not call)
     void _addClient(AsyncEventSourceClient * client);
     void _handleDisconnect(AsyncEventSourceClient * client);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual WebRouteKind route(String& uri) const override final { uri = _url; return WEB_ROUTE_EXACT; }
 };
 
 class AsyncEventSourceResponse: public AsyncWebServerResponse {
@@ -8,9 +8,9 @@
    server.on("/json", HTTP_ANY, [](AsyncWebServerRequest * request) {
 
     AsyncJsonResponse * response = new AsyncJsonResponse();
-    JsonObject& root = response->getRoot();
+    JsonObject root = response->getRoot();
     root["key1"] = "key number one";
-    JsonObject& nested = root.createNestedObject("nested");
+    JsonObject nested = root.createNestedObject("nested");
     nested["key1"] = "key number one";
 
     response->setLength();
@@ -26,7 +26,7 @@
 
   AsyncCallbackJsonWebHandler* handler = new AsyncCallbackJsonWebHandler("/rest/endpoint");
   handler->onRequest([](AsyncWebServerRequest *request, JsonVariant &json) {
-    JsonObject& jsonObj = json.as<JsonObject>();
+    JsonObject jsonObj = json.as<JsonObject>();
     // ...
   });
   server.addHandler(handler);
@@ -35,13 +35,20 @@
 #ifndef ASYNC_JSON_H_
 #define ASYNC_JSON_H_
 #include <ArduinoJson.h>
+#include <new>
 
-const char* JSON_MIMETYPE = "application/json";
+// Capacity of the JsonDocument of a response or a parsed request body
+#ifndef DYNAMIC_JSON_DOCUMENT_SIZE
+#define DYNAMIC_JSON_DOCUMENT_SIZE 1024
+#endif
+
+static const char* const JSON_MIMETYPE = "application/json";
 
 /*
  * Json Response
  * */
 
+// Keeps the part of the output from byte `from` on that fits in the chunk, the rest is counted and dropped
 class ChunkPrint : public Print {
   private:
     uint8_t* _destination;
@@ -63,56 +70,84 @@ class ChunkPrint : public Print {
       }
       return 0;
     }
+    size_t write(const uint8_t *buffer, size_t size){
+      size_t skip = std::min(_to_skip, size);
+      _to_skip -= skip;
+      size_t copy = std::min(_to_write, size - skip);
+      memcpy(_destination + _pos, buffer + skip, copy);
+      _to_write -= copy;
+      _pos += copy;
+      return skip + copy;
+    }
+    size_t written() const { return _pos; }
 };
 
+// The document is serialized straight into each outgoing chunk, no copy of the whole output is made.
+// Every chunk serializes it again up to its end, so small documents or large chunks are cheapest.
 class AsyncJsonResponse: public AsyncAbstractResponse {
   private:
-    DynamicJsonBuffer _jsonBuffer;
+    DynamicJsonDocument _jsonBuffer;
     JsonVariant _root;
     bool _isValid;
   public:
-    AsyncJsonResponse(bool isArray=false): _isValid{false} {
+    AsyncJsonResponse(bool isArray=false, size_t maxJsonBufferSize=DYNAMIC_JSON_DOCUMENT_SIZE): _jsonBuffer(maxJsonBufferSize), _isValid{false} {
       _code = 200;
       _contentType = JSON_MIMETYPE;
       if(isArray)
-        _root = _jsonBuffer.createArray();
+        _root = _jsonBuffer.to<JsonArray>();
       else
-        _root = _jsonBuffer.createObject();
+        _root = _jsonBuffer.to<JsonObject>();
     }
     ~AsyncJsonResponse() {}
     JsonVariant & getRoot() { return _root; }
     bool _sourceValid() const { return _isValid; }
     size_t setLength() {
-      _contentLength = _root.measureLength();
+      _contentLength = measureJson(_jsonBuffer);
       if (_contentLength) { _isValid = true; }
       return _contentLength;
     }
 
-   size_t getSize() { return _jsonBuffer.size(); }
+    size_t getSize() { return _jsonBuffer.memoryUsage(); }
 
     size_t _fillBuffer(uint8_t *data, size_t len){
       ChunkPrint dest(data, _sentLength, len);
-      _root.printTo( dest ) ;
-      return len;
+      serializeJson(_jsonBuffer, dest);
+      return dest.written();
     }
 };
 
 typedef std::function<void(AsyncWebServerRequest *request, JsonVariant &json)> ArJsonRequestHandlerFunction;
 
+// Document of a request body with its pool and parser in one block, kept in the request's
+// _tempObject and freed along with it
+class AsyncJsonRequestBody: public JsonDocument {
+  public:
+    JsonPushDeserializer parser;
+
+    static AsyncJsonRequestBody* create(size_t capacity){
+      void* block = malloc(sizeof(AsyncJsonRequestBody) + capacity);
+      return block ? new (block) AsyncJsonRequestBody(capacity) : NULL;
+    }
+  private:
+    AsyncJsonRequestBody(size_t capacity): JsonDocument((char*)(this + 1), capacity), parser(*this) {}
+};
+
+// The body is parsed chunk by chunk as it arrives, only the document is kept
 class AsyncCallbackJsonWebHandler: public AsyncWebHandler {
 private:
 protected:
   const String _uri;
   WebRequestMethodComposite _method;
   ArJsonRequestHandlerFunction _onRequest;
-  int _contentLength;
-  int _maxContentLength;
+  size_t _maxContentLength;
+  size_t _maxJsonBufferSize;
 public:
-  AsyncCallbackJsonWebHandler(const String& uri, ArJsonRequestHandlerFunction onRequest) : _uri(uri), _method(HTTP_POST|HTTP_PUT|HTTP_PATCH), _onRequest(onRequest), _maxContentLength(16384) {}
+  AsyncCallbackJsonWebHandler(const String& uri, ArJsonRequestHandlerFunction onRequest=NULL, size_t maxJsonBufferSize=DYNAMIC_JSON_DOCUMENT_SIZE)
+    : _uri(uri), _method(HTTP_POST|HTTP_PUT|HTTP_PATCH), _onRequest(onRequest), _maxContentLength(16384), _maxJsonBufferSize(maxJsonBufferSize) {}
   void setMethod(WebRequestMethodComposite method){ _method = method; }
   void setMaxContentLength(int maxContentLength){ _maxContentLength = maxContentLength; }
+  void setMaxJsonBufferSize(size_t maxJsonBufferSize){ _maxJsonBufferSize = maxJsonBufferSize; }
   void onRequest(ArJsonRequestHandlerFunction fn){ _onRequest = fn; }
-
   virtual bool canHandle(AsyncWebServerRequest *request) override final{
     if(!_onRequest)
       return false;
@@ -130,17 +165,22 @@ public:
     return true;
   }
 
+  virtual WebRouteKind route(String& uri) const override final {
+    if(!_onRequest || !_uri.length())
+      return WEB_ROUTE_ANY;
+    uri = _uri;
+    return WEB_ROUTE_PATH;
+  }
+
   virtual void handleRequest(AsyncWebServerRequest *request) override final {
     if(_onRequest) {
-      if (request->_tempObject != NULL) {
-        DynamicJsonBuffer jsonBuffer;
-        JsonVariant json = jsonBuffer.parse((uint8_t*)(request->_tempObject));
-        if (json.success()) {
-          _onRequest(request, json);
-          return;
-        }
+      AsyncJsonRequestBody* body = (AsyncJsonRequestBody*)(request->_tempObject);
+      if (body != NULL && !body->parser.end()) {
+        JsonVariant json = body->as<JsonVariant>();
+        _onRequest(request, json);
+        return;
       }
-      request->send(_contentLength > _maxContentLength ? 413 : 400);
+      request->send(request->contentLength() > _maxContentLength ? 413 : 400);
     } else {
       request->send(500);
     }
@@ -149,12 +189,11 @@ public:
   }
   virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override final {
     if (_onRequest) {
-      _contentLength = total;
-      if (total > 0 && request->_tempObject == NULL && total < _maxContentLength) {
-        request->_tempObject = malloc(total);
+      if (index == 0 && request->_tempObject == NULL && total <= _maxContentLength) {
+        request->_tempObject = AsyncJsonRequestBody::create(_maxJsonBufferSize);
       }
       if (request->_tempObject != NULL) {
-        memcpy((uint8_t*)(request->_tempObject) + index, data, len);
+        ((AsyncJsonRequestBody*)(request->_tempObject))->parser.feed(data, len);
       }
     }
   }
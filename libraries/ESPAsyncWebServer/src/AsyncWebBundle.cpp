@@ -0,0 +1,177 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "AsyncWebBundle.h"
+#include "WebResponseImpl.h"
+
+#ifdef ESP32
+#include "esp_partition.h"
+#endif
+
+static const char * _encodingNames[] = { NULL, "gzip", "br" };
+
+// FNV-1a, must match fnv1a() in bundle.js
+static uint32_t _bundleHash(const char * str){
+  uint32_t hash = 0x811c9dc5;
+  while(*str){
+    hash ^= (uint8_t)*str++;
+    hash *= 0x01000193;
+  }
+  return hash;
+}
+
+AsyncWebBundleHandler::AsyncWebBundleHandler(const char* uri, const uint8_t* bundle)
+  : _bundle(bundle), _count(0), _uri(uri), _default_file("index.html"), _cache_control()
+{
+  // Ensure leading '/' and remove the trailing one, root will be ""
+  if (_uri.length() == 0 || _uri[0] != '/') _uri = "/" + _uri;
+  if (_uri[_uri.length()-1] == '/') _uri = _uri.substring(0, _uri.length()-1);
+
+  if(_bundle == NULL)
+    return;
+  web_bundle_header_t header;
+  memcpy_P(&header, _bundle, sizeof(header));
+  if(header.magic == WEB_BUNDLE_MAGIC && header.version == WEB_BUNDLE_VERSION)
+    _count = header.count;
+}
+
+AsyncWebBundleHandler& AsyncWebBundleHandler::setDefaultFile(const char* filename){
+  _default_file = String(filename);
+  return *this;
+}
+
+AsyncWebBundleHandler& AsyncWebBundleHandler::setCacheControl(const char* cache_control){
+  _cache_control = String(cache_control);
+  return *this;
+}
+
+void AsyncWebBundleHandler::_readEntry(uint16_t index, web_bundle_entry_t* entry) const {
+  memcpy_P(entry, _bundle + sizeof(web_bundle_header_t) + index * sizeof(web_bundle_entry_t), sizeof(web_bundle_entry_t));
+}
+
+bool AsyncWebBundleHandler::_find(const String& path, web_bundle_entry_t* entry, bool* varies, AsyncWebServerRequest *request) const {
+  const uint32_t hash = _bundleHash(path.c_str());
+  web_bundle_entry_t e;
+
+  // Lower bound of the hash, variants of one path are adjacent and ordered by encoding
+  uint16_t lo = 0, hi = _count;
+  while(lo < hi){
+    uint16_t mid = lo + (hi - lo) / 2;
+    _readEntry(mid, &e);
+    if(e.hash < hash) lo = mid + 1;
+    else hi = mid;
+  }
+
+  bool found = false;
+  uint8_t variants = 0;
+  for(uint16_t i = lo; i < _count; i++){
+    _readEntry(i, &e);
+    if(e.hash != hash)
+      break;
+    if(strcmp_P(path.c_str(), (PGM_P)(_bundle + e.path)) != 0)
+      continue;
+    variants++;
+    // The first variant is the fallback, a later one wins if the client accepts it
+    if(!found || (request && e.encoding != WEB_BUNDLE_IDENTITY && request->acceptsEncoding(_encodingNames[e.encoding]))){
+      *entry = e;
+      found = true;
+    }
+  }
+  if(varies)
+    *varies = variants > 1;
+  return found;
+}
+
+String AsyncWebBundleHandler::_path(AsyncWebServerRequest *request) const {
+  String path = request->url().substring(_uri.length());
+  if(path.length() == 0 || path[path.length()-1] == '/'){
+    if(path.length() == 0)
+      path = "/";
+    path += _default_file;
+  }
+  return path;
+}
+
+bool AsyncWebBundleHandler::canHandle(AsyncWebServerRequest *request){
+  if(!_count
+    || request->method() != HTTP_GET
+    || !request->url().startsWith(_uri)
+    || !request->isExpectedRequestedConnType(RCT_DEFAULT, RCT_HTTP)
+  ){
+    return false;
+  }
+  web_bundle_entry_t entry;
+  if(!_find(_path(request), &entry, NULL, NULL))
+    return false;
+
+  request->addInterestingHeader("Accept-Encoding");
+  request->addInterestingHeader("If-None-Match");
+  return true;
+}
+
+void AsyncWebBundleHandler::handleRequest(AsyncWebServerRequest *request){
+  if((_username != "" && _password != "") && !request->authenticate(_username.c_str(), _password.c_str()))
+    return request->requestAuthentication();
+
+  web_bundle_entry_t entry;
+  bool varies = false;
+  if(!_find(_path(request), &entry, &varies, request))
+    return request->send(404);
+
+  // Strong validator per representation: content hash plus encoding
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%08x-%u\"", entry.etag, entry.encoding);
+
+  AsyncWebServerResponse * response;
+  if(request->header("If-None-Match").equals(etag)){
+    response = new AsyncBasicResponse(304); // Not modified
+  } else {
+    response = request->beginResponse_P(200, String(FPSTR(_bundle + entry.type)), _bundle + entry.offset, entry.length);
+    if(entry.encoding != WEB_BUNDLE_IDENTITY)
+      response->addHeader("Content-Encoding", _encodingNames[entry.encoding]);
+  }
+  if(varies)
+    response->addHeader("Vary", "Accept-Encoding");
+  if(_cache_control.length())
+    response->addHeader("Cache-Control", _cache_control);
+  response->addHeader("ETag", etag);
+  request->send(response);
+}
+
+#ifdef ESP32
+const uint8_t* AsyncWebBundleHandler::mapPartition(const char* label){
+  const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if(partition == NULL)
+    return NULL;
+
+  const void* ptr = NULL;
+  spi_flash_mmap_handle_t handle;
+  if(esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK)
+    return NULL;
+
+  const web_bundle_header_t* header = (const web_bundle_header_t*)ptr;
+  if(header->magic != WEB_BUNDLE_MAGIC || header->version != WEB_BUNDLE_VERSION || header->size > partition->size){
+    spi_flash_munmap(handle);
+    return NULL;
+  }
+  // The mapping lives for the rest of the program, like a PROGMEM array would
+  return (const uint8_t*)ptr;
+}
+#endif
@@ -0,0 +1,85 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBBUNDLE_H_
+#define ASYNCWEBBUNDLE_H_
+
+#include <ESPAsyncWebServer.h>
+
+/*
+ * BUNDLE :: Read-only web directory packed into one flash blob by ESP-DASH/vue-frontend/bundle.js
+ *
+ * The blob is either linked in as a PROGMEM array or flashed into a data partition.
+ * Every file is stored precompressed (gzip, plus brotli when smaller), identical payloads
+ * are stored once, and the entry table is sorted by path hash so a lookup is a binary search
+ * over flash without mounting any filesystem.
+ * */
+
+#define WEB_BUNDLE_MAGIC   0x31425741 // "AWB1"
+#define WEB_BUNDLE_VERSION 1
+
+typedef enum { WEB_BUNDLE_IDENTITY = 0, WEB_BUNDLE_GZIP = 1, WEB_BUNDLE_BROTLI = 2 } WebBundleEncoding;
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t size;
+  uint32_t reserved;
+} web_bundle_header_t;
+
+typedef struct {
+  uint32_t hash;     // FNV-1a of the path
+  uint32_t path;     // offset of NUL terminated path
+  uint32_t type;     // offset of NUL terminated content type
+  uint32_t offset;   // offset of the payload
+  uint32_t length;   // payload length
+  uint32_t etag;     // FNV-1a of the uncompressed content
+  uint8_t encoding;  // WebBundleEncoding
+  uint8_t reserved[3];
+} web_bundle_entry_t;
+
+class AsyncWebBundleHandler: public AsyncWebHandler {
+  private:
+    const uint8_t* _bundle;
+    uint16_t _count;
+    String _uri;
+    String _default_file;
+    String _cache_control;
+    void _readEntry(uint16_t index, web_bundle_entry_t* entry) const;
+    bool _find(const String& path, web_bundle_entry_t* entry, bool* varies, AsyncWebServerRequest *request) const;
+    String _path(AsyncWebServerRequest *request) const;
+  public:
+    AsyncWebBundleHandler(const char* uri, const uint8_t* bundle);
+    bool valid() const { return _count != 0; }
+    size_t count() const { return _count; }
+    AsyncWebBundleHandler& setDefaultFile(const char* filename);
+    AsyncWebBundleHandler& setCacheControl(const char* cache_control);
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual WebRouteKind route(String& uri) const override final { uri = _uri; return WEB_ROUTE_PREFIX; }
+
+#ifdef ESP32
+    // Memory-map a data partition flashed with a .bin bundle, returns NULL if missing or invalid
+    static const uint8_t* mapPartition(const char* label);
+#endif
+};
+
+#endif /* ASYNCWEBBUNDLE_H_ */
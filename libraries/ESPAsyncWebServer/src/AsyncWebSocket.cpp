@@ -20,6 +20,7 @@
 */
 #include "Arduino.h"
 #include "AsyncWebSocket.h"
+#include "AsyncWebSocketDeflate.h"
 
 #include <libb64/cencode.h>
 
@@ -42,6 +43,14 @@ void SHA1Final(unsigned char digest[20], SHA1_CTX* context);
 
 #define MAX_PRINTF_LEN 64
 
+// Set on the first frame of a compressed message
+#define WS_RSV1 0x40
+
+// Frames up to this payload size are assembled on the stack, larger ones on the heap
+#ifndef WS_FRAME_INLINE_SIZE
+#define WS_FRAME_INLINE_SIZE 256
+#endif
+
 size_t webSocketSendFrameWindow(AsyncClient *client){
   if(!client->canSend())
     return 0;
@@ -51,6 +60,32 @@ size_t webSocketSendFrameWindow(AsyncClient *client){
   return space - 8;
 }
 
+// XOR data with the mask, offset is the position of data[0] in the masked payload
+void webSocketMask(uint8_t *data, size_t len, const uint8_t *mask, size_t offset){
+  // Bytes up to the first word boundary
+  while(len && ((uintptr_t)data & 3)){
+    *data++ ^= mask[offset++ & 3];
+    len--;
+  }
+  if(len >= 4){
+    // The mask rotated to line up with the aligned words
+    uint8_t rotated[4];
+    for(uint8_t i = 0; i < 4; i++)
+      rotated[i] = mask[(offset + i) & 3];
+    uint32_t word;
+    memcpy(&word, rotated, 4);
+    uint32_t *words = (uint32_t *)data;
+    size_t count = len >> 2;
+    for(size_t i = 0; i < count; i++)
+      words[i] ^= word;
+    data += count << 2;
+    len &= 3;
+  }
+  // Tail, the mask phase is unchanged by whole words
+  while(len--)
+    *data++ ^= mask[offset++ & 3];
+}
+
 size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool mask, uint8_t *data, size_t len){
   if(!client->canSend())
     return 0;
@@ -68,19 +103,22 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
   }
   if(len > 125)
     headLen += 2;
-  if(space < headLen)
+  // The frame is queued whole or not at all, a caller can try it again as it was
+  if(space < headLen + len)
     return 0;
-  space -= headLen;
-
-  if(len > space) len = space;
 
-  uint8_t *buf = (uint8_t*)malloc(headLen);
-  if(buf == NULL){
-    //os_printf("could not malloc %u bytes for frame header\n", headLen);
-    return 0;
+  // Assembled in one piece for a single add(), which takes all of it or nothing.
+  // A masked payload is masked in the copy, the caller's data stays as it is
+  // for a retry after a failed add()
+  uint8_t inlineBuf[WS_FRAME_INLINE_SIZE + 8];
+  uint8_t *buf = inlineBuf;
+  if(len > WS_FRAME_INLINE_SIZE){
+    buf = (uint8_t *)malloc(headLen + len);
+    if(!buf)
+      return 0;
   }
 
-  buf[0] = opcode & 0x0F;
+  buf[0] = opcode & (WS_RSV1 | 0x0F);
   if(final)
     buf[0] |= 0x80;
   if(len < 126)
@@ -94,32 +132,37 @@ size_t webSocketSendFrame(AsyncClient *client, bool final, uint8_t opcode, bool
     buf[1] |= 0x80;
     memcpy(buf + (headLen - 4), mbuf, 4);
   }
-  if(client->add((const char *)buf, headLen) != headLen){
-    //os_printf("error adding %lu header bytes\n", headLen);
-    free(buf);
-    return 0;
-  }
-  free(buf);
 
   if(len){
-    if(len && mask){
-      size_t i;
-      for(i=0;i<len;i++)
-        data[i] = data[i] ^ mbuf[i%4];
-    }
-    if(client->add((const char *)data, len) != len){
-      //os_printf("error adding %lu data bytes\n", len);
-      return 0;
-    }
+    memcpy(buf + headLen, data, len);
+    if(mask)
+      webSocketMask(buf + headLen, len, mbuf, 0);
   }
+  size_t added = client->add((const char *)buf, headLen + len);
+  if(buf != inlineBuf)
+    free(buf);
+  if(added != headLen + len){
+    //os_printf("error adding %lu frame bytes\n", headLen + len);
+    return 0;
+  }
+  // Queued is sent, the stack pushes it out with the next output
   if(!client->send()){
     //os_printf("error sending frame: %lu\n", headLen+len);
-    return 0;
   }
   return len;
 }
 
 
+#if ASYNC_WEB_LOCKING
+// Reference counts of the buffers and messages that clients on several workers share
+static portMUX_TYPE _wsRefMux = portMUX_INITIALIZER_UNLOCKED;
+#define WS_REF_LOCK()   portENTER_CRITICAL(&_wsRefMux)
+#define WS_REF_UNLOCK() portEXIT_CRITICAL(&_wsRefMux)
+#else
+#define WS_REF_LOCK()
+#define WS_REF_UNLOCK()
+#endif
+
 /*
  *    AsyncWebSocketMessageBuffer
  */
@@ -131,6 +174,9 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer()
   ,_len(0)
   ,_lock(false)
   ,_count(0)
+  ,_headLen(0)
+  ,_framed(WS_NOT_FRAMED)
+  ,_owned(false)
 {
 
 }
@@ -140,17 +186,17 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(uint8_t * data, size_t
   ,_len(size)
   ,_lock(false)
   ,_count(0)
+  ,_headLen(0)
+  ,_framed(WS_NOT_FRAMED)
+  ,_owned(false)
 {
 
   if (!data) {
     return; 
   }
 
-  _data = new uint8_t[_len + 1];
-
-  if (_data) {
+  if (_alloc(_len)) {
     memcpy(_data, data, _len);
-    _data[_len] = 0; 
   }
 }
 
@@ -160,13 +206,11 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(size_t size)
   ,_len(size)
   ,_lock(false)
   ,_count(0)
+  ,_headLen(0)
+  ,_framed(WS_NOT_FRAMED)
+  ,_owned(false)
 {
-  _data = new uint8_t[_len + 1]; 
-
-  if (_data) {
-    _data[_len] = 0; 
-  }
-  
+  _alloc(_len);
 }
 
 AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(const AsyncWebSocketMessageBuffer & copy)
@@ -174,19 +218,16 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(const AsyncWebSocketMes
   ,_len(0)
   ,_lock(false)
   ,_count(0)
+  ,_headLen(0)
+  ,_framed(WS_NOT_FRAMED)
+  ,_owned(false)
 {
   _len = copy._len;
   _lock = copy._lock;
   _count = 0;
 
-  if (_len) {
-    _data = new uint8_t[_len + 1]; 
-    _data[_len] = 0; 
-  } 
-
-  if (_data) {
+  if (_len && _alloc(_len) && copy._data) {
     memcpy(_data, copy._data, _len);
-    _data[_len] = 0; 
   }
 
 }
@@ -196,6 +237,9 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(AsyncWebSocketMessageBu
   ,_len(0)
   ,_lock(false)
   ,_count(0)
+  ,_headLen(0)
+  ,_framed(WS_NOT_FRAMED)
+  ,_owned(false)
 {
   _len = copy._len;
   _lock = copy._lock;
@@ -203,6 +247,8 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(AsyncWebSocketMessageBu
 
   if (copy._data) {
     _data = copy._data; 
+    _headLen = copy._headLen;
+    _framed = copy._framed;
     copy._data = nullptr; 
   } 
 
@@ -211,28 +257,90 @@ AsyncWebSocketMessageBuffer::AsyncWebSocketMessageBuffer(AsyncWebSocketMessageBu
 AsyncWebSocketMessageBuffer::~AsyncWebSocketMessageBuffer()
 {
     if (_data) {
-      delete[] _data; 
+      delete[] (_data - WS_FRAME_HEADROOM); 
     }
 }
 
+bool AsyncWebSocketMessageBuffer::_alloc(size_t size)
+{
+  // The data is preceded by room for the frame header and followed by a NUL
+  uint8_t * storage = new uint8_t[WS_FRAME_HEADROOM + size + 1];
+  if (!storage) {
+    _data = nullptr;
+    return false;
+  }
+  _data = storage + WS_FRAME_HEADROOM;
+  _data[size] = 0;
+  _headLen = 0;
+  _framed = WS_NOT_FRAMED;
+  return true;
+}
+
 bool AsyncWebSocketMessageBuffer::reserve(size_t size) 
 {
   _len = size; 
 
   if (_data) {
-    delete[] _data;
+    delete[] (_data - WS_FRAME_HEADROOM);
     _data = nullptr; 
   }
 
-  _data = new uint8_t[_len + 1];
+  return _alloc(_len);
+}
 
-  if (_data) {
-    _data[_len] = 0;
-    return true; 
+bool AsyncWebSocketMessageBuffer::_frame(uint8_t opcode)
+{
+  if (!_data || _len > 0xFFFF) {
+    return false;
+  }
+  if (_framed == opcode) {
+    return true;
+  }
+  // Messages still sending the old header would see it change
+  if (_count) {
+    return false;
+  }
+  _headLen = (_len < 126) ? 2 : 4;
+  uint8_t * head = _data - _headLen;
+  head[0] = 0x80 | (opcode & 0x0F);
+  if (_len < 126) {
+    head[1] = _len;
   } else {
-    return false; 
+    head[1] = 126;
+    head[2] = (uint8_t)((_len >> 8) & 0xFF);
+    head[3] = (uint8_t)(_len & 0xFF);
   }
+  _framed = opcode;
+  return true;
+}
+
+void AsyncWebSocketMessageBuffer::operator ++(int i)
+{
+  WS_REF_LOCK();
+  _count++;
+  WS_REF_UNLOCK();
+}
+
+void AsyncWebSocketMessageBuffer::operator --(int i)
+{
+  WS_REF_LOCK();
+  if (_count > 0) {
+    _count--;
+  }
+  WS_REF_UNLOCK();
+}
 
+void AsyncWebSocketMessageBuffer::_release()
+{
+  WS_REF_LOCK();
+  if (_count > 0) {
+    _count--;
+  }
+  bool last = _owned && canDelete();
+  WS_REF_UNLOCK();
+  if (last) {
+    delete this;
+  }
 }
 
 
@@ -279,19 +387,95 @@ class AsyncWebSocketControl {
     }
 };
 
+/*
+ * Message, shared by the clients it was queued for
+ */
+
+void AsyncWebSocketMessage::retain(){
+  WS_REF_LOCK();
+  _refs++;
+  WS_REF_UNLOCK();
+}
+
+void AsyncWebSocketMessage::release(){
+  WS_REF_LOCK();
+  bool last = !--_refs;
+  WS_REF_UNLOCK();
+  if(last)
+    delete this;
+}
+
+void AsyncWebSocketMessage::begin(AsyncWebSocketProgress &progress, AsyncWebSocketDeflater *deflater){
+  progress.data = _data;
+  progress.len = _len;
+  progress.sent = 0;
+  progress.ack = 0;
+  progress.acked = 0;
+  progress.deflated = false;
+  progress.started = true;
+  if(deflater && _status == WS_MSG_SENDING){
+    // Every client has its own compression context, the compressed copy is the client's own
+    uint8_t * compressed;
+    size_t len = deflater->compress(_data, _len, &compressed);
+    if(len){
+      progress.data = compressed;
+      progress.len = len;
+      progress.deflated = true;
+    }
+  }
+}
+
+size_t AsyncWebSocketMessage::send(AsyncClient *client, AsyncWebSocketProgress &progress){
+  if(_status != WS_MSG_SENDING || !progress.started)
+    return 0;
+  if(progress.acked < progress.ack){
+    return 0;
+  }
+  if(progress.sent >= progress.len){
+    return 0;
+  }
+
+  // A frame built once for every client goes out in one piece if it fits
+  size_t frameLen;
+  const uint8_t * frame = (progress.sent == 0 && !_mask && !progress.deflated) ? _frame(&frameLen) : NULL;
+  if(frame && client->canSend() && client->space() >= frameLen && client->add((const char *)frame, frameLen) == frameLen){
+    progress.sent = progress.len;
+    progress.ack += frameLen;
+    client->send();
+    return progress.len;
+  }
+
+  size_t toSend = progress.len - progress.sent;
+  size_t window = webSocketSendFrameWindow(client);
+
+  if(window < toSend) {
+      toSend = window;
+  }
+
+  size_t frameAck = toSend + ((toSend < 126)?2:4) + (_mask * 4);
+  bool final = (progress.sent + toSend == progress.len);
+  uint8_t* dPtr = progress.data + progress.sent;
+  uint8_t opCode = (progress.sent == 0)?(uint8_t)(_opcode | (progress.deflated ? WS_RSV1 : 0)):(uint8_t)WS_CONTINUATION;
+
+  size_t sent = webSocketSendFrame(client, final, opCode, _mask, dPtr, toSend);
+  // Nothing of a failed frame was queued, it is tried again from the same place
+  if(toSend && sent == toSend){
+    progress.sent += toSend;
+    progress.ack += frameAck;
+  }
+  return sent;
+}
+
 /*
  * Basic Buffered Message
  */
 
 
 AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(const char * data, size_t len, uint8_t opcode, bool mask)
-  :_len(len)
-  ,_sent(0)
-  ,_ack(0)
-  ,_acked(0)
 {
   _opcode = opcode & 0x07;
   _mask = mask;
+  _len = len;
   _data = (uint8_t*)malloc(_len+1);
   if(_data == NULL){
     _len = 0;
@@ -303,11 +487,6 @@ AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(const char * data, size_t
   }
 }
 AsyncWebSocketBasicMessage::AsyncWebSocketBasicMessage(uint8_t opcode, bool mask)
-  :_len(0)
-  ,_sent(0)
-  ,_ack(0)
-  ,_acked(0)
-  ,_data(NULL)
 {
   _opcode = opcode & 0x07;
   _mask = mask;
@@ -320,64 +499,6 @@ AsyncWebSocketBasicMessage::~AsyncWebSocketBasicMessage() {
     free(_data);
 }
 
- void AsyncWebSocketBasicMessage::ack(size_t len, uint32_t time)  {
-  _acked += len;
-  if(_sent == _len && _acked == _ack){
-    _status = WS_MSG_SENT;
-  }
-}
- size_t AsyncWebSocketBasicMessage::send(AsyncClient *client)  {
-  if(_status != WS_MSG_SENDING)
-    return 0;
-  if(_acked < _ack){
-    return 0;
-  }
-  if(_sent == _len){
-    if(_acked == _ack)
-      _status = WS_MSG_SENT;
-    return 0;
-  }
-  if(_sent > _len){
-      _status = WS_MSG_ERROR;
-      return 0;
-  }
-
-  size_t toSend = _len - _sent;
-  size_t window = webSocketSendFrameWindow(client);
-
-  if(window < toSend) {
-      toSend = window;
-  }
-
-  _sent += toSend;
-  _ack += toSend + ((toSend < 126)?2:4) + (_mask * 4);
-
-  bool final = (_sent == _len);
-  uint8_t* dPtr = (uint8_t*)(_data + (_sent - toSend));
-  uint8_t opCode = (toSend && _sent == toSend)?_opcode:(uint8_t)WS_CONTINUATION;
-
-  size_t sent = webSocketSendFrame(client, final, opCode, _mask, dPtr, toSend);
-  _status = WS_MSG_SENDING;
-  if(toSend && sent != toSend){
-      _sent -= (toSend - sent);
-      _ack -= (toSend - sent);
-  }
-  return sent;
-}
-
-// bool AsyncWebSocketBasicMessage::reserve(size_t size) { 
-//   if (size) {
-//     _data = (uint8_t*)malloc(size +1);
-//     if (_data) {
-//       memset(_data, 0, size); 
-//       _len = size; 
-//       _status = WS_MSG_SENDING;
-//       return true; 
-//     }
-//   }
-//   return false; 
-//  }
-
 
 /*
  * AsyncWebSocketMultiMessage Message
@@ -385,11 +506,7 @@ AsyncWebSocketBasicMessage::~AsyncWebSocketBasicMessage() {
 
 
 AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode, bool mask)
-  :_len(0)
-  ,_sent(0)
-  ,_ack(0)
-  ,_acked(0)
-  ,_WSbuffer(nullptr)
+  :_WSbuffer(nullptr)
 {
 
   _opcode = opcode & 0x07;
@@ -411,58 +528,16 @@ AsyncWebSocketMultiMessage::AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuff
 
 AsyncWebSocketMultiMessage::~AsyncWebSocketMultiMessage() {
   if (_WSbuffer) {
-    (*_WSbuffer)--; // decreases the counter. 
+    _WSbuffer->_release(); // decreases the counter, the last one frees the buffer
   }
 }
 
- void AsyncWebSocketMultiMessage::ack(size_t len, uint32_t time)  {
-  _acked += len;
-  if(_sent >= _len && _acked >= _ack){
-    _status = WS_MSG_SENT;
+const uint8_t * AsyncWebSocketMultiMessage::_frame(size_t *frameLen) const {
+  if (!_WSbuffer || _WSbuffer->_framedOpcode() != _opcode) {
+    return NULL;
   }
-  //ets_printf("A: %u\n", len);
-}
- size_t AsyncWebSocketMultiMessage::send(AsyncClient *client)  {
-  if(_status != WS_MSG_SENDING)
-    return 0;
-  if(_acked < _ack){
-    return 0;
-  }
-  if(_sent == _len){
-    _status = WS_MSG_SENT;
-    return 0;
-  }
-  if(_sent > _len){
-      _status = WS_MSG_ERROR;
-      //ets_printf("E: %u > %u\n", _sent, _len);
-      return 0;
-  }
-
-  size_t toSend = _len - _sent;
-  size_t window = webSocketSendFrameWindow(client);
-
-  if(window < toSend) {
-      toSend = window;
-  }
-
-  _sent += toSend;
-  _ack += toSend + ((toSend < 126)?2:4) + (_mask * 4);
-
-  //ets_printf("W: %u %u\n", _sent - toSend, toSend);
-
-  bool final = (_sent == _len);
-  uint8_t* dPtr = (uint8_t*)(_data + (_sent - toSend));
-  uint8_t opCode = (toSend && _sent == toSend)?_opcode:(uint8_t)WS_CONTINUATION;
-
-  size_t sent = webSocketSendFrame(client, final, opCode, _mask, dPtr, toSend);
-  _status = WS_MSG_SENDING;
-  if(toSend && sent != toSend){
-      //ets_printf("E: %u != %u\n", toSend, sent);
-      _sent -= (toSend - sent);
-      _ack -= (toSend - sent);
-  }
-  //ets_printf("S: %u %u\n", _sent, sent);
-  return sent;
+  *frameLen = _WSbuffer->_frameHeadLen() + _len;
+  return _WSbuffer->_frameStart();
 }
 
 
@@ -472,11 +547,14 @@ AsyncWebSocketMultiMessage::~AsyncWebSocketMultiMessage() {
  const char * AWSC_PING_PAYLOAD = "ESPAsyncWebServer-PING";
  const size_t AWSC_PING_PAYLOAD_LEN = 22;
 
-AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server)
+AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server, AsyncWebSocketDeflater *deflater)
   : _controlQueue(LinkedList<AsyncWebSocketControl *>([](AsyncWebSocketControl *c){ delete  c; }))
-  , _messageQueue(LinkedList<AsyncWebSocketMessage *>([](AsyncWebSocketMessage *m){ delete  m; }))
+  , _messageQueue(LinkedList<AsyncWebSocketMessage *>([](AsyncWebSocketMessage *m){ m->release(); }))
   , _tempObject(NULL)
 {
+  _progress.data = NULL;
+  _progress.deflated = false;
+  _progress.started = false;
   _client = request->client();
   _server = server;
   _clientId = _server->_getNextId();
@@ -484,6 +562,21 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _pstate = 0;
   _lastMessageTime = millis();
   _keepAlivePeriod = 0;
+  _queuePolicy = _server->queuePolicy();
+  _slow = false;
+  _fullSince = 0;
+  _dropped = 0;
+  _coalesced = 0;
+  _deflater = deflater;
+  _deflate = (deflater != NULL);
+  _inflating = false;
+  _inflateOpcode = 0;
+  _inflateData = NULL;
+  _inflateLen = 0;
+  _pheadLen = 0;
+  _arena = NULL;
+  _arenaSize = 0;
+  _messageLen = 0;
   _client->setRxTimeout(0);
   _client->onError([](void *r, AsyncClient* c, int8_t error){ ((AsyncWebSocketClient*)(r))->_onError(error); }, this);
   _client->onAck([](void *r, AsyncClient* c, size_t len, uint32_t time){ ((AsyncWebSocketClient*)(r))->_onAck(len, time); }, this);
@@ -497,13 +590,18 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
 }
 
 AsyncWebSocketClient::~AsyncWebSocketClient(){
+  _endMessage();
   _messageQueue.free();
   _controlQueue.free();
+  delete _deflater;
+  free(_inflateData);
+  free(_arena);
   _server->_handleEvent(this, WS_EVT_DISCONNECT, NULL, NULL, 0);
 }
 
 void AsyncWebSocketClient::_onAck(size_t len, uint32_t time){
   _lastMessageTime = millis();
+  _lock.lock();
   if(!_controlQueue.isEmpty()){
     auto head = _controlQueue.front();
     if(head->finished()){
@@ -511,21 +609,29 @@ void AsyncWebSocketClient::_onAck(size_t len, uint32_t time){
       if(_status == WS_DISCONNECTING && head->opcode() == WS_DISCONNECT){
         _controlQueue.remove(head);
         _status = WS_DISCONNECTED;
+        // Closing deletes this client, the lock goes first
+        _lock.unlock();
         _client->close(true);
         return;
       }
       _controlQueue.remove(head);
     }
   }
-  if(len && !_messageQueue.isEmpty()){
-    _messageQueue.front()->ack(len, time);
+  if(len && _progress.started){
+    _progress.acked += len;
   }
-  _server->_cleanBuffers(); 
   _runQueue();
+  _lock.unlock();
 }
 
 void AsyncWebSocketClient::_onPoll(){
+  if(_queuePolicy == WS_QUEUE_BLOCK && _slow && (millis() - _fullSince) >= WS_QUEUE_BLOCK_TIMEOUT){
+    // The peer stopped reading, its queue would hold the senders back for good
+    _client->close(true);
+    return;
+  }
   if(_client->canSend() && (!_controlQueue.isEmpty() || !_messageQueue.isEmpty())){
+    AsyncWebLockGuard l(_lock);
     _runQueue();
   } else if(_keepAlivePeriod > 0 && _controlQueue.isEmpty() && _messageQueue.isEmpty() && (millis() - _lastMessageTime) >= _keepAlivePeriod){
     ping((uint8_t *)AWSC_PING_PAYLOAD, AWSC_PING_PAYLOAD_LEN);
@@ -533,37 +639,88 @@ void AsyncWebSocketClient::_onPoll(){
 }
 
 void AsyncWebSocketClient::_runQueue(){
-  while(!_messageQueue.isEmpty() && _messageQueue.front()->finished()){
+  while(!_messageQueue.isEmpty() && _messageQueue.front()->finished(_progress)){
+    _endMessage();
     _messageQueue.remove(_messageQueue.front());
   }
+  if(_slow && _messageQueue.length() <= WS_MAX_QUEUED_MESSAGES / 2){
+    _slow = false;
+  }
 
-  if(!_controlQueue.isEmpty() && (_messageQueue.isEmpty() || _messageQueue.front()->betweenFrames()) && webSocketSendFrameWindow(_client) > (size_t)(_controlQueue.front()->len() - 1)){
+  if(!_controlQueue.isEmpty() && _betweenFrames() && webSocketSendFrameWindow(_client) > (size_t)(_controlQueue.front()->len() - 1)){
     _controlQueue.front()->send(_client);
-  } else if(!_messageQueue.isEmpty() && _messageQueue.front()->betweenFrames() && webSocketSendFrameWindow(_client)){
-    _messageQueue.front()->send(_client);
+  } else if(!_messageQueue.isEmpty() && _betweenFrames() && webSocketSendFrameWindow(_client)){
+    if(!_progress.started)
+      _messageQueue.front()->begin(_progress, _deflater);
+    _messageQueue.front()->send(_client, _progress);
   }
 }
 
+// Done with the message at the front of the queue
+void AsyncWebSocketClient::_endMessage(){
+  if(_progress.deflated)
+    free(_progress.data);
+  _progress.data = NULL;
+  _progress.deflated = false;
+  _progress.started = false;
+}
+
 void AsyncWebSocketClient::_queueMessage(AsyncWebSocketMessage *dataMessage){
   if(dataMessage == NULL)
     return;
+  dataMessage->retain();
   if(_status != WS_CONNECTED){
-    delete dataMessage;
+    dataMessage->release();
     return;
   }
-  if(_messageQueue.length() > WS_MAX_QUEUED_MESSAGES){
-      ets_printf("ERROR: Too many messages queued\n");
-      delete dataMessage;
+  _lock.lock();
+  if(_makeRoom(dataMessage)){
+    _messageQueue.add(dataMessage);
   } else {
-      _messageQueue.add(dataMessage);
+    _dropped++;
+    dataMessage->release();
+  }
+  bool filled = queueIsFull() && !_slow;
+  if(filled){
+    _slow = true;
+    _fullSince = millis();
   }
   if(_client->canSend())
     _runQueue();
+  _lock.unlock();
+  // Outside the lock, the handler may send to this client or close it
+  if(filled)
+    _server->_handleSlowClient(this);
+}
+
+// Applies the queue policy before dataMessage is added, false if it has to be dropped
+bool AsyncWebSocketClient::_makeRoom(AsyncWebSocketMessage *dataMessage){
+  uint32_t key = dataMessage->key();
+  if(_queuePolicy == WS_QUEUE_COALESCE && key){
+    if(_messageQueue.remove_first([this, key](AsyncWebSocketMessage * const &m){ return m->key() == key && !_started(m); })){
+      _coalesced++;
+    }
+  }
+  if(!queueIsFull()){
+    return true;
+  }
+  if(_queuePolicy == WS_QUEUE_BLOCK){
+    return _messageQueue.length() < WS_QUEUE_BLOCK_LIMIT;
+  }
+  if(_queuePolicy == WS_QUEUE_DROP_OLDEST || _queuePolicy == WS_QUEUE_COALESCE){
+    if(_messageQueue.remove_first([this](AsyncWebSocketMessage * const &m){ return !_started(m); })){
+      _dropped++;
+      return true;
+    }
+  }
+  // Counted by the caller in droppedMessages(), printing here would stall every broadcast to a slow client
+  return false;
 }
 
 void AsyncWebSocketClient::_queueControl(AsyncWebSocketControl *controlMessage){
   if(controlMessage == NULL)
     return;
+  AsyncWebLockGuard l(_lock);
   _controlQueue.add(controlMessage);
   if(_client->canSend())
     _runQueue();
@@ -610,86 +767,95 @@ void AsyncWebSocketClient::_onDisconnect(){
   _server->_handleDisconnect(this);
 }
 
+// Size of the frame header starting with head, 2 until the first two bytes are known
+static size_t webSocketHeaderLength(const uint8_t *head, size_t have){
+  if(have < 2)
+    return 2;
+  uint8_t len = head[1] & 0x7F;
+  return 2 + ((len == 126) ? 2 : (len == 127) ? 8 : 0) + ((head[1] & 0x80) ? 4 : 0);
+}
+
 void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
   _lastMessageTime = millis();
   uint8_t *data = (uint8_t*)pbuf;
   while(plen > 0){
     if(!_pstate){
-      const uint8_t *fdata = data;
+      // The header may be split over TCP segments, it is collected first
+      size_t headLen;
+      while(plen && _pheadLen < (headLen = webSocketHeaderLength(_phead, _pheadLen))){
+        _phead[_pheadLen++] = *data++;
+        plen--;
+      }
+      headLen = webSocketHeaderLength(_phead, _pheadLen);
+      if(_pheadLen < headLen)
+        return;
+      _pheadLen = 0;
+
+      const uint8_t *fdata = _phead;
       _pinfo.index = 0;
       _pinfo.final = (fdata[0] & 0x80) != 0;
       _pinfo.opcode = fdata[0] & 0x0F;
       _pinfo.masked = (fdata[1] & 0x80) != 0;
       _pinfo.len = fdata[1] & 0x7F;
-      data += 2;
-      plen -= 2;
+      if(_pinfo.opcode == WS_TEXT || _pinfo.opcode == WS_BINARY){
+        // RSV1 on the first frame marks a compressed message
+        _inflating = _deflate && (fdata[0] & WS_RSV1);
+        _inflateOpcode = _pinfo.opcode;
+        _inflateLen = 0;
+      }
       if(_pinfo.len == 126){
         _pinfo.len = fdata[3] | (uint16_t)(fdata[2]) << 8;
-        data += 2;
-        plen -= 2;
       } else if(_pinfo.len == 127){
         _pinfo.len = fdata[9] | (uint16_t)(fdata[8]) << 8 | (uint32_t)(fdata[7]) << 16 | (uint32_t)(fdata[6]) << 24 | (uint64_t)(fdata[5]) << 32 | (uint64_t)(fdata[4]) << 40 | (uint64_t)(fdata[3]) << 48 | (uint64_t)(fdata[2]) << 56;
-        data += 8;
-        plen -= 8;
       }
-
       if(_pinfo.masked){
-        memcpy(_pinfo.mask, data, 4);
-        data += 4;
-        plen -= 4;
+        memcpy(_pinfo.mask, fdata + headLen - 4, 4);
+      }
+      if(_pinfo.opcode < 8){
+        if(_pinfo.opcode){
+          _pinfo.message_opcode = _pinfo.opcode;
+          _pinfo.num = 0;
+        } else _pinfo.num += 1;
+      }
+      if(!plen && _pinfo.len){
+        // The header ended with the segment, the payload comes with the next one
+        _pstate = 1;
+        return;
       }
     }
 
     const size_t datalen = std::min((size_t)(_pinfo.len - _pinfo.index), plen);
-    const auto datalast = data[datalen];
+    const uint8_t datalast = datalen ? data[datalen] : 0;
 
     if(_pinfo.masked){
-      for(size_t i=0;i<datalen;i++)
-        data[i] ^= _pinfo.mask[(_pinfo.index+i)%4];
+      webSocketMask(data, datalen, _pinfo.mask, _pinfo.index);
     }
 
-    if((datalen + _pinfo.index) < _pinfo.len){
-      _pstate = 1;
+    const bool frameDone = (datalen + _pinfo.index) == _pinfo.len;
+    _pstate = frameDone ? 0 : 1;
 
-      if(_pinfo.index == 0){
-        if(_pinfo.opcode){
-          _pinfo.message_opcode = _pinfo.opcode;
-          _pinfo.num = 0;
-        } else _pinfo.num += 1;
-      }
-      _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, (uint8_t*)data, datalen);
-
-      _pinfo.index += datalen;
-    } else if((datalen + _pinfo.index) == _pinfo.len){
-      _pstate = 0;
-      if(_pinfo.opcode == WS_DISCONNECT){
-        if(datalen){
-          uint16_t reasonCode = (uint16_t)(data[0] << 8) + data[1];
-          char * reasonString = (char*)(data+2);
-          if(reasonCode > 1001){
-            _server->_handleEvent(this, WS_EVT_ERROR, (void *)&reasonCode, (uint8_t*)reasonString, strlen(reasonString));
-          }
-        }
-        if(_status == WS_DISCONNECTING){
-          _status = WS_DISCONNECTED;
-          _client->close(true);
-        } else {
-          _status = WS_DISCONNECTING;
-          _queueControl(new AsyncWebSocketControl(WS_DISCONNECT, data, datalen));
-        }
-      } else if(_pinfo.opcode == WS_PING){
-        _queueControl(new AsyncWebSocketControl(WS_PONG, data, datalen));
-      } else if(_pinfo.opcode == WS_PONG){
-        if(datalen != AWSC_PING_PAYLOAD_LEN || memcmp(AWSC_PING_PAYLOAD, data, AWSC_PING_PAYLOAD_LEN) != 0)
-          _server->_handleEvent(this, WS_EVT_PONG, NULL, data, datalen);
-      } else if(_pinfo.opcode < 8){//continuation or text/binary frame
-        _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, data, datalen);
+    if(_pinfo.opcode < 8){//continuation or text/binary frame
+      if(_inflating){
+        _inflateAppend(data, datalen);
+        if(frameDone && _pinfo.final)
+          _inflateMessage();
+      } else {
+        _handleData(data, datalen, frameDone && _pinfo.final);
       }
+    } else if(_pinfo.len > sizeof(_pcontrol)){
+      if(frameDone)
+        close(1002);
     } else {
-      //os_printf("frame error: len: %u, index: %llu, total: %llu\n", datalen, _pinfo.index, _pinfo.len);
-      //what should we do?
-      break;
+      // Control frames are small, a split one is collected and handled once complete
+      uint8_t *payload = data;
+      if(!frameDone || _pinfo.index){
+        memcpy(_pcontrol + _pinfo.index, data, datalen);
+        payload = _pcontrol;
+      }
+      if(frameDone)
+        _handleControl(payload, _pinfo.len);
     }
+    _pinfo.index += datalen;
 
     // restore byte as _handleEvent may have added a null terminator i.e., data[len] = 0;
     if (datalen > 0)
@@ -700,6 +866,156 @@ void AsyncWebSocketClient::_onData(void *pbuf, size_t plen){
   }
 }
 
+void AsyncWebSocketClient::_handleControl(uint8_t *data, size_t datalen){
+  if(_pinfo.opcode == WS_DISCONNECT){
+    if(datalen >= 2){
+      uint16_t reasonCode = (uint16_t)(data[0] << 8) + data[1];
+      if(reasonCode > 1001){
+        // The reason is not null terminated in the frame, it is passed on as a string
+        char reasonString[124];
+        size_t reasonLen = datalen - 2;
+        memcpy(reasonString, data + 2, reasonLen);
+        reasonString[reasonLen] = 0;
+        _server->_handleEvent(this, WS_EVT_ERROR, (void *)&reasonCode, (uint8_t*)reasonString, reasonLen);
+      }
+    }
+    if(_status == WS_DISCONNECTING){
+      _status = WS_DISCONNECTED;
+      _client->close(true);
+    } else {
+      _status = WS_DISCONNECTING;
+      _queueControl(new AsyncWebSocketControl(WS_DISCONNECT, data, datalen));
+    }
+  } else if(_pinfo.opcode == WS_PING){
+    _queueControl(new AsyncWebSocketControl(WS_PONG, data, datalen));
+  } else if(_pinfo.opcode == WS_PONG){
+    if(datalen != AWSC_PING_PAYLOAD_LEN || memcmp(AWSC_PING_PAYLOAD, data, AWSC_PING_PAYLOAD_LEN) != 0)
+      _server->_handleEvent(this, WS_EVT_PONG, NULL, data, datalen);
+  }
+}
+
+// Payload of a text or binary message at _pinfo.index of the current frame, last ends the message
+void AsyncWebSocketClient::_handleData(uint8_t *data, size_t len, bool last){
+  if(_server->_hasMessageStream()){
+    _server->_handleMessageStream(this, _pinfo.message_opcode, data, len, _messageLen, last);
+    _messageLen = last ? 0 : _messageLen + len;
+    return;
+  }
+  size_t max = _server->reassemble();
+  if(!max){
+    _server->_handleEvent(this, WS_EVT_DATA, (void *)&_pinfo, data, len);
+    return;
+  }
+  if(_messageLen > max){
+    // Too long, skipped to its end
+    if(last)
+      _messageLen = 0;
+    return;
+  }
+  if(_messageLen + len > max){
+    _messageLen = last ? 0 : max + 1;
+    close(1009);
+    return;
+  }
+  if(last && _messageLen == 0){
+    // Arrived in one piece, no copy needed, the byte after it is put back by _onData.
+    // An empty message may end the segment, there is no byte after it to use
+    uint8_t empty = 0;
+    if(len)
+      data[len] = 0;
+    _deliverMessage(_pinfo.message_opcode, len ? data : &empty, len);
+    return;
+  }
+  if(_messageLen + len + 1 > _arenaSize){
+    size_t size = _arenaSize ? _arenaSize : WS_REASSEMBLE_CHUNK;
+    while(size < _messageLen + len + 1)
+      size <<= 1;
+    if(size > max + 1)
+      size = max + 1;
+    uint8_t *grown = (uint8_t*)realloc(_arena, size);
+    if(grown == NULL){
+      _messageLen = last ? 0 : max + 1;
+      close(1011);
+      return;
+    }
+    _arena = grown;
+    _arenaSize = size;
+  }
+  memcpy(_arena + _messageLen, data, len);
+  _messageLen += len;
+  if(last){
+    size_t total = _messageLen;
+    _messageLen = 0;
+    _arena[total] = 0;
+    _deliverMessage(_pinfo.message_opcode, _arena, total);
+  }
+}
+
+// A whole message, reassembled or inflated
+void AsyncWebSocketClient::_deliverMessage(uint8_t opcode, uint8_t *data, size_t len){
+  if(_server->_hasMessageStream()){
+    _server->_handleMessageStream(this, opcode, data, len, 0, true);
+    return;
+  }
+  AwsFrameInfo info = _pinfo;
+  info.message_opcode = opcode;
+  info.opcode = opcode;
+  info.num = 0;
+  info.final = 1;
+  info.index = 0;
+  info.len = len;
+  _server->_handleEvent(this, WS_EVT_DATA, (void *)&info, data, len);
+}
+
+// Compressed frames are collected until the message is complete, it then inflates in one piece
+void AsyncWebSocketClient::_inflateAppend(uint8_t *data, size_t len){
+  if(_inflateLen > WS_DEFLATE_MAX_MESSAGE)
+    return; // failed already
+  if(_inflateLen + len > WS_DEFLATE_MAX_MESSAGE){
+    _inflateLen = WS_DEFLATE_MAX_MESSAGE + 1;
+    close(1009);
+    return;
+  }
+  // Room for the 00 00 FF FF tail the sender left out
+  uint8_t *grown = (uint8_t*)realloc(_inflateData, _inflateLen + len + 4);
+  if(grown == NULL){
+    _inflateLen = WS_DEFLATE_MAX_MESSAGE + 1;
+    close(1011);
+    return;
+  }
+  _inflateData = grown;
+  memcpy(_inflateData + _inflateLen, data, len);
+  _inflateLen += len;
+}
+
+void AsyncWebSocketClient::_inflateMessage(){
+  _inflating = false;
+  bool failed = (_inflateLen > WS_DEFLATE_MAX_MESSAGE) || (_inflateData == NULL);
+  uint8_t *out = NULL;
+  size_t outLen = WS_DEFLATE_MAX_MESSAGE;
+  if(!failed){
+    memcpy(_inflateData + _inflateLen, "\x00\x00\xff\xff", 4);
+    out = (uint8_t*)malloc(WS_DEFLATE_MAX_MESSAGE + 1);
+    bool full = false;
+    if(out == NULL){
+      close(1011);
+      failed = true;
+    } else if(!webSocketInflate(_inflateData, _inflateLen + 4, out, &outLen, &full)){
+      // Larger than WS_DEFLATE_MAX_MESSAGE inflated is too big, anything else is corrupt
+      close(full ? 1009 : 1007);
+      failed = true;
+    }
+  }
+  free(_inflateData);
+  _inflateData = NULL;
+  _inflateLen = 0;
+  if(!failed){
+    out[outLen] = 0;
+    _deliverMessage(_inflateOpcode, out, outLen);
+  }
+  free(out);
+}
+
 size_t AsyncWebSocketClient::printf(const char *format, ...) {
   va_list arg;
   va_start(arg, format);
@@ -791,9 +1107,12 @@ void AsyncWebSocketClient::text(const __FlashStringHelper *data){
     free(message);
   }
 }
-void AsyncWebSocketClient::text(AsyncWebSocketMessageBuffer * buffer)
+void AsyncWebSocketClient::text(AsyncWebSocketMessageBuffer * buffer, uint32_t key)
 {
-  _queueMessage(new AsyncWebSocketMultiMessage(buffer));
+  AsyncWebSocketMessage * message = new AsyncWebSocketMultiMessage(buffer);
+  if(message)
+    message->key(key);
+  _queueMessage(message);
 }
 
 void AsyncWebSocketClient::binary(const char * message, size_t len){
@@ -822,9 +1141,12 @@ void AsyncWebSocketClient::binary(const __FlashStringHelper *data, size_t len){
   }
   
 }
-void AsyncWebSocketClient::binary(AsyncWebSocketMessageBuffer * buffer)
+void AsyncWebSocketClient::binary(AsyncWebSocketMessageBuffer * buffer, uint32_t key)
 {
-  _queueMessage(new AsyncWebSocketMultiMessage(buffer, WS_BINARY));
+  AsyncWebSocketMessage * message = new AsyncWebSocketMultiMessage(buffer, WS_BINARY);
+  if(message)
+    message->key(key);
+  _queueMessage(message);
 }
 
 IPAddress AsyncWebSocketClient::remoteIP() {
@@ -851,10 +1173,14 @@ AsyncWebSocket::AsyncWebSocket(const String& url)
   :_url(url)
   ,_clients(LinkedList<AsyncWebSocketClient *>([](AsyncWebSocketClient *c){ delete c; }))
   ,_cNextId(1)
+  ,_queuePolicy(WS_QUEUE_DROP_NEWEST)
+  ,_deflate(false)
+  ,_reassembleLength(0)
   ,_enabled(true)
-  ,_buffers(LinkedList<AsyncWebSocketMessageBuffer *>([](AsyncWebSocketMessageBuffer *b){ delete b; }))
 {
   _eventHandler = NULL;
+  _slowClientHandler = NULL;
+  _messageStreamHandler = NULL;
 }
 
 AsyncWebSocket::~AsyncWebSocket(){}
@@ -865,11 +1191,23 @@ void AsyncWebSocket::_handleEvent(AsyncWebSocketClient * client, AwsEventType ty
   }
 }
 
+void AsyncWebSocket::_handleMessageStream(AsyncWebSocketClient * client, uint8_t opcode, uint8_t *data, size_t len, size_t index, bool final){
+  _messageStreamHandler(this, client, opcode, data, len, index, final);
+}
+
+void AsyncWebSocket::_handleSlowClient(AsyncWebSocketClient * client){
+  if(_slowClientHandler != NULL){
+    _slowClientHandler(this, client, client->queueLength());
+  }
+}
+
 void AsyncWebSocket::_addClient(AsyncWebSocketClient * client){
+  AsyncWebLockGuard l(_lock);
   _clients.add(client);
 }
 
 void AsyncWebSocket::_handleDisconnect(AsyncWebSocketClient * client){
+  AsyncWebLockGuard l(_lock);
   
   _clients.remove_first([=](AsyncWebSocketClient * c){
     return c->id() == client->id();
@@ -877,12 +1215,14 @@ void AsyncWebSocket::_handleDisconnect(AsyncWebSocketClient * client){
 }
 
 size_t AsyncWebSocket::count() const {
+  AsyncWebLockGuard l(_lock);
   return _clients.count_if([](AsyncWebSocketClient * c){
     return c->status() == WS_CONNECTED;
   });
 }
 
 AsyncWebSocketClient * AsyncWebSocket::client(uint32_t id){
+  AsyncWebLockGuard l(_lock);
   for(const auto &c: _clients){
     if(c->id() == id && c->status() == WS_CONNECTED){
       return c;
@@ -893,12 +1233,14 @@ AsyncWebSocketClient * AsyncWebSocket::client(uint32_t id){
 
 
 void AsyncWebSocket::close(uint32_t id, uint16_t code, const char * message){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c)
     c->close(code, message);
 }
 
 void AsyncWebSocket::closeAll(uint16_t code, const char * message){
+  AsyncWebLockGuard l(_lock);
   for(const auto& c: _clients){
     if(c->status() == WS_CONNECTED)
       c->close(code, message);
@@ -906,12 +1248,14 @@ void AsyncWebSocket::closeAll(uint16_t code, const char * message){
 }
 
 void AsyncWebSocket::ping(uint32_t id, uint8_t *data, size_t len){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c)
     c->ping(data, len);
 }
 
 void AsyncWebSocket::pingAll(uint8_t *data, size_t len){
+  AsyncWebLockGuard l(_lock);
   for(const auto& c: _clients){
     if(c->status() == WS_CONNECTED)
       c->ping(data, len);
@@ -919,21 +1263,22 @@ void AsyncWebSocket::pingAll(uint8_t *data, size_t len){
 }
 
 void AsyncWebSocket::text(uint32_t id, const char * message, size_t len){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c)
     c->text(message, len);
 }
 
-void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer * buffer){
+void AsyncWebSocket::textAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key){
   if (!buffer) return;
-  buffer->lock(); 
-  for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED){
-        c->text(buffer);
-    }
-  }
-  buffer->unlock();
-  _cleanBuffers(); 
+  buffer->_frame(WS_TEXT);
+  // One message for every client, each keeps its own place in it. The count held here lets
+  // whoever drops the last one free the buffer, even a client that finished on another worker
+  (*buffer)++;
+  AsyncWebSocketMultiMessage * message = new AsyncWebSocketMultiMessage(buffer);
+  message->key(key);
+  messageAll(message);
+  buffer->_release();
 }
 
 
@@ -943,6 +1288,7 @@ void AsyncWebSocket::textAll(const char * message, size_t len){
 }
 
 void AsyncWebSocket::binary(uint32_t id, const char * message, size_t len){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c)
     c->binary(message, len);
@@ -953,33 +1299,40 @@ void AsyncWebSocket::binaryAll(const char * message, size_t len){
   binaryAll(buffer); 
 }
 
-void AsyncWebSocket::binaryAll(AsyncWebSocketMessageBuffer * buffer)
+void AsyncWebSocket::binaryAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key)
 {
   if (!buffer) return;
-  buffer->lock(); 
-    for(const auto& c: _clients){
-    if(c->status() == WS_CONNECTED)
-      c->binary(buffer);
-  }
-  buffer->unlock(); 
-  _cleanBuffers(); 
+  buffer->_frame(WS_BINARY);
+  (*buffer)++;
+  AsyncWebSocketMultiMessage * message = new AsyncWebSocketMultiMessage(buffer, WS_BINARY);
+  message->key(key);
+  messageAll(message);
+  buffer->_release();
 }
 
 void AsyncWebSocket::message(uint32_t id, AsyncWebSocketMessage *message){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c)
     c->message(message);
 }
 
 void AsyncWebSocket::messageAll(AsyncWebSocketMultiMessage *message){
+  if(message == NULL)
+    return;
+  // Held while the clients queue it, deleted here if none of them did
+  message->retain();
+  _lock.lock();
   for(const auto& c: _clients){
     if(c->status() == WS_CONNECTED)
       c->message(message);
   }
-  _cleanBuffers(); 
+  _lock.unlock();
+  message->release();
 }
 
 size_t AsyncWebSocket::printf(uint32_t id, const char *format, ...){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c){
     va_list arg;
@@ -1017,6 +1370,7 @@ size_t AsyncWebSocket::printfAll(const char *format, ...) {
 
 #ifndef ESP32
 size_t AsyncWebSocket::printf_P(uint32_t id, PGM_P formatP, ...){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c != NULL){
     va_list arg;
@@ -1066,6 +1420,7 @@ void AsyncWebSocket::text(uint32_t id, const String &message){
   text(id, message.c_str(), message.length());
 }
 void AsyncWebSocket::text(uint32_t id, const __FlashStringHelper *message){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c != NULL)
     c->text(message);
@@ -1083,6 +1438,7 @@ void AsyncWebSocket::textAll(const String &message){
   textAll(message.c_str(), message.length());
 }
 void AsyncWebSocket::textAll(const __FlashStringHelper *message){
+  AsyncWebLockGuard l(_lock);
   for(const auto& c: _clients){
     if(c->status() == WS_CONNECTED)
       c->text(message);
@@ -1101,6 +1457,7 @@ void AsyncWebSocket::binary(uint32_t id, const String &message){
   binary(id, message.c_str(), message.length());
 }
 void AsyncWebSocket::binary(uint32_t id, const __FlashStringHelper *message, size_t len){
+  AsyncWebLockGuard l(_lock);
   AsyncWebSocketClient * c = client(id);
   if(c != NULL)
     c-> binary(message, len);
@@ -1118,6 +1475,7 @@ void AsyncWebSocket::binaryAll(const String &message){
   binaryAll(message.c_str(), message.length());
 }
 void AsyncWebSocket::binaryAll(const __FlashStringHelper *message, size_t len){
+  AsyncWebLockGuard l(_lock);
   for(const auto& c: _clients){
     if(c->status() == WS_CONNECTED)
       c-> binary(message, len);
@@ -1131,6 +1489,7 @@ const char * WS_STR_VERSION = "Sec-WebSocket-Version";
 const char * WS_STR_KEY = "Sec-WebSocket-Key";
 const char * WS_STR_PROTOCOL = "Sec-WebSocket-Protocol";
 const char * WS_STR_ACCEPT = "Sec-WebSocket-Accept";
+const char * WS_STR_EXTENSIONS = "Sec-WebSocket-Extensions";
 const char * WS_STR_UUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
 bool AsyncWebSocket::canHandle(AsyncWebServerRequest *request){
@@ -1146,6 +1505,7 @@ bool AsyncWebSocket::canHandle(AsyncWebServerRequest *request){
   request->addInterestingHeader(WS_STR_VERSION);
   request->addInterestingHeader(WS_STR_KEY);
   request->addInterestingHeader(WS_STR_PROTOCOL);
+  request->addInterestingHeader(WS_STR_EXTENSIONS);
   return true;
 }
 
@@ -1165,12 +1525,21 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest *request){
     return;
   }
   AsyncWebHeader* key = request->getHeader(WS_STR_KEY);
-  AsyncWebServerResponse *response = new AsyncWebSocketResponse(key->value(), this);
+  AsyncWebSocketResponse *response = new AsyncWebSocketResponse(key->value(), this);
   if(request->hasHeader(WS_STR_PROTOCOL)){
     AsyncWebHeader* protocol = request->getHeader(WS_STR_PROTOCOL);
     //ToDo: check protocol
     response->addHeader(WS_STR_PROTOCOL, protocol->value());
   }
+  if(_deflate && request->hasHeader(WS_STR_EXTENSIONS)){
+    uint8_t windowBits;
+    bool noContextTakeover;
+    String accepted;
+    if(webSocketNegotiateDeflate(request->getHeader(WS_STR_EXTENSIONS)->value(), windowBits, noContextTakeover, accepted)){
+      response->_deflater = new AsyncWebSocketDeflater(windowBits, noContextTakeover);
+      response->addHeader(WS_STR_EXTENSIONS, accepted);
+    }
+  }
   request->send(response);
 }
 
@@ -1178,7 +1547,7 @@ AsyncWebSocketMessageBuffer * AsyncWebSocket::makeBuffer(size_t size)
 {
   AsyncWebSocketMessageBuffer * buffer = new AsyncWebSocketMessageBuffer(size); 
   if (buffer) {
-    _buffers.add(buffer);
+    buffer->_owned = true;
   }
   return buffer; 
 }
@@ -1188,21 +1557,12 @@ AsyncWebSocketMessageBuffer * AsyncWebSocket::makeBuffer(uint8_t * data, size_t
   AsyncWebSocketMessageBuffer * buffer = new AsyncWebSocketMessageBuffer(data, size); 
   
   if (buffer) {
-    _buffers.add(buffer);
+    buffer->_owned = true;
   }
 
   return buffer; 
 }
 
-void AsyncWebSocket::_cleanBuffers()
-{
-  for(AsyncWebSocketMessageBuffer * c: _buffers){
-    if(c && c->canDelete()){
-        _buffers.remove(c);
-    }
-  }
-}
-
 
 /*
  * Response to Web Socket request - sends the authorization and detaches the TCP Client from the web server
@@ -1211,6 +1571,7 @@ void AsyncWebSocket::_cleanBuffers()
 
 AsyncWebSocketResponse::AsyncWebSocketResponse(const String& key, AsyncWebSocket *server){
   _server = server;
+  _deflater = NULL;
   _code = 101;
   _sendContentLength = false;
 
@@ -1255,9 +1616,16 @@ void AsyncWebSocketResponse::_respond(AsyncWebServerRequest *request){
   _state = RESPONSE_WAIT_ACK;
 }
 
+AsyncWebSocketResponse::~AsyncWebSocketResponse(){
+  delete _deflater;
+}
+
 size_t AsyncWebSocketResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time){
   if(len){
-    new AsyncWebSocketClient(request, _server);
+    // The client takes the compressor, and deletes the request and with it this response
+    AsyncWebSocketDeflater *deflater = _deflater;
+    _deflater = NULL;
+    new AsyncWebSocketClient(request, _server, deflater);
   }
   return 0;
 }
@@ -31,10 +31,25 @@
 #endif
 #include <ESPAsyncWebServer.h>
 
+// First size of the buffer a client reassembles messages in, it doubles up to the maximum
+#ifndef WS_REASSEMBLE_CHUNK
+#define WS_REASSEMBLE_CHUNK 128
+#endif
+
+// WS_QUEUE_BLOCK: most messages a client holds even so, and how long (ms) its queue may stay
+// full before the client is closed
+#ifndef WS_QUEUE_BLOCK_LIMIT
+#define WS_QUEUE_BLOCK_LIMIT (2 * WS_MAX_QUEUED_MESSAGES)
+#endif
+#ifndef WS_QUEUE_BLOCK_TIMEOUT
+#define WS_QUEUE_BLOCK_TIMEOUT 10000
+#endif
+
 class AsyncWebSocket;
 class AsyncWebSocketResponse;
 class AsyncWebSocketClient;
 class AsyncWebSocketControl;
+class AsyncWebSocketDeflater;
 
 typedef struct {
     /** Message type as defined by enum AwsFrameType.
@@ -64,6 +79,18 @@ typedef enum { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING } AwsClientStatus
 typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
 typedef enum { WS_MSG_SENDING, WS_MSG_SENT, WS_MSG_ERROR } AwsMessageStatus;
 typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+// What a client does with a new message once WS_MAX_QUEUED_MESSAGES are waiting:
+// WS_QUEUE_DROP_NEWEST  drops the new message
+// WS_QUEUE_DROP_OLDEST  drops the oldest message that has not started sending
+// WS_QUEUE_COALESCE     a message with a key always replaces the waiting one with the same key,
+//                       when still full the oldest is dropped
+// WS_QUEUE_BLOCK        drops nothing up to WS_QUEUE_BLOCK_LIMIT, senders have to check queueIsFull()
+//                       before sending more. A client full for WS_QUEUE_BLOCK_TIMEOUT is closed
+typedef enum { WS_QUEUE_DROP_NEWEST, WS_QUEUE_DROP_OLDEST, WS_QUEUE_COALESCE, WS_QUEUE_BLOCK } AwsQueuePolicy;
+
+// Room kept in front of every message buffer for the frame header, see _frame()
+#define WS_FRAME_HEADROOM 4
+#define WS_NOT_FRAMED 0xFF
 
 class AsyncWebSocketMessageBuffer {
   private:
@@ -71,6 +98,10 @@ class AsyncWebSocketMessageBuffer {
     size_t _len;
     bool _lock; 
     uint32_t _count;  
+    uint8_t _headLen;       // header written in front of _data, 0 if none
+    uint8_t _framed;        // opcode of that header or WS_NOT_FRAMED
+    bool _owned;            // made by makeBuffer(), deletes itself when the last message is done with it
+    bool _alloc(size_t size);
 
   public:
     AsyncWebSocketMessageBuffer();
@@ -79,8 +110,8 @@ class AsyncWebSocketMessageBuffer {
     AsyncWebSocketMessageBuffer(const AsyncWebSocketMessageBuffer &); 
     AsyncWebSocketMessageBuffer(AsyncWebSocketMessageBuffer &&); 
     ~AsyncWebSocketMessageBuffer(); 
-    void operator ++(int i) { _count++; }
-    void operator --(int i) {  if (_count > 0) { _count--; } ;  }
+    void operator ++(int i);
+    void operator --(int i);
     bool reserve(size_t size);
     void lock() { _lock = true; }
     void unlock() { _lock = false; }
@@ -88,55 +119,71 @@ class AsyncWebSocketMessageBuffer {
     size_t length() { return _len; }
     uint32_t count() { return _count; }
     bool canDelete() { return (!_count && !_lock); } 
+    // Write an unmasked final frame header in front of the data, false if it can not be
+    bool _frame(uint8_t opcode);
+    const uint8_t * _frameStart() const { return _data - _headLen; }
+    uint8_t _framedOpcode() const { return _framed; }
+    uint8_t _frameHeadLen() const { return _headLen; }
+    void _release();
 
     friend AsyncWebSocket; 
 
 };
 
+//How far a client got through the message at the front of its queue. A message is shared by every
+//client it was queued for, each of them sends it at its own pace
+struct AsyncWebSocketProgress {
+  uint8_t * data;   // the payload, or this client's compressed copy of it
+  size_t len;
+  size_t sent;
+  size_t ack;
+  size_t acked;
+  bool deflated;
+  bool started;     // set up for sending, the message can not be dropped any more
+};
+
 class AsyncWebSocketMessage {
   protected:
     uint8_t _opcode;
     bool _mask;
     AwsMessageStatus _status;
+    uint32_t _key;
+    uint32_t _refs;
+    uint8_t * _data;
+    size_t _len;
+    //the whole frame if it was built ahead for every client, NULL to frame the payload per client
+    virtual const uint8_t * _frame(size_t *frameLen __attribute__((unused))) const { return NULL; }
   public:
-    AsyncWebSocketMessage():_opcode(WS_TEXT),_mask(false),_status(WS_MSG_ERROR){}
+    AsyncWebSocketMessage():_opcode(WS_TEXT),_mask(false),_status(WS_MSG_ERROR),_key(0),_refs(0),_data(NULL),_len(0){}
     virtual ~AsyncWebSocketMessage(){}
-    virtual void ack(size_t len __attribute__((unused)), uint32_t time __attribute__((unused))){}
-    virtual size_t send(AsyncClient *client __attribute__((unused))){ return 0; }
-    virtual bool finished(){ return _status != WS_MSG_SENDING; }
-    virtual bool betweenFrames() const { return false; }
+    //messages with the same non zero key replace each other in a WS_QUEUE_COALESCE queue
+    void key(uint32_t key){ _key = key; }
+    uint32_t key() const { return _key; }
+    //held by every queue it is in, the last one to let go deletes it
+    void retain();
+    void release();
+    //compresses right before the message starts sending, so the client sees messages in the order they were compressed
+    void begin(AsyncWebSocketProgress &progress, AsyncWebSocketDeflater *deflater);
+    size_t send(AsyncClient *client, AsyncWebSocketProgress &progress);
+    bool finished(const AsyncWebSocketProgress &progress) const {
+      return _status != WS_MSG_SENDING || (progress.started && progress.sent == progress.len && progress.acked >= progress.ack);
+    }
 };
 
 class AsyncWebSocketBasicMessage: public AsyncWebSocketMessage {
-  private:
-    size_t _len;
-    size_t _sent;
-    size_t _ack;
-    size_t _acked;
-    uint8_t * _data;
 public:
     AsyncWebSocketBasicMessage(const char * data, size_t len, uint8_t opcode=WS_TEXT, bool mask=false);
     AsyncWebSocketBasicMessage(uint8_t opcode=WS_TEXT, bool mask=false);
     virtual ~AsyncWebSocketBasicMessage() override;
-    virtual bool betweenFrames() const override { return _acked == _ack; }
-    virtual void ack(size_t len, uint32_t time) override ;
-    virtual size_t send(AsyncClient *client) override ;
 };
 
 class AsyncWebSocketMultiMessage: public AsyncWebSocketMessage {
   private:
-    uint8_t * _data;
-    size_t _len;
-    size_t _sent;
-    size_t _ack;
-    size_t _acked;
     AsyncWebSocketMessageBuffer * _WSbuffer; 
+    virtual const uint8_t * _frame(size_t *frameLen) const override;
 public:
     AsyncWebSocketMultiMessage(AsyncWebSocketMessageBuffer * buffer, uint8_t opcode=WS_TEXT, bool mask=false); 
     virtual ~AsyncWebSocketMultiMessage() override;
-    virtual bool betweenFrames() const override { return _acked == _ack; }
-    virtual void ack(size_t len, uint32_t time) override ;
-    virtual size_t send(AsyncClient *client) override ;
 };
 
 class AsyncWebSocketClient {
@@ -148,13 +195,43 @@ class AsyncWebSocketClient {
 
     LinkedList<AsyncWebSocketControl *> _controlQueue;
     LinkedList<AsyncWebSocketMessage *> _messageQueue;
+    AsyncWebSocketProgress _progress;
+    AsyncWebLock _lock;     // the queues, a broadcast from another worker can queue while this one sends
 
     uint8_t _pstate;
     AwsFrameInfo _pinfo;
+    uint8_t _phead[14];     // header of the next frame while it is incomplete
+    uint8_t _pheadLen;
+    uint8_t _pcontrol[125]; // payload of a split control frame
+    uint8_t *_arena;        // reassembled message, kept for the next one
+    size_t _arenaSize;
+    size_t _messageLen;     // bytes of the current message so far
 
     uint32_t _lastMessageTime;
     uint32_t _keepAlivePeriod;
 
+    AwsQueuePolicy _queuePolicy;
+    bool _slow;
+    uint32_t _fullSince;    // millis() when the queue filled up, while _slow
+    uint32_t _dropped;
+    uint32_t _coalesced;
+
+    AsyncWebSocketDeflater *_deflater;
+    bool _deflate;
+    bool _inflating;
+    uint8_t _inflateOpcode;
+    uint8_t *_inflateData;
+    size_t _inflateLen;
+
+    bool _makeRoom(AsyncWebSocketMessage *dataMessage);
+    bool _started(AsyncWebSocketMessage *m) const { return _progress.started && m == _messageQueue.front(); }
+    bool _betweenFrames() const { return !_progress.started || _progress.acked >= _progress.ack; }
+    void _endMessage();
+    void _inflateAppend(uint8_t *data, size_t len);
+    void _inflateMessage();
+    void _handleControl(uint8_t *data, size_t len);
+    void _handleData(uint8_t *data, size_t len, bool last);
+    void _deliverMessage(uint8_t opcode, uint8_t *data, size_t len);
     void _queueMessage(AsyncWebSocketMessage *dataMessage);
     void _queueControl(AsyncWebSocketControl *controlMessage);
     void _runQueue();
@@ -162,7 +239,7 @@ class AsyncWebSocketClient {
   public:
     void *_tempObject;
 
-    AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server);
+    AsyncWebSocketClient(AsyncWebServerRequest *request, AsyncWebSocket *server, AsyncWebSocketDeflater *deflater=NULL);
     ~AsyncWebSocketClient();
 
     //client id increments for the given server
@@ -171,6 +248,8 @@ class AsyncWebSocketClient {
     AsyncClient* client(){ return _client; }
     AsyncWebSocket *server(){ return _server; }
     AwsFrameInfo const &pinfo() const { return _pinfo; }
+    //permessage-deflate was negotiated
+    bool deflate() const { return _deflate; }
 
     IPAddress remoteIP();
     uint16_t  remotePort();
@@ -187,6 +266,15 @@ class AsyncWebSocketClient {
       return (uint16_t)(_keepAlivePeriod / 1000);
     }
 
+    //what happens to new messages while the queue is full
+    void queuePolicy(AwsQueuePolicy policy){ _queuePolicy = policy; }
+    AwsQueuePolicy queuePolicy() const { return _queuePolicy; }
+    size_t queueLength() const { return _messageQueue.length(); }
+    bool queueIsFull() const { return _messageQueue.length() >= WS_MAX_QUEUED_MESSAGES; }
+    //messages lost to a full queue, and messages replaced by a newer one with the same key
+    uint32_t droppedMessages() const { return _dropped; }
+    uint32_t coalescedMessages() const { return _coalesced; }
+
     //data packets
     void message(AsyncWebSocketMessage *message){ _queueMessage(message); }
 
@@ -200,7 +288,7 @@ class AsyncWebSocketClient {
     void text(char * message);
     void text(const String &message);
     void text(const __FlashStringHelper *data);
-    void text(AsyncWebSocketMessageBuffer *buffer); 
+    void text(AsyncWebSocketMessageBuffer *buffer, uint32_t key=0); 
 
     void binary(const char * message, size_t len);
     void binary(const char * message);
@@ -208,7 +296,7 @@ class AsyncWebSocketClient {
     void binary(char * message);
     void binary(const String &message);
     void binary(const __FlashStringHelper *data, size_t len);
-    void binary(AsyncWebSocketMessageBuffer *buffer); 
+    void binary(AsyncWebSocketMessageBuffer *buffer, uint32_t key=0); 
 
     //system callbacks (do not call)
     void _onAck(size_t len, uint32_t time);
@@ -220,14 +308,22 @@ class AsyncWebSocketClient {
 };
 
 typedef std::function<void(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)> AwsEventHandler;
+typedef std::function<void(AsyncWebSocket * server, AsyncWebSocketClient * client, size_t queued)> AwsSlowClientHandler;
+typedef std::function<void(AsyncWebSocket * server, AsyncWebSocketClient * client, uint8_t opcode, uint8_t *data, size_t len, size_t index, bool final)> AwsMessageStreamHandler;
 
 //WebServer Handler implementation that plays the role of a socket server
 class AsyncWebSocket: public AsyncWebHandler {
   private:
     String _url;
     LinkedList<AsyncWebSocketClient *> _clients;
+    mutable AsyncWebLock _lock; // _clients, held while a broadcast walks it
     uint32_t _cNextId;
     AwsEventHandler _eventHandler;
+    AwsSlowClientHandler _slowClientHandler;
+    AwsMessageStreamHandler _messageStreamHandler;
+    AwsQueuePolicy _queuePolicy;
+    bool _deflate;
+    size_t _reassembleLength;
     bool _enabled;
   public:
     AsyncWebSocket(const String& url);
@@ -259,7 +355,7 @@ class AsyncWebSocket: public AsyncWebHandler {
     void textAll(char * message);
     void textAll(const String &message);
     void textAll(const __FlashStringHelper *message); //  need to convert
-    void textAll(AsyncWebSocketMessageBuffer * buffer); 
+    void textAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key=0); 
 
     void binary(uint32_t id, const char * message, size_t len);
     void binary(uint32_t id, const char * message);
@@ -274,7 +370,7 @@ class AsyncWebSocket: public AsyncWebHandler {
     void binaryAll(char * message);
     void binaryAll(const String &message);
     void binaryAll(const __FlashStringHelper *message, size_t len);
-    void binaryAll(AsyncWebSocketMessageBuffer * buffer); 
+    void binaryAll(AsyncWebSocketMessageBuffer * buffer, uint32_t key=0); 
 
     void message(uint32_t id, AsyncWebSocketMessage *message);
     void messageAll(AsyncWebSocketMultiMessage *message);
@@ -291,20 +387,46 @@ class AsyncWebSocket: public AsyncWebHandler {
       _eventHandler = handler;
     }
 
+    //called once when a client's queue fills up, again after it drained to half
+    void onSlowClient(AwsSlowClientHandler handler){
+      _slowClientHandler = handler;
+    }
+
+    //queue policy of clients that connect from now on
+    void queuePolicy(AwsQueuePolicy policy){ _queuePolicy = policy; }
+    AwsQueuePolicy queuePolicy() const { return _queuePolicy; }
+
+    //accept permessage-deflate from clients that offer it, see AsyncWebSocketDeflate.h
+    void deflate(bool enable){ _deflate = enable; }
+    bool deflate() const { return _deflate; }
+
+    //deliver every text/binary message up to maxLength bytes whole, as a single WS_EVT_DATA, 0 turns it off
+    //longer messages close the connection
+    void reassemble(size_t maxLength){ _reassembleLength = maxLength; }
+    size_t reassemble() const { return _reassembleLength; }
+
+    //messages as a stream instead of WS_EVT_DATA: the payload in order across frames, index is its offset
+    //in the message and final is set on the last part
+    void onMessageStream(AwsMessageStreamHandler handler){
+      _messageStreamHandler = handler;
+    }
+
     //system callbacks (do not call)
-    uint32_t _getNextId(){ return _cNextId++; }
+    uint32_t _getNextId(){ AsyncWebLockGuard l(_lock); return _cNextId++; }
     void _addClient(AsyncWebSocketClient * client);
     void _handleDisconnect(AsyncWebSocketClient * client);
     void _handleEvent(AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len);
+    void _handleSlowClient(AsyncWebSocketClient * client);
+    bool _hasMessageStream() const { return (bool)_messageStreamHandler; }
+    void _handleMessageStream(AsyncWebSocketClient * client, uint8_t opcode, uint8_t *data, size_t len, size_t index, bool final);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual WebRouteKind route(String& uri) const override final { uri = _url; return WEB_ROUTE_EXACT; }
 
 
     //  messagebuffer functions/objects. 
     AsyncWebSocketMessageBuffer * makeBuffer(size_t size = 0); 
     AsyncWebSocketMessageBuffer * makeBuffer(uint8_t * data, size_t size); 
-    LinkedList<AsyncWebSocketMessageBuffer *> _buffers;
-    void _cleanBuffers(); 
 };
 
 //WebServer response to authenticate the socket and detach the tcp client from the web server request
@@ -313,7 +435,9 @@ class AsyncWebSocketResponse: public AsyncWebServerResponse {
     String _content;
     AsyncWebSocket *_server;
   public:
+    AsyncWebSocketDeflater *_deflater;
     AsyncWebSocketResponse(const String& key, AsyncWebSocket *server);
+    ~AsyncWebSocketResponse();
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
     bool _sourceValid() const { return true; }
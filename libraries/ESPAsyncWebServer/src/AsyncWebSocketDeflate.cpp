@@ -0,0 +1,530 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "AsyncWebSocketDeflate.h"
+
+#define WS_DEFLATE_MIN_MATCH 3
+#define WS_DEFLATE_MAX_MATCH 258
+
+static const uint16_t _lengthBase[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const uint8_t _lengthExtra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+static const uint16_t _distanceBase[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const uint8_t _distanceExtra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+/*
+ * Compressor
+ * */
+
+typedef struct {
+  uint8_t *out;
+  size_t pos;
+  uint32_t bits;
+  uint8_t count;
+} deflate_writer_t;
+
+static void _putBits(deflate_writer_t *w, uint32_t value, uint8_t n){
+  w->bits |= value << w->count;
+  w->count += n;
+  while(w->count >= 8){
+    w->out[w->pos++] = w->bits & 0xFF;
+    w->bits >>= 8;
+    w->count -= 8;
+  }
+}
+
+// Huffman codes are stored starting with their most significant bit
+static void _putCode(deflate_writer_t *w, uint32_t code, uint8_t n){
+  uint32_t reversed = 0;
+  for(uint8_t i = 0; i < n; i++){
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  _putBits(w, reversed, n);
+}
+
+// Fixed literal/length code of RFC 1951 3.2.6
+static void _putSymbol(deflate_writer_t *w, uint16_t symbol){
+  if(symbol < 144)
+    _putCode(w, 0x30 + symbol, 8);
+  else if(symbol < 256)
+    _putCode(w, 0x190 + symbol - 144, 9);
+  else if(symbol < 280)
+    _putCode(w, symbol - 256, 7);
+  else
+    _putCode(w, 0xC0 + symbol - 280, 8);
+}
+
+static void _putMatch(deflate_writer_t *w, uint16_t length, uint16_t distance){
+  uint8_t i = 28;
+  while(_lengthBase[i] > length)
+    i--;
+  _putSymbol(w, 257 + i);
+  _putBits(w, length - _lengthBase[i], _lengthExtra[i]);
+  i = 29;
+  while(_distanceBase[i] > distance)
+    i--;
+  _putCode(w, i, 5);
+  _putBits(w, distance - _distanceBase[i], _distanceExtra[i]);
+}
+
+static uint16_t _hash(const uint8_t *data){
+  uint32_t v = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+  return (uint32_t)(v * 2654435761UL) >> (32 - WS_DEFLATE_HASH_BITS);
+}
+
+AsyncWebSocketDeflater::AsyncWebSocketDeflater(uint8_t windowBits, bool noContextTakeover)
+  : _windowBits(windowBits)
+  , _noContextTakeover(noContextTakeover)
+  , _window(NULL)
+  , _head(NULL)
+  , _prev(NULL)
+  , _pos(0)
+{
+  size_t windowSize = 1 << _windowBits;
+  _window = (uint8_t*)malloc(windowSize);
+  _head = (uint32_t*)malloc(sizeof(uint32_t) << WS_DEFLATE_HASH_BITS);
+  _prev = (uint16_t*)malloc(sizeof(uint16_t) * windowSize);
+  if(!_window || !_head || !_prev){
+    free(_window);
+    free(_head);
+    free(_prev);
+    _window = NULL;
+    _head = NULL;
+    _prev = NULL;
+    return;
+  }
+  reset();
+}
+
+AsyncWebSocketDeflater::~AsyncWebSocketDeflater(){
+  free(_window);
+  free(_head);
+  free(_prev);
+}
+
+void AsyncWebSocketDeflater::reset(){
+  // _prev is only reached through _head, so it needs no clearing
+  memset(_head, 0, sizeof(uint32_t) << WS_DEFLATE_HASH_BITS);
+  _pos = 0;
+}
+
+void AsyncWebSocketDeflater::_insert(uint32_t pos, uint16_t hash){
+  uint32_t last = _head[hash];
+  uint32_t distance = last ? pos - (last - 1) : 0;
+  _prev[pos & ((1 << _windowBits) - 1)] = (distance < (1UL << _windowBits)) ? distance : 0;
+  _head[hash] = pos + 1;
+}
+
+size_t AsyncWebSocketDeflater::compress(const uint8_t *data, size_t len, uint8_t **out){
+  *out = NULL;
+  if(!valid() || !len)
+    return 0;
+  if(_noContextTakeover || _pos > 0x7FFFFFFF)
+    reset();
+
+  // Fixed codes never take more than 9 bits for a byte
+  deflate_writer_t w = { (uint8_t*)malloc(len + (len >> 3) + 8), 0, 0, 0 };
+  if(!w.out)
+    return 0;
+
+  const uint32_t windowSize = 1 << _windowBits;
+  const uint32_t start = _pos;
+  _putBits(&w, 2, 3); // not the last block, fixed codes
+  size_t i = 0;
+  while(i < len && w.pos < len){
+    size_t best = 0;
+    uint32_t bestDistance = 0;
+    if(i + 2 < len){
+      uint32_t pos = start + i;
+      uint16_t hash = _hash(data + i);
+      uint32_t candidate = _head[hash];
+      size_t max = len - i;
+      if(max > WS_DEFLATE_MAX_MATCH)
+        max = WS_DEFLATE_MAX_MATCH;
+      for(uint8_t chain = 0; candidate && chain < WS_DEFLATE_CHAIN; chain++){
+        uint32_t c = candidate - 1;
+        uint32_t distance = pos - c;
+        // Older positions have left the window and their _prev slot was reused
+        if(distance >= windowSize)
+          break;
+        size_t length = 0;
+        while(length < max && _byte(c + length, data, start) == data[i + length])
+          length++;
+        if(length > best){
+          best = length;
+          bestDistance = distance;
+          if(length == max)
+            break;
+        }
+        uint16_t back = _prev[c & (windowSize - 1)];
+        if(!back)
+          break;
+        candidate = c - back + 1;
+      }
+      _insert(pos, hash);
+    }
+    if(best >= WS_DEFLATE_MIN_MATCH){
+      _putMatch(&w, best, bestDistance);
+      for(size_t j = i + 1; j < i + best && j + 2 < len; j++)
+        _insert(start + j, _hash(data + j));
+      i += best;
+    } else {
+      _putSymbol(&w, data[i]);
+      i++;
+    }
+  }
+
+  // History for the next message
+  size_t keep = (len < windowSize) ? len : windowSize;
+  for(size_t j = len - keep; j < len; j++)
+    _window[(start + j) & (windowSize - 1)] = data[j];
+  _pos = start + len;
+
+  if(i == len){
+    // End of block and the empty stored block of a sync flush, its 00 00 FF FF is left out
+    _putSymbol(&w, 256);
+    _putBits(&w, 0, 3);
+    if(w.count)
+      _putBits(&w, 0, 8 - w.count);
+  }
+  if(i < len || w.pos >= len){
+    // Sent as it is, the client will not have it in its window
+    free(w.out);
+    reset();
+    return 0;
+  }
+  *out = w.out;
+  return w.pos;
+}
+
+/*
+ * Negotiation
+ * */
+
+static bool _acceptDeflateOffer(const String& offer, uint8_t& windowBits, bool& noContextTakeover, String& response){
+  int semicolon = offer.indexOf(';');
+  String name = offer.substring(0, (semicolon < 0) ? offer.length() : semicolon);
+  name.trim();
+  if(!name.equalsIgnoreCase("permessage-deflate"))
+    return false;
+
+  uint8_t bits = WS_DEFLATE_WINDOW_BITS;
+  bool bitsOffered = false;
+  bool noContext = false;
+  while(semicolon >= 0){
+    int next = offer.indexOf(';', semicolon + 1);
+    String param = offer.substring(semicolon + 1, (next < 0) ? offer.length() : next);
+    semicolon = next;
+    String value;
+    int equals = param.indexOf('=');
+    if(equals >= 0){
+      value = param.substring(equals + 1);
+      value.trim();
+      if(value.length() >= 2 && value.startsWith("\"") && value.endsWith("\""))
+        value = value.substring(1, value.length() - 1);
+      param = param.substring(0, equals);
+    }
+    param.trim();
+    if(param.equalsIgnoreCase("server_no_context_takeover")){
+      if(noContext || equals >= 0)
+        return false;
+      noContext = true;
+    } else if(param.equalsIgnoreCase("client_no_context_takeover")){
+      if(equals >= 0)
+        return false;
+    } else if(param.equalsIgnoreCase("server_max_window_bits")){
+      long n = value.toInt();
+      if(bitsOffered || n < 8 || n > 15)
+        return false;
+      bitsOffered = true;
+      if(n < bits)
+        bits = n;
+    } else if(param.equalsIgnoreCase("client_max_window_bits")){
+      // Without context takeover the client's window does not matter here
+      if(equals >= 0 && (value.toInt() < 8 || value.toInt() > 15))
+        return false;
+    } else {
+      return false;
+    }
+  }
+
+  windowBits = bits;
+  noContextTakeover = noContext;
+  response = F("permessage-deflate; client_no_context_takeover");
+  if(noContext)
+    response += F("; server_no_context_takeover");
+  if(bitsOffered){
+    response += F("; server_max_window_bits=");
+    response += String(bits);
+  }
+  return true;
+}
+
+bool webSocketNegotiateDeflate(const String& offers, uint8_t& windowBits, bool& noContextTakeover, String& response){
+  int start = 0;
+  while(start < (int)offers.length()){
+    int end = offers.indexOf(',', start);
+    if(end < 0)
+      end = offers.length();
+    if(_acceptDeflateOffer(offers.substring(start, end), windowBits, noContextTakeover, response))
+      return true;
+    start = end + 1;
+  }
+  return false;
+}
+
+/*
+ * Decompressor
+ * */
+
+typedef struct {
+  const uint8_t *in;
+  size_t inLen;
+  size_t inPos;
+  uint32_t bits;
+  uint8_t count;
+  bool error;
+  uint8_t *out;
+  size_t outLen;
+  size_t outPos;
+  bool full;      // the output did not fit
+} inflate_state_t;
+
+// Canonical code as counts of every length and the symbols ordered by code
+typedef struct {
+  uint16_t count[16];
+  uint16_t symbol[288];
+} inflate_huffman_t;
+
+typedef struct {
+  inflate_huffman_t lengths;
+  inflate_huffman_t distances;
+  uint8_t codeLengths[320];
+} inflate_tables_t;
+
+static uint32_t _getBits(inflate_state_t *s, uint8_t n){
+  while(s->count < n){
+    if(s->inPos == s->inLen){
+      s->error = true;
+      return 0;
+    }
+    s->bits |= (uint32_t)s->in[s->inPos++] << s->count;
+    s->count += 8;
+  }
+  uint32_t value = s->bits & ((1UL << n) - 1);
+  s->bits >>= n;
+  s->count -= n;
+  return value;
+}
+
+static bool _buildHuffman(inflate_huffman_t *h, const uint8_t *lengths, uint16_t n){
+  memset(h->count, 0, sizeof(h->count));
+  for(uint16_t i = 0; i < n; i++)
+    h->count[lengths[i]]++;
+  int left = 1;
+  for(uint8_t len = 1; len < 16; len++){
+    left <<= 1;
+    left -= h->count[len];
+    if(left < 0)
+      return false;
+  }
+  uint16_t offsets[16];
+  offsets[1] = 0;
+  for(uint8_t len = 1; len < 15; len++)
+    offsets[len + 1] = offsets[len] + h->count[len];
+  for(uint16_t i = 0; i < n; i++){
+    if(lengths[i])
+      h->symbol[offsets[lengths[i]]++] = i;
+  }
+  return true;
+}
+
+static int _decodeSymbol(inflate_state_t *s, const inflate_huffman_t *h){
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for(uint8_t len = 1; len < 16; len++){
+    code |= _getBits(s, 1);
+    if(s->error)
+      return -1;
+    int count = h->count[len];
+    if(code - count < first)
+      return h->symbol[index + (code - first)];
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+static bool _inflateCodes(inflate_state_t *s, const inflate_huffman_t *lengths, const inflate_huffman_t *distances){
+  while(true){
+    int symbol = _decodeSymbol(s, lengths);
+    if(symbol < 0)
+      return false;
+    if(symbol < 256){
+      if(s->outPos == s->outLen){
+        s->full = true;
+        return false;
+      }
+      s->out[s->outPos++] = symbol;
+    } else if(symbol == 256){
+      return true;
+    } else {
+      symbol -= 257;
+      if(symbol >= 29)
+        return false;
+      size_t length = _lengthBase[symbol] + _getBits(s, _lengthExtra[symbol]);
+      int d = _decodeSymbol(s, distances);
+      if(d < 0 || d >= 30)
+        return false;
+      size_t distance = _distanceBase[d] + _getBits(s, _distanceExtra[d]);
+      if(s->error || distance > s->outPos)
+        return false;
+      if(length > s->outLen - s->outPos){
+        s->full = true;
+        return false;
+      }
+      // Byte by byte, the copy may overlap what it writes
+      uint8_t *to = s->out + s->outPos;
+      const uint8_t *from = to - distance;
+      for(size_t i = 0; i < length; i++)
+        to[i] = from[i];
+      s->outPos += length;
+    }
+  }
+}
+
+static bool _inflateStored(inflate_state_t *s){
+  // Starts at the next byte
+  s->bits = 0;
+  s->count = 0;
+  if(s->inLen - s->inPos < 4)
+    return false;
+  const uint8_t *p = s->in + s->inPos;
+  uint16_t len = p[0] | (p[1] << 8);
+  uint16_t nlen = p[2] | (p[3] << 8);
+  if(len != (uint16_t)~nlen)
+    return false;
+  s->inPos += 4;
+  if(len > s->inLen - s->inPos)
+    return false;
+  if(len > s->outLen - s->outPos){
+    s->full = true;
+    return false;
+  }
+  memcpy(s->out + s->outPos, s->in + s->inPos, len);
+  s->inPos += len;
+  s->outPos += len;
+  return true;
+}
+
+static bool _inflateFixed(inflate_state_t *s, inflate_tables_t *t){
+  uint16_t i = 0;
+  for(; i < 144; i++) t->codeLengths[i] = 8;
+  for(; i < 256; i++) t->codeLengths[i] = 9;
+  for(; i < 280; i++) t->codeLengths[i] = 7;
+  for(; i < 288; i++) t->codeLengths[i] = 8;
+  _buildHuffman(&t->lengths, t->codeLengths, 288);
+  for(i = 0; i < 30; i++) t->codeLengths[i] = 5;
+  _buildHuffman(&t->distances, t->codeLengths, 30);
+  return _inflateCodes(s, &t->lengths, &t->distances);
+}
+
+static bool _inflateDynamic(inflate_state_t *s, inflate_tables_t *t){
+  static const uint8_t order[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+  uint16_t nlen = _getBits(s, 5) + 257;
+  uint16_t ndist = _getBits(s, 5) + 1;
+  uint16_t ncode = _getBits(s, 4) + 4;
+  if(s->error || nlen > 286 || ndist > 30)
+    return false;
+
+  uint16_t i = 0;
+  for(; i < ncode; i++)
+    t->codeLengths[order[i]] = _getBits(s, 3);
+  for(; i < 19; i++)
+    t->codeLengths[order[i]] = 0;
+  if(s->error || !_buildHuffman(&t->lengths, t->codeLengths, 19))
+    return false;
+
+  i = 0;
+  while(i < nlen + ndist){
+    int symbol = _decodeSymbol(s, &t->lengths);
+    if(symbol < 0)
+      return false;
+    if(symbol < 16){
+      t->codeLengths[i++] = symbol;
+      continue;
+    }
+    uint8_t repeat = 0;
+    uint16_t count;
+    if(symbol == 16){
+      if(i == 0)
+        return false;
+      repeat = t->codeLengths[i - 1];
+      count = 3 + _getBits(s, 2);
+    } else if(symbol == 17){
+      count = 3 + _getBits(s, 3);
+    } else {
+      count = 11 + _getBits(s, 7);
+    }
+    if(s->error || i + count > nlen + ndist)
+      return false;
+    while(count--)
+      t->codeLengths[i++] = repeat;
+  }
+  // Without an end of block code the block could not end
+  if(t->codeLengths[256] == 0)
+    return false;
+  if(!_buildHuffman(&t->lengths, t->codeLengths, nlen) || !_buildHuffman(&t->distances, t->codeLengths + nlen, ndist))
+    return false;
+  return _inflateCodes(s, &t->lengths, &t->distances);
+}
+
+bool webSocketInflate(const uint8_t *in, size_t inLen, uint8_t *out, size_t *outLen, bool *full){
+  inflate_state_t s = { in, inLen, 0, 0, 0, false, out, *outLen, 0, false };
+  inflate_tables_t *tables = (inflate_tables_t*)malloc(sizeof(inflate_tables_t));
+  if(!tables)
+    return false;
+
+  bool ok = true;
+  bool last = false;
+  // The message ends with the empty stored block of a sync flush or with a last block
+  while(ok && !last && s.inPos < s.inLen){
+    last = _getBits(&s, 1);
+    uint8_t type = _getBits(&s, 2);
+    if(s.error)
+      ok = false;
+    else if(type == 0)
+      ok = _inflateStored(&s);
+    else if(type == 1)
+      ok = _inflateFixed(&s, tables);
+    else if(type == 2)
+      ok = _inflateDynamic(&s, tables);
+    else
+      ok = false;
+  }
+  free(tables);
+  *outLen = s.outPos;
+  if(full)
+    *full = s.full;
+  return ok && !s.error;
+}
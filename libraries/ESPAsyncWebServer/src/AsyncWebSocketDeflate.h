@@ -0,0 +1,89 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBSOCKETDEFLATE_H_
+#define ASYNCWEBSOCKETDEFLATE_H_
+
+#include <Arduino.h>
+
+/*
+ * PERMESSAGE-DEFLATE :: RFC 7692 compression of WebSocket messages
+ *
+ * Messages to the client are compressed with the fixed Huffman codes and an LZ77 window that is
+ * kept from one message to the next (context takeover), so an update mostly refers back to the
+ * one before it. The window is 1 << WS_DEFLATE_WINDOW_BITS bytes per client instead of the 32KB
+ * zlib uses, and for messages of a few hundred bytes fixed codes do as well as dynamic ones
+ * without sending or building any tables.
+ * Clients are always told client_no_context_takeover, so every incoming message inflates on
+ * its own into a single buffer and no receive window has to be kept.
+ * */
+
+// Window of the compressor, 8 to 15, a client may ask for less
+#ifndef WS_DEFLATE_WINDOW_BITS
+#define WS_DEFLATE_WINDOW_BITS 10
+#endif
+
+// Longest incoming compressed message, before and after inflating
+#ifndef WS_DEFLATE_MAX_MESSAGE
+#define WS_DEFLATE_MAX_MESSAGE 4096
+#endif
+
+// Earlier positions tried for a match
+#ifndef WS_DEFLATE_CHAIN
+#define WS_DEFLATE_CHAIN 8
+#endif
+
+#define WS_DEFLATE_HASH_BITS 9
+
+class AsyncWebSocketDeflater {
+  private:
+    uint8_t _windowBits;
+    bool _noContextTakeover;
+    uint8_t *_window;   // the last bytes of earlier messages, at position & mask
+    uint32_t *_head;    // hash of three bytes -> latest position with it + 1, 0 for none
+    uint16_t *_prev;    // position & mask -> distance back to the previous one with the same hash
+    uint32_t _pos;      // position of the next message since the last reset
+
+    uint8_t _byte(uint32_t pos, const uint8_t *data, uint32_t start) const {
+      return (pos >= start) ? data[pos - start] : _window[pos & ((1 << _windowBits) - 1)];
+    }
+    void _insert(uint32_t pos, uint16_t hash);
+
+  public:
+    AsyncWebSocketDeflater(uint8_t windowBits, bool noContextTakeover);
+    ~AsyncWebSocketDeflater();
+    AsyncWebSocketDeflater(const AsyncWebSocketDeflater&) = delete;
+    AsyncWebSocketDeflater& operator=(const AsyncWebSocketDeflater&) = delete;
+
+    bool valid() const { return _window != NULL; }
+    void reset();
+    // Compresses one message into a malloc()ed *out, 0 if that would not make it smaller
+    size_t compress(const uint8_t *data, size_t len, uint8_t **out);
+};
+
+// Picks the first permessage-deflate offer of a Sec-WebSocket-Extensions header that can be
+// accepted, response is then the value of the header to answer with
+bool webSocketNegotiateDeflate(const String& offers, uint8_t& windowBits, bool& noContextTakeover, String& response);
+
+// Inflates one message with its 00 00 FF FF tail put back, *outLen is the size of out going in
+// and the inflated length coming out, false if the data is corrupt or, with *full set, does not fit
+bool webSocketInflate(const uint8_t *in, size_t inLen, uint8_t *out, size_t *outLen, bool *full = NULL);
+
+#endif /* ASYNCWEBSOCKETDEFLATE_H_ */
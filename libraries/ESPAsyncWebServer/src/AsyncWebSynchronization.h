@@ -0,0 +1,90 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBSYNCHRONIZATION_H_
+#define ASYNCWEBSYNCHRONIZATION_H_
+
+#include "Arduino.h"
+#ifdef ESP32
+#include <AsyncTCP.h>
+#endif
+
+/*
+ * LOCKS :: State that callbacks of different connections share
+ *
+ * With ASYNC_WORKERS above 1 the callbacks of different connections run at the same time in
+ * several async_tcp tasks. AsyncWebLock serializes them around the route table and the client
+ * lists and send queues of AsyncWebSocket and AsyncEventSource. The task holding it can take it
+ * again, so an event handler can send through the server that called it. Counters and caches
+ * that are only touched for a few instructions use a critical section of their own file.
+ * With a single worker every callback runs in the same task and all of it compiles to nothing.
+ * */
+
+#if defined(ESP32) && ASYNC_WORKERS > 1
+#define ASYNC_WEB_LOCKING 1
+#else
+#define ASYNC_WEB_LOCKING 0
+#endif
+
+#if ASYNC_WEB_LOCKING
+
+class AsyncWebLock {
+  private:
+    SemaphoreHandle_t _lock;
+    TaskHandle_t _owner;
+    uint16_t _depth;
+  public:
+    AsyncWebLock():_lock(xSemaphoreCreateMutex()),_owner(NULL),_depth(0){}
+    ~AsyncWebLock(){ vSemaphoreDelete(_lock); }
+    void lock(){
+      TaskHandle_t self = xTaskGetCurrentTaskHandle();
+      if(!_depth || _owner != self){
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        _owner = self;
+      }
+      _depth++;
+    }
+    void unlock(){
+      if(!--_depth){
+        _owner = NULL;
+        xSemaphoreGive(_lock);
+      }
+    }
+};
+
+#else
+
+class AsyncWebLock {
+  public:
+    void lock(){}
+    void unlock(){}
+};
+
+#endif
+
+class AsyncWebLockGuard {
+  private:
+    AsyncWebLock &_lock;
+  public:
+    AsyncWebLockGuard(AsyncWebLock &lock):_lock(lock){ _lock.lock(); }
+    ~AsyncWebLockGuard(){ _lock.unlock(); }
+};
+
+#endif /* ASYNCWEBSYNCHRONIZATION_H_ */
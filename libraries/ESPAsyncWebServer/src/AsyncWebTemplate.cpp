@@ -0,0 +1,214 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "AsyncWebTemplate.h"
+
+#define WEB_TEMPLATE_ESCAPE 0xFFFF
+
+AsyncWebTemplate::AsyncWebTemplate(const uint8_t* content, size_t len)
+  : _source(content)
+  , _length(len)
+  , _placeholders(NULL)
+  , _placeholderCount(0)
+  , _slots(NULL)
+  , _slotCount(0)
+{
+  _compile();
+}
+
+AsyncWebTemplate::AsyncWebTemplate(PGM_P content)
+  : AsyncWebTemplate((const uint8_t*)content, strlen_P(content))
+{}
+
+AsyncWebTemplate::~AsyncWebTemplate(){
+  free(_placeholders);
+  delete[] _slots;
+}
+
+size_t AsyncWebTemplate::_match(size_t offset) const {
+  // "%%" is an escaped placeholder character
+  if(offset + 1 < _length && pgm_read_byte(_source + offset + 1) == TEMPLATE_PLACEHOLDER)
+    return 2;
+  for(size_t i = offset + 1; i < _length && i <= offset + TEMPLATE_PARAM_NAME_LENGTH + 1; i++){
+    uint8_t c = pgm_read_byte(_source + i);
+    if(c == TEMPLATE_PLACEHOLDER)
+      return i - offset + 1;
+    if(isspace(c))
+      break;
+  }
+  return 0;
+}
+
+bool AsyncWebTemplate::_nameEquals(uint32_t offset, uint8_t length, const char* name, size_t nameLength) const {
+  if(length != nameLength)
+    return false;
+  for(uint8_t i = 0; i < length; i++){
+    if(pgm_read_byte(_source + offset + i) != (uint8_t)name[i])
+      return false;
+  }
+  return true;
+}
+
+void AsyncWebTemplate::_compile(){
+  if(_source == NULL)
+    return;
+
+  // First pass: count, so the index is a single allocation
+  size_t count = 0;
+  for(size_t i = 0; i < _length; i++){
+    if(pgm_read_byte(_source + i) != TEMPLATE_PLACEHOLDER)
+      continue;
+    size_t len = _match(i);
+    if(len){
+      count++;
+      i += len - 1;
+    }
+  }
+  if(count >= WEB_TEMPLATE_ESCAPE){
+    _source = NULL;
+    return;
+  }
+  if(count == 0)
+    return;
+
+  _placeholders = (placeholder_t*)malloc(count * sizeof(placeholder_t));
+  _slots = new (std::nothrow) slot_t[count];
+  if(!_placeholders || !_slots){
+    free(_placeholders);
+    delete[] _slots;
+    _placeholders = NULL;
+    _slots = NULL;
+    _source = NULL;
+    return;
+  }
+
+  // Second pass: index the placeholders, every name gets one slot
+  char name[TEMPLATE_PARAM_NAME_LENGTH];
+  for(size_t i = 0; i < _length; i++){
+    if(pgm_read_byte(_source + i) != TEMPLATE_PLACEHOLDER)
+      continue;
+    size_t len = _match(i);
+    if(!len)
+      continue;
+    placeholder_t* p = &_placeholders[_placeholderCount++];
+    p->offset = i;
+    p->length = len;
+    p->slot = WEB_TEMPLATE_ESCAPE;
+    if(len > 2){
+      uint8_t nameLength = len - 2;
+      memcpy_P(name, _source + i + 1, nameLength);
+      uint16_t s = 0;
+      while(s < _slotCount && !_nameEquals(_slots[s].name, _slots[s].length, name, nameLength))
+        s++;
+      if(s == _slotCount){
+        _slots[s].name = i + 1;
+        _slots[s].length = nameLength;
+        _slotCount++;
+      }
+      p->slot = s;
+    }
+    i += len - 1;
+  }
+}
+
+bool AsyncWebTemplate::bind(const char* name, AwsTemplateValue value){
+  size_t nameLength = strlen(name);
+  for(uint16_t s = 0; s < _slotCount; s++){
+    if(_nameEquals(_slots[s].name, _slots[s].length, name, nameLength)){
+      _slots[s].value = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Template Response
+ * */
+
+AsyncTemplateResponse::AsyncTemplateResponse(int code, const String& contentType, const AsyncWebTemplate& tpl): AsyncAbstractResponse() {
+  _code = code;
+  _contentType = contentType;
+  _template = &tpl;
+  _offset = 0;
+  _placeholder = 0;
+  _valueLength = 0;
+  _valueSent = 0;
+  // Values are only known while rendering
+  _contentLength = 0;
+  _sendContentLength = false;
+  _chunked = true;
+}
+
+static size_t _renderValue(const AwsTemplateValue& value, char* buf, size_t len){
+  size_t written = value(buf, len);
+  return (written >= len) ? len - 1 : written;
+}
+
+size_t AsyncTemplateResponse::_fillBuffer(uint8_t *data, size_t len){
+  size_t pos = 0;
+
+  // Rest of a value that did not fit the previous buffer
+  if(_valueSent < _valueLength){
+    size_t n = _valueLength - _valueSent;
+    if(n > len)
+      n = len;
+    memcpy(data, _value + _valueSent, n);
+    _valueSent += n;
+    pos += n;
+  }
+
+  while(pos < len && _valueSent == _valueLength){
+    bool placeholder = _placeholder < _template->_placeholderCount;
+    size_t end = placeholder ? _template->_placeholders[_placeholder].offset : _template->_length;
+    if(_offset < end){
+      // Literal text up to the next placeholder
+      size_t n = end - _offset;
+      if(n > len - pos)
+        n = len - pos;
+      memcpy_P(data + pos, _template->_source + _offset, n);
+      _offset += n;
+      pos += n;
+      continue;
+    }
+    if(!placeholder)
+      break;
+
+    const AsyncWebTemplate::placeholder_t& p = _template->_placeholders[_placeholder++];
+    _offset += p.length;
+    if(p.slot == WEB_TEMPLATE_ESCAPE){
+      data[pos++] = TEMPLATE_PLACEHOLDER;
+      continue;
+    }
+    const AwsTemplateValue& value = _template->_slots[p.slot].value;
+    if(!value)
+      continue;
+    if(len - pos >= WEB_TEMPLATE_VALUE_LENGTH){
+      // Enough room, the value goes straight into the send buffer
+      pos += _renderValue(value, (char*)data + pos, WEB_TEMPLATE_VALUE_LENGTH);
+    } else {
+      _valueLength = _renderValue(value, _value, WEB_TEMPLATE_VALUE_LENGTH);
+      _valueSent = (_valueLength > len - pos) ? len - pos : _valueLength;
+      memcpy(data + pos, _value, _valueSent);
+      pos += _valueSent;
+    }
+  }
+  return pos;
+}
@@ -0,0 +1,101 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBTEMPLATE_H_
+#define ASYNCWEBTEMPLATE_H_
+
+#include <ESPAsyncWebServer.h>
+#include "WebResponseImpl.h"
+
+/*
+ * TEMPLATE :: Page with %NAME% placeholders, compiled once when it is created
+ *
+ * The source (PROGMEM or RAM) is scanned a single time for placeholders and their names are
+ * resolved to value slots, so rendering a response only walks the placeholder index.
+ * Literal text is copied straight from the source and every value is written by its
+ * callback directly into the send buffer, there is no String per placeholder.
+ * A placeholder is TEMPLATE_PLACEHOLDER, up to TEMPLATE_PARAM_NAME_LENGTH characters
+ * without whitespace and TEMPLATE_PLACEHOLDER again, "%%" is a literal '%'.
+ * Anything else is left as it is, placeholders without a bound value render empty.
+ * */
+
+// Longest value a callback can write for one placeholder
+#ifndef WEB_TEMPLATE_VALUE_LENGTH
+#define WEB_TEMPLATE_VALUE_LENGTH 128
+#endif
+
+// Writes the value into buf like snprintf(), a result of len or more is cut to len - 1 bytes
+typedef std::function<size_t(char* buf, size_t len)> AwsTemplateValue;
+
+class AsyncWebTemplate {
+  private:
+    typedef struct {
+      uint32_t offset; // of the opening placeholder character in the source
+      uint16_t length; // of the whole placeholder, both placeholder characters included
+      uint16_t slot;   // index into _slots, WEB_TEMPLATE_ESCAPE for "%%"
+    } placeholder_t;
+
+    typedef struct {
+      uint32_t name;   // offset of the name in the source
+      uint8_t length;
+      AwsTemplateValue value;
+    } slot_t;
+
+    const uint8_t* _source;
+    size_t _length;
+    placeholder_t* _placeholders;
+    uint16_t _placeholderCount;
+    slot_t* _slots;
+    uint16_t _slotCount;
+
+    size_t _match(size_t offset) const;
+    void _compile();
+    bool _nameEquals(uint32_t offset, uint8_t length, const char* name, size_t nameLength) const;
+
+    friend class AsyncTemplateResponse;
+
+  public:
+    explicit AsyncWebTemplate(const uint8_t* content, size_t len);
+    explicit AsyncWebTemplate(PGM_P content);
+    ~AsyncWebTemplate();
+    AsyncWebTemplate(const AsyncWebTemplate&) = delete;
+    AsyncWebTemplate& operator=(const AsyncWebTemplate&) = delete;
+
+    bool valid() const { return _source != NULL; }
+    size_t placeholders() const { return _placeholderCount; }
+    // Set the value of every %name% placeholder, false if the template has no such name
+    bool bind(const char* name, AwsTemplateValue value);
+};
+
+class AsyncTemplateResponse: public AsyncAbstractResponse {
+  private:
+    const AsyncWebTemplate* _template;
+    size_t _offset;          // next source byte
+    uint16_t _placeholder;   // next placeholder
+    char _value[WEB_TEMPLATE_VALUE_LENGTH];
+    uint16_t _valueLength;   // pending value that did not fit the previous buffer
+    uint16_t _valueSent;
+  public:
+    AsyncTemplateResponse(int code, const String& contentType, const AsyncWebTemplate& tpl);
+    bool _sourceValid() const { return _template->valid(); }
+    virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+};
+
+#endif /* ASYNCWEBTEMPLATE_H_ */
@@ -38,6 +38,8 @@
 #error Platform not supported
 #endif
 
+#include "AsyncWebSynchronization.h"
+
 #define DEBUGF(...) //Serial.printf(__VA_ARGS__)
 
 class AsyncWebServer;
@@ -50,6 +52,8 @@ class AsyncWebHandler;
 class AsyncStaticWebHandler;
 class AsyncCallbackWebHandler;
 class AsyncResponseStream;
+class AsyncWebRouteTable;
+class AsyncWebTemplate;
 
 #ifndef WEBSERVER_H
 typedef enum {
@@ -122,6 +126,24 @@ class AsyncWebHeader {
 
 typedef enum { RCT_NOT_USED = -1, RCT_DEFAULT = 0, RCT_HTTP, RCT_WS, RCT_EVENT, RCT_MAX } RequestedConnectionType;
 
+// Per request scratch arena holding the request line and the headers while they are parsed
+#ifndef WEB_REQUEST_HEAD_SIZE
+#define WEB_REQUEST_HEAD_SIZE 1536
+#endif
+
+// Headers kept per request, at most 32 (one bit each in the pending mask)
+#ifndef WEB_REQUEST_MAX_HEADERS
+#define WEB_REQUEST_MAX_HEADERS 32
+#endif
+#if WEB_REQUEST_MAX_HEADERS > 32
+#error WEB_REQUEST_MAX_HEADERS can not exceed 32
+#endif
+
+typedef struct {
+  uint16_t name;  // offset of NUL terminated name in the arena
+  uint16_t value; // offset of NUL terminated value in the arena
+} web_header_span_t;
+
 typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
 typedef std::function<String(const String&)> AwsTemplateProcessor;
 
@@ -140,6 +162,13 @@ class AsyncWebServerRequest {
     String _temp;
     uint8_t _parseState;
 
+    char _head[WEB_REQUEST_HEAD_SIZE];
+    uint16_t _headLen;      // bytes of the arena in use
+    uint16_t _lineStart;    // start of the line being collected in the arena
+    web_header_span_t _headerSpans[WEB_REQUEST_MAX_HEADERS];
+    uint8_t _headerCount;
+    mutable uint32_t _headersPending; // spans not yet turned into AsyncWebHeader objects
+
     uint8_t _version;
     WebRequestMethodComposite _method;
     String _url;
@@ -150,14 +179,16 @@ class AsyncWebServerRequest {
     RequestedConnectionType _reqconntype;
     void _removeNotInterestingHeaders();
     bool _isDigest;
+    bool _isStaleDigest;        // the next digest challenge says stale=TRUE
+    bool _digestPasswordIsHash; // a stored MD5 HA1, no SHA-256 challenge
     bool _isMultipart;
     bool _isPlainPost;
     bool _expectingContinue;
     size_t _contentLength;
     size_t _parsedLength;
 
-    LinkedList<AsyncWebHeader *> _headers;
-    LinkedList<AsyncWebParameter *> _params;
+    mutable SmallVector<AsyncWebHeader *, 8> _headers;
+    SmallVector<AsyncWebParameter *, 8> _params;
 
     uint8_t _multiParseState;
     uint8_t _boundaryPosition;
@@ -180,12 +211,18 @@ class AsyncWebServerRequest {
 
     void _addParam(AsyncWebParameter*);
 
-    bool _parseReqHead();
-    bool _parseReqHeader();
-    void _parseLine();
+    bool _parseReqHead(const char* line, size_t len);
+    bool _parseReqHeader(const char* line, size_t len);
+    void _parseLine(const char* line, size_t len);
+    void _parseFail(int code);
     void _parsePlainPostChar(uint8_t data);
     void _parseMultipartPostByte(uint8_t data, bool last);
     void _addGetParams(const String& params);
+    void _addGetParams(const char* params, size_t len);
+    static void _urlDecode(String& decoded, const char* text, size_t len);
+
+    void _materializeHeaders() const;
+    const char* _headerValue(const char* name) const;
 
     void _handleUploadStart();
     void _handleUploadByte(uint8_t data, bool last);
@@ -233,6 +270,7 @@ class AsyncWebServerRequest {
     void sendChunked(const String& contentType, AwsResponseFiller callback, AwsTemplateProcessor templateCallback=nullptr);
     void send_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     void send_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback=nullptr);
+    void send(int code, const String& contentType, const AsyncWebTemplate& tpl);
 
     AsyncWebServerResponse *beginResponse(int code, const String& contentType=String(), const String& content=String());
     AsyncWebServerResponse *beginResponse(FS &fs, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
@@ -243,6 +281,7 @@ class AsyncWebServerRequest {
     AsyncResponseStream *beginResponseStream(const String& contentType, size_t bufferSize=1460);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback=nullptr);
+    AsyncWebServerResponse *beginResponse(int code, const String& contentType, const AsyncWebTemplate& tpl);
 
     size_t headers() const;                     // get header count
     bool hasHeader(const String& name) const;   // check if header exists
@@ -272,6 +311,7 @@ class AsyncWebServerRequest {
     const String& header(const __FlashStringHelper * data) const;// get request header value by F(name)    
     const String& header(size_t i) const;        // get request header value by number
     const String& headerName(size_t i) const;    // get request header name by number
+    bool acceptsEncoding(const char* coding) const; // check Accept-Encoding for a content coding ("br", "gzip")
     String urlDecode(const String& text) const;
 };
 
@@ -314,6 +354,19 @@ class AsyncWebRewrite {
  * HANDLER :: One instance can be attached to any Request (done by the Server)
  * */
 
+// Urls a handler can accept, used by the route table compiled at begin()
+typedef enum {
+  WEB_ROUTE_ANY,    // can not tell, the handler is asked about every request
+  WEB_ROUTE_EXACT,  // url equals uri
+  WEB_ROUTE_PREFIX, // url starts with uri
+  WEB_ROUTE_PATH    // url equals uri or starts with uri + "/"
+} WebRouteKind;
+
+// Build a route table at begin() instead of asking every handler about every request
+#ifndef WEB_ROUTE_TABLE
+#define WEB_ROUTE_TABLE 1
+#endif
+
 class AsyncWebHandler {
   protected:
     ArRequestFilterFunction _filter;
@@ -332,6 +385,8 @@ class AsyncWebHandler {
     virtual void handleUpload(AsyncWebServerRequest *request  __attribute__((unused)), const String& filename __attribute__((unused)), size_t index __attribute__((unused)), uint8_t *data __attribute__((unused)), size_t len __attribute__((unused)), bool final  __attribute__((unused))){}
     virtual void handleBody(AsyncWebServerRequest *request __attribute__((unused)), uint8_t *data __attribute__((unused)), size_t len __attribute__((unused)), size_t index __attribute__((unused)), size_t total __attribute__((unused))){}
     virtual bool isRequestHandlerTrivial(){return true;}
+    // canHandle() must return false for any url outside of what is reported here
+    virtual WebRouteKind route(String& uri __attribute__((unused))) const { return WEB_ROUTE_ANY; }
 };
 
 /*
@@ -387,6 +442,8 @@ class AsyncWebServer {
     LinkedList<AsyncWebRewrite*> _rewrites;
     LinkedList<AsyncWebHandler*> _handlers;
     AsyncCallbackWebHandler* _catchAllHandler;
+    AsyncWebRouteTable* _routes;
+    AsyncWebLock _routeLock; // handler and rewrite lists and the route table, lookups share its scratch
 
   public:
     AsyncWebServer(uint16_t port);
@@ -419,6 +476,7 @@ class AsyncWebServer {
 
     void reset(); //remove all writers and handlers, with onNotFound/onFileUpload/onRequestBody 
   
+    bool _routesReady();
     void _handleDisconnect(AsyncWebServerRequest *request);
     void _attachHandler(AsyncWebServerRequest *request);
     void _rewriteRequest(AsyncWebServerRequest *request);
@@ -29,12 +29,15 @@ class LinkedListNode {
     T _value;
   public:
     LinkedListNode<T>* next;
-    LinkedListNode(const T val): _value(val), next(nullptr) {}
+    LinkedListNode<T>* prev;
+    LinkedListNode(const T val): _value(val), next(nullptr), prev(nullptr) {}
     ~LinkedListNode(){}
     const T& value() const { return _value; };
     T& value(){ return _value; }
 };
 
+// Doubly linked, with a tail pointer and a cached size: add(), length() and
+// removing the front (message queues) are O(1)
 template <typename T, template<typename> class Item = LinkedListNode>
 class LinkedList {
   public:
@@ -43,35 +46,52 @@ class LinkedList {
     typedef std::function<bool(const T&)> Predicate;
   private:
     ItemType* _root;
+    ItemType* _tail;
+    size_t _count;
     OnRemove _onRemove;
 
+    // Remembers the next node up front, so the current one may be removed while iterating
     class Iterator {
       ItemType* _node;
+      ItemType* _next;
     public:
-      Iterator(ItemType* current = nullptr) : _node(current) {}
-      Iterator(const Iterator& i) : _node(i._node) {}
-      Iterator& operator ++() { _node = _node->next; return *this; }
+      Iterator(ItemType* current = nullptr) : _node(current), _next(current ? current->next : nullptr) {}
+      Iterator(const Iterator& i) : _node(i._node), _next(i._next) {}
+      Iterator& operator ++() { _node = _next; _next = _node ? _node->next : nullptr; return *this; }
       bool operator != (const Iterator& i) const { return _node != i._node; }
       const T& operator * () const { return _node->value(); }
       const T* operator -> () const { return &_node->value(); }
     };
+
+    void _unlink(ItemType* it){
+      if(it->prev) it->prev->next = it->next;
+      else _root = it->next;
+      if(it->next) it->next->prev = it->prev;
+      else _tail = it->prev;
+      _count--;
+      if (_onRemove) {
+        _onRemove(it->value());
+      }
+      delete it;
+    }
     
   public:
     typedef const Iterator ConstIterator;
     ConstIterator begin() const { return ConstIterator(_root); }
     ConstIterator end() const { return ConstIterator(nullptr); }
 
-    LinkedList(OnRemove onRemove) : _root(nullptr), _onRemove(onRemove) {}
+    LinkedList(OnRemove onRemove) : _root(nullptr), _tail(nullptr), _count(0), _onRemove(onRemove) {}
     ~LinkedList(){}
     void add(const T& t){
       auto it = new ItemType(t);
+      it->prev = _tail;
       if(!_root){
         _root = it;
       } else {
-        auto i = _root;
-        while(i->next) i = i->next;
-        i->next = it;
+        _tail->next = it;
       }
+      _tail = it;
+      _count++;
     }
     T& front() const {
       return _root->value();
@@ -81,13 +101,7 @@ class LinkedList {
       return _root == nullptr;
     }
     size_t length() const {
-      size_t i = 0;
-      auto it = _root;
-      while(it){
-        i++;
-        it = it->next;
-      }
-      return i;
+      return _count;
     }
     size_t count_if(Predicate predicate) const {
       size_t i = 0;
@@ -104,56 +118,28 @@ class LinkedList {
       return i;
     }
     const T* nth(size_t N) const {
-      size_t i = 0;
+      if(N >= _count)
+        return nullptr;
       auto it = _root;
-      while(it){
-        if(i++ == N)
-          return &(it->value());
+      while(N--)
         it = it->next;
-      }
-      return nullptr;
+      return &(it->value());
     }
     bool remove(const T& t){
-      auto it = _root;
-      auto pit = _root;
-      while(it){
+      for(auto it = _root; it; it = it->next){
         if(it->value() == t){
-          if(it == _root){
-            _root = _root->next;
-          } else {
-            pit->next = it->next;
-          }
-          
-          if (_onRemove) {
-            _onRemove(it->value());
-          }
-          
-          delete it;
+          _unlink(it);
           return true;
         }
-        pit = it;
-        it = it->next;
       }
       return false;
     }
     bool remove_first(Predicate predicate){
-      auto it = _root;
-      auto pit = _root;
-      while(it){
+      for(auto it = _root; it; it = it->next){
         if(predicate(it->value())){
-          if(it == _root){
-            _root = _root->next;
-          } else {
-            pit->next = it->next;
-          }
-          if (_onRemove) {
-            _onRemove(it->value());
-          }
-          delete it;
+          _unlink(it);
           return true;
         }
-        pit = it;
-        it = it->next;
       }
       return false;
     }
@@ -168,6 +154,104 @@ class LinkedList {
         delete it;
       }
       _root = nullptr;
+      _tail = nullptr;
+      _count = 0;
+    }
+};
+
+// Same interface as LinkedList for short lists of pointers (request headers and params):
+// the first N items live inside the object, past that they move to one heap array
+template <typename T, size_t N>
+class SmallVector {
+  public:
+    typedef std::function<void(const T&)> OnRemove;
+    typedef std::function<bool(const T&)> Predicate;
+    typedef const T* ConstIterator;
+  private:
+    T _inline[N];
+    T* _items;
+    size_t _count;
+    size_t _capacity;
+    OnRemove _onRemove;
+
+    void _erase(size_t i){
+      T t = _items[i];
+      for(; i + 1 < _count; i++)
+        _items[i] = _items[i+1];
+      _count--;
+      if (_onRemove) {
+        _onRemove(t);
+      }
+    }
+
+  public:
+    ConstIterator begin() const { return _items; }
+    ConstIterator end() const { return _items + _count; }
+
+    SmallVector(OnRemove onRemove) : _items(_inline), _count(0), _capacity(N), _onRemove(onRemove) {}
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+    ~SmallVector(){
+      if(_items != _inline)
+        delete[] _items;
+    }
+    void add(const T& t){
+      if(_count == _capacity){
+        T* items = new T[_capacity * 2];
+        for(size_t i = 0; i < _count; i++)
+          items[i] = _items[i];
+        if(_items != _inline)
+          delete[] _items;
+        _items = items;
+        _capacity *= 2;
+      }
+      _items[_count++] = t;
+    }
+    T& front() const {
+      return _items[0];
+    }
+    bool isEmpty() const {
+      return _count == 0;
+    }
+    size_t length() const {
+      return _count;
+    }
+    size_t count_if(Predicate predicate) const {
+      size_t n = 0;
+      for(size_t i = 0; i < _count; i++){
+        if (!predicate || predicate(_items[i]))
+          n++;
+      }
+      return n;
+    }
+    const T* nth(size_t i) const {
+      return i < _count ? &_items[i] : nullptr;
+    }
+    bool remove(const T& t){
+      for(size_t i = 0; i < _count; i++){
+        if(_items[i] == t){
+          _erase(i);
+          return true;
+        }
+      }
+      return false;
+    }
+    bool remove_first(Predicate predicate){
+      for(size_t i = 0; i < _count; i++){
+        if(predicate(_items[i])){
+          _erase(i);
+          return true;
+        }
+      }
+      return false;
+    }
+    void free(){
+      size_t count = _count;
+      _count = 0;
+      if (_onRemove) {
+        for(size_t i = 0; i < count; i++)
+          _onRemove(_items[i]);
+      }
     }
 };
 
@@ -19,9 +19,14 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "WebAuthentication.h"
+#include "AsyncWebSynchronization.h"
 #include <libb64/cencode.h>
 #ifdef ESP32
+#include "esp_system.h"
 #include "mbedtls/md5.h"
+#if DIGEST_SHA256
+#include "mbedtls/sha256.h"
+#endif
 #else
 #include "md5.h"
 #endif
@@ -58,54 +63,361 @@ bool checkBasicAuthentication(const char * hash, const char * username, const ch
   return false;
 }
 
-static bool getMD5(uint8_t * data, uint16_t len, char * output){//33 bytes or more
+static const char digestHexDigits[] = "0123456789abcdef";
+
+// MD5, or SHA-256 for RFC 7616, fed piece by piece so the strings it hashes are never built
+class DigestHash {
+  private:
 #ifdef ESP32
-    mbedtls_md5_context _ctx;
+    mbedtls_md5_context _md5;
+#if DIGEST_SHA256
+    mbedtls_sha256_context _sha;
+#endif
 #else
-    md5_context_t _ctx;
+    md5_context_t _md5;
+#endif
+    bool _sha256;
+
+  public:
+    DigestHash(bool sha256) : _sha256(sha256){
+#if DIGEST_SHA256
+      if(_sha256){
+        mbedtls_sha256_init(&_sha);
+        mbedtls_sha256_starts(&_sha, 0);
+        return;
+      }
 #endif
-  uint8_t i;
-  uint8_t * _buf = (uint8_t*)malloc(16);
-  if(_buf == NULL)
-    return false;
-  memset(_buf, 0x00, 16);
 #ifdef ESP32
-  mbedtls_md5_init(&_ctx);
-  mbedtls_md5_starts(&_ctx);
-  mbedtls_md5_update(&_ctx, data, len);
-  mbedtls_md5_finish(&_ctx, _buf);
+      mbedtls_md5_init(&_md5);
+      mbedtls_md5_starts(&_md5);
 #else
-  MD5Init(&_ctx);
-  MD5Update(&_ctx, data, len);
-  MD5Final(_buf, &_ctx);
+      MD5Init(&_md5);
 #endif
-  for(i = 0; i < 16; i++) {
-    sprintf(output + (i * 2), "%02x", _buf[i]);
+    }
+
+    void add(const char * data, size_t len){
+      if(len == 0)
+        return;
+#if DIGEST_SHA256
+      if(_sha256){
+        mbedtls_sha256_update(&_sha, (const uint8_t *)data, len);
+        return;
+      }
+#endif
+#ifdef ESP32
+      mbedtls_md5_update(&_md5, (const uint8_t *)data, len);
+#else
+      MD5Update(&_md5, (uint8_t *)data, len);
+#endif
+    }
+
+    void add(const char * str){
+      add(str, strlen(str));
+    }
+
+    // Lowercase hex and a terminator, 33 bytes or 65 for SHA-256
+    void finish(char * hex){
+      uint8_t digest[32];
+      size_t len = 16;
+#if DIGEST_SHA256
+      if(_sha256){
+        mbedtls_sha256_finish(&_sha, digest);
+        mbedtls_sha256_free(&_sha);
+        len = 32;
+      } else
+#endif
+      {
+#ifdef ESP32
+        mbedtls_md5_finish(&_md5, digest);
+        mbedtls_md5_free(&_md5);
+#else
+        MD5Final(digest, &_md5);
+#endif
+      }
+      for(size_t i = 0; i < len; i++){
+        *hex++ = digestHexDigits[digest[i] >> 4];
+        *hex++ = digestHexDigits[digest[i] & 0x0F];
+      }
+      *hex = 0;
+    }
+};
+
+static uint32_t digestRandom(){
+#if defined(ESP32)
+  return esp_random();
+#elif defined(ESP8266)
+  return RANDOM_REG32;
+#else
+  return rand();
+#endif
+}
+
+// 128 random bits as 32 hex digits and a terminator
+static void genRandomHex(char * out){
+  for(uint8_t i = 0; i < 4; i++){
+    uint32_t r = digestRandom();
+    for(uint8_t j = 0; j < 8; j++){
+      *out++ = digestHexDigits[r & 0x0F];
+      r >>= 4;
+    }
   }
-  free(_buf);
-  return true;
+  *out = 0;
+}
+
+// A value of the Authorization header, pointing into it
+struct DigestField {
+  const char * value;
+  size_t len;
+};
+
+struct DigestParams {
+  DigestField username;
+  DigestField realm;
+  DigestField nonce;
+  DigestField uri;
+  DigestField response;
+  DigestField qop;
+  DigestField nc;
+  DigestField cnonce;
+  DigestField opaque;
+  DigestField algorithm;
+};
+
+static bool fieldIs(const DigestField& field, const char * str){
+  return field.value != NULL && strncmp(field.value, str, field.len) == 0 && str[field.len] == 0;
 }
 
-static String genRandomMD5(){
-#ifdef ESP8266
-  uint32_t r = RANDOM_REG32;
+static bool parseDigestHeader(const char * p, DigestParams * params){
+  memset(params, 0, sizeof(DigestParams));
+  while(true){
+    while(*p == ' ' || *p == '\t' || *p == ',')
+      p++;
+    if(*p == 0)
+      return true;
+
+    DigestField name;
+    name.value = p;
+    while(*p && *p != '=' && *p != ',' && *p != ' ')
+      p++;
+    name.len = p - name.value;
+    while(*p == ' ')
+      p++;
+    if(*p != '='){
+      //os_printf("AUTH FAIL: no = sign\n");
+      return false;
+    }
+    p++;
+    while(*p == ' ')
+      p++;
+
+    DigestField value;
+    if(*p == '"'){
+      value.value = ++p;
+      while(*p && *p != '"')
+        p++;
+      if(*p != '"')
+        return false;
+      value.len = p++ - value.value;
+    } else {
+      value.value = p;
+      while(*p && *p != ',' && *p != ' ' && *p != '\t')
+        p++;
+      value.len = p - value.value;
+    }
+
+    if(fieldIs(name, "username"))
+      params->username = value;
+    else if(fieldIs(name, "realm"))
+      params->realm = value;
+    else if(fieldIs(name, "nonce"))
+      params->nonce = value;
+    else if(fieldIs(name, "uri"))
+      params->uri = value;
+    else if(fieldIs(name, "response"))
+      params->response = value;
+    else if(fieldIs(name, "qop"))
+      params->qop = value;
+    else if(fieldIs(name, "nc"))
+      params->nc = value;
+    else if(fieldIs(name, "cnonce"))
+      params->cnonce = value;
+    else if(fieldIs(name, "opaque"))
+      params->opaque = value;
+    else if(fieldIs(name, "algorithm"))
+      params->algorithm = value;
+  }
+}
+
+// Nonces handed out and the nonce counts they were used with
+struct DigestNonce {
+  char value[33];    // empty when the slot is free
+  uint32_t issued;   // millis()
+  uint32_t lastNc;   // highest nonce count accepted
+  uint32_t ncWindow; // bit n set when lastNc - n was accepted, parallel requests arrive out of order
+};
+
+static DigestNonce digestNonces[DIGEST_NONCE_SLOTS];
+
+#if ASYNC_WEB_LOCKING
+// The nonce slots and the HA1 cache, requests on several workers authenticate at once
+static portMUX_TYPE _digestMux = portMUX_INITIALIZER_UNLOCKED;
+#define DIGEST_LOCK()   portENTER_CRITICAL(&_digestMux)
+#define DIGEST_UNLOCK() portEXIT_CRITICAL(&_digestMux)
 #else
-  uint32_t r = rand();
+#define DIGEST_LOCK()
+#define DIGEST_UNLOCK()
 #endif
-  char * out = (char*)malloc(33);
-  if(out == NULL || !getMD5((uint8_t*)(&r), 4, out))
-    return "";
-  String res = String(out);
-  free(out);
-  return res;
+
+static void issueDigestNonce(char * nonce){
+  genRandomHex(nonce);
+  DIGEST_LOCK();
+  uint32_t now = millis();
+  DigestNonce * slot = &digestNonces[0];
+  for(uint8_t i = 0; i < DIGEST_NONCE_SLOTS; i++){
+    DigestNonce * n = &digestNonces[i];
+    if(n->value[0] == 0){
+      slot = n;
+      break;
+    }
+    if(now - n->issued > now - slot->issued)
+      slot = n;
+  }
+  memcpy(slot->value, nonce, sizeof(slot->value));
+  slot->issued = now;
+  slot->lastNc = 0;
+  slot->ncWindow = 0;
+  DIGEST_UNLOCK();
 }
 
-static String stringMD5(const String& in){
-  char * out = (char*)malloc(33);
-  if(out == NULL || !getMD5((uint8_t*)(in.c_str()), in.length(), out))
-    return "";
-  String res = String(out);
-  free(out);
+// NULL if the nonce was not handed out or has expired
+static DigestNonce * findDigestNonce(const DigestField& nonce){
+  for(uint8_t i = 0; i < DIGEST_NONCE_SLOTS; i++){
+    DigestNonce * n = &digestNonces[i];
+    if(n->value[0] == 0 || !fieldIs(nonce, n->value))
+      continue;
+    if(millis() - n->issued >= DIGEST_NONCE_LIFETIME){
+      n->value[0] = 0;
+      return NULL;
+    }
+    return n;
+  }
+  return NULL;
+}
+
+// Every nonce count is accepted once, lower ones only if they are at most 31 behind the highest
+static bool acceptDigestNc(DigestNonce * n, const DigestField& field){
+  if(field.len == 0 || field.len > 8)
+    return false;
+  uint32_t nc = 0;
+  for(size_t i = 0; i < field.len; i++){
+    char c = field.value[i];
+    uint8_t digit;
+    if(c >= '0' && c <= '9')
+      digit = c - '0';
+    else if(c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if(c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      return false;
+    nc = (nc << 4) | digit;
+  }
+  if(nc == 0)
+    return false;
+  if(nc > n->lastNc){
+    uint32_t shift = nc - n->lastNc;
+    n->ncWindow = (shift < 32) ? ((n->ncWindow << shift) | 1) : 1;
+    n->lastNc = nc;
+    return true;
+  }
+  uint32_t behind = n->lastNc - nc;
+  if(behind >= 32 || (n->ncWindow & (1UL << behind)))
+    return false;
+  n->ncWindow |= 1UL << behind;
+  return true;
+}
+
+#if DIGEST_HA1_CACHE_SIZE
+struct DigestHA1 {
+  char key[DIGEST_HA1_KEY_SIZE]; // the "username:realm:password" that was hashed
+  char ha1[65];
+  bool sha256;
+};
+
+static DigestHA1 digestHA1Cache[DIGEST_HA1_CACHE_SIZE];
+static uint8_t digestHA1Next = 0;
+#endif
+
+static void digestHA1(const DigestField& username, const DigestField& realm, const char * password, bool sha256, char * ha1){
+  size_t passwordLen = strlen(password);
+#if DIGEST_HA1_CACHE_SIZE
+  size_t keyLen = username.len + realm.len + passwordLen + 2;
+  if(keyLen < DIGEST_HA1_KEY_SIZE){
+    char key[DIGEST_HA1_KEY_SIZE];
+    memcpy(key, username.value, username.len);
+    key[username.len] = ':';
+    memcpy(key + username.len + 1, realm.value, realm.len);
+    key[username.len + realm.len + 1] = ':';
+    memcpy(key + username.len + realm.len + 2, password, passwordLen + 1);
+
+    DIGEST_LOCK();
+    for(uint8_t i = 0; i < DIGEST_HA1_CACHE_SIZE; i++){
+      if(digestHA1Cache[i].sha256 == sha256 && strcmp(digestHA1Cache[i].key, key) == 0){
+        strcpy(ha1, digestHA1Cache[i].ha1);
+        DIGEST_UNLOCK();
+        return;
+      }
+    }
+    DIGEST_UNLOCK();
+    //hashed outside the lock, a miss on two workers at once stores it twice
+    DigestHash hash(sha256);
+    hash.add(key, keyLen);
+    hash.finish(ha1);
+
+    DIGEST_LOCK();
+    DigestHA1 * entry = &digestHA1Cache[digestHA1Next];
+    digestHA1Next = (digestHA1Next + 1) % DIGEST_HA1_CACHE_SIZE;
+    memcpy(entry->key, key, keyLen + 1);
+    strcpy(entry->ha1, ha1);
+    entry->sha256 = sha256;
+    DIGEST_UNLOCK();
+    return;
+  }
+#endif
+  DigestHash hash(sha256);
+  hash.add(username.value, username.len);
+  hash.add(":", 1);
+  hash.add(realm.value, realm.len);
+  hash.add(":", 1);
+  hash.add(password, passwordLen);
+  hash.finish(ha1);
+}
+
+// Copies the parts into a buffer on the stack, or on the heap when they do not fit, and makes the String once
+template<size_t N>
+static String digestJoin(const char * const (&parts)[N]){
+  size_t lens[N];
+  size_t len = 0;
+  for(size_t i = 0; i < N; i++){
+    lens[i] = strlen(parts[i]);
+    len += lens[i];
+  }
+  char buffer[DIGEST_BUFFER_SIZE];
+  char * out = buffer;
+  if(len >= sizeof(buffer)){
+    out = (char *)malloc(len + 1);
+    if(out == NULL)
+      return String();
+  }
+  char * p = out;
+  for(size_t i = 0; i < N; i++){
+    memcpy(p, parts[i], lens[i]);
+    p += lens[i];
+  }
+  *p = 0;
+  String res(out);
+  if(out != buffer)
+    free(out);
   return res;
 }
 
@@ -113,123 +425,140 @@ String generateDigestHash(const char * username, const char * password, const ch
   if(username == NULL || password == NULL || realm == NULL){
     return "";
   }
-  char * out = (char*)malloc(33);
-  String res = String(username);
-  res.concat(":");
-  res.concat(realm);
-  res.concat(":");
-  String in = res;
-  in.concat(password);
-  if(out == NULL || !getMD5((uint8_t*)(in.c_str()), in.length(), out))
-    return "";
-  res.concat(out);
-  free(out);
-  return res;
+  char ha1[33];
+  DigestHash hash(false);
+  hash.add(username);
+  hash.add(":", 1);
+  hash.add(realm);
+  hash.add(":", 1);
+  hash.add(password);
+  hash.finish(ha1);
+
+  const char * parts[] = { username, ":", realm, ":", ha1 };
+  return digestJoin(parts);
 }
 
-String requestDigestAuthentication(const char * realm){
-  String header = "realm=\"";
+String requestDigestAuthentication(const char * realm, bool stale){
   if(realm == NULL)
-    header.concat("asyncesp");
-  else
-    header.concat(realm);
-  header.concat( "\", qop=\"auth\", nonce=\"");
-  header.concat(genRandomMD5());
-  header.concat("\", opaque=\"");
-  header.concat(genRandomMD5());
-  header.concat("\"");
-  return header;
+    realm = "asyncesp";
+  char nonce[33];
+  char opaque[33];
+  issueDigestNonce(nonce);
+  genRandomHex(opaque);
+
+  const char * parts[] = { "realm=\"", realm, "\", qop=\"auth\", nonce=\"", nonce, "\", opaque=\"", opaque, "\"", stale ? ", stale=TRUE" : "" };
+  return digestJoin(parts);
 }
 
-bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri){
+bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri, bool * stale){
+  if(stale != NULL)
+    *stale = false;
   if(username == NULL || password == NULL || header == NULL || method == NULL){
     //os_printf("AUTH FAIL: missing requred fields\n");
     return false;
   }
 
-  String myHeader = String(header);
-  int nextBreak = myHeader.indexOf(",");
-  if(nextBreak < 0){
-    //os_printf("AUTH FAIL: no variables\n");
+  DigestParams params;
+  if(!parseDigestHeader(header, &params))
+    return false;
+  if(!params.username.value || !params.realm.value || !params.nonce.value || !params.uri.value || !params.response.value){
+    //os_printf("AUTH FAIL: missing fields\n");
+    return false;
+  }
+  if(!fieldIs(params.username, username)){
+    //os_printf("AUTH FAIL: username\n");
+    return false;
+  }
+  if(realm != NULL && !fieldIs(params.realm, realm)){
+    //os_printf("AUTH FAIL: realm\n");
+    return false;
+  }
+  if(nonce != NULL && !fieldIs(params.nonce, nonce)){
+    //os_printf("AUTH FAIL: nonce\n");
+    return false;
+  }
+  if(opaque != NULL && !fieldIs(params.opaque, opaque)){
+    //os_printf("AUTH FAIL: opaque\n");
+    return false;
+  }
+  if(uri != NULL && !fieldIs(params.uri, uri)){
+    //os_printf("AUTH FAIL: uri\n");
+    return false;
+  }
+  if(!fieldIs(params.qop, "auth") || !params.nc.value || !params.cnonce.value){
+    //os_printf("AUTH FAIL: qop\n");
     return false;
   }
 
-  String myUsername = String();
-  String myRealm = String();
-  String myNonce = String();
-  String myUri = String();
-  String myResponse = String();
-  String myQop = String();
-  String myNc = String();
-  String myCnonce = String();
+  bool sha256 = false;
+  if(params.algorithm.value != NULL && !fieldIs(params.algorithm, "MD5")){
+#if DIGEST_SHA256
+    //a stored hash is an MD5 one
+    if(passwordIsHash || !fieldIs(params.algorithm, "SHA-256"))
+      return false;
+    sha256 = true;
+#else
+    //os_printf("AUTH FAIL: algorithm\n");
+    return false;
+#endif
+  }
 
-  myHeader += ", ";
-  do {
-    String avLine = myHeader.substring(0, nextBreak);
-    avLine.trim();
-    myHeader = myHeader.substring(nextBreak+1);
-    nextBreak = myHeader.indexOf(",");
+  char ha1[65];
+  if(!passwordIsHash)
+    digestHA1(params.username, params.realm, password, sha256, ha1);
 
-    int eqSign = avLine.indexOf("=");
-    if(eqSign < 0){
-      //os_printf("AUTH FAIL: no = sign\n");
-      return false;
-    }
-    String varName = avLine.substring(0, eqSign);
-    avLine = avLine.substring(eqSign + 1);
-    if(avLine.startsWith("\"")){
-      avLine = avLine.substring(1, avLine.length() - 1);
-    }
+  char ha2[65];
+  DigestHash ha2Hash(sha256);
+  ha2Hash.add(method);
+  ha2Hash.add(":", 1);
+  ha2Hash.add(params.uri.value, params.uri.len);
+  ha2Hash.finish(ha2);
 
-    if(varName.equals("username")){
-      if(!avLine.equals(username)){
-        //os_printf("AUTH FAIL: username\n");
-        return false;
-      }
-      myUsername = avLine;
-    } else if(varName.equals("realm")){
-      if(realm != NULL && !avLine.equals(realm)){
-        //os_printf("AUTH FAIL: realm\n");
-        return false;
-      }
-      myRealm = avLine;
-    } else if(varName.equals("nonce")){
-      if(nonce != NULL && !avLine.equals(nonce)){
-        //os_printf("AUTH FAIL: nonce\n");
-        return false;
-      }
-      myNonce = avLine;
-    } else if(varName.equals("opaque")){
-      if(opaque != NULL && !avLine.equals(opaque)){
-        //os_printf("AUTH FAIL: opaque\n");
-        return false;
-      }
-    } else if(varName.equals("uri")){
-      if(uri != NULL && !avLine.equals(uri)){
-        //os_printf("AUTH FAIL: uri\n");
-        return false;
-      }
-      myUri = avLine;
-    } else if(varName.equals("response")){
-      myResponse = avLine;
-    } else if(varName.equals("qop")){
-      myQop = avLine;
-    } else if(varName.equals("nc")){
-      myNc = avLine;
-    } else if(varName.equals("cnonce")){
-      myCnonce = avLine;
-    }
-  } while(nextBreak > 0);
+  char expected[65];
+  DigestHash hash(sha256);
+  hash.add(passwordIsHash ? password : ha1);
+  hash.add(":", 1);
+  hash.add(params.nonce.value, params.nonce.len);
+  hash.add(":", 1);
+  hash.add(params.nc.value, params.nc.len);
+  hash.add(":", 1);
+  hash.add(params.cnonce.value, params.cnonce.len);
+  hash.add(":auth:", 6);
+  hash.add(ha2);
+  hash.finish(expected);
 
-  String ha1 = (passwordIsHash) ? String(password) : stringMD5(myUsername + ":" + myRealm + ":" + String(password));
-  String ha2 = String(method) + ":" + myUri;
-  String response = ha1 + ":" + myNonce + ":" + myNc + ":" + myCnonce + ":" + myQop + ":" + stringMD5(ha2);
+  size_t expectedLen = sha256 ? 64 : 32;
+  if(params.response.len != expectedLen){
+    //os_printf("AUTH FAIL: password\n");
+    return false;
+  }
+  uint8_t diff = 0;
+  for(size_t i = 0; i < expectedLen; i++)
+    diff |= expected[i] ^ params.response.value[i];
+  if(diff != 0){
+    //os_printf("AUTH FAIL: password\n");
+    return false;
+  }
 
-  if(myResponse.equals(stringMD5(response))){
-    //os_printf("AUTH SUCCESS\n");
-    return true;
+  //the caller keeps no nonce, it has to be one requestDigestAuthentication() handed out
+  if(nonce == NULL){
+    //found and counted in one go, so a nonce count is accepted once whatever the workers
+    DIGEST_LOCK();
+    DigestNonce * issued = findDigestNonce(params.nonce);
+    bool accepted = issued != NULL && acceptDigestNc(issued, params.nc);
+    DIGEST_UNLOCK();
+    if(issued == NULL){
+      //os_printf("AUTH FAIL: stale nonce\n");
+      if(stale != NULL)
+        *stale = true;
+      return false;
+    }
+    if(!accepted){
+      //os_printf("AUTH FAIL: nonce count replayed\n");
+      return false;
+    }
   }
 
-  //os_printf("AUTH FAIL: password\n");
-  return false;
+  //os_printf("AUTH SUCCESS\n");
+  return true;
 }
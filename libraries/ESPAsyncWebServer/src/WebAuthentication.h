@@ -24,9 +24,45 @@
 
 #include "Arduino.h"
 
+// Nonces handed out by requestDigestAuthentication() are remembered in a table of this many slots,
+// the oldest one is replaced when it is full. A nonce is accepted for DIGEST_NONCE_LIFETIME ms.
+#ifndef DIGEST_NONCE_SLOTS
+#define DIGEST_NONCE_SLOTS 8
+#endif
+#ifndef DIGEST_NONCE_LIFETIME
+#define DIGEST_NONCE_LIFETIME 300000
+#endif
+
+// HA1 = H(username:realm:password) of the last plain text passwords, so that a request costs two hashes
+// instead of three. Credentials longer than DIGEST_HA1_KEY_SIZE are hashed every time.
+#ifndef DIGEST_HA1_CACHE_SIZE
+#define DIGEST_HA1_CACHE_SIZE 2
+#endif
+#ifndef DIGEST_HA1_KEY_SIZE
+#define DIGEST_HA1_KEY_SIZE 64
+#endif
+
+// Challenges and stored hashes are written into a stack buffer of this size, a longer realm or username
+// takes one from the heap.
+#ifndef DIGEST_BUFFER_SIZE
+#define DIGEST_BUFFER_SIZE 160
+#endif
+
+// Offer RFC 7616 SHA-256 digests before MD5. ESP32 computes them on the SHA engine, it has none for MD5.
+#ifndef DIGEST_SHA256
+#ifdef ESP32
+#define DIGEST_SHA256 1
+#else
+#define DIGEST_SHA256 0
+#endif
+#endif
+
 bool checkBasicAuthentication(const char * header, const char * username, const char * password);
-String requestDigestAuthentication(const char * realm);
-bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri);
+// With nonce NULL the nonce has to be one requestDigestAuthentication() handed out, and each nonce count
+// is accepted once. stale is set when the challenge has to be sent again with stale=TRUE: the credentials
+// are right but the nonce expired or is not known, the browser then retries without asking the user.
+String requestDigestAuthentication(const char * realm, bool stale = false);
+bool checkDigestAuthentication(const char * header, const char * method, const char * username, const char * password, const char * realm, bool passwordIsHash, const char * nonce, const char * opaque, const char * uri, bool * stale = NULL);
 
 //for storing hashed versions on the device that can be authenticated against
 String generateDigestHash(const char * username, const char * password, const char * realm);
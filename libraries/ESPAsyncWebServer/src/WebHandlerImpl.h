@@ -47,6 +47,7 @@ class AsyncStaticWebHandler: public AsyncWebHandler {
     AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cache_control);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual WebRouteKind route(String& uri) const override final { uri = _uri; return WEB_ROUTE_PREFIX; }
     AsyncStaticWebHandler& setIsDir(bool isDir);
     AsyncStaticWebHandler& setDefaultFile(const char* filename);
     AsyncStaticWebHandler& setCacheControl(const char* cache_control);
@@ -89,6 +90,13 @@ class AsyncCallbackWebHandler: public AsyncWebHandler {
       request->addInterestingHeader("ANY");
       return true;
     }
+
+    virtual WebRouteKind route(String& uri) const override final {
+      if(!_onRequest || !_uri.length())
+        return WEB_ROUTE_ANY;
+      uri = _uri;
+      return WEB_ROUTE_PATH;
+    }
   
     virtual void handleRequest(AsyncWebServerRequest *request) override final {
       if(_onRequest)
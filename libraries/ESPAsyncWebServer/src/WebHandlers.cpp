@@ -95,6 +95,8 @@ bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request){
     if(_cache_control.length())
       request->addInterestingHeader("If-None-Match");
 
+    request->addInterestingHeader("Accept-Encoding");
+
     DEBUGF("[AsyncStaticWebHandler::canHandle] TRUE\n");
     return true;
   }
@@ -138,10 +140,19 @@ bool AsyncStaticWebHandler::_fileExists(AsyncWebServerRequest *request, const St
 {
   bool fileFound = false;
   bool gzipFound = false;
+  bool brotliFound = false;
 
   String gzip = path + ".gz";
 
-  if (_gzipFirst) {
+  // A brotli sibling is only worth a lookup if the client can decode it
+  if (request->acceptsEncoding("br")) {
+    request->_tempFile = _fs.open(path + ".br", "r");
+    brotliFound = FILE_IS_REAL(request->_tempFile);
+  }
+
+  if (brotliFound) {
+    // Served as is, gzip statistics are left alone
+  } else if (_gzipFirst) {
     request->_tempFile = _fs.open(gzip, "r");
     gzipFound = FILE_IS_REAL(request->_tempFile);
     if (!gzipFound){
@@ -157,7 +168,7 @@ bool AsyncStaticWebHandler::_fileExists(AsyncWebServerRequest *request, const St
     }
   }
 
-  bool found = fileFound || gzipFound;
+  bool found = fileFound || gzipFound || brotliFound;
 
   if (found) {
     // Extract the file name from the path and keep it in _tempObject
@@ -166,6 +177,8 @@ bool AsyncStaticWebHandler::_fileExists(AsyncWebServerRequest *request, const St
     snprintf(_tempPath, pathLen+1, "%s", path.c_str());
     request->_tempObject = (void*)_tempPath;
 
+    if (brotliFound) return true;
+
     // Calculate gzip statistic
     _gzipStats = (_gzipStats << 1) + (gzipFound ? 1 : 0);
     if (_gzipStats == 0x00) _gzipFirst = false; // All files are not gzip
@@ -206,6 +219,9 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request)
       request->send(response);
     } else {
       AsyncWebServerResponse * response = new AsyncFileResponse(request->_tempFile, filename, String(), false, _callback);
+      String name = String(request->_tempFile.name());
+      if (name.endsWith(".br") || name.endsWith(".gz"))
+        response->addHeader("Vary", "Accept-Encoding");
       if (_last_modified.length())
         response->addHeader("Last-Modified", _last_modified);
       if (_cache_control.length()){
@@ -21,6 +21,7 @@
 #include "ESPAsyncWebServer.h"
 #include "WebResponseImpl.h"
 #include "WebAuthentication.h"
+#include "AsyncWebTemplate.h"
 
 #ifndef ESP8266
 #define os_strlen strlen
@@ -39,6 +40,10 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _response(NULL)
   , _temp()
   , _parseState(0)
+  , _headLen(0)
+  , _lineStart(0)
+  , _headerCount(0)
+  , _headersPending(0)
   , _version(0)
   , _method(HTTP_ANY)
   , _url()
@@ -48,13 +53,15 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _authorization()
   , _reqconntype(RCT_HTTP)
   , _isDigest(false)
+  , _isStaleDigest(false)
+  , _digestPasswordIsHash(false)
   , _isMultipart(false)
   , _isPlainPost(false)
   , _expectingContinue(false)
   , _contentLength(0)
   , _parsedLength(0)
-  , _headers(LinkedList<AsyncWebHeader *>([](AsyncWebHeader *h){ delete h; }))
-  , _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p){ delete p; }))
+  , _headers([](AsyncWebHeader *h){ delete h; })
+  , _params([](AsyncWebParameter *p){ delete p; })
   , _multiParseState(0)
   , _boundaryPosition(0)
   , _itemStartIndex(0)
@@ -102,29 +109,28 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
 
   if(_parseState < PARSE_REQ_BODY){
     // Find new line in buf
-    char *str = (char*)buf;
-    for (i = 0; i < len; i++) {
-      if (str[i] == '\n') {
-        break;
+    const char *str = (const char*)buf;
+    const char *eol = (const char*)memchr(str, '\n', len);
+    size_t lineLen = eol ? (size_t)(eol - str) : len;
+    if (eol && _headLen == _lineStart) {
+      // Whole line is inside this packet, parse it where it is
+      _parseLine(str, lineLen);
+    } else {
+      // Line spans packets, collect it in the arena
+      if (_headLen + lineLen > WEB_REQUEST_HEAD_SIZE) {
+        _parseFail(_parseState == PARSE_REQ_START ? 414 : 431);
+        return;
       }
+      memcpy(_head + _headLen, str, lineLen);
+      _headLen += lineLen;
+      if (eol)
+        _parseLine(_head + _lineStart, _headLen - _lineStart);
     }
-    if (i == len) { // No new line, just add the buffer in _temp
-      char ch = str[len-1];
-      str[len-1] = 0;
-      _temp.reserve(_temp.length()+len);
-      _temp.concat(str);
-      _temp.concat(ch);
-    } else { // Found new line - extract it and parse
-      str[i] = 0; // Terminate the string at the end of the line.
-      _temp.concat(str);
-      _temp.trim();
-      _parseLine();
-      if (++i < len) {
-        // Still have more buffer to process
-        buf = str+i;
-        len-= i;
-        continue;
-      }
+    if (eol && (i = lineLen + 1) < len) {
+      // Still have more buffer to process
+      buf = (void*)(str+i);
+      len-= i;
+      continue;
     }
   } else if(_parseState == PARSE_REQ_BODY){
     // A handler should be already attached at this point in _parseLine function.
@@ -178,11 +184,44 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
 
 void AsyncWebServerRequest::_removeNotInterestingHeaders(){
   if (_interestingHeaders.containsIgnoreCase("ANY")) return; // nothing to do
-  for(const auto& header: _headers){
-      if(!_interestingHeaders.containsIgnoreCase(header->name().c_str())){
-        _headers.remove(header);
+  // Spans that nobody asked for are never turned into objects
+  for(uint8_t i = 0; i < _headerCount; i++){
+    uint32_t bit = (uint32_t)1 << i;
+    if(!(_headersPending & bit)) continue;
+    bool interesting = false;
+    for(const auto& name: _interestingHeaders){
+      if(strcasecmp(name.c_str(), _head + _headerSpans[i].name) == 0){
+        interesting = true;
+        break;
       }
+    }
+    if(!interesting) _headersPending &= ~bit;
   }
+  while(_headers.remove_first([this](AsyncWebHeader* const& header){
+    return !_interestingHeaders.containsIgnoreCase(header->name());
+  }));
+}
+
+void AsyncWebServerRequest::_materializeHeaders() const {
+  for(uint8_t i = 0; _headersPending && i < _headerCount; i++){
+    uint32_t bit = (uint32_t)1 << i;
+    if(_headersPending & bit){
+      _headersPending &= ~bit;
+      _headers.add(new AsyncWebHeader(String(_head + _headerSpans[i].name), String(_head + _headerSpans[i].value)));
+    }
+  }
+}
+
+const char* AsyncWebServerRequest::_headerValue(const char* name) const {
+  for(const auto& h: _headers){
+    if(strcasecmp(h->name().c_str(), name) == 0)
+      return h->value().c_str();
+  }
+  for(uint8_t i = 0; i < _headerCount; i++){
+    if((_headersPending & ((uint32_t)1 << i)) && strcasecmp(_head + _headerSpans[i].name, name) == 0)
+      return _head + _headerSpans[i].value;
+  }
+  return NULL;
 }
 
 void AsyncWebServerRequest::_onPoll(){
@@ -231,121 +270,145 @@ void AsyncWebServerRequest::_addParam(AsyncWebParameter *p){
 }
 
 void AsyncWebServerRequest::_addGetParams(const String& params){
-  size_t start = 0;
-  while (start < params.length()){
-    int end = params.indexOf('&', start);
-    if (end < 0) end = params.length();
-    int equal = params.indexOf('=', start);
-    if (equal < 0 || equal > end) equal = end;
-    String name = params.substring(start, equal);
-    String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value)));
-    start = end + 1;
+  _addGetParams(params.c_str(), params.length());
+}
+
+void AsyncWebServerRequest::_addGetParams(const char* params, size_t len){
+  const char* end = params + len;
+  while (params < end){
+    const char* amp = (const char*)memchr(params, '&', end - params);
+    if (!amp) amp = end;
+    const char* equal = (const char*)memchr(params, '=', amp - params);
+    if (!equal) equal = amp;
+    String name = String();
+    String value = String();
+    _urlDecode(name, params, equal - params);
+    if (equal + 1 < amp) _urlDecode(value, equal + 1, amp - equal - 1);
+    _addParam(new AsyncWebParameter(name, value));
+    params = amp + 1;
   }
 }
 
-bool AsyncWebServerRequest::_parseReqHead(){
+static const struct {
+  const char * name;
+  WebRequestMethodComposite method;
+} _httpMethods[] = {
+  { "GET", HTTP_GET }, { "POST", HTTP_POST }, { "DELETE", HTTP_DELETE }, { "PUT", HTTP_PUT },
+  { "PATCH", HTTP_PATCH }, { "HEAD", HTTP_HEAD }, { "OPTIONS", HTTP_OPTIONS }
+};
+
+bool AsyncWebServerRequest::_parseReqHead(const char* line, size_t len){
   // Split the head into method, url and version
-  int index = _temp.indexOf(' ');
-  String m = _temp.substring(0, index);
-  index = _temp.indexOf(' ', index+1);
-  String u = _temp.substring(m.length()+1, index);
-  _temp = _temp.substring(index+1);
-
-  if(m == "GET"){
-    _method = HTTP_GET;
-  } else if(m == "POST"){
-    _method = HTTP_POST;
-  } else if(m == "DELETE"){
-    _method = HTTP_DELETE;
-  } else if(m == "PUT"){
-    _method = HTTP_PUT;
-  } else if(m == "PATCH"){
-    _method = HTTP_PATCH;
-  } else if(m == "HEAD"){
-    _method = HTTP_HEAD;
-  } else if(m == "OPTIONS"){
-    _method = HTTP_OPTIONS;
-  }
-
-  String g = String();
-  index = u.indexOf('?');
-  if(index > 0){
-    g = u.substring(index +1);
-    u = u.substring(0, index);
-  }
-  _url = urlDecode(u);
-  _addGetParams(g);
-
-  if(!_temp.startsWith("HTTP/1.0"))
+  const char* end = line + len;
+  const char* u = (const char*)memchr(line, ' ', len);
+  size_t mLen = u ? u - line : len;
+  u = u ? u + 1 : end;
+  const char* v = (const char*)memchr(u, ' ', end - u);
+  const char* uEnd = v ? v : end;
+  v = v ? v + 1 : end;
+
+  for(size_t i = 0; i < sizeof(_httpMethods) / sizeof(_httpMethods[0]); i++){
+    if(strlen(_httpMethods[i].name) == mLen && memcmp(_httpMethods[i].name, line, mLen) == 0){
+      _method = _httpMethods[i].method;
+      break;
+    }
+  }
+
+  const char* q = (const char*)memchr(u, '?', uEnd - u);
+  if(q == u) q = NULL;
+  _urlDecode(_url, u, (q ? q : uEnd) - u);
+  if(q) _addGetParams(q + 1, uEnd - q - 1);
+
+  if(end - v < 8 || memcmp(v, "HTTP/1.0", 8) != 0)
     _version = 1;
 
-  _temp = String();
+  // The request line is not needed anymore, hand the arena over to the headers
+  _headLen = _lineStart = 0;
   return true;
 }
 
-bool strContains(String src, String find, bool mindcase = true) {
-  int pos=0, i=0;
-  const int slen = src.length();
-  const int flen = find.length();
-
-  if (slen < flen) return false;
-  while (pos <= (slen - flen)) {
-    for (i=0; i < flen; i++) {
-      if (mindcase) {
-        if (src[pos+i] != find[i]) i = flen + 1; // no match
-      } else if (tolower(src[pos+i]) != tolower(find[i])) i = flen + 1; // no match
-    }
-    if (i == flen) return true;
-    pos++;
+static bool _containsIgnoreCase(const char* src, const char* find){
+  size_t flen = strlen(find);
+  for(; *src; src++){
+    if(strncasecmp(src, find, flen) == 0) return true;
   }
   return false;
 }
 
-bool AsyncWebServerRequest::_parseReqHeader(){
-  int index = _temp.indexOf(':');
-  if(index){
-    String name = _temp.substring(0, index);
-    String value = _temp.substring(index + 2);
-    if(name.equalsIgnoreCase("Host")){
-      _host = value;
-    } else if(name.equalsIgnoreCase("Content-Type")){
-      if (value.startsWith("multipart/")){
-        _boundary = value.substring(value.indexOf('=')+1);
-        _boundary.replace("\"","");
-        _contentType = value.substring(0, value.indexOf(';'));
-        _isMultipart = true;
-      } else {
-        _contentType = value;
-      }
-    } else if(name.equalsIgnoreCase("Content-Length")){
-      _contentLength = atoi(value.c_str());
-    } else if(name.equalsIgnoreCase("Expect") && value == "100-continue"){
-      _expectingContinue = true;
-    } else if(name.equalsIgnoreCase("Authorization")){
-      if(value.length() > 5 && value.substring(0,5).equalsIgnoreCase("Basic")){
-        _authorization = value.substring(6);
-      } else if(value.length() > 6 && value.substring(0,6).equalsIgnoreCase("Digest")){
-        _isDigest = true;
-        _authorization = value.substring(7);
-      }
+bool AsyncWebServerRequest::_parseReqHeader(const char* line, size_t len){
+  const char* colon = (const char*)memchr(line, ':', len);
+  if(colon == NULL || colon == line){
+    // Not a header, drop whatever was collected for it
+    _headLen = _lineStart;
+    return false;
+  }
+  size_t nameLen = colon - line;
+  while(nameLen && isspace((unsigned char)line[nameLen-1])) nameLen--;
+  const char* value = colon + 1;
+  size_t valueLen = line + len - value;
+  while(valueLen && isspace((unsigned char)*value)){ value++; valueLen--; }
+
+  if(_headerCount == WEB_REQUEST_MAX_HEADERS || _lineStart + nameLen + valueLen + 2 > WEB_REQUEST_HEAD_SIZE){
+    _parseFail(431);
+    return false;
+  }
+
+  // Keep "name\0value\0" in the arena, the line may already be there so this can overlap
+  web_header_span_t* span = &_headerSpans[_headerCount];
+  span->name = _lineStart;
+  span->value = _lineStart + nameLen + 1;
+  memmove(_head + span->name, line, nameLen);
+  _head[span->name + nameLen] = 0;
+  memmove(_head + span->value, value, valueLen);
+  _head[span->value + valueLen] = 0;
+  _headLen = _lineStart = span->value + valueLen + 1;
+  _headersPending |= (uint32_t)1 << _headerCount;
+  _headerCount++;
+
+  const char* n = _head + span->name;
+  const char* v = _head + span->value;
+  if(strcasecmp(n, "Host") == 0){
+    _host = v;
+  } else if(strcasecmp(n, "Content-Type") == 0){
+    _contentType = v;
+    if (strncmp(v, "multipart/", 10) == 0){
+      const char* boundary = strchr(v, '=');
+      _boundary = boundary ? boundary + 1 : v;
+      _boundary.replace("\"","");
+      const char* semicolon = strchr(v, ';');
+      if (semicolon) _contentType.remove(semicolon - v);
+      _isMultipart = true;
+    }
+  } else if(strcasecmp(n, "Content-Length") == 0){
+    _contentLength = atoi(v);
+  } else if(strcasecmp(n, "Expect") == 0 && strcmp(v, "100-continue") == 0){
+    _expectingContinue = true;
+  } else if(strcasecmp(n, "Authorization") == 0){
+    if(valueLen > 5 && strncasecmp(v, "Basic", 5) == 0){
+      _authorization = v + 6;
+    } else if(valueLen > 6 && strncasecmp(v, "Digest", 6) == 0){
+      _isDigest = true;
+      _authorization = v + 7;
+    }
+  } else {
+    if(strcasecmp(n, "Upgrade") == 0 && strcasecmp(v, "websocket") == 0){
+      // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
+      _reqconntype = RCT_WS;
     } else {
-      if(name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket")){
-        // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
-        _reqconntype = RCT_WS;
-      } else {
-        if(name.equalsIgnoreCase("Accept") && strContains(value, "text/event-stream", false)){
-          // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
-          _reqconntype = RCT_EVENT;
-        }
+      if(strcasecmp(n, "Accept") == 0 && _containsIgnoreCase(v, "text/event-stream")){
+        // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
+        _reqconntype = RCT_EVENT;
       }
     }
-    _headers.add(new AsyncWebHeader(name, value));
   }
-  _temp = String();
   return true;
 }
 
+void AsyncWebServerRequest::_parseFail(int code){
+  _parseState = PARSE_REQ_FAIL;
+  send(code);
+}
+
 void AsyncWebServerRequest::_parsePlainPostChar(uint8_t data){
   if(data && (char)data != '&')
     _temp += (char)data;
@@ -546,21 +609,26 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last){
   }
 }
 
-void AsyncWebServerRequest::_parseLine(){
+void AsyncWebServerRequest::_parseLine(const char* line, size_t len){
+  // Trim the line, this also drops the '\r'
+  while(len && isspace((unsigned char)line[len-1])) len--;
+  while(len && isspace((unsigned char)*line)){ line++; len--; }
+
   if(_parseState == PARSE_REQ_START){
-    if(!_temp.length()){
+    if(!len){
       _parseState = PARSE_REQ_FAIL;
       _client->close();
     } else {
-      _parseReqHead();
+      _parseReqHead(line, len);
       _parseState = PARSE_REQ_HEADERS;
     }
     return;
   }
 
   if(_parseState == PARSE_REQ_HEADERS){
-    if(!_temp.length()){
+    if(!len){
       //end of headers
+      _headLen = _lineStart;
       _server->_rewriteRequest(this);
       _server->_attachHandler(this);
       _removeNotInterestingHeaders();
@@ -576,21 +644,16 @@ void AsyncWebServerRequest::_parseLine(){
         if(_handler) _handler->handleRequest(this);
         else send(501);
       }
-    } else _parseReqHeader();
+    } else _parseReqHeader(line, len);
   }
 }
 
 size_t AsyncWebServerRequest::headers() const{
-  return _headers.length();
+  return _headers.length() + __builtin_popcount(_headersPending);
 }
 
 bool AsyncWebServerRequest::hasHeader(const String& name) const {
-  for(const auto& h: _headers){
-    if(h->name().equalsIgnoreCase(name)){
-      return true;
-    }
-  }
-  return false;
+  return _headerValue(name.c_str()) != NULL;
 }
 
 bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
@@ -614,6 +677,7 @@ bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
+  _materializeHeaders();
   for(const auto& h: _headers){
     if(h->name().equalsIgnoreCase(name)){
       return h;
@@ -637,6 +701,7 @@ AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper * dat
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const {
+  _materializeHeaders();
   auto header = _headers.nth(num);
   return header ? *header : nullptr;
 }
@@ -763,6 +828,10 @@ AsyncWebServerResponse * AsyncWebServerRequest::beginResponse_P(int code, const
   return beginResponse_P(code, contentType, (const uint8_t *)content, strlen_P(content), callback);
 }
 
+AsyncWebServerResponse * AsyncWebServerRequest::beginResponse(int code, const String& contentType, const AsyncWebTemplate& tpl){
+  return new AsyncTemplateResponse(code, contentType, tpl);
+}
+
 void AsyncWebServerRequest::send(int code, const String& contentType, const String& content){
   send(beginResponse(code, contentType, content));
 }
@@ -799,6 +868,10 @@ void AsyncWebServerRequest::send_P(int code, const String& contentType, PGM_P co
   send(beginResponse_P(code, contentType, content, callback));
 }
 
+void AsyncWebServerRequest::send(int code, const String& contentType, const AsyncWebTemplate& tpl){
+  send(beginResponse(code, contentType, tpl));
+}
+
 void AsyncWebServerRequest::redirect(const String& url){
   AsyncWebServerResponse * response = beginResponse(302);
   response->addHeader("Location",url);
@@ -806,9 +879,10 @@ void AsyncWebServerRequest::redirect(const String& url){
 }
 
 bool AsyncWebServerRequest::authenticate(const char * username, const char * password, const char * realm, bool passwordIsHash){
+  _digestPasswordIsHash = passwordIsHash;
   if(_authorization.length()){
     if(_isDigest)
-      return checkDigestAuthentication(_authorization.c_str(), methodToString(), username, password, realm, passwordIsHash, NULL, NULL, NULL);
+      return checkDigestAuthentication(_authorization.c_str(), methodToString(), username, password, realm, passwordIsHash, NULL, NULL, NULL, &_isStaleDigest);
     else if(!passwordIsHash)
       return checkBasicAuthentication(_authorization.c_str(), username, password);
     else
@@ -818,6 +892,7 @@ bool AsyncWebServerRequest::authenticate(const char * username, const char * pas
 }
 
 bool AsyncWebServerRequest::authenticate(const char * hash){
+  _digestPasswordIsHash = true;
   if(!_authorization.length() || hash == NULL)
     return false;
 
@@ -833,7 +908,7 @@ bool AsyncWebServerRequest::authenticate(const char * hash){
       return false;
     String realm = hStr.substring(0, separator);
     hStr = hStr.substring(separator + 1);
-    return checkDigestAuthentication(_authorization.c_str(), methodToString(), username.c_str(), hStr.c_str(), realm.c_str(), true, NULL, NULL, NULL);
+    return checkDigestAuthentication(_authorization.c_str(), methodToString(), username.c_str(), hStr.c_str(), realm.c_str(), true, NULL, NULL, NULL, &_isStaleDigest);
   }
 
   return (_authorization.equals(hash));
@@ -850,7 +925,15 @@ void AsyncWebServerRequest::requestAuthentication(const char * realm, bool isDig
     r->addHeader("WWW-Authenticate", header);
   } else {
     String header = "Digest ";
-    header.concat(requestDigestAuthentication(realm));
+    header.concat(requestDigestAuthentication(realm, _isStaleDigest));
+#if DIGEST_SHA256
+    //preferred challenge first, both with the same nonce
+    if(!_digestPasswordIsHash){
+      String sha256Header = header;
+      sha256Header.concat(", algorithm=SHA-256");
+      r->addHeader("WWW-Authenticate", sha256Header);
+    }
+#endif
     r->addHeader("WWW-Authenticate", header);
   }
   send(r);
@@ -913,8 +996,14 @@ const String& AsyncWebServerRequest::argName(size_t i) const {
 }
 
 const String& AsyncWebServerRequest::header(const char* name) const {
-  AsyncWebHeader* h = getHeader(String(name));
-  return h ? h->value() : SharedEmptyString;
+  if(_headerValue(name) == NULL)
+    return SharedEmptyString;
+  _materializeHeaders();
+  for(const auto& h: _headers){
+    if(strcasecmp(h->name().c_str(), name) == 0)
+      return h->value();
+  }
+  return SharedEmptyString;
 }
 
 const String& AsyncWebServerRequest::header(const __FlashStringHelper * data) const {
@@ -942,18 +1031,49 @@ const String& AsyncWebServerRequest::headerName(size_t i) const {
   return h ? h->name() : SharedEmptyString;
 }
 
+bool AsyncWebServerRequest::acceptsEncoding(const char* coding) const {
+  // RFC 7231 5.3.4: an explicit entry wins over "*", q=0 means not acceptable
+  const char * p = _headerValue("Accept-Encoding");
+  if(p == NULL)
+    return false;
+  size_t codingLen = strlen(coding);
+  bool wildcard = false;
+  while(*p){
+    while(*p == ' ' || *p == ',') p++;
+    const char * token = p;
+    while(*p && *p != ',' && *p != ';' && *p != ' ') p++;
+    size_t tokenLen = p - token;
+    bool refused = false;
+    while(*p && *p != ','){
+      if((*p == 'q' || *p == 'Q') && p[1] == '=')
+        refused = atof(p + 2) == 0;
+      p++;
+    }
+    if(tokenLen == codingLen && strncasecmp(token, coding, codingLen) == 0)
+      return !refused;
+    if(tokenLen == 1 && *token == '*')
+      wildcard = !refused;
+  }
+  return wildcard;
+}
+
 String AsyncWebServerRequest::urlDecode(const String& text) const {
-  char temp[] = "0x00";
-  unsigned int len = text.length();
-  unsigned int i = 0;
   String decoded = String();
+  _urlDecode(decoded, text.c_str(), text.length());
+  return decoded;
+}
+
+void AsyncWebServerRequest::_urlDecode(String& decoded, const char* text, size_t len){
+  char temp[] = "0x00";
+  size_t i = 0;
+  decoded = String();
   decoded.reserve(len); // Allocate the string internal buffer - never longer from source text
   while (i < len){
     char decodedChar;
-    char encodedChar = text.charAt(i++);
+    char encodedChar = text[i++];
     if ((encodedChar == '%') && (i + 1 < len)){
-      temp[2] = text.charAt(i++);
-      temp[3] = text.charAt(i++);
+      temp[2] = text[i++];
+      temp[3] = text[i++];
       decodedChar = strtol(temp, NULL, 16);
     } else if (encodedChar == '+') {
       decodedChar = ' ';
@@ -962,7 +1082,6 @@ String AsyncWebServerRequest::urlDecode(const String& text) const {
     }
     decoded.concat(decodedChar);
   }
-  return decoded;
 }
 
 
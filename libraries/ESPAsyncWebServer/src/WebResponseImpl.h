@@ -47,6 +47,10 @@ class AsyncAbstractResponse: public AsyncWebServerResponse {
     // we won't be able to access it as contiguous array of bytes when reading from it,
     // so by gaining performance in one place, we'll lose it in another.
     std::vector<uint8_t> _cache;
+    // Bytes add() did not take, they were read from the content already and go out first
+    std::vector<uint8_t> _unsent;
+    size_t _unsentContent; // content bytes of the chunk in _unsent
+    bool _unsentLast;      // _unsent ends the content
     size_t _readDataFromCacheOrContent(uint8_t* data, const size_t len);
     size_t _fillBufferAndProcessTemplates(uint8_t* buf, size_t maxLen);
   protected:
@@ -57,8 +61,28 @@ class AsyncAbstractResponse: public AsyncWebServerResponse {
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
     bool _sourceValid() const { return false; }
     virtual size_t _fillBuffer(uint8_t *buf __attribute__((unused)), size_t maxLen __attribute__((unused))) { return 0; }
+    // Whole content if it is addressable memory that outlives the connection, see _ack()
+    virtual const uint8_t* _mappedContent() const { return NULL; }
 };
 
+// Size and number of the send buffers shared by all responses, see _ack()
+#ifndef WEB_RESPONSE_BUFFER_SIZE
+#define WEB_RESPONSE_BUFFER_SIZE 1460
+#endif
+#ifndef WEB_RESPONSE_BUFFER_POOL
+#define WEB_RESPONSE_BUFFER_POOL 2
+#endif
+
+// Hand memory-mapped content (PROGMEM, mapped partitions) to the TCP stack by reference.
+// Only ESP32 maps flash into the data address space, ESP8266 PROGMEM needs aligned reads.
+#ifndef WEB_RESPONSE_ZERO_COPY
+#ifdef ESP32
+#define WEB_RESPONSE_ZERO_COPY 1
+#else
+#define WEB_RESPONSE_ZERO_COPY 0
+#endif
+#endif
+
 #ifndef TEMPLATE_PLACEHOLDER
 #define TEMPLATE_PLACEHOLDER '%'
 #endif
@@ -116,6 +140,7 @@ class AsyncProgmemResponse: public AsyncAbstractResponse {
     AsyncProgmemResponse(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     bool _sourceValid() const { return true; }
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+    virtual const uint8_t* _mappedContent() const override;
 };
 
 class cbuf;
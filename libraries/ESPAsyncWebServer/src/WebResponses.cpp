@@ -21,6 +21,9 @@
 #include "ESPAsyncWebServer.h"
 #include "WebResponseImpl.h"
 #include "cbuf.h"
+#if WEB_RESPONSE_ZERO_COPY
+#include "soc/soc.h"
+#endif
 
 // Since ESP8266 does not link memchr by default, here's its implementation.
 void* memchr(void* ptr, int ch, size_t count)
@@ -72,6 +75,7 @@ const char* AsyncWebServerResponse::_responseCodeToString(int code) {
     case 415: return "Unsupported Media Type";
     case 416: return "Requested range not satisfiable";
     case 417: return "Expectation Failed";
+    case 431: return "Request Header Fields Too Large";
     case 500: return "Internal Server Error";
     case 501: return "Not Implemented";
     case 502: return "Bad Gateway";
@@ -243,7 +247,7 @@ size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint
  * Abstract Response
  * */
 
-AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _callback(callback)
+AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _unsentContent(0), _unsentLast(false), _callback(callback)
 {
   // In case of template processing, we're unable to determine real response size
   if(callback) {
@@ -260,6 +264,62 @@ void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request){
   _ack(request, 0, 0);
 }
 
+/*
+ * Send buffers are allocated once and handed from one _ack() to the next,
+ * instead of a malloc()/free() of up to a whole send window per packet.
+ * Writes copy into the TCP stack, so a buffer is free again as soon as _ack() returns.
+ * */
+
+static uint8_t* _sendBuffers[WEB_RESPONSE_BUFFER_POOL];
+static bool _sendBufferBusy[WEB_RESPONSE_BUFFER_POOL];
+
+#ifdef ESP32
+static portMUX_TYPE _sendBufferMux = portMUX_INITIALIZER_UNLOCKED;
+#define SEND_BUFFER_LOCK()   portENTER_CRITICAL(&_sendBufferMux)
+#define SEND_BUFFER_UNLOCK() portEXIT_CRITICAL(&_sendBufferMux)
+#else
+#define SEND_BUFFER_LOCK()
+#define SEND_BUFFER_UNLOCK()
+#endif
+
+static uint8_t* _acquireSendBuffer(){
+  int slot = -1;
+  SEND_BUFFER_LOCK();
+  for(int i = 0; i < WEB_RESPONSE_BUFFER_POOL; i++){
+    if(!_sendBufferBusy[i]){
+      _sendBufferBusy[i] = true;
+      slot = i;
+      break;
+    }
+  }
+  SEND_BUFFER_UNLOCK();
+  if(slot < 0){
+    // Pool exhausted, fall back to a one-off buffer
+    return (uint8_t*)malloc(WEB_RESPONSE_BUFFER_SIZE);
+  }
+  if(_sendBuffers[slot] == NULL){
+    _sendBuffers[slot] = (uint8_t*)malloc(WEB_RESPONSE_BUFFER_SIZE);
+    if(_sendBuffers[slot] == NULL)
+      _sendBufferBusy[slot] = false;
+  }
+  return _sendBuffers[slot];
+}
+
+static void _releaseSendBuffer(uint8_t* buf){
+  bool pooled = false;
+  SEND_BUFFER_LOCK();
+  for(int i = 0; i < WEB_RESPONSE_BUFFER_POOL; i++){
+    if(_sendBuffers[i] == buf){
+      _sendBufferBusy[i] = false;
+      pooled = true;
+      break;
+    }
+  }
+  SEND_BUFFER_UNLOCK();
+  if(!pooled)
+    free(buf);
+}
+
 size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time){
   if(!_sourceValid()){
     _state = RESPONSE_FAILED;
@@ -267,90 +327,147 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     return 0;
   }
   _ackedLength += len;
-  size_t space = request->client()->space();
+  AsyncClient* client = request->client();
+  size_t space = client->space();
+  size_t written = 0;
 
-  size_t headLen = _head.length();
   if(_state == RESPONSE_HEADERS){
-    if(space >= headLen){
-      _state = RESPONSE_CONTENT;
-      space -= headLen;
-    } else {
-      String out = _head.substring(0, space);
-      _head = _head.substring(space);
-      _writtenLength += request->client()->write(out.c_str(), out.length());
-      return out.length();
+    size_t headLen = _head.length();
+    if(space < headLen){
+      // Send what fits, the rest goes out on the next ack
+      size_t sent = client->write(_head.c_str(), space);
+      _head.remove(0, sent);
+      _writtenLength += sent;
+      return sent;
+    }
+    // Queued without sending, the stack merges it with the first content bytes
+    written = client->add(_head.c_str(), headLen);
+    _writtenLength += written;
+    space -= written;
+    if(written < headLen){
+      _head.remove(0, written);
+      if(written) client->send();
+      return written;
     }
+    _head = String();
+    _state = RESPONSE_CONTENT;
   }
 
-  if(_state == RESPONSE_CONTENT){
-    size_t outLen;
-    if(_chunked){
-      if(space <= 8){
-        return 0;
-      }
-      outLen = space;
-    } else if(!_sendContentLength){
+  if(_state == RESPONSE_CONTENT && !_unsent.empty()){
+    size_t added = client->add((const char*)_unsent.data(), _unsent.size());
+    _writtenLength += added;
+    written += added;
+    space -= added;
+    _unsent.erase(_unsent.begin(), _unsent.begin() + added);
+    if(!_chunked)
+      _sentLength += added;
+    if(!_unsent.empty()){
+      if(written) client->send();
+      return written;
+    }
+    std::vector<uint8_t>().swap(_unsent);
+    if(_chunked)
+      _sentLength += _unsentContent;
+    if(_unsentLast)
+      _state = RESPONSE_WAIT_ACK;
+  }
+
+#if WEB_RESPONSE_ZERO_COPY
+  const uint8_t* mapped = (_state == RESPONSE_CONTENT && !_chunked && !_callback) ? _mappedContent() : NULL;
+  if(mapped){
+    // The stack keeps a reference instead of a copy, so no send buffer is needed at all
+    size_t outLen = _contentLength - _sentLength;
+    if(outLen > space)
       outLen = space;
-    } else {
-      outLen = ((_contentLength - _sentLength) > space)?space:(_contentLength - _sentLength);
+    if(outLen){
+      size_t added = client->add((const char*)mapped + _sentLength, outLen, 0);
+      _sentLength += added;
+      _writtenLength += added;
+      written += added;
     }
+    if(_sentLength == _contentLength)
+      _state = RESPONSE_WAIT_ACK;
+    if(written)
+      client->send();
+    return written;
+  }
+#endif
 
-    uint8_t *buf = (uint8_t *)malloc(outLen+headLen);
+  if(_state == RESPONSE_CONTENT){
+    uint8_t *buf = _acquireSendBuffer();
     if (!buf) {
-      // os_printf("_ack malloc %d failed\n", outLen+headLen);
-      return 0;
+      // os_printf("_ack buffer %d failed\n", WEB_RESPONSE_BUFFER_SIZE);
+      if(written) client->send();
+      return written;
     }
 
-    if(headLen){
-      memcpy(buf, _head.c_str(), _head.length());
-    }
+    // Fill the send window one buffer at a time
+    while(_state == RESPONSE_CONTENT){
+      size_t outLen = (space > WEB_RESPONSE_BUFFER_SIZE) ? WEB_RESPONSE_BUFFER_SIZE : space;
+      if(_chunked){
+        if(outLen <= 8){
+          break;
+        }
+      } else if(_sendContentLength){
+        if((_contentLength - _sentLength) < outLen)
+          outLen = _contentLength - _sentLength;
+        if(!outLen && _sentLength < _contentLength)
+          break;
+      } else if(!outLen){
+        break;
+      }
 
-    size_t readLen = 0;
+      size_t readLen = 0;
+      size_t sendLen = 0;
 
-    if(_chunked){
-      // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
-      // See RFC2616 sections 2, 3.6.1.
-      readLen = _fillBufferAndProcessTemplates(buf+headLen+6, outLen - 8);
-      if(readLen == RESPONSE_TRY_AGAIN){
-          free(buf);
-          return 0;
+      if(_chunked){
+        // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
+        // See RFC2616 sections 2, 3.6.1.
+        readLen = _fillBufferAndProcessTemplates(buf+6, outLen - 8);
+        if(readLen == RESPONSE_TRY_AGAIN){
+          break;
+        }
+        sendLen = sprintf((char*)buf, "%x", (unsigned int)readLen);
+        while(sendLen < 4) buf[sendLen++] = ' ';
+        buf[sendLen++] = '\r';
+        buf[sendLen++] = '\n';
+        sendLen += readLen;
+        buf[sendLen++] = '\r';
+        buf[sendLen++] = '\n';
+      } else {
+        readLen = _fillBufferAndProcessTemplates(buf, outLen);
+        if(readLen == RESPONSE_TRY_AGAIN){
+          break;
+        }
+        sendLen = readLen;
       }
-      outLen = sprintf((char*)buf+headLen, "%x", readLen) + headLen;
-      while(outLen < headLen + 4) buf[outLen++] = ' ';
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
-      outLen += readLen;
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
-    } else {
-      readLen = _fillBufferAndProcessTemplates(buf+headLen, outLen);
-      if(readLen == RESPONSE_TRY_AGAIN){
-          free(buf);
-          return 0;
+      bool last = (_chunked && readLen == 0) || (!_sendContentLength && readLen == 0) || (!_chunked && _sentLength + readLen == _contentLength);
+
+      size_t added = 0;
+      if(sendLen){
+        added = client->add((const char*)buf, sendLen);
+        _writtenLength += added;
+        written += added;
+        space -= added;
       }
-      outLen = readLen + headLen;
-    }
-
-    if(headLen){
-        _head = String();
-    }
-
-    if(outLen){
-        _writtenLength += request->client()->write((const char*)buf, outLen);
-    }
-
-    if(_chunked){
-        _sentLength += readLen;
-    } else {
-        _sentLength += outLen - headLen;
+      if(added < sendLen){
+        // The content can not be read again, keep the rest for the next ack
+        _unsent.assign(buf + added, buf + sendLen);
+        _unsentContent = readLen;
+        _unsentLast = last;
+        if(!_chunked)
+          _sentLength += added;
+        break;
+      }
+      _sentLength += readLen;
+      if(last)
+        _state = RESPONSE_WAIT_ACK;
     }
 
-    free(buf);
-
-    if((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0) || (!_chunked && _sentLength == _contentLength)){
-      _state = RESPONSE_WAIT_ACK;
-    }
-    return outLen;
+    _releaseSendBuffer(buf);
+    if(written)
+      client->send();
+    return written;
 
   } else if(_state == RESPONSE_WAIT_ACK){
     if(!_sendContentLength || _ackedLength >= _writtenLength){
@@ -544,6 +661,11 @@ AsyncFileResponse::AsyncFileResponse(File content, const String& path, const Str
     _callback = nullptr; // Unable to process gzipped templates
     _sendContentLength = true;
     _chunked = false;
+  } else if(!download && String(content.name()).endsWith(".br") && !path.endsWith(".br")){
+    addHeader("Content-Encoding", "br");
+    _callback = nullptr; // Unable to process compressed templates
+    _sendContentLength = true;
+    _chunked = false;
   }
 
   _content = content;
@@ -658,6 +780,16 @@ size_t AsyncProgmemResponse::_fillBuffer(uint8_t *data, size_t len){
   return left;
 }
 
+const uint8_t* AsyncProgmemResponse::_mappedContent() const {
+#if WEB_RESPONSE_ZERO_COPY
+  // Only flash stays put until the peer acks it, RAM passed to send_P() may not
+  uintptr_t start = (uintptr_t)_content;
+  if(start >= SOC_DROM_LOW && start < SOC_DROM_HIGH && _contentLength <= SOC_DROM_HIGH - start)
+    return _content;
+#endif
+  return NULL;
+}
+
 
 /*
  * Response Stream (You can print/write/printf to it, up to the contentLen bytes)
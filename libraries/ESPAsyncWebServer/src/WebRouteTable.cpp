@@ -0,0 +1,232 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "ESPAsyncWebServer.h"
+#include "WebRouteTable.h"
+
+#define WEB_ROUTE_EMPTY 0xFFFF
+
+// Entry kinds, a bitmask so one probe can look for several
+#define ROUTE_HANDLER_EXACT  0x01
+#define ROUTE_HANDLER_PREFIX 0x02
+#define ROUTE_REWRITE        0x04
+
+#define FNV_OFFSET 0x811c9dc5
+#define FNV_PRIME  0x01000193
+
+static uint32_t _routeHash(const char * str, size_t len){
+  uint32_t hash = FNV_OFFSET;
+  while(len--){
+    hash ^= (uint8_t)*str++;
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+AsyncWebRouteTable::AsyncWebRouteTable()
+  : _handlers(NULL)
+  , _rewrites(NULL)
+  , _handlerCount(0)
+  , _rewriteCount(0)
+  , _entries(NULL)
+  , _entryCount(0)
+  , _slots(NULL)
+  , _slotMask(0)
+  , _wildcards(NULL)
+  , _wildcardCount(0)
+  , _candidates(NULL)
+  , _candidateCount(0)
+  , _keys(NULL)
+  , _valid(false)
+{}
+
+AsyncWebRouteTable::~AsyncWebRouteTable(){
+  _free();
+}
+
+void AsyncWebRouteTable::_free(){
+  free(_handlers);
+  free(_rewrites);
+  free(_entries);
+  free(_slots);
+  free(_wildcards);
+  free(_candidates);
+  free(_keys);
+  _handlers = NULL;
+  _rewrites = NULL;
+  _entries = NULL;
+  _slots = NULL;
+  _wildcards = NULL;
+  _candidates = NULL;
+  _keys = NULL;
+  _handlerCount = _rewriteCount = _entryCount = _wildcardCount = _candidateCount = 0;
+  _slotMask = 0;
+  _valid = false;
+}
+
+void AsyncWebRouteTable::_addEntry(uint8_t kind, uint16_t index, const String& key, size_t* keyOffset){
+  route_entry_t* e = &_entries[_entryCount];
+  e->kind = kind;
+  e->index = index;
+  e->length = key.length();
+  e->hash = _routeHash(key.c_str(), e->length);
+  e->key = _keys + *keyOffset;
+  memcpy(_keys + *keyOffset, key.c_str(), e->length + 1);
+  *keyOffset += e->length + 1;
+
+  uint16_t slot = e->hash & _slotMask;
+  while(_slots[slot] != WEB_ROUTE_EMPTY)
+    slot = (slot + 1) & _slotMask;
+  _slots[slot] = _entryCount++;
+}
+
+bool AsyncWebRouteTable::build(const LinkedList<AsyncWebHandler*>& handlers, const LinkedList<AsyncWebRewrite*>& rewrites){
+  _free();
+
+  // First pass: size everything so the table is a handful of allocations
+  size_t handlerCount = handlers.length();
+  size_t rewriteCount = rewrites.length();
+  size_t entryCount = rewriteCount;
+  size_t keysSize = 0;
+  String uri;
+  for(const auto& h: handlers){
+    uri = String();
+    WebRouteKind kind = h->route(uri);
+    if(kind == WEB_ROUTE_PATH){
+      entryCount += 2;
+      keysSize += 2 * (uri.length() + 1) + 1;
+    } else if(kind != WEB_ROUTE_ANY){
+      entryCount++;
+      keysSize += uri.length() + 1;
+    }
+  }
+  for(const auto& r: rewrites)
+    keysSize += r->from().length() + 1;
+  if(handlerCount >= WEB_ROUTE_EMPTY || rewriteCount >= WEB_ROUTE_EMPTY || entryCount >= WEB_ROUTE_EMPTY / 2)
+    return false;
+
+  size_t slots = 8;
+  while(slots < entryCount * 2)
+    slots <<= 1;
+
+  _handlers = (AsyncWebHandler**)malloc((handlerCount + 1) * sizeof(AsyncWebHandler*));
+  _rewrites = (AsyncWebRewrite**)malloc((rewriteCount + 1) * sizeof(AsyncWebRewrite*));
+  _entries = (route_entry_t*)malloc((entryCount + 1) * sizeof(route_entry_t));
+  _slots = (uint16_t*)malloc(slots * sizeof(uint16_t));
+  _wildcards = (uint16_t*)malloc((handlerCount + 1) * sizeof(uint16_t));
+  _candidates = (uint16_t*)malloc((handlerCount + rewriteCount + 1) * sizeof(uint16_t));
+  _keys = (char*)malloc(keysSize + 1);
+  if(!_handlers || !_rewrites || !_entries || !_slots || !_wildcards || !_candidates || !_keys){
+    _free();
+    return false;
+  }
+  memset(_slots, 0xFF, slots * sizeof(uint16_t));
+  _slotMask = slots - 1;
+
+  // Second pass: fill it in registration order
+  size_t keyOffset = 0;
+  for(const auto& h: handlers){
+    _handlers[_handlerCount] = h;
+    uri = String();
+    WebRouteKind kind = h->route(uri);
+    if(kind == WEB_ROUTE_EXACT){
+      _addEntry(ROUTE_HANDLER_EXACT, _handlerCount, uri, &keyOffset);
+    } else if(kind == WEB_ROUTE_PREFIX){
+      _addEntry(ROUTE_HANDLER_PREFIX, _handlerCount, uri, &keyOffset);
+    } else if(kind == WEB_ROUTE_PATH){
+      // The url itself or anything below it
+      _addEntry(ROUTE_HANDLER_EXACT, _handlerCount, uri, &keyOffset);
+      _addEntry(ROUTE_HANDLER_PREFIX, _handlerCount, uri + "/", &keyOffset);
+    } else {
+      _wildcards[_wildcardCount++] = _handlerCount;
+    }
+    _handlerCount++;
+  }
+  for(const auto& r: rewrites){
+    _rewrites[_rewriteCount] = r;
+    _addEntry(ROUTE_REWRITE, _rewriteCount, r->from(), &keyOffset);
+    _rewriteCount++;
+  }
+  _valid = true;
+  return true;
+}
+
+void AsyncWebRouteTable::_addCandidate(uint16_t index){
+  // Keep the candidates sorted, there are only ever a few
+  uint16_t i = _candidateCount++;
+  while(i > 0 && _candidates[i-1] > index){
+    _candidates[i] = _candidates[i-1];
+    i--;
+  }
+  _candidates[i] = index;
+}
+
+void AsyncWebRouteTable::_collect(const String& url, uint8_t kinds, uint16_t from){
+  const char* str = url.c_str();
+  size_t len = url.length();
+  uint32_t hash = FNV_OFFSET;
+  // Every prefix of the url is probed, the hash of each one is one step away from the previous
+  for(size_t l = 0; l <= len; l++){
+    if(l > 0){
+      hash ^= (uint8_t)str[l-1];
+      hash *= FNV_PRIME;
+    }
+    uint8_t wanted = kinds & ((l == len) ? 0xFF : ROUTE_HANDLER_PREFIX);
+    if(!wanted)
+      continue;
+    for(uint16_t slot = hash & _slotMask; _slots[slot] != WEB_ROUTE_EMPTY; slot = (slot + 1) & _slotMask){
+      const route_entry_t* e = &_entries[_slots[slot]];
+      if(e->hash == hash && (e->kind & wanted) && e->index >= from && e->length == l && memcmp(e->key, str, l) == 0)
+        _addCandidate(e->index);
+    }
+  }
+}
+
+AsyncWebHandler* AsyncWebRouteTable::attach(AsyncWebServerRequest *request){
+  _candidateCount = 0;
+  for(uint16_t i = 0; i < _wildcardCount; i++)
+    _addCandidate(_wildcards[i]);
+  _collect(request->url(), ROUTE_HANDLER_EXACT | ROUTE_HANDLER_PREFIX, 0);
+
+  uint16_t previous = WEB_ROUTE_EMPTY;
+  for(uint16_t i = 0; i < _candidateCount; i++){
+    uint16_t index = _candidates[i];
+    if(index == previous)
+      continue;
+    previous = index;
+    AsyncWebHandler* h = _handlers[index];
+    if(h->filter(request) && h->canHandle(request))
+      return h;
+  }
+  return NULL;
+}
+
+AsyncWebRewrite* AsyncWebRouteTable::rewrite(AsyncWebServerRequest *request, uint16_t* from){
+  _candidateCount = 0;
+  _collect(request->url(), ROUTE_REWRITE, *from);
+  for(uint16_t i = 0; i < _candidateCount; i++){
+    AsyncWebRewrite* r = _rewrites[_candidates[i]];
+    if(r->filter(request)){
+      *from = _candidates[i] + 1;
+      return r;
+    }
+  }
+  return NULL;
+}
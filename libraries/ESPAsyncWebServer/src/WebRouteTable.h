@@ -0,0 +1,81 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBSERVERROUTETABLE_H_
+#define ASYNCWEBSERVERROUTETABLE_H_
+
+/*
+ * ROUTES :: Hashed index of the handlers and rewrites, compiled by AsyncWebServer::begin()
+ *
+ * Every handler reports the urls it could possibly accept through AsyncWebHandler::route().
+ * Exact urls and url prefixes go into one open addressing table keyed by FNV-1a, which is
+ * incremental, so all prefixes of a request url are probed in a single pass over it.
+ * Handlers that can not tell (WEB_ROUTE_ANY) are candidates for every request.
+ * Candidates are still checked with filter() and canHandle() in registration order,
+ * so the first matching handler wins exactly like with the linear walk.
+ * A lookup collects its candidates in a scratch buffer of the table, AsyncWebServer holds
+ * its route lock around build() and every lookup.
+ * */
+
+class AsyncWebRouteTable {
+  private:
+    typedef struct {
+      uint32_t hash;
+      uint16_t index;  // position in the handler or rewrite list
+      uint16_t length; // length of the key
+      uint8_t kind;    // WEB_ROUTE_EXACT / WEB_ROUTE_PREFIX / rewrite
+      const char* key; // NUL terminated, inside _keys
+    } route_entry_t;
+
+    AsyncWebHandler** _handlers;
+    AsyncWebRewrite** _rewrites;
+    uint16_t _handlerCount;
+    uint16_t _rewriteCount;
+    route_entry_t* _entries;
+    uint16_t _entryCount;
+    uint16_t* _slots;       // open addressing, entry index or WEB_ROUTE_EMPTY
+    uint16_t _slotMask;
+    uint16_t* _wildcards;   // handlers routed as WEB_ROUTE_ANY, in order
+    uint16_t _wildcardCount;
+    uint16_t* _candidates;  // scratch for one lookup
+    uint16_t _candidateCount;
+    char* _keys;
+    bool _valid;
+
+    void _free();
+    void _addEntry(uint8_t kind, uint16_t index, const String& key, size_t* keyOffset);
+    void _addCandidate(uint16_t index);
+    void _collect(const String& url, uint8_t kinds, uint16_t from);
+
+  public:
+    AsyncWebRouteTable();
+    ~AsyncWebRouteTable();
+
+    bool build(const LinkedList<AsyncWebHandler*>& handlers, const LinkedList<AsyncWebRewrite*>& rewrites);
+    void invalidate(){ _valid = false; }
+    bool valid() const { return _valid; }
+
+    // First handler accepting the request, NULL if none does
+    AsyncWebHandler* attach(AsyncWebServerRequest *request);
+    // Next rewrite at or after *from that applies to the request url, *from is moved past it
+    AsyncWebRewrite* rewrite(AsyncWebServerRequest *request, uint16_t* from);
+};
+
+#endif /* ASYNCWEBSERVERROUTETABLE_H_ */
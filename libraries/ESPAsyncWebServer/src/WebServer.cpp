@@ -20,6 +20,7 @@
 */
 #include "ESPAsyncWebServer.h"
 #include "WebHandlerImpl.h"
+#include "WebRouteTable.h"
 
 bool ON_STA_FILTER(AsyncWebServerRequest *request) {
   return WiFi.localIP() == request->client()->localIP();
@@ -34,6 +35,7 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
   : _server(port)
   , _rewrites(LinkedList<AsyncWebRewrite*>([](AsyncWebRewrite* r){ delete r; }))
   , _handlers(LinkedList<AsyncWebHandler*>([](AsyncWebHandler* h){ delete h; }))
+  , _routes(NULL)
 {
   _catchAllHandler = new AsyncCallbackWebHandler();
   if(_catchAllHandler == NULL)
@@ -54,14 +56,19 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
 AsyncWebServer::~AsyncWebServer(){
   reset();
   delete _catchAllHandler;
+  delete _routes;
 }
 
 AsyncWebRewrite& AsyncWebServer::addRewrite(AsyncWebRewrite* rewrite){
+  AsyncWebLockGuard l(_routeLock);
   _rewrites.add(rewrite);
+  if(_routes) _routes->invalidate();
   return *rewrite;
 }
 
 bool AsyncWebServer::removeRewrite(AsyncWebRewrite *rewrite){
+  AsyncWebLockGuard l(_routeLock);
+  if(_routes) _routes->invalidate();
   return _rewrites.remove(rewrite);
 }
 
@@ -70,19 +77,38 @@ AsyncWebRewrite& AsyncWebServer::rewrite(const char* from, const char* to){
 }
 
 AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler){
+  AsyncWebLockGuard l(_routeLock);
   _handlers.add(handler);
+  if(_routes) _routes->invalidate();
   return *handler;
 }
 
 bool AsyncWebServer::removeHandler(AsyncWebHandler *handler){
+  AsyncWebLockGuard l(_routeLock);
+  if(_routes) _routes->invalidate();
   return _handlers.remove(handler);
 }
 
 void AsyncWebServer::begin(){
+#if WEB_ROUTE_TABLE
+  _routeLock.lock();
+  if(_routes == NULL)
+    _routes = new AsyncWebRouteTable();
+  if(_routes != NULL)
+    _routes->build(_handlers, _rewrites);
+  _routeLock.unlock();
+#endif
   _server.setNoDelay(true);
   _server.begin();
 }
 
+bool AsyncWebServer::_routesReady(){
+  // Handlers or rewrites changed after begin(), compile again on first use
+  if(_routes == NULL)
+    return false;
+  return _routes->valid() || _routes->build(_handlers, _rewrites);
+}
+
 #if ASYNC_TCP_SSL_ENABLED
 void AsyncWebServer::onSslFileRequest(AcSSlFileHandler cb, void* arg){
   _server.onSslFileRequest(cb, arg);
@@ -98,6 +124,16 @@ void AsyncWebServer::_handleDisconnect(AsyncWebServerRequest *request){
 }
 
 void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request){
+  AsyncWebLockGuard l(_routeLock);
+  if(_routesReady()){
+    uint16_t next = 0;
+    AsyncWebRewrite* r;
+    while((r = _routes->rewrite(request, &next)) != NULL){
+      request->_url = r->toUrl();
+      request->_addGetParams(r->params());
+    }
+    return;
+  }
   for(const auto& r: _rewrites){
     if (r->from() == request->_url && r->filter(request)){
       request->_url = r->toUrl();
@@ -107,11 +143,20 @@ void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request){
 }
 
 void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request){
-  for(const auto& h: _handlers){
-    if (h->filter(request) && h->canHandle(request)){
+  AsyncWebLockGuard l(_routeLock);
+  if(_routesReady()){
+    AsyncWebHandler* h = _routes->attach(request);
+    if(h != NULL){
       request->setHandler(h);
       return;
     }
+  } else {
+    for(const auto& h: _handlers){
+      if (h->filter(request) && h->canHandle(request)){
+        request->setHandler(h);
+        return;
+      }
+    }
   }
   
   request->addInterestingHeader("ANY");
@@ -176,8 +221,10 @@ void AsyncWebServer::onRequestBody(ArBodyHandlerFunction fn){
 }
 
 void AsyncWebServer::reset(){
+  AsyncWebLockGuard l(_routeLock);
   _rewrites.free();
   _handlers.free();
+  if(_routes) _routes->invalidate();
   
   if (_catchAllHandler != NULL){
     _catchAllHandler->onRequest(NULL);